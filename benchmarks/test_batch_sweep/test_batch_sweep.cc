@@ -0,0 +1,21 @@
+#include <iostream>
+#include "common.h"
+#include "dnnmark.h"
+#include "batch_sweep.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark(32);
+  dnnmark.ParseAllConfig(FLAGS_config);
+  dnnmark.Initialize();
+  BatchSweep<TestType> batch_sweep(&dnnmark);
+  batch_sweep.Run();
+  batch_sweep.Report();
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <iomanip>
+#include "common.h"
+#include "dnnmark.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+// A plain convolutional network of the given depth and base width built
+// without a config file
+void BuildVariant(DNNMark<TestType> *dnnmark, int num_blocks, int width) {
+  ConvolutionParam conv;
+  conv.kernel_size_h_ = conv.kernel_size_w_ = 3;
+  conv.pad_h_ = conv.pad_w_ = 1;
+  PoolingParam pool;
+  pool.kernel_size_h_ = pool.kernel_size_w_ = 2;
+  pool.stride_h_ = pool.stride_w_ = 2;
+  BatchNormParam bn;
+  bn.mode_ = CUDNN_BATCHNORM_SPATIAL;
+
+  std::string prev = "null";
+  for (int i = 0; i < num_blocks; i++) {
+    std::string block = std::to_string(i + 1);
+    conv.output_num_ = width << i;
+    dnnmark->AddConvolution("conv" + block, prev, conv,
+                            i == 0 ? DataDim(64, 3, 224, 224) : DataDim())
+            .AddBatchNorm("bn" + block, "conv" + block, bn)
+            .AddActivation("relu" + block, "bn" + block, ActivationParam())
+            .AddPooling("pool" + block, "relu" + block, pool);
+    prev = "pool" + block;
+  }
+  FullyConnectedParam fc;
+  fc.output_num_ = 1000;
+  dnnmark->AddFullyConnected("fc", prev, fc)
+          .AddSoftmax("softmax", "fc", SoftmaxParam());
+}
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark(32);
+  dnnmark.ParseGeneralConfig(FLAGS_config);
+  dnnmark.Set("run_mode", "composed");
+
+  // Every variant is built, set up and timed in process
+  const int kIterations = 10;
+  for (int num_blocks = 2; num_blocks <= 5; num_blocks++) {
+    for (int width = 16; width <= 64; width *= 2) {
+      dnnmark.setDataFillEnabled(true);
+      dnnmark.ClearLayers();
+      BuildVariant(&dnnmark, num_blocks, width);
+      dnnmark.Initialize();
+
+      // Warm up, then time training steps
+      dnnmark.Forward();
+      dnnmark.Backward();
+      dnnmark.setDataFillEnabled(false);
+      Timer timer;
+      timer.Start();
+      for (int i = 0; i < kIterations; i++) {
+        dnnmark.Forward();
+        dnnmark.Backward();
+      }
+      timer.Stop();
+      std::cout << std::fixed << std::setprecision(3)
+                << "[Builder] blocks=" << num_blocks << " width=" << width
+                << " layers=" << dnnmark.getNumLayers() << ": "
+                << timer.Elapsed() / kIterations << " ms per step"
+                << std::defaultfloat << std::endl;
+    }
+  }
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
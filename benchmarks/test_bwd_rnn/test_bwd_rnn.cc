@@ -0,0 +1,21 @@
+#include <iostream>
+#include "common.h"
+#include "dnnmark.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark;
+  dnnmark.ParseGeneralConfig(FLAGS_config);
+  dnnmark.ParseLayerConfig(FLAGS_config);
+  dnnmark.Initialize();
+  // Backward propagates through the gate activations of a forward pass
+  dnnmark.Forward();
+  dnnmark.Backward();
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
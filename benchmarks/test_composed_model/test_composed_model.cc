@@ -1,6 +1,7 @@
 #include <iostream>
 #include "common.h"
 #include "dnnmark.h"
+#include "dry_run.h"
 #include "usage.h"
 
 using namespace dnnmark;
@@ -9,6 +10,15 @@ int main(int argc, char **argv) {
   INIT_FLAGS(argc, argv);
   INIT_LOG(argv);
   LOG(INFO) << "DNNMark suites: Start...";
+  if (FLAGS_dry_run) {
+    // No handles and no device memory are needed
+    DNNMark<TestType> dnnmark(0);
+    dnnmark.ParseAllConfig(FLAGS_config);
+    DryRun<TestType> dry_run(&dnnmark);
+    dry_run.Run();
+    dry_run.Report();
+    return 0;
+  }
   DNNMark<TestType> dnnmark(3);
   dnnmark.ParseAllConfig(FLAGS_config);
   dnnmark.Initialize();
@@ -0,0 +1,31 @@
+#include <iostream>
+#include "common.h"
+#include "dnnmark.h"
+#include "data_parallel.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  int max_replicas = 1;
+  {
+    DNNMark<TestType> dnnmark;
+    dnnmark.ParseGeneralConfig(FLAGS_config);
+    max_replicas = dnnmark.getNumReplicas();
+  }
+  // Sweep the number of replicas, scaling is relative to a single replica
+  float baseline = 0;
+  for (int r = 1; r <= max_replicas; r++) {
+    DataParallel<TestType> data_parallel(FLAGS_config, r);
+    data_parallel.Setup();
+    data_parallel.Run();
+    if (r == 1)
+      baseline = data_parallel.getStepTime();
+    data_parallel.Report(baseline);
+  }
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <iomanip>
+#include "common.h"
+#include "dnnmark.h"
+#include "checksum.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark(32);
+  dnnmark.ParseGeneralConfig(FLAGS_config);
+
+  // The same model without and with deterministic mode
+  const int kIterations = 10;
+  float step_time[2];
+  int mismatches[2];
+  int num_tensors = 0;
+  int batch_size = 0;
+  for (int deterministic = 0; deterministic < 2; deterministic++) {
+    dnnmark.setDeterministic(deterministic);
+    dnnmark.setDataFillEnabled(true);
+    dnnmark.ClearLayers();
+    dnnmark.ParseLayerConfig(FLAGS_config);
+    dnnmark.Initialize();
+    batch_size = dnnmark.GetLayerByID(0)->getInputDim()->n_;
+
+    // Warm up, then time full steps on fixed input
+    dnnmark.RunAll();
+    dnnmark.setDataFillEnabled(false);
+    Timer timer;
+    timer.Start();
+    for (int i = 0; i < kIterations; i++)
+      dnnmark.RunAll();
+    timer.Stop();
+    step_time[deterministic] = timer.Elapsed() / kIterations;
+
+    // Two passes over the same input and weights have to agree
+    Checksum<TestType> first(&dnnmark), second(&dnnmark);
+    dnnmark.Forward();
+    dnnmark.Backward();
+    first.Compute();
+    dnnmark.Forward();
+    dnnmark.Backward();
+    second.Compute();
+    mismatches[deterministic] = first.CountMismatches(second);
+    num_tensors = first.getNumTensors();
+    if (deterministic)
+      first.Report();
+  }
+
+  const char *names[] = {"non-deterministic", "deterministic"};
+  for (int i = 0; i < 2; i++)
+    std::cout << std::fixed << std::setprecision(3)
+              << "[Deterministic] " << names[i] << ": "
+              << step_time[i] << " ms per step, "
+              << batch_size / step_time[i] * 1000 << " samples/s, "
+              << mismatches[i] << " of " << num_tensors
+              << " checksums differ between passes"
+              << std::defaultfloat << std::endl;
+  std::cout << std::fixed << std::setprecision(2)
+            << "[Deterministic] Throughput cost: "
+            << (step_time[1] / step_time[0] - 1) * 100 << "%"
+            << std::defaultfloat << std::endl;
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
@@ -0,0 +1,33 @@
+#include <iostream>
+#include <iomanip>
+#include "common.h"
+#include "dnnmark.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark(32);
+  dnnmark.ParseAllConfig(FLAGS_config);
+  dnnmark.Initialize();
+
+  // Every step consumes a batch the workers prepared meanwhile
+  const int kIterations = 50;
+  dnnmark.RunAll();
+  Timer timer;
+  timer.Start();
+  for (int i = 0; i < kIterations; i++)
+    dnnmark.RunAll();
+  timer.Stop();
+
+  std::cout << std::fixed << std::setprecision(3)
+            << "[InputPipeline] step: " << timer.Elapsed() / kIterations
+            << " ms" << std::defaultfloat << std::endl;
+  for (auto &pipeline : dnnmark.getInputPipelines())
+    pipeline->Report();
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
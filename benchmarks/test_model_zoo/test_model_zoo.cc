@@ -0,0 +1,62 @@
+#include <iostream>
+#include <iomanip>
+#include "common.h"
+#include "dnnmark.h"
+#include "dry_run.h"
+#include "model_zoo.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  if (FLAGS_dry_run) {
+    // No handles and no device memory are needed
+    DNNMark<TestType> dnnmark(0);
+    dnnmark.ParseGeneralConfig(FLAGS_config);
+    ModelZoo<TestType> model_zoo(&dnnmark);
+    model_zoo.Build(FLAGS_model, FLAGS_batch_size, FLAGS_resolution);
+    model_zoo.Report();
+    DryRun<TestType> dry_run(&dnnmark);
+    dry_run.Run();
+    dry_run.Report();
+    return 0;
+  }
+  // Initialize grows the handles to the number of layers the model adds
+  DNNMark<TestType> dnnmark(32);
+  dnnmark.ParseGeneralConfig(FLAGS_config);
+  ModelZoo<TestType> model_zoo(&dnnmark);
+  model_zoo.Build(FLAGS_model, FLAGS_batch_size, FLAGS_resolution);
+  model_zoo.Report();
+  dnnmark.Initialize();
+
+  // Warm up, then time the passes on fixed input
+  const int kIterations = 10;
+  dnnmark.Forward();
+  if (dnnmark.isTraining())
+    dnnmark.Backward();
+  dnnmark.setDataFillEnabled(false);
+  Timer timer;
+  timer.Start();
+  for (int i = 0; i < kIterations; i++)
+    dnnmark.Forward();
+  timer.Stop();
+  float forward_time = timer.Elapsed() / kIterations;
+  float backward_time = 0;
+  if (dnnmark.isTraining()) {
+    timer.Start();
+    for (int i = 0; i < kIterations; i++)
+      dnnmark.Backward();
+    timer.Stop();
+    backward_time = timer.Elapsed() / kIterations;
+  }
+  std::cout << std::fixed << std::setprecision(3)
+            << "[Model Zoo] " << FLAGS_model << " forward " << forward_time
+            << " ms, backward " << backward_time << " ms, "
+            << FLAGS_batch_size * 1000.0 / (forward_time + backward_time)
+            << " images/s" << std::defaultfloat << std::endl;
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
@@ -0,0 +1,22 @@
+#include <iostream>
+#include "common.h"
+#include "dnnmark.h"
+#include "offload.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark(21);
+  dnnmark.ParseAllConfig(FLAGS_config);
+  dnnmark.Initialize();
+  Offload<TestType> offload(&dnnmark);
+  offload.Setup();
+  offload.Train();
+  offload.Report();
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
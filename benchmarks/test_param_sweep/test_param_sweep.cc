@@ -0,0 +1,22 @@
+#include <iostream>
+#include "common.h"
+#include "dnnmark.h"
+#include "param_sweep.h"
+#include "usage.h"
+
+DEFINE_string(csv, "",
+    "Also write one row per sweep point to this CSV file.");
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark(32);
+  ParamSweep<TestType> param_sweep(&dnnmark, FLAGS_config);
+  param_sweep.Run();
+  param_sweep.Report(FLAGS_csv);
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
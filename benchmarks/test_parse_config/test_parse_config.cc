@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include "common.h"
+#include "dnnmark.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+// A chain of convolution, batch normalization, activation and pooling
+// blocks with the general section of the given config
+std::string SyntheticConfig(const std::string &config_file, int num_layers) {
+  std::ifstream is(config_file.c_str(), std::ifstream::in);
+  CHECK(is.is_open()) << "Cannot open " << config_file;
+  std::ostringstream os;
+  os << is.rdbuf() << "\n";
+  os << "[Convolution]\nname=layer0\nn=32\nc=3\nh=224\nw=224\n"
+     << "previous_layer=null\nconv_mode=cross_correlation\n"
+     << "num_output=64\nkernel_size=3\npad=1\nstride=1\n"
+     << "conv_fwd_pref=fastest\nconv_bwd_filter_pref=fastest\n"
+     << "conv_bwd_data_pref=fastest\n\n";
+  for (int i = 1; i < num_layers; i++) {
+    std::string name = "layer" + std::to_string(i);
+    std::string prev = "layer" + std::to_string(i - 1);
+    switch (i % 4) {
+      case 0:
+        os << "[Convolution]\nname=" << name << "\nprevious_layer=" << prev
+           << "\nconv_mode=cross_correlation\nnum_output=64\n"
+           << "kernel_size=3\npad=1\nstride=1\nconv_fwd_pref=fastest\n"
+           << "conv_bwd_filter_pref=fastest\nconv_bwd_data_pref=fastest\n";
+        break;
+      case 1:
+        os << "[BatchNorm]\nname=" << name << "\nprevious_layer=" << prev
+           << "\nbatchnorm_mode=spatial\nsave_intermediates=true\n"
+           << "exp_avg_factor=1\nepsilon=1e-5\n";
+        break;
+      case 2:
+        os << "[Activation]\nname=" << name << "\nprevious_layer=" << prev
+           << "\nactivation_mode=relu\n";
+        break;
+      case 3:
+        os << "[Pooling]\nname=" << name << "\nprevious_layer=" << prev
+           << "\npool_mode=max\nkernel_size=3\npad=1\nstride=1\n";
+        break;
+    }
+    os << "\n";
+  }
+  return os.str();
+}
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark(32);
+
+  const int kNumLayers = 10000;
+  const int kIterations = 5;
+  std::string config = SyntheticConfig(FLAGS_config, kNumLayers);
+  int num_lines = std::count(config.begin(), config.end(), '\n');
+
+  // Parsing only, no layer is set up
+  double total = 0;
+  for (int i = 0; i < kIterations; i++) {
+    dnnmark.ClearLayers();
+    std::istringstream is(config);
+    auto start = std::chrono::steady_clock::now();
+    dnnmark.ParseAllConfig(is);
+    total += std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+  }
+  CHECK_EQ(dnnmark.getNumLayers(), kNumLayers);
+
+  double parse_time = total / kIterations;
+  std::cout << std::fixed << std::setprecision(3)
+            << "[Parse] " << kNumLayers << " layers, " << num_lines
+            << " lines: " << parse_time << " ms, "
+            << num_lines / parse_time * 1000 << " lines/s"
+            << std::defaultfloat << std::endl;
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
@@ -0,0 +1,24 @@
+#include <iostream>
+#include "common.h"
+#include "dnnmark.h"
+#include "pipeline.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark(21);
+  dnnmark.ParseAllConfig(FLAGS_config);
+  dnnmark.Initialize();
+  Pipeline<TestType> pipeline(&dnnmark);
+  pipeline.Setup();
+  pipeline.Forward();
+  pipeline.Report();
+  pipeline.Train();
+  pipeline.Report();
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
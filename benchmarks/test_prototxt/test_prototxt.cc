@@ -0,0 +1,48 @@
+#include <iostream>
+#include <iomanip>
+#include "common.h"
+#include "dnnmark.h"
+#include "prototxt_importer.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  CHECK_GT(FLAGS_prototxt.size(), 0) << "A prototxt file is needed.";
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark(32);
+  dnnmark.ParseGeneralConfig(FLAGS_config);
+  PrototxtImporter<TestType> importer(&dnnmark);
+  importer.Import(FLAGS_prototxt);
+  importer.Report();
+  dnnmark.Initialize();
+
+  // Warm up, then time the passes on fixed input
+  const int kIterations = 10;
+  dnnmark.Forward();
+  if (dnnmark.isTraining())
+    dnnmark.Backward();
+  dnnmark.setDataFillEnabled(false);
+  Timer timer;
+  timer.Start();
+  for (int i = 0; i < kIterations; i++)
+    dnnmark.Forward();
+  timer.Stop();
+  float forward_time = timer.Elapsed() / kIterations;
+  float backward_time = 0;
+  if (dnnmark.isTraining()) {
+    timer.Start();
+    for (int i = 0; i < kIterations; i++)
+      dnnmark.Backward();
+    timer.Stop();
+    backward_time = timer.Elapsed() / kIterations;
+  }
+  std::cout << std::fixed << std::setprecision(3)
+            << "[Prototxt] " << dnnmark.getNumLayers() << " layers, forward "
+            << forward_time << " ms, backward " << backward_time << " ms"
+            << std::defaultfloat << std::endl;
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
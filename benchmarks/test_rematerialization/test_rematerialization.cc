@@ -0,0 +1,27 @@
+#include <iostream>
+#include "common.h"
+#include "dnnmark.h"
+#include "rematerialization.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark(21);
+  dnnmark.ParseAllConfig(FLAGS_config);
+  dnnmark.Initialize();
+  Rematerialization<TestType> remat(&dnnmark);
+  remat.Setup();
+  remat.Train();
+  remat.Report();
+  for (auto budget : dnnmark.getMemoryBudgets()) {
+    remat.Plan(budget);
+    remat.Train();
+    remat.Report();
+  }
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <iomanip>
+#include "common.h"
+#include "dnnmark.h"
+#include "checksum.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark(32);
+  dnnmark.ParseGeneralConfig(FLAGS_config);
+
+  // Save the random model, or load the configured snapshot
+  const std::string kFile = "dnnmark_test.snapshot";
+  dnnmark.ParseLayerConfig(FLAGS_config);
+  dnnmark.Initialize();
+  if (dnnmark.getSnapshotFile().empty())
+    dnnmark.SaveSnapshot(kFile);
+  dnnmark.setDataFillEnabled(false);
+  dnnmark.Forward();
+  Checksum<TestType> saved(&dnnmark);
+  saved.Compute();
+
+  // The same model rebuilt starts from other random data until the
+  // snapshot is loaded over it
+  std::string file =
+    dnnmark.getSnapshotFile().empty() ? kFile : dnnmark.getSnapshotFile();
+  dnnmark.setDataFillEnabled(true);
+  dnnmark.ClearLayers();
+  dnnmark.ParseLayerConfig(FLAGS_config);
+  dnnmark.Initialize();
+  // Fusion already folded the random parameters, loading folds the
+  // saved ones again, so every top matches the saved model only if the
+  // snapshot holds unfolded weights
+  dnnmark.LoadSnapshot(file);
+  dnnmark.setDataFillEnabled(false);
+
+  // Warm up, then time forward passes on the loaded weights
+  const int kIterations = 10;
+  dnnmark.Forward();
+  Checksum<TestType> loaded(&dnnmark);
+  loaded.Compute();
+  Timer timer;
+  timer.Start();
+  for (int i = 0; i < kIterations; i++)
+    dnnmark.Forward();
+  timer.Stop();
+
+  std::cout << std::fixed << std::setprecision(3)
+            << "[Snapshot] Forward: " << timer.Elapsed() / kIterations
+            << " ms, " << saved.CountMismatches(loaded) << " of "
+            << saved.getNumTensors()
+            << " checksums differ from the saved model"
+            << std::defaultfloat << std::endl;
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <iomanip>
+#include "common.h"
+#include "dnnmark.h"
+#include "optimizer.h"
+#include "usage.h"
+
+using namespace dnnmark;
+
+int main(int argc, char **argv) {
+  INIT_FLAGS(argc, argv);
+  INIT_LOG(argv);
+  LOG(INFO) << "DNNMark suites: Start...";
+  DNNMark<TestType> dnnmark(32);
+  dnnmark.ParseAllConfig(FLAGS_config);
+  dnnmark.Initialize();
+
+  // Warm up, then time every phase of the following steps
+  dnnmark.Forward();
+  dnnmark.Backward();
+  dnnmark.Update();
+  dnnmark.setDataFillEnabled(false);
+
+  const int kIterations = 10;
+  float forward_time = 0, backward_time = 0, update_time = 0;
+  Timer timer;
+  for (int i = 0; i < kIterations; i++) {
+    timer.Start();
+    dnnmark.Forward();
+    timer.Stop();
+    forward_time += timer.Elapsed();
+    timer.Start();
+    dnnmark.Backward();
+    timer.Stop();
+    backward_time += timer.Elapsed();
+    timer.Start();
+    dnnmark.Update();
+    timer.Stop();
+    update_time += timer.Elapsed();
+  }
+  forward_time /= kIterations;
+  backward_time /= kIterations;
+  update_time /= kIterations;
+
+  if (dnnmark.GetOptimizer() != nullptr)
+    std::cout << "[TrainingStep] Optimizer updates "
+              << dnnmark.GetOptimizer()->getNumTensors() << " tensors, "
+              << dnnmark.GetOptimizer()->getNumElements() << " parameters"
+              << std::endl;
+  std::cout << std::fixed << std::setprecision(3)
+            << "[TrainingStep] forward: " << forward_time << " ms"
+            << " backward: " << backward_time << " ms"
+            << " optimizer: " << update_time << " ms"
+            << " step: " << forward_time + backward_time + update_time
+            << " ms" << std::endl;
+  LOG(INFO) << "DNNMark suites: Tear down...";
+  return 0;
+}
@@ -26,4 +26,13 @@ DEFINE_string(config, "",
     "The self defined DNN config file.");
 DEFINE_int32(debuginfo, 0,
     "The debug info switch to turn on/off debug information.");
-
+DEFINE_bool(dry_run, false,
+    "Report shapes, FLOPs and memory of the config without running it.");
+DEFINE_string(prototxt, "",
+    "A Caffe network definition to import instead of the config layers.");
+DEFINE_string(model, "resnet50",
+    "The model zoo network to build instead of the config layers.");
+DEFINE_int32(batch_size, 64,
+    "The batch size of the model zoo network.");
+DEFINE_int32(resolution, 224,
+    "The input height and width of the model zoo network.");
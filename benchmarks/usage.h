@@ -27,6 +27,11 @@
 
 DECLARE_string(config);
 DECLARE_int32(debuginfo);
+DECLARE_bool(dry_run);
+DECLARE_string(prototxt);
+DECLARE_string(model);
+DECLARE_int32(batch_size);
+DECLARE_int32(resolution);
 
 #define INIT_FLAGS(X, Y) \
 gflags::SetUsageMessage(\
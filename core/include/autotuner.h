@@ -0,0 +1,163 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_AUTOTUNER_H_
+#define CORE_INCLUDE_AUTOTUNER_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnn_param.h"
+#include "dnn_utility.h"
+
+namespace dnnmark {
+
+// One measured algorithm of a convolution direction
+struct AlgoCandidate {
+  int algo_;
+  float time_;
+  size_t workspace_size_;
+};
+
+inline const char *ConvDirectionName(ConvDirection direction) {
+  switch (direction) {
+    case CONV_FWD: return "fwd";
+    case CONV_BWD_FILTER: return "bwd_filter";
+    default: return "bwd_data";
+  }
+}
+
+// Whether an algorithm gives the same result on every run, the ones that
+// are not accumulate partial results with atomics
+inline bool isDeterministicAlgo(ConvDirection direction, int algo) {
+  switch (direction) {
+    case CONV_BWD_FILTER:
+      return algo != CUDNN_CONVOLUTION_BWD_FILTER_ALGO_0 &&
+             algo != CUDNN_CONVOLUTION_BWD_FILTER_ALGO_3;
+    case CONV_BWD_DATA:
+      return algo != CUDNN_CONVOLUTION_BWD_DATA_ALGO_0;
+    default:
+      return true;
+  }
+}
+
+//
+// Winners of the algorithm search kept across runs in a text file, one
+// entry per line
+//   <key> <algorithm> <time in ms> <workspace bytes>
+// Keys hold the direction, the problem shape, data type, layout and the
+// fingerprint of the machine, so one file can serve several GPUs.
+// Later lines override earlier ones.
+//
+class AutotuneCache {
+ private:
+  struct Entry {
+    int algo_;
+    float time_;
+    size_t workspace_size_;
+  };
+  std::string file_;
+  std::map<std::string, Entry> entries_;
+  std::string fingerprint_;
+
+  static std::unique_ptr<AutotuneCache> instance_;
+  AutotuneCache() {}
+
+ public:
+  static AutotuneCache *GetInstance();
+  // Load the entries of the file unless it is the one already open
+  void Open(const std::string &file);
+  bool Lookup(const std::string &key, int *algo, float *time,
+              size_t *workspace_size);
+  void Store(const std::string &key, int algo, float time,
+             size_t workspace_size);
+  // Device name, compute capability, CUDA and cuDNN versions
+  const std::string &getFingerprint();
+};
+
+//
+// Empirical choice of the convolution algorithms of one layer. Every
+// algorithm of a direction cuDNN accepts for the problem is run a few
+// times untimed, then timed over repetitions, and the fastest whose
+// workspace fits the limit wins. The buffers passed in are overwritten.
+//
+template <typename T>
+class ConvAutotuner {
+ private:
+  cudnnHandle_t cudnn_;
+  std::string layer_name_;
+  cudnnTensorDescriptor_t bottom_desc_;
+  cudnnFilterDescriptor_t filter_desc_;
+  cudnnConvolutionDescriptor_t conv_desc_;
+  cudnnTensorDescriptor_t top_desc_;
+  DataDim input_dim_;
+  ConvolutionParam conv_param_;
+  AutotuneParam autotune_param_;
+  size_t workspace_limit_;
+  // Only deterministic algorithms are candidates
+  bool deterministic_;
+
+  // Problem part of the cache keys, built on first use so that nothing
+  // touches the device or the cache file unless a search is made
+  std::string shape_;
+  const std::string &Shape();
+
+  // Query gives the workspace an algorithm needs and run launches it,
+  // both return the cuDNN status so that unsupported ones are skipped
+  // When candidates are requested the cache is bypassed and every
+  // algorithm that ran is returned, fastest first
+  int Search(ConvDirection direction, int num_algos,
+             const std::function<cudnnStatus_t(int, size_t *)> &query,
+             const std::function<cudnnStatus_t(int, void *, size_t)> &run,
+             std::vector<AlgoCandidate> *candidates);
+
+ public:
+  ConvAutotuner(cudnnHandle_t cudnn,
+                const std::string &layer_name,
+                const DataDim &input_dim,
+                const ConvolutionParam &conv_param,
+                DataTensor<T> *bottom_desc,
+                ConvolutionDesc<T> *desc,
+                DataTensor<T> *top_desc,
+                const AutotuneParam &autotune_param,
+                size_t workspace_limit,
+                bool deterministic);
+
+  cudnnConvolutionFwdAlgo_t Forward(
+      const T *bottom, const T *weights, T *top,
+      std::vector<AlgoCandidate> *candidates = nullptr);
+  cudnnConvolutionBwdFilterAlgo_t BackwardFilter(
+      const T *bottom, const T *top_diff, T *weights_diff,
+      std::vector<AlgoCandidate> *candidates = nullptr);
+  cudnnConvolutionBwdDataAlgo_t BackwardData(
+      const T *weights, const T *top_diff, T *bottom_diff,
+      std::vector<AlgoCandidate> *candidates = nullptr);
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_AUTOTUNER_H_
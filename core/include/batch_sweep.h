@@ -20,52 +20,47 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-#ifndef CORE_INCLUDE_DATA_PNG_H_
-#define CORE_INCLUDE_DATA_PNG_H_
+#ifndef CORE_INCLUDE_BATCH_SWEEP_H_
+#define CORE_INCLUDE_BATCH_SWEEP_H_
 
 #include <vector>
-#include <map>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnn_utility.h"
+#include "dnnmark.h"
 
 namespace dnnmark {
 
-// Seed of random number generator
-static unsigned long long int seed = 1234;
+//
+// Times a model for every batch size of the batch_sweep list. Buffers are
+// allocated once for the largest size by Initialize; each smaller size is
+// a batch view over them, so only descriptors are re-derived.
+//
 
-class PseudoNumGenerator {
+template <typename T>
+class BatchSweep {
  private:
-  curandGenerator_t gen_;  
-
-  // Constructor
-  PseudoNumGenerator() {
-    CURAND_CALL(curandCreateGenerator(&gen_, CURAND_RNG_PSEUDO_DEFAULT));
-    CURAND_CALL(curandSetPseudoRandomGeneratorSeed(gen_, seed));
-  }
+  struct Point {
+    int batch_size;
+    // Average time per iteration of each phase in milliseconds
+    float forward_time;
+    float backward_time;
+    float update_time;
+  };
 
-  // PNG instance
-  static std::unique_ptr<PseudoNumGenerator> instance_;
- public:
+  DNNMark<T> *p_dnnmark_;
+  int num_iterations_;
+  std::vector<Point> points_;
 
-  ~PseudoNumGenerator() {
-    CURAND_CALL(curandDestroyGenerator(gen_));
-  }
+  void SetBatchSize(int n);
 
-  static PseudoNumGenerator *GetInstance() {
-    if (instance_.get())
-      return instance_.get();
-    instance_.reset(new PseudoNumGenerator());
-    return instance_.get();
-  }
-  void GenerateUniformData(float *dev_ptr, int size) {
-    CURAND_CALL(curandGenerateUniform(gen_, dev_ptr, size));
-  }
-  void GenerateUniformData(double *dev_ptr, int size) {
-    CURAND_CALL(curandGenerateUniformDouble(gen_, dev_ptr, size));
-  }  
+ public:
+  BatchSweep(DNNMark<T> *p_dnnmark, int num_iterations = 10);
+  int Run();
+  void Report();
 };
 
-std::unique_ptr<PseudoNumGenerator> PseudoNumGenerator::instance_ = nullptr;
-
 } // namespace dnnmark
 
-#endif // CORE_INCLUDE_DATA_PNG_H_
-
+#endif // CORE_INCLUDE_BATCH_SWEEP_H_
@@ -0,0 +1,65 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_CHECKSUM_H_
+#define CORE_INCLUDE_CHECKSUM_H_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// Bitwise checksums of the tensors of a model: the tops, bottom gradients,
+// parameters and parameter gradients of every layer. Two runs on the same
+// input agree on every checksum only when all their reductions are
+// deterministic, which makes them a cheap check for regression bisects.
+//
+
+template <typename T>
+class Checksum {
+ private:
+  DNNMark<T> *p_dnnmark_;
+  // Tensor name and FNV-1a hash of its bytes, in layer order
+  std::vector<std::pair<std::string, unsigned long long>> checksums_;
+
+  void Add(const std::string &name, int chunk_id);
+
+ public:
+  Checksum(DNNMark<T> *p_dnnmark);
+  // Hash the current contents, after the passes of interest
+  int Compute();
+  void Report();
+  // Number of tensors whose checksum differs from the other one's
+  int CountMismatches(const Checksum<T> &other);
+
+  int getNumTensors() { return checksums_.size(); }
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_CHECKSUM_H_
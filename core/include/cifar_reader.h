@@ -0,0 +1,77 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_CIFAR_READER_H_
+#define CORE_INCLUDE_CIFAR_READER_H_
+
+#include <string>
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+
+namespace dnnmark {
+
+//
+// CIFAR-10 binary batches read through mmap. A record is one label byte
+// followed by the 32x32 image as three 1024 byte planes, red, green and
+// blue. Records are copied to the device as raw bytes and converted there
+// into normalized NCHW data, written straight into the destination chunk.
+// Reading goes through all files in order and wraps around at the end.
+//
+
+template <typename T>
+class CifarReader {
+ private:
+  struct MappedFile {
+    int fd_;
+    const unsigned char *records_;
+    size_t size_;
+    int num_records_;
+  };
+  std::vector<MappedFile> files_;
+  int num_records_;
+  // File and record within it that the next batch starts at
+  int file_;
+  int record_;
+  // Device buffer of raw records, grown to the largest batch
+  unsigned char *staging_;
+  int staging_records_;
+
+ public:
+  static const int kImageSize = 3 * 32 * 32;
+  static const int kRecordSize = 1 + kImageSize;
+
+  CifarReader(const std::vector<std::string> &files);
+  ~CifarReader();
+  // Convert the next n images into dst, n * kImageSize elements
+  void Next(T *dst, int n, cudaStream_t stream = 0);
+  // Host view of a record, the index wraps around the dataset. The
+  // mapping is read-only, so any thread may call it.
+  const unsigned char *GetRecord(long long index);
+
+  int getNumRecords() { return num_records_; }
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_CIFAR_READER_H_
@@ -108,6 +108,36 @@ enum RunMode {
   COMPOSED
 };
 
+// Execution mode
+enum ExecutionMode {
+  TRAINING = 0,
+  INFERENCE
+};
+
+// Optimizer applied after the backward pass
+enum OptimizerType {
+  NO_OPTIMIZER = 0,
+  SGD_MOMENTUM,
+  ADAM,
+  LAMB
+};
+
+// Convolution computations an algorithm is chosen for
+enum ConvDirection {
+  CONV_FWD = 0,
+  CONV_BWD_FILTER,
+  CONV_BWD_DATA,
+  NUM_CONV_DIRECTIONS
+};
+
+// Pipeline schedule
+// GPipe: all micro-batches run forward before any runs backward
+// 1F1B: after warming up, each stage alternates one forward and one backward
+enum PipelineSchedule {
+  GPIPE = 0,
+  ONE_F_ONE_B
+};
+
 // Layer type
 enum LayerType {
   CONVOLUTION = 1,
@@ -118,7 +148,13 @@ enum LayerType {
   SOFTMAX,
   BN,
   DROPOUT,
-  BYPASS
+  BYPASS,
+  LSTM,
+  GRU,
+  BATCHED_MATMUL,
+  LAYER_NORM,
+  GELU,
+  ATTENTION
 };
 
 } // namespace dnnmark
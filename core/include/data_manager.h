@@ -25,35 +25,76 @@
 
 #include <memory>
 #include <map>
+#include <functional>
 #include <glog/logging.h>
 
 #include "common.h"
-#include "data_png.h"
+#include "kernels.h"
 
 namespace dnnmark {
 
+// Base seed of the random data, every chunk derives its own from it
+const unsigned long long kDataSeed = 1234;
+
 template <typename T>
 class Data {
  private:
-  PseudoNumGenerator *png_;
   int size_;
   T *gpu_ptr_;
+  // Whether gpu_ptr_ was allocated by this chunk
+  bool owned_;
+  // Replaces the random generator when set, e.g. a dataset reader
+  std::function<void(T *, int)> source_;
+  // Random data of the chunk, see DNNMarkFillUniform
+  unsigned long long seed_;
+  unsigned int fills_;
  public:
   Data(int size)
-  : size_(size) {
+  : size_(size), owned_(true), seed_(kDataSeed), fills_(0) {
     LOG(INFO) << "Create Data chunk of size " << size_;
     CUDA_CALL(cudaMalloc(&gpu_ptr_, size * sizeof(T)));
   }
   ~Data() {
     LOG(INFO) << "Free Data chunk of size " << size_;
-    CUDA_CALL(cudaFree(gpu_ptr_));
-    cudaFree(gpu_ptr_);
+    if (owned_)
+      CUDA_CALL(cudaFree(gpu_ptr_));
   }
   void Filler() {
-    png_ = PseudoNumGenerator::GetInstance();
-    png_->GenerateUniformData(gpu_ptr_, size_);
+    if (source_) {
+      source_(gpu_ptr_, size_);
+      return;
+    }
+    DNNMarkFillUniform<T>(0, size_, seed_, fills_++, gpu_ptr_);
   }
+  void setSeed(unsigned long long seed) { seed_ = seed; }
   T *Get() { return gpu_ptr_; }
+  int getSize() { return size_; }
+  void setSource(const std::function<void(T *, int)> &source) {
+    source_ = source;
+  }
+  // Backward passes keep the batch of a sourced chunk that forward read
+  bool hasSource() { return static_cast<bool>(source_); }
+
+  // Give the device memory back while the chunk keeps its id and size,
+  // the content is lost until it is written again after Acquire
+  void Release() {
+    if (owned_)
+      CUDA_CALL(cudaFree(gpu_ptr_));
+    gpu_ptr_ = nullptr;
+    owned_ = false;
+  }
+  void Acquire() {
+    if (owned_)
+      return;
+    CUDA_CALL(cudaMalloc(&gpu_ptr_, size_ * sizeof(T)));
+    owned_ = true;
+  }
+  // Borrow device memory owned elsewhere, e.g. a staging buffer
+  void Attach(T *ptr) {
+    Release();
+    gpu_ptr_ = ptr;
+  }
+  bool isResident() { return owned_; }
 };
 
 
@@ -87,6 +128,8 @@ class DataManager {
     int gen_chunk_id = num_data_chunks_;
     num_data_chunks_++;
     gpu_data_pool_.emplace(gen_chunk_id, std::make_shared<Data<T>>(size));
+    gpu_data_pool_[gen_chunk_id]->setSeed(
+      kDataSeed + gen_chunk_id * 0x9E3779B97F4A7C15ULL);
     LOG(INFO) << "Create data with ID: " << gen_chunk_id;
     return gen_chunk_id;
   }
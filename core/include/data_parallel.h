@@ -0,0 +1,131 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_DATA_PARALLEL_H_
+#define CORE_INCLUDE_DATA_PARALLEL_H_
+
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnn_utility.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// Data-parallel training simulated on one device.
+// Independent copies of the network process an equal share of the batch,
+// each replica is driven by its own host thread on its own stream. After
+// backward the gradients of learnable layers are summed across replicas
+// with a bandwidth-optimal ring all-reduce over device memory.
+// The all-reduce either follows backward, or is overlapped with it: the
+// gradients are grouped into buckets in backward order and a communicator
+// thread reduces every bucket as soon as all replicas have filled it.
+//
+
+template <typename T>
+class DataParallel {
+ private:
+  std::string config_file_;
+  int num_replicas_;
+  int num_layers_;
+  int batch_size_;
+
+  std::vector<std::unique_ptr<DNNMark<T>>> replicas_;
+  std::vector<cudaStream_t> streams_;
+
+  // Communication runs on its own streams so it can overlap compute
+  std::vector<cudaStream_t> comm_streams_;
+  std::vector<cublasHandle_t> comm_blas_;
+
+  // Gradient chunks of every replica, same order across replicas
+  std::vector<std::vector<Data<T> *>> gradients_;
+  size_t gradient_bytes_;
+
+  // Gradient buckets in backward order, each is a list of gradient indices
+  size_t bucket_size_;
+  std::vector<std::vector<int>> buckets_;
+  // Layer whose backward completes a bucket, mapped to that bucket
+  std::map<int, int> bucket_closers_;
+  // Per replica and bucket, recorded when the bucket is filled
+  std::vector<std::vector<cudaEvent_t>> bucket_ready_;
+  // Number of replicas that have filled each bucket
+  std::vector<int> bucket_fill_count_;
+  std::mutex bucket_mutex_;
+  std::condition_variable bucket_cv_;
+
+  // Completion of the last ring step of every replica
+  std::vector<cudaEvent_t> step_done_;
+  // Timing events of a step
+  cudaEvent_t start_;
+  std::vector<cudaEvent_t> compute_done_;
+  std::vector<cudaEvent_t> comm_done_;
+
+  // Measurements in milliseconds
+  std::vector<float> compute_time_;
+  float isolated_compute_time_;
+  float comm_time_;
+  float overlapped_exposed_comm_time_;
+
+  void AssignBuckets();
+  void ComputeStep(int replica);
+  void OnGradientReady(int replica, Layer<T> *layer);
+  void Communicator();
+  void RingAllReduce(const std::vector<int> &gradient_ids);
+  // Time from the last compute to the last communication completion
+  float ExposedCommTime();
+
+ public:
+  DataParallel(const std::string &config_file, int num_replicas);
+  ~DataParallel();
+  int Setup();
+  int Run();
+  void Report(float baseline_step_time = 0);
+
+  int getNumReplicas() { return num_replicas_; }
+  // Slowest replica while all replicas share the device
+  float getComputeTime();
+  // One replica running alone, what a dedicated worker would take
+  float getIsolatedComputeTime() { return isolated_compute_time_; }
+  int getNumBuckets() { return buckets_.size(); }
+  // Communication when the all-reduce starts after backward, all exposed
+  float getCommTime() { return comm_time_; }
+  // Communication left exposed when the all-reduce overlaps backward
+  float getOverlappedExposedCommTime() {
+    return overlapped_exposed_comm_time_;
+  }
+  // Projected step time of a worker with a device of its own
+  float getStepTime() { return isolated_compute_time_ + comm_time_; }
+  float getOverlappedStepTime() {
+    return isolated_compute_time_ + overlapped_exposed_comm_time_;
+  }
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_DATA_PARALLEL_H_
@@ -42,104 +42,20 @@ const std::vector<std::string> layer_section_keywords = {
   "[Softmax]",
   "[BatchNorm]",
   "[Dropout]",
-  "[Bypass]"
+  "[Bypass]",
+  "[LSTM]",
+  "[GRU]",
+  "[BatchedMatMul]",
+  "[LayerNorm]",
+  "[GELU]",
+  "[Attention]"
 };
 
-// DNNMark keywords
-const std::vector<std::string> dnnmark_config_keywords = {
-  "run_mode"
-};
-
-// Data config keywords
-const std::vector<std::string> data_config_keywords = {
-  "name",
-  "n",
-  "c",
-  "h",
-  "w",
-  "previous_layer"
-};
-
-// Convolution layer keywords
-const std::vector<std::string> conv_config_keywords = {
-  "conv_mode",
-  "num_output",
-  "kernel_size",
-  "pad",
-  "stride",
-  "kernel_size_h",
-  "kernel_size_w",
-  "pad_h",
-  "pad_w",
-  "stride_h",
-  "stride_w",
-  "conv_fwd_pref",
-  "conv_bwd_filter_pref",
-  "conv_bwd_data_pref"
-};
-
-// Pooling layer keywords
-const std::vector<std::string> pool_config_keywords = {
-  "pool_mode",
-  "kernel_size",
-  "pad",
-  "stride",
-  "kernel_size_h",
-  "kernel_size_w",
-  "pad_h",
-  "pad_w",
-  "stride_h",
-  "stride_w"
-};
-
-// LRN layer keywords
-const std::vector<std::string> lrn_config_keywords = {
-  "lrn_mode",
-  "local_size",
-  "alpha",
-  "beta",
-  "k"
-};
-
-// Activation layer keywords
-const std::vector<std::string> activation_config_keywords = {
-  "activation_mode"
-};
-
-// FC layer keywords
-const std::vector<std::string> fc_config_keywords = {
-  "num_output"
-};
-
-// Softmax layer keywords
-const std::vector<std::string> softmax_config_keywords = {
-  "softmax_algo",
-  "softmax_mode"
-};
-
-// BN layer keywords
-const std::vector<std::string> bn_config_keywords = {
-  "batchnorm_mode",
-  "save_intermediates",
-  "exp_avg_factor",
-  "epsilon"
-};
-
-// DROPOUT layer keywords
-const std::vector<std::string> dropout_config_keywords = {
-  "dropout_probability",
-  "random_seed"
-};
-
-// BYPASS layer keywords
-const std::vector<std::string> bypass_config_keywords = {
-};
+// The keywords of a section are those of its setter table in DNNMark
 
 bool isSection(const std::string &s);
 bool isGeneralSection(const std::string &s);
 bool isLayerSection(const std::string &s);
-bool isKeywordExist(const std::string &s,
-                    const std::vector<std::string> &config_keywords);
 
 } // namespace dnnmark
 
@@ -24,12 +24,16 @@
 #define CORE_INCLUDE_DNN_LAYER_H_
 
 #include <vector>
+#include <memory>
 #include <glog/logging.h>
 #include "cudnn.h"
 #include "common.h"
+#include "utility.h"
 #include "dnn_param.h"
 #include "dnn_utility.h"
 #include "data_manager.h"
+#include "cifar_reader.h"
+#include "input_pipeline.h"
 
 namespace dnnmark {
 
@@ -47,6 +51,8 @@ class Layer {
   int layer_id_;
   std::string layer_name_;
   std::string previous_layer_name_;
+  // Where the bottoms of a first layer come from, random data when empty
+  std::string data_source_;
   DataDim input_dim_;
   DataDim output_dim_;
   DataTensor<T> bottom_desc_;
@@ -66,13 +72,64 @@ class Layer {
   std::vector<int> top_chunk_ids_;
   std::vector<Data<T> *> top_diffs_;
   std::vector<int> top_diff_chunk_ids_;
+
+  // Learnable parameters and their gradients, in matching order
+  std::vector<int> param_chunk_ids_;
+  std::vector<int> param_diff_chunk_ids_;
+  // Tensors a trained model carries besides its parameters, e.g. the
+  // running statistics of batch normalization
+  std::vector<int> state_chunk_ids_;
+
+  // Batch view, the layer computes on samples
+  // [batch_begin_, batch_begin_ + batch_n_) of its bottoms and tops
+  int batch_begin_;
+  int batch_n_;
+
+  // The top aliases the bottom, decided before Setup. Layers whose
+  // gradient may overwrite the top diff alias the bottom diff as well.
+  bool in_place_;
+  // Forward work of this layer is carried out in place by the preceding
+  // layer that the fusion pass merged it into
+  bool absorbed_;
+
+  // Random data is generated once by FillData after Setup and only
+  // regenerated in the passes when asked to, a dataset source delivers a
+  // new batch every pass
+  bool isDataFillRequired() {
+    return p_dnnmark_->isDataFillEnabled() && isDataFillLayer() &&
+           (p_dnnmark_->isRefillEachIteration() ||
+            (!bottoms_.empty() && bottoms_[0]->hasSource()));
+  }
+
+  // Gradient buffers only exist when backward passes run
+  bool isTraining() { return p_dnnmark_->isTraining(); }
+
+  // Data pointers adjusted to the current batch view
+  T *BottomPtr(int index) {
+    return bottoms_[index]->Get() + batch_begin_ *
+           input_dim_.c_ * input_dim_.h_ * input_dim_.w_;
+  }
+  T *BottomDiffPtr(int index) {
+    return bottom_diffs_[index]->Get() + batch_begin_ *
+           input_dim_.c_ * input_dim_.h_ * input_dim_.w_;
+  }
+  T *TopPtr(int index) {
+    return tops_[index]->Get() + batch_begin_ *
+           output_dim_.c_ * output_dim_.h_ * output_dim_.w_;
+  }
+  T *TopDiffPtr(int index) {
+    return top_diffs_[index]->Get() + batch_begin_ *
+           output_dim_.c_ * output_dim_.h_ * output_dim_.w_;
+  }
  public:
   Layer(DNNMark<T> *p_dnnmark)
   : p_dnnmark_(p_dnnmark),
     layer_id_(0), has_learnable_params_(false),
     input_dim_(), bottom_desc_(),
     output_dim_(), top_desc_(),
-    num_bottoms_(1), num_tops_(1) {
+    num_bottoms_(1), num_tops_(1),
+    batch_begin_(0), batch_n_(0),
+    in_place_(false), absorbed_(false) {
     data_manager_ = DataManager<T>::GetInstance();
   }
   ~Layer() {
@@ -86,6 +143,10 @@ class Layer {
   void setPrevLayerName(const char *previous_layer_name) {
     previous_layer_name_.assign(previous_layer_name);
   }
+  void setDataSource(const std::string &data_source) {
+    data_source_ = data_source;
+  }
+  std::string getDataSource() { return data_source_; }
   void setLayerId(int layer_id) { layer_id_ = layer_id; }
   int getLayerId() { return layer_id_; }
   void setLayerType(LayerType type) { type_ = type; }
@@ -95,10 +156,68 @@ class Layer {
   int getNumTops() { return num_tops_; }
   int getTopChunkID(int index) { return top_chunk_ids_[index]; }
   int getTopDiffChunkID(int index) { return top_diff_chunk_ids_[index]; }
+  int getNumBottomDiffs() { return bottom_diff_chunk_ids_.size(); }
+  int getBottomDiffChunkID(int index) {
+    return bottom_diff_chunk_ids_[index];
+  }
   int getTopDimN() { return output_dim_.n_; }
   int getTopDimC() { return output_dim_.c_; }
   int getTopDimH() { return output_dim_.h_; }
   int getTopDimW() { return output_dim_.w_; }
+  std::string getLayerName() { return layer_name_; }
+  std::string getPrevLayerName() { return previous_layer_name_; }
+  bool hasLearnableParams() { return has_learnable_params_; }
+  int getNumParams() { return param_chunk_ids_.size(); }
+  int getParamChunkID(int index) { return param_chunk_ids_[index]; }
+  int getParamDiffChunkID(int index) { return param_diff_chunk_ids_[index]; }
+  int getNumStates() { return state_chunk_ids_.size(); }
+  int getStateChunkID(int index) { return state_chunk_ids_[index]; }
+  int getNumBottoms() { return bottom_chunk_ids_.size(); }
+  int getBottomChunkID(int index) { return bottom_chunk_ids_[index]; }
+  int getBatchBegin() { return batch_begin_; }
+  int getBatchN() { return batch_n_; }
+  bool isInPlace() { return in_place_; }
+  void setInPlace(bool in_place) { in_place_ = in_place; }
+  bool isAbsorbed() { return absorbed_; }
+  void setAbsorbed(bool absorbed) { absorbed_ = absorbed; }
+
+  // Layers whose inputs are not produced by another layer
+  bool isDataFillLayer() {
+    return p_dnnmark_->getRunMode() == STANDALONE ||
+           !previous_layer_name_.compare("null");
+  }
+
+  // Fill what the passes of a data fill layer read, sourced bottoms are
+  // left to the first forward pass
+  void FillData() {
+    for (auto bottom : bottoms_)
+      if (!bottom->hasSource())
+        bottom->Filler();
+    for (auto top : tops_)
+      top->Filler();
+    for (auto top_diff : top_diffs_)
+      top_diff->Filler();
+  }
+
+  // Derive the output dimension from the input dimension and parameters
+  virtual void ComputeOutputDim() { output_dim_ = input_dim_; }
+
+  // Data read by the backward pass besides the top diffs. A top may only
+  // overwrite its bottom when nobody reads the overwritten values later.
+  virtual bool BackwardReadsBottom() { return true; }
+  virtual bool BackwardReadsTop() { return true; }
+
+  // Restrict computation to a contiguous slice of the batch. Descriptors
+  // are re-derived for the slice while the data chunks stay in place.
+  virtual void SetBatchView(int begin, int n) {
+    CHECK_GE(begin, 0);
+    CHECK_GT(n, 0);
+    CHECK_LE(begin + n, input_dim_.n_);
+    batch_begin_ = begin;
+    batch_n_ = n;
+    bottom_desc_.Reset(n, input_dim_.c_, input_dim_.h_, input_dim_.w_);
+    top_desc_.Reset(n, output_dim_.c_, output_dim_.h_, output_dim_.w_);
+  }
 
   // Base layer setup function
   virtual void Setup() {
@@ -135,11 +254,40 @@ class Layer {
           data_manager_->CreateData(bottom_size));
         bottoms_.push_back(
           data_manager_->GetData(bottom_chunk_ids_[i]));
+        if (!isTraining())
+          continue;
         bottom_diff_chunk_ids_.push_back(
           data_manager_->CreateData(bottom_size));
         bottom_diffs_.push_back(
           data_manager_->GetData(bottom_diff_chunk_ids_[i]));
       }
+
+      // Bottoms filled from a dataset instead of the random generator,
+      // prepared in the background when an input pipeline is configured
+      std::shared_ptr<CifarReader<T>> reader;
+      if (!data_source_.empty()) {
+        CHECK(input_dim_.c_ == 3 && input_dim_.h_ == 32 &&
+              input_dim_.w_ == 32)
+          << layer_name_ << ": CIFAR-10 images are 3x32x32";
+        std::vector<std::string> files;
+        SplitList(data_source_.substr(data_source_.find(':') + 1), &files);
+        reader = std::make_shared<CifarReader<T>>(files);
+      }
+      if (p_dnnmark_->getInputParam()->pipeline_) {
+        std::shared_ptr<InputPipeline<T>> pipeline =
+          std::make_shared<InputPipeline<T>>(*p_dnnmark_->getInputParam(),
+                                             input_dim_, reader);
+        p_dnnmark_->AddInputPipeline(pipeline);
+        for (auto bottom : bottoms_)
+          bottom->setSource([pipeline](T *ptr, int size) {
+            pipeline->Consume(ptr, size);
+          });
+      } else if (reader) {
+        for (auto bottom : bottoms_)
+          bottom->setSource([reader](T *ptr, int size) {
+            reader->Next(ptr, size / CifarReader<T>::kImageSize);
+          });
+      }
     } else {
       //
       // Composed mode
@@ -172,6 +320,8 @@ class Layer {
             previous_layer->getTopChunkID(i));
           bottoms_.push_back(
             data_manager_->GetData(bottom_chunk_ids_[i]));
+          if (!isTraining())
+            continue;
           bottom_diff_chunk_ids_.push_back(
             previous_layer->getTopDiffChunkID(i));
           bottom_diffs_.push_back(
@@ -181,6 +331,10 @@ class Layer {
         LOG(FATAL) << "Wrong previous layer name!!!";
       }
     }
+
+    // The whole batch is computed unless a view is set afterwards
+    batch_begin_ = 0;
+    batch_n_ = input_dim_.n_;
   }
 
   virtual void ForwardPropagation() {}
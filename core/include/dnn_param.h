@@ -24,6 +24,8 @@
 #define CORE_INCLUDE_DNN_PARAM_H_
 
 #include <iostream>
+#include <string>
+#include <limits>
 #include <cudnn.h>
 
 namespace dnnmark {
@@ -36,6 +38,8 @@ struct DataDim {
 
   DataDim()
   : n_(0), c_(0), h_(0), w_(0) {}
+  DataDim(int n, int c, int h, int w)
+  : n_(n), c_(c), h_(h), w_(w) {}
 };
 
 inline std::ostream &operator<<(std::ostream &os, const DataDim &data_dim) {
@@ -61,6 +65,10 @@ struct ConvolutionParam {
   cudnnConvolutionFwdPreference_t conv_fwd_pref_;
   cudnnConvolutionBwdFilterPreference_t conv_bwd_filter_pref_;
   cudnnConvolutionBwdDataPreference_t conv_bwd_data_pref_;
+  // Largest workspace of one direction, also given to the heuristics
+  size_t workspace_limit_;
+  // Time every algorithm instead of taking the heuristic choice
+  bool autotune_;
   ConvolutionParam()
   : mode_(CUDNN_CROSS_CORRELATION), output_num_(32),
     pad_h_(2), pad_w_(2),
@@ -69,7 +77,9 @@ struct ConvolutionParam {
     kernel_size_h_(5), kernel_size_w_(5),
     conv_fwd_pref_(CUDNN_CONVOLUTION_FWD_PREFER_FASTEST),
     conv_bwd_filter_pref_(CUDNN_CONVOLUTION_BWD_FILTER_PREFER_FASTEST),
-    conv_bwd_data_pref_(CUDNN_CONVOLUTION_BWD_DATA_PREFER_FASTEST) {}
+    conv_bwd_data_pref_(CUDNN_CONVOLUTION_BWD_DATA_PREFER_FASTEST),
+    workspace_limit_(std::numeric_limits<size_t>::max()),
+    autotune_(false) {}
   
 };
 
@@ -189,11 +199,14 @@ struct BatchNormParam {
   bool save_intermediates_;
   double exp_avg_factor_;
   double epsilon_;
+  // Normalize with the running statistics as in inference
+  bool use_global_stats_;
   BatchNormParam()
   : mode_(CUDNN_BATCHNORM_PER_ACTIVATION),
     save_intermediates_(true),
     exp_avg_factor_(1),
-    epsilon_(CUDNN_BN_MIN_EPSILON) {}
+    epsilon_(CUDNN_BN_MIN_EPSILON),
+    use_global_stats_(false) {}
 };
 
 inline std::ostream &operator<<(std::ostream &os,
@@ -207,6 +220,8 @@ inline std::ostream &operator<<(std::ostream &os,
      << bn_param.exp_avg_factor_ << std::endl;
   os << "[BatchNorm Param] Epsilon: "
      << bn_param.epsilon_ << std::endl;
+  os << "[BatchNorm Param] Use Global Stats: "
+     << bn_param.use_global_stats_ << std::endl;
   return os;
 }
 
@@ -228,6 +243,94 @@ inline std::ostream &operator<<(std::ostream &os,
   return os;
 }
 
+struct OptimizerParam {
+  OptimizerType type_;
+  double learning_rate_;
+  double momentum_;
+  double weight_decay_;
+  double beta1_;
+  double beta2_;
+  double epsilon_;
+  OptimizerParam()
+  : type_(NO_OPTIMIZER), learning_rate_(0.01), momentum_(0.9),
+    weight_decay_(0), beta1_(0.9), beta2_(0.999), epsilon_(1e-8) {}
+};
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const OptimizerParam &optimizer_param) {
+  os << std::endl;
+  os << "[Optimizer Param] Type: "
+     << optimizer_param.type_ << std::endl;
+  os << "[Optimizer Param] Learning Rate: "
+     << optimizer_param.learning_rate_ << std::endl;
+  os << "[Optimizer Param] Momentum: "
+     << optimizer_param.momentum_ << std::endl;
+  os << "[Optimizer Param] Weight Decay: "
+     << optimizer_param.weight_decay_ << std::endl;
+  os << "[Optimizer Param] Beta1: "
+     << optimizer_param.beta1_ << std::endl;
+  os << "[Optimizer Param] Beta2: "
+     << optimizer_param.beta2_ << std::endl;
+  os << "[Optimizer Param] Epsilon: "
+     << optimizer_param.epsilon_ << std::endl;
+  return os;
+}
+
+struct AutotuneParam {
+  // Autotune every convolution layer, layers may also opt in one by one
+  bool enabled_;
+  // Winners from earlier runs, new ones are appended
+  std::string cache_file_;
+  int warmup_;
+  int repetitions_;
+  AutotuneParam()
+  : enabled_(false), cache_file_("dnnmark_autotune.cache"),
+    warmup_(2), repetitions_(5) {}
+};
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const AutotuneParam &autotune_param) {
+  os << std::endl;
+  os << "[Autotune Param] Enabled: "
+     << autotune_param.enabled_ << std::endl;
+  os << "[Autotune Param] Cache File: "
+     << autotune_param.cache_file_ << std::endl;
+  os << "[Autotune Param] Warmup: "
+     << autotune_param.warmup_ << std::endl;
+  os << "[Autotune Param] Repetitions: "
+     << autotune_param.repetitions_ << std::endl;
+  return os;
+}
+
+struct InputParam {
+  // Prepare first layer batches on host threads ahead of the network
+  bool pipeline_;
+  int prefetch_slots_;
+  int num_workers_;
+  // Random crop from the zero padded image and horizontal mirror
+  bool augment_;
+  int crop_pad_;
+  InputParam()
+  : pipeline_(false), prefetch_slots_(2), num_workers_(2),
+    augment_(false), crop_pad_(4) {}
+};
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const InputParam &input_param) {
+  os << std::endl;
+  os << "[Input Param] Pipeline: "
+     << input_param.pipeline_ << std::endl;
+  os << "[Input Param] Prefetch Slots: "
+     << input_param.prefetch_slots_ << std::endl;
+  os << "[Input Param] Workers: "
+     << input_param.num_workers_ << std::endl;
+  os << "[Input Param] Augment: "
+     << input_param.augment_ << std::endl;
+  os << "[Input Param] Crop Pad: "
+     << input_param.crop_pad_ << std::endl;
+  return os;
+}
+
 struct BypassParam {
 	BypassParam() {}
 };
@@ -239,6 +342,130 @@ inline std::ostream &operator<<(std::ostream &os,
   return os;
 }
 
+// Stacked recurrent layers, the cell is given by the layer type. The
+// input holds seq_len steps per sample, the output N x seq_len x
+// (hidden_size * directions) x 1.
+struct RNNParam {
+  int hidden_size_;
+  int num_layers_;
+  // Zero takes the channels of the input as the number of steps
+  int seq_len_;
+  bool bidirectional_;
+  RNNParam()
+  : hidden_size_(512), num_layers_(1), seq_len_(0),
+    bidirectional_(false) {}
+};
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const RNNParam &rnn_param) {
+  os << std::endl;
+  os << "[RNN Param] Hidden Size: "
+     << rnn_param.hidden_size_ << std::endl;
+  os << "[RNN Param] Layers: "
+     << rnn_param.num_layers_ << std::endl;
+  os << "[RNN Param] Sequence Length: "
+     << rnn_param.seq_len_ << std::endl;
+  os << "[RNN Param] Bidirectional: "
+     << rnn_param.bidirectional_ << std::endl;
+  return os;
+}
+
+// Matrix products of the tokens of every sample, one per head. The input
+// holds seq_len tokens per sample, each split into num_heads equal parts.
+// Part h of the tokens of a sample is multiplied by operand h, which has
+// output_cols columns. The output is N x seq_len x (num_heads *
+// output_cols) x 1.
+struct BatchedMatMulParam {
+  int num_heads_;
+  int output_cols_;
+  // Zero takes the channels of the input as the number of tokens
+  int seq_len_;
+  // Multiply by the transposed operands, stored output_cols x part size
+  bool transpose_;
+  // One set of operands learned for all samples, otherwise each sample
+  // has its own as the keys and values of attention
+  bool shared_;
+  BatchedMatMulParam()
+  : num_heads_(1), output_cols_(64), seq_len_(0),
+    transpose_(false), shared_(false) {}
+};
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const BatchedMatMulParam &bmm_param) {
+  os << std::endl;
+  os << "[Batched MatMul Param] Heads: "
+     << bmm_param.num_heads_ << std::endl;
+  os << "[Batched MatMul Param] Output Columns: "
+     << bmm_param.output_cols_ << std::endl;
+  os << "[Batched MatMul Param] Sequence Length: "
+     << bmm_param.seq_len_ << std::endl;
+  os << "[Batched MatMul Param] Transpose: "
+     << bmm_param.transpose_ << std::endl;
+  os << "[Batched MatMul Param] Shared: "
+     << bmm_param.shared_ << std::endl;
+  return os;
+}
+
+// Normalizes every token over its features with a learned scale and
+// shift per feature
+struct LayerNormParam {
+  // Zero takes the channels of the input as the number of tokens
+  int seq_len_;
+  double epsilon_;
+  LayerNormParam()
+  : seq_len_(0), epsilon_(1e-5) {}
+};
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const LayerNormParam &ln_param) {
+  os << std::endl;
+  os << "[LayerNorm Param] Sequence Length: "
+     << ln_param.seq_len_ << std::endl;
+  os << "[LayerNorm Param] Epsilon: "
+     << ln_param.epsilon_ << std::endl;
+  return os;
+}
+
+struct GELUParam {
+  // The tanh approximation instead of the exact erf form
+  bool approximate_;
+  GELUParam()
+  : approximate_(true) {}
+};
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const GELUParam &gelu_param) {
+  os << std::endl;
+  os << "[GELU Param] Approximate: "
+     << gelu_param.approximate_ << std::endl;
+  return os;
+}
+
+// Multi-head self-attention over seq_len tokens per sample. The model
+// width is the number of features of a token, split evenly among the
+// heads. The output has the shape of the input.
+struct AttentionParam {
+  int num_heads_;
+  // Zero takes the channels of the input as the number of tokens
+  int seq_len_;
+  // Tokens only attend to themselves and earlier tokens
+  bool causal_;
+  AttentionParam()
+  : num_heads_(8), seq_len_(0), causal_(false) {}
+};
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const AttentionParam &attention_param) {
+  os << std::endl;
+  os << "[Attention Param] Heads: "
+     << attention_param.num_heads_ << std::endl;
+  os << "[Attention Param] Sequence Length: "
+     << attention_param.seq_len_ << std::endl;
+  os << "[Attention Param] Causal: "
+     << attention_param.causal_ << std::endl;
+  return os;
+}
+
 } // namespace dnnmark
 
 #endif // CORE_INCLUDE_DNN_PARAM_H_
@@ -34,6 +34,7 @@ class Handle {
  private:
   cudnnHandle_t *cudnn_handles_;
   cublasHandle_t *blas_handles_;
+  cudaStream_t *streams_;
   int num_cudnn_handles_;
   int num_blas_handles_;
  public:
@@ -46,9 +47,30 @@ class Handle {
   cublasHandle_t GetBlas(int index);
   int num_cudnn() { return num_cudnn_handles_; }
   int num_blas() { return num_blas_handles_; }
+  // Add handles up to the given number, existing ones keep their streams
+  void Grow(int num);
+
+  // Bind the cuDNN and cuBLAS handles of the given index to a stream
+  void SetStream(int index, cudaStream_t stream);
+  cudaStream_t GetStream();
+  cudaStream_t GetStream(int index);
 
 };
 
+// Measure elapsed device time between two points of a stream
+class Timer {
+ private:
+  cudaEvent_t start_;
+  cudaEvent_t stop_;
+ public:
+  Timer();
+  ~Timer();
+  void Start(cudaStream_t stream = 0);
+  void Stop(cudaStream_t stream = 0);
+  // Elapsed time in milliseconds, waits for the stop point to be reached
+  float Elapsed();
+};
+
 class Descriptor {
  protected:
   bool set_;
@@ -83,6 +105,12 @@ class DataTensor : public Descriptor {
     set_ = true;
   }
 
+  // Describe the tensor again, e.g. for another batch size
+  void Reset(int n, int c, int h, int w) {
+    set_ = false;
+    Set(n, c, h, w);
+  }
+
   cudnnTensorDescriptor_t Get() {
     if (set_)
       return desc_;
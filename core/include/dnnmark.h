@@ -29,7 +29,10 @@
 #include <string>
 #include <list>
 #include <map>
+#include <unordered_map>
 #include <memory>
+#include <functional>
+#include <vector>
 #include <glog/logging.h>
 
 #include "common.h"
@@ -42,18 +45,29 @@
 #include "dnn_layer.h"
 
 #include "activation_layer.h"
+#include "attention_layer.h"
+#include "batched_matmul_layer.h"
 #include "bn_layer.h"
 #include "bypass_layer.h"
 #include "conv_layer.h"
 #include "dropout_layer.h"
 #include "fc_layer.h"
+#include "gelu_layer.h"
+#include "layer_norm_layer.h"
 #include "lrn_layer.h"
 #include "pool_layer.h"
+#include "rnn_layer.h"
 #include "softmax_layer.h"
 
 namespace dnnmark {
 
-const std::map<std::string, LayerType> layer_type_map = {
+template <typename T> class Fusion;
+template <typename T> class InPlace;
+template <typename T> class Optimizer;
+template <typename T> class WorkspacePlanner;
+template <typename T> class Snapshot;
+
+const std::unordered_map<std::string, LayerType> layer_type_map = {
 {layer_section_keywords[0], CONVOLUTION},
 {layer_section_keywords[1], POOLING},
 {layer_section_keywords[2], LRN},
@@ -62,36 +76,207 @@ const std::map<std::string, LayerType> layer_type_map = {
 {layer_section_keywords[5], SOFTMAX},
 {layer_section_keywords[6], BN},
 {layer_section_keywords[7], DROPOUT},
-{layer_section_keywords[8], BYPASS}
+{layer_section_keywords[8], BYPASS},
+{layer_section_keywords[9], LSTM},
+{layer_section_keywords[10], GRU},
+{layer_section_keywords[11], BATCHED_MATMUL},
+{layer_section_keywords[12], LAYER_NORM},
+{layer_section_keywords[13], GELU},
+{layer_section_keywords[14], ATTENTION}
 };
 
 template <typename T>
 class DNNMark {
  private:
   RunMode run_mode_;
+  // Inference runs forward passes only and allocates no gradients
+  ExecutionMode mode_;
   Handle handle_;
   // The map is ordered, so we don't need other container to store the layers
   std::map<int, std::shared_ptr<Layer<T>>> layers_map_;
   std::map<std::string, int> name_id_map_;
   int num_layers_added_;
 
+  // Whether input layers get random data, once at Initialize and before
+  // each pass only when refill_each_iteration_ is set
+  bool data_fill_enabled_;
+  bool refill_each_iteration_;
+
+  // Tensors loaded over the random data at Initialize, none when empty
+  std::string snapshot_file_;
+
+  // Only algorithms and reductions giving the same result on every run
+  bool deterministic_;
+
+  // Background preparation of first layer batches
+  InputParam input_param_;
+  std::vector<std::shared_ptr<InputPipeline<T>>> input_pipelines_;
+
+  // Pipeline-parallel execution related
+  int pipeline_microbatches_;
+  int pipeline_stages_;
+  PipelineSchedule pipeline_schedule_;
+
+  // Number of data-parallel replicas
+  int num_replicas_;
+  // Gradient exchange granularity in bytes
+  size_t allreduce_bucket_size_;
+
+  // Activation memory budgets in bytes for rematerialization planning
+  std::vector<size_t> memory_budgets_;
+
+  // Layer tops moved to host memory between forward and backward
+  std::vector<std::string> offload_layers_;
+  int offload_slots_;
+
+  // Layer fusion pass, applied in composed mode unless disabled
+  bool fusion_enabled_;
+  std::shared_ptr<Fusion<T>> fusion_;
+
+  // In-place execution of layers whose backward allows it
+  bool in_place_enabled_;
+  std::shared_ptr<InPlace<T>> in_place_;
+
+  // Batch sizes timed over buffers allocated once for the largest one
+  std::vector<int> batch_sweep_;
+
+  // Parameter update applied by Update after the backward pass
+  OptimizerParam optimizer_param_;
+  std::shared_ptr<Optimizer<T>> optimizer_;
+
+  // Empirical convolution algorithm selection
+  AutotuneParam autotune_param_;
+
+  // Bytes all convolution workspaces share, zero for no budget
+  size_t workspace_budget_;
+  std::shared_ptr<WorkspacePlanner<T>> workspace_planner_;
+
+  // Invoked in Backward once a layer's weight gradients are produced
+  std::vector<std::function<void(Layer<T> *)>> gradient_ready_hooks_;
+
   // Private functions
-  void SetLayerParams(LayerType layer_type,
-                      int current_layer_id,
-                      const std::string &var,
-                      const std::string &val);
+  // Single pass over a config, sections not asked for are skipped. The
+  // source names the config in error messages.
+  int ParseConfig(std::istream &is, const std::string &source,
+                  bool general, bool layers);
+  // What is wrong with a configured layer, empty when nothing is
+  std::string CheckLayer(Layer<T> *layer);
+  // Named, connected and checked layer of the builder
+  Layer<T> *AddLayer(LayerType layer_type, const std::string &name,
+                     const std::string &previous_layer,
+                     const DataDim &input_dim);
+  template <typename P>
+  DNNMark<T> &AddLayer(LayerType layer_type, const std::string &name,
+                       const std::string &previous_layer,
+                       const DataDim &input_dim, const P &param,
+                       P *(*get_param)(Layer<T> *));
 
  public:
+  // Config keyword tables, each built once. A setter applies the value of
+  // its keyword and returns false when the value is malformed or out of
+  // range. Layer setters are only given layers of their table's type.
+  typedef std::function<bool(DNNMark<T> *, const std::string &)>
+    GeneralSetter;
+  typedef std::function<bool(DNNMark<T> *, Layer<T> *, const std::string &)>
+    LayerSetter;
+  typedef std::unordered_map<std::string, GeneralSetter> GeneralSetterTable;
+  typedef std::unordered_map<std::string, LayerSetter> LayerSetterTable;
+  static const GeneralSetterTable &GetGeneralSetters();
+  static const LayerSetterTable &GetLayerSetters(LayerType layer_type);
+
 
   DNNMark();
   DNNMark(int num_layers);
   int ParseAllConfig(const std::string &config_file);
+  int ParseAllConfig(std::istream &is);
   int ParseGeneralConfig(const std::string &config_file);
+  int ParseGeneralConfig(std::istream &is);
   int ParseLayerConfig(const std::string &config_file);
+  int ParseLayerConfig(std::istream &is);
+  // Drop all layers and what was planned on them, the handle and the
+  // general configuration are kept for the next ParseLayerConfig
+  void ClearLayers();
+  // Append an unconfigured layer, the next id in layer order
+  Layer<T> *CreateLayer(LayerType layer_type);
+
+  // Network builder, an alternative to ParseLayerConfig. Each call
+  // appends a layer, checks it like the parser does and returns the model
+  // for chaining, Initialize then sets the layers up as usual. The input
+  // dimension is only read for first layers, whose previous layer is
+  // "null", e.g.
+  //   dnnmark.Set("run_mode", "composed")
+  //          .AddConvolution("conv1", "null", conv, DataDim(64, 3, 224, 224))
+  //          .AddActivation("relu1", "conv1", ActivationParam());
+  // Set applies a [DNNMark] keyword through the parser's setter.
+  DNNMark<T> &Set(const std::string &var, const std::string &val);
+  DNNMark<T> &AddConvolution(const std::string &name,
+                             const std::string &previous_layer,
+                             const ConvolutionParam &param,
+                             const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddPooling(const std::string &name,
+                         const std::string &previous_layer,
+                         const PoolingParam &param,
+                         const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddLRN(const std::string &name,
+                     const std::string &previous_layer,
+                     const LRNParam &param,
+                     const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddActivation(const std::string &name,
+                            const std::string &previous_layer,
+                            const ActivationParam &param,
+                            const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddFullyConnected(const std::string &name,
+                                const std::string &previous_layer,
+                                const FullyConnectedParam &param,
+                                const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddSoftmax(const std::string &name,
+                         const std::string &previous_layer,
+                         const SoftmaxParam &param,
+                         const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddBatchNorm(const std::string &name,
+                           const std::string &previous_layer,
+                           const BatchNormParam &param,
+                           const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddDropout(const std::string &name,
+                         const std::string &previous_layer,
+                         const DropoutParam &param,
+                         const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddBypass(const std::string &name,
+                        const std::string &previous_layer,
+                        const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddLSTM(const std::string &name,
+                      const std::string &previous_layer,
+                      const RNNParam &param,
+                      const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddGRU(const std::string &name,
+                     const std::string &previous_layer,
+                     const RNNParam &param,
+                     const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddBatchedMatMul(const std::string &name,
+                               const std::string &previous_layer,
+                               const BatchedMatMulParam &param,
+                               const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddLayerNorm(const std::string &name,
+                           const std::string &previous_layer,
+                           const LayerNormParam &param,
+                           const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddGELU(const std::string &name,
+                      const std::string &previous_layer,
+                      const GELUParam &param,
+                      const DataDim &input_dim = DataDim());
+  DNNMark<T> &AddAttention(const std::string &name,
+                           const std::string &previous_layer,
+                           const AttentionParam &param,
+                           const DataDim &input_dim = DataDim());
   int Initialize();
   int RunAll();
   int Forward();
   int Backward();
+  int Update();
+  // Parameters, running statistics and random inputs of the model, see
+  // Snapshot for the file format
+  int SaveSnapshot(const std::string &file);
+  int LoadSnapshot(const std::string &file);
 
   Handle *GetHandle() { return &handle_; }
   Layer<T> *GetLayerByID(int layer_id) { return layers_map_[layer_id].get(); }
@@ -101,7 +286,56 @@ class DNNMark {
   bool isLayerExist(const std::string &name) {
     return name_id_map_.find(name) != name_id_map_.end();
   }
+  // The single layer reading the top of the given one, null otherwise
+  Layer<T> *GetSoleConsumer(Layer<T> *layer);
   RunMode getRunMode() { return run_mode_; }
+  ExecutionMode getMode() { return mode_; }
+  bool isTraining() { return mode_ == TRAINING; }
+  int getNumLayers() { return layers_map_.size(); }
+  bool isDataFillEnabled() { return data_fill_enabled_; }
+  void setDataFillEnabled(bool enabled) { data_fill_enabled_ = enabled; }
+  bool isRefillEachIteration() { return refill_each_iteration_; }
+  std::string getSnapshotFile() { return snapshot_file_; }
+  InputParam *getInputParam() { return &input_param_; }
+  // One per first layer with a pipeline, set up by the layer
+  void AddInputPipeline(const std::shared_ptr<InputPipeline<T>> &pipeline) {
+    input_pipelines_.push_back(pipeline);
+  }
+  const std::vector<std::shared_ptr<InputPipeline<T>>> &getInputPipelines() {
+    return input_pipelines_;
+  }
+  bool isDeterministic() { return deterministic_; }
+  void setDeterministic(bool deterministic) { deterministic_ = deterministic; }
+  int getPipelineMicrobatches() { return pipeline_microbatches_; }
+  int getPipelineStages() { return pipeline_stages_; }
+  PipelineSchedule getPipelineSchedule() { return pipeline_schedule_; }
+  int getNumReplicas() { return num_replicas_; }
+  size_t getAllreduceBucketSize() { return allreduce_bucket_size_; }
+  const std::vector<size_t> &getMemoryBudgets() { return memory_budgets_; }
+  const std::vector<std::string> &getOffloadLayers() {
+    return offload_layers_;
+  }
+  int getOffloadSlots() { return offload_slots_; }
+  bool isFusionEnabled() { return fusion_enabled_; }
+  // Null when no fusion pass ran
+  Fusion<T> *GetFusion() { return fusion_.get(); }
+  bool isInPlaceEnabled() { return in_place_enabled_; }
+  // Null when no in-place analysis ran
+  InPlace<T> *GetInPlace() { return in_place_.get(); }
+  const std::vector<int> &getBatchSweep() { return batch_sweep_; }
+  OptimizerParam *getOptimizerParam() { return &optimizer_param_; }
+  // Null when no optimizer is configured
+  Optimizer<T> *GetOptimizer() { return optimizer_.get(); }
+  AutotuneParam *getAutotuneParam() { return &autotune_param_; }
+  size_t getWorkspaceBudget() { return workspace_budget_; }
+  // Null when no workspace budget is set
+  WorkspacePlanner<T> *GetWorkspacePlanner() {
+    return workspace_planner_.get();
+  }
+  void AddGradientReadyHook(const std::function<void(Layer<T> *)> &hook) {
+    gradient_ready_hooks_.push_back(hook);
+  }
+  void ClearGradientReadyHooks() { gradient_ready_hooks_.clear(); }
 
 };
 
@@ -0,0 +1,80 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_DRY_RUN_H_
+#define CORE_INCLUDE_DRY_RUN_H_
+
+#include <string>
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// Static analysis of a parsed model. Shapes are propagated through the
+// ComputeOutputDim of every layer and the cost of each layer is derived
+// from its shapes and parameters, without Setup and without any device
+// allocation. FLOPs count a multiply-add as two operations, elementwise
+// layers are approximated by a fixed number of operations per element.
+//
+
+template <typename T>
+class DryRun {
+ private:
+  struct LayerSummary {
+    Layer<T> *layer;
+    size_t num_params;
+    double fwd_flops;
+    double bwd_data_flops;
+    double bwd_filter_flops;
+    // Weights, their gradients and other per-layer state
+    size_t param_bytes;
+    // Top and, in training, top diff unless aliased to the bottom
+    size_t activation_bytes;
+    // Explicit GEMM lowering of one sample for each convolution pass
+    size_t workspace_bytes;
+  };
+
+  DNNMark<T> *p_dnnmark_;
+  std::vector<LayerSummary> summaries_;
+  // Bottom and bottom diff of the first layer
+  size_t input_bytes_;
+
+  void InferShape(Layer<T> *layer);
+  LayerSummary Summarize(Layer<T> *layer);
+  std::string TypeName(LayerType type);
+
+ public:
+  DryRun(DNNMark<T> *p_dnnmark);
+  int Run();
+  void Report();
+
+  // Everything Setup allocates stays resident, so the peak is the sum
+  size_t getPeakBytes();
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_DRY_RUN_H_
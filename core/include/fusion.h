@@ -0,0 +1,86 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_FUSION_H_
+#define CORE_INCLUDE_FUSION_H_
+
+#include <string>
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnn_utility.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// Layer fusion pass over a composed model. Recognized patterns are
+//   Convolution -> Activation(ReLU): bias and ReLU in the conv epilogue
+//   Convolution -> BatchNorm: inference BN folded into weights and bias
+//   BatchNorm -> Activation(ReLU): one pass over the data instead of two
+// Merged layers are planned before Setup to run in place on the top of
+// the producer, which computes them in its own forward once the pass is
+// applied after Setup. Absorbed layers skip their forward. Folding
+// writes separate chunks, so the parameters keep their trained values.
+//
+
+template <typename T>
+class Fusion {
+ private:
+  struct Group {
+    std::string pattern;
+    // Producer first, then the absorbed layers in forward order
+    std::vector<Layer<T> *> layers;
+    // Intermediate tops that are no longer written and read back
+    size_t bytes_saved;
+    // Forward time of the layers in the group in milliseconds
+    float time_before;
+    float time_after;
+  };
+
+  DNNMark<T> *p_dnnmark_;
+  std::vector<Group> groups_;
+  bool applied_;
+
+  bool isReLU(Layer<T> *layer);
+  bool isFoldable(Layer<T> *layer);
+  float TimeForward(const std::vector<Layer<T> *> &layers);
+  // Fold the current parameters of the group into its producer
+  void Fuse(const Group &group);
+
+ public:
+  Fusion(DNNMark<T> *p_dnnmark);
+  // Find the groups on the parsed layers, before Setup
+  int Plan();
+  // Fuse the groups on the set up layers
+  int Apply();
+  // Fold again after the parameters changed, e.g. a snapshot was loaded
+  int Refold();
+  void Report();
+
+  int getNumFusions() { return groups_.size(); }
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_FUSION_H_
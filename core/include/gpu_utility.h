@@ -37,6 +37,24 @@ void DNNMarkGEMM(cublasHandle_t handle,
                  T *beta,
                  T *c, int ldc);
 
+// y = alpha * x + y
+// batch_count products of the same shape, matrix i of an operand starts
+// i * stride elements after the first one
+template <typename T>
+void DNNMarkBatchedGEMM(cublasHandle_t handle,
+                        bool is_a_transpose, bool is_b_transpose,
+                        int m, int n, int k,
+                        T *alpha,
+                        T *a, int lda, long long stride_a,
+                        T *b, int ldb, long long stride_b,
+                        T *beta,
+                        T *c, int ldc, long long stride_c,
+                        int batch_count);
+
+template <typename T>
+void DNNMarkAXPY(cublasHandle_t handle, int n,
+                 T *alpha, T *x, T *y);
+
 } // namespace dnnmark
 
 #endif // CORE_INCLUDE_GPU_UTILITY_H_
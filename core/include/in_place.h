@@ -0,0 +1,67 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_IN_PLACE_H_
+#define CORE_INCLUDE_IN_PLACE_H_
+
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// In-place analysis over a composed model. Activation, GELU, dropout and
+// batch normalization layers get their top aliased to their bottom when
+//   - they are the only consumer of the bottom,
+//   - their own backward does not read the bottom, and
+//   - no layer sharing the bottom chunk reads it in its backward.
+// The decision is taken before Setup, which then skips allocating the
+// top and, for elementwise gradients, the top diff.
+//
+
+template <typename T>
+class InPlace {
+ private:
+  DNNMark<T> *p_dnnmark_;
+  // Layers made in place by the analysis, fused layers not included
+  std::vector<Layer<T> *> layers_;
+
+  Layer<T> *Producer(Layer<T> *layer);
+  bool isCandidate(Layer<T> *layer);
+  // Device memory not allocated because the layer runs in place
+  size_t BytesSaved(Layer<T> *layer);
+
+ public:
+  InPlace(DNNMark<T> *p_dnnmark);
+  // Mark the layers on the parsed model, before Setup
+  int Plan();
+  void Report();
+
+  int getNumInPlace() { return layers_.size(); }
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_IN_PLACE_H_
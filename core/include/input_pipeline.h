@@ -0,0 +1,100 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_INPUT_PIPELINE_H_
+#define CORE_INCLUDE_INPUT_PIPELINE_H_
+
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnn_param.h"
+#include "cifar_reader.h"
+
+namespace dnnmark {
+
+//
+// Producer/consumer preparation of first layer batches. Worker threads
+// assemble batch k into pinned host slot k % prefetch_slots: the records
+// are read (from a CIFAR-10 reader, or synthesized without one), optionally
+// cropped and mirrored, and normalized into NCHW. The layer's fill step
+// consumes batches in order by copying the ready slot to the device
+// asynchronously, so preparation overlaps the network running the
+// previous batch. Time the consumer spends waiting for a slot is the
+// input-bound part of the step.
+//
+
+template <typename T>
+class InputPipeline {
+ private:
+  enum SlotState { FREE, FILLING, READY };
+  struct Slot {
+    T *host_;
+    SlotState state_;
+    // Batch the slot holds or will hold next
+    long long batch_;
+    // Recorded after the copy out of the slot, waited on before refilling
+    cudaEvent_t copied_;
+  };
+
+  InputParam param_;
+  DataDim dim_;
+  std::shared_ptr<CifarReader<T>> reader_;
+  int image_size_;
+
+  std::vector<Slot> slots_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stop_;
+  long long next_produce_;
+  long long next_consume_;
+
+  // Statistics in milliseconds
+  double prepare_time_;
+  double wait_time_;
+  double first_consume_;
+  double last_consume_;
+
+  void Worker();
+  void Prepare(long long batch, T *dst);
+
+ public:
+  InputPipeline(const InputParam &param, const DataDim &dim,
+                const std::shared_ptr<CifarReader<T>> &reader);
+  ~InputPipeline();
+  // Copy the next batch, size elements, into dst on the default stream
+  void Consume(T *dst, int size);
+  void Report();
+
+  long long getNumConsumed() { return next_consume_; }
+  // Share of the time since the first batch spent waiting for input
+  double getInputBoundFraction();
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_INPUT_PIPELINE_H_
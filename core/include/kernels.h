@@ -0,0 +1,226 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_KERNELS_H_
+#define CORE_INCLUDE_KERNELS_H_
+
+#include <cuda_runtime.h>
+
+namespace dnnmark {
+
+//
+// Custom CUDA kernels for operations cuDNN does not provide fused.
+// The kernels live in kernels.cu, only host side launchers are exposed.
+//
+
+// y = act(x * scale[c] + shift[c]), c = (i / inner) % channels.
+// inner is H * W for per-channel and 1 for per-activation parameters.
+template <typename T>
+void DNNMarkScaleShiftActivation(cudaStream_t stream, int n,
+                                 int channels, int inner,
+                                 const T *x, const T *scale, const T *shift,
+                                 T *y, bool relu);
+
+// Uniform random data in (0, 1] from a counter-based generator. The
+// values only depend on the seed, the fill number and the element index,
+// so a chunk gets the same data on every run and a new set on each fill.
+template <typename T>
+void DNNMarkFillUniform(cudaStream_t stream, int n,
+                        unsigned long long seed, unsigned int fill, T *y);
+
+// Convert n CIFAR-10 records (a label byte and three 32x32 uint8 planes)
+// into NCHW data normalized with the per-channel dataset mean and
+// standard deviation.
+template <typename T>
+void DNNMarkCifarToNCHW(cudaStream_t stream, int n,
+                        const unsigned char *records, T *y);
+
+// Elements of one tensor processed by a block of a multi-tensor update
+const int kMultiTensorChunk = 16384;
+
+// Parameter tensors updated by a single launch, all arrays in device
+// memory. Block b processes up to kMultiTensorChunk elements of tensor
+// block_tensor[b] starting at element block_offset[b]. state1 and state2
+// hold the optimizer state per tensor, unused entries may be null.
+template <typename T>
+struct MultiTensorList {
+  int num_tensors;
+  int num_blocks;
+  const int *sizes;
+  const int *block_tensor;
+  const int *block_offset;
+  T **params;
+  T **grads;
+  T **state1;
+  T **state2;
+};
+
+// SGD with momentum, state1 is the velocity
+// v = momentum * v + g + weight_decay * w, w -= lr * v
+template <typename T>
+void DNNMarkSGDMomentumUpdate(cudaStream_t stream,
+                              const MultiTensorList<T> &list,
+                              T lr, T momentum, T weight_decay);
+
+// Adam with decoupled weight decay, state1 and state2 are the first and
+// second moments. bias_correction1 and bias_correction2 are
+// 1 - beta1^t and 1 - beta2^t for step t.
+template <typename T>
+void DNNMarkAdamUpdate(cudaStream_t stream, const MultiTensorList<T> &list,
+                       T lr, T beta1, T beta2, T epsilon, T weight_decay,
+                       T bias_correction1, T bias_correction2);
+
+// LAMB: the Adam update of every tensor is scaled by the trust ratio
+// ||w|| / ||update||. The first pass leaves the update in the gradients
+// and accumulates both squared norms per tensor into norms, which holds
+// 2 * num_tensors entries. The second pass applies the update.
+// Block sums go to partials, with 2 * num_blocks entries, and are added
+// up in a fixed order, so the result is the same on every run and no
+// double atomics are needed.
+template <typename T>
+void DNNMarkLAMBUpdate(cudaStream_t stream, const MultiTensorList<T> &list,
+                       T *norms, T *partials, T lr, T beta1, T beta2,
+                       T epsilon, T weight_decay, T bias_correction1,
+                       T bias_correction2);
+
+// One timestep of a recurrent layer over n sequences. Row s of a
+// strided tensor starts s * stride elements in, recur, h_diff and
+// c_diff are packed. Gates are input, forget, cell and output for LSTM
+// and reset, update and candidate for GRU.
+template <typename T>
+struct RNNStep {
+  int n;
+  int hidden;
+  // Input projection x * W_x of the step. Forward replaces it with the
+  // gate activations, backward with the gate pre-activation gradients.
+  T *gates;
+  int gate_stride;
+  // Projection h_prev * W_h of the previous hidden state, null at the
+  // first step. GRU backward writes its gradient here.
+  T *recur;
+  // Biases of the input and the recurrent projection, one combined
+  // bias for LSTM
+  const T *bias;
+  // LSTM cell state, GRU recurrent candidate term h_prev * W_hn + b_hn.
+  // GRU backward replaces the latter with its gradient.
+  T *cell;
+  const T *cell_prev;
+  int cell_stride;
+  // Hidden state forward, gradient from the layer above backward
+  T *h;
+  const T *h_prev;
+  int hidden_stride;
+  // Gradients flowing to the previous step. carry is set when they hold
+  // those of the following step, to be added.
+  T *h_diff;
+  T *c_diff;
+  bool carry;
+};
+
+// Fused gate nonlinearities and state updates of a step, the GEMMs of
+// the projections are left to the caller
+template <typename T>
+void DNNMarkLSTMForwardStep(cudaStream_t stream, const RNNStep<T> &step);
+template <typename T>
+void DNNMarkLSTMBackwardStep(cudaStream_t stream, const RNNStep<T> &step);
+template <typename T>
+void DNNMarkGRUForwardStep(cudaStream_t stream, const RNNStep<T> &step);
+template <typename T>
+void DNNMarkGRUBackwardStep(cudaStream_t stream, const RNNStep<T> &step);
+
+// GELU of n elements, the tanh approximation or the exact erf form. x and
+// y may be the same. Backward computes the gradient from the input.
+template <typename T>
+void DNNMarkGELUForward(cudaStream_t stream, int n, bool approximate,
+                        const T *x, T *y);
+template <typename T>
+void DNNMarkGELUBackward(cudaStream_t stream, int n, bool approximate,
+                         const T *x, const T *y_diff, T *x_diff);
+
+// Rows of a chunk whose gamma and beta gradients a block sums into
+// partials, which are then added up in a fixed order
+const int kLayerNormRowChunk = 32;
+
+// Layer normalization of rows of features elements with a scale gamma
+// and a shift beta per feature. Forward keeps the mean and the reciprocal
+// standard deviation of every row for backward, which writes the
+// gradients of the input, gamma and beta. partials holds
+// 2 * features * ceil(rows / kLayerNormRowChunk) entries.
+template <typename T>
+void DNNMarkLayerNormForward(cudaStream_t stream, int rows, int features,
+                             T epsilon, const T *x, const T *gamma,
+                             const T *beta, T *y, T *mean, T *rstd);
+template <typename T>
+void DNNMarkLayerNormBackward(cudaStream_t stream, int rows, int features,
+                              const T *x, const T *y_diff, const T *gamma,
+                              const T *mean, const T *rstd, T *x_diff,
+                              T *gamma_diff, T *beta_diff, T *partials);
+
+// Queries per block of the attention kernels, one per thread, and keys
+// staged in shared memory at a time. Heads are at most kMaxHeadDim wide.
+const int kAttentionRows = 64;
+const int kAttentionTile = 16;
+const int kMaxHeadDim = 128;
+
+// Scaled dot-product attention of num_heads heads in each of n samples.
+// Token t of sample s starts (s * seq_len + t) times the stride into a
+// tensor, its head h another h * head_dim elements in. Gradients have
+// the strides of their tensors.
+template <typename T>
+struct AttentionArgs {
+  int n;
+  int seq_len;
+  int num_heads;
+  int head_dim;
+  const T *q;
+  const T *k;
+  const T *v;
+  int qkv_stride;
+  T *o;
+  int o_stride;
+  // Log-sum-exp of the scores of each query, n * num_heads * seq_len
+  // entries written by forward
+  T *lse;
+  // Sum of o * o_diff of each query, computed by backward
+  T *delta;
+  T scale;
+  bool causal;
+  const T *o_diff;
+  T *q_diff;
+  T *k_diff;
+  T *v_diff;
+};
+
+// Forward runs the softmax online over tiles of keys and never stores
+// the seq_len x seq_len scores. Backward recomputes them from lse, once
+// for the key and value gradients and once for the query gradients, so
+// no gradient is accumulated by atomics.
+template <typename T>
+void DNNMarkAttentionForward(cudaStream_t stream,
+                             const AttentionArgs<T> &args);
+template <typename T>
+void DNNMarkAttentionBackward(cudaStream_t stream,
+                              const AttentionArgs<T> &args);
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_KERNELS_H_
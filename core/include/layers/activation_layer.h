@@ -50,6 +50,12 @@ class ActivationLayer : public Layer<T> {
   using Layer<T>::top_chunk_ids_;
   using Layer<T>::top_diffs_;
   using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::batch_begin_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
 
  private:
   ActivationParam activation_param_;
@@ -94,11 +100,15 @@ class ActivationLayer : public Layer<T> {
                      output_dim_.h_ *
                      output_dim_.w_;
       for (int i = 0; i < num_tops_; i++) {
-        top_chunk_ids_.push_back(
+        top_chunk_ids_.push_back(Layer<T>::isInPlace() ?
+          bottom_chunk_ids_[i] :
           data_manager_->CreateData(top_size));
         tops_.push_back(
           data_manager_->GetData(top_chunk_ids_[i]));
-        top_diff_chunk_ids_.push_back(
+        if (!Layer<T>::isTraining())
+          continue;
+        top_diff_chunk_ids_.push_back(Layer<T>::isInPlace() ?
+          bottom_diff_chunk_ids_[i] :
           data_manager_->CreateData(top_size));
         top_diffs_.push_back(
           data_manager_->GetData(top_diff_chunk_ids_[i]));
@@ -106,6 +116,14 @@ class ActivationLayer : public Layer<T> {
     }
   }
 
+  // These modes compute the gradient from the output alone
+  bool BackwardReadsBottom() {
+    return activation_param_.mode_ != CUDNN_ACTIVATION_RELU &&
+           activation_param_.mode_ != CUDNN_ACTIVATION_SIGMOID &&
+           activation_param_.mode_ != CUDNN_ACTIVATION_TANH &&
+           activation_param_.mode_ != CUDNN_ACTIVATION_CLIPPED_RELU;
+  }
+
   void ComputeOutputDim() {
     output_dim_.n_ = input_dim_.n_;
     output_dim_.c_ = input_dim_.c_;
@@ -114,8 +132,11 @@ class ActivationLayer : public Layer<T> {
   }
 
   void ForwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    // The producer of the bottom already computed this layer in place
+    if (Layer<T>::isAbsorbed())
+      return;
+
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
         bottoms_[i]->Filler();
@@ -131,16 +152,15 @@ class ActivationLayer : public Layer<T> {
              p_dnnmark_->GetHandle()->GetCudnn(),
              desc_.Get(),
              DataType<T>::one, 
-             bottom_desc_.Get(), bottoms_[i]->Get(),
+             bottom_desc_.Get(), BottomPtr(i),
              DataType<T>::zero,
-             top_desc_.Get(), tops_[i]->Get()));
+             top_desc_.Get(), TopPtr(i)));
     }
     cudaProfilerStop();
 
   }
   void BackwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the top and top diff data
       for (int i = 0; i < num_tops_; i++) {
         tops_[i]->Filler();
@@ -148,7 +168,8 @@ class ActivationLayer : public Layer<T> {
       }
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
-        bottoms_[i]->Filler();
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
       }
     }
 
@@ -161,11 +182,11 @@ class ActivationLayer : public Layer<T> {
              p_dnnmark_->GetHandle()->GetCudnn(),
              desc_.Get(),
              DataType<T>::one, 
-             top_desc_.Get(), tops_[i]->Get(),
-             top_desc_.Get(), top_diffs_[i]->Get(),
-             bottom_desc_.Get(), bottoms_[i]->Get(),
+             top_desc_.Get(), TopPtr(i),
+             top_desc_.Get(), TopDiffPtr(i),
+             bottom_desc_.Get(), BottomPtr(i),
              DataType<T>::zero,
-             bottom_desc_.Get(), bottom_diffs_[i]->Get()));
+             bottom_desc_.Get(), BottomDiffPtr(i)));
     }
     cudaProfilerStop();
   }
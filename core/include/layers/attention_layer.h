@@ -0,0 +1,350 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef CORE_INCLUDE_LAYERS_ATTENTION_LAYER_H_
+#define CORE_INCLUDE_LAYERS_ATTENTION_LAYER_H_
+
+#include <cmath>
+
+#include "dnn_layer.h"
+#include "kernels.h"
+
+namespace dnnmark {
+
+//
+// Multi-head self-attention. The input holds seq_len tokens of width
+// features per sample. One GEMM projects all tokens to queries, keys and
+// values, a fused kernel computes the scaled dot-product attention of
+// every head without storing the scores, and a second GEMM projects the
+// concatenated heads back to the model width. Like the fully connected
+// layer the projections have no bias. Backward reads the projections and
+// the softmax statistics of the last forward pass, so it needs the
+// forward pass before it.
+//
+
+template <typename T>
+class AttentionLayer : public Layer<T> {
+  // using declaration for calling member from base class
+  using Layer<T>::p_dnnmark_;
+  using Layer<T>::layer_id_;
+  using Layer<T>::input_dim_;
+  using Layer<T>::output_dim_;
+  using Layer<T>::bottom_desc_;
+  using Layer<T>::top_desc_;
+  using Layer<T>::data_manager_;
+
+  using Layer<T>::num_bottoms_;
+  using Layer<T>::bottoms_;
+  using Layer<T>::bottom_chunk_ids_;
+  using Layer<T>::bottom_diffs_;
+  using Layer<T>::bottom_diff_chunk_ids_;
+
+  using Layer<T>::num_tops_;
+  using Layer<T>::tops_;
+  using Layer<T>::top_chunk_ids_;
+  using Layer<T>::top_diffs_;
+  using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::param_chunk_ids_;
+  using Layer<T>::param_diff_chunk_ids_;
+  using Layer<T>::batch_begin_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
+
+ private:
+  AttentionParam attention_param_;
+
+  int seq_len_;
+  // Model width and its part of a head
+  int width_;
+  int head_dim_;
+  T scale_alpha_;
+  T scale_beta_;
+
+  // Query, key and value projection, 3 * width x width, and the output
+  // projection, width x width
+  Data<T> *weights_qkv_;
+  Data<T> *weights_out_;
+  Data<T> *weights_qkv_diff_;
+  Data<T> *weights_out_diff_;
+
+  // Queries, keys and values of a token next to each other, the attention
+  // output of all heads and the log-sum-exp of the scores of each query
+  Data<T> *qkv_;
+  Data<T> *attention_;
+  Data<T> *lse_;
+  Data<T> *qkv_diff_;
+  Data<T> *attention_diff_;
+  Data<T> *delta_;
+
+  cublasHandle_t Blas() {
+    return p_dnnmark_->getRunMode() == COMPOSED ?
+           p_dnnmark_->GetHandle()->GetBlas(layer_id_) :
+           p_dnnmark_->GetHandle()->GetBlas();
+  }
+
+  cudaStream_t Stream() {
+    return p_dnnmark_->getRunMode() == COMPOSED ?
+           p_dnnmark_->GetHandle()->GetStream(layer_id_) :
+           p_dnnmark_->GetHandle()->GetStream();
+  }
+
+  Data<T> *CreateData(int size) {
+    return data_manager_->GetData(data_manager_->CreateData(size));
+  }
+
+  // Learnable tensor and its gradient
+  Data<T> *CreateParam(int size, Data<T> **diff) {
+    int chunk_id = data_manager_->CreateData(size);
+    Data<T> *param = data_manager_->GetData(chunk_id);
+    param_chunk_ids_.push_back(chunk_id);
+    param->Filler();
+    if (Layer<T>::isTraining()) {
+      int diff_chunk_id = data_manager_->CreateData(size);
+      param_diff_chunk_ids_.push_back(diff_chunk_id);
+      *diff = data_manager_->GetData(diff_chunk_id);
+    }
+    return param;
+  }
+
+  // Attention of the heads of the current batch view
+  AttentionArgs<T> Args() {
+    int token_begin = batch_begin_ * seq_len_;
+    AttentionArgs<T> args;
+    args.n = batch_n_;
+    args.seq_len = seq_len_;
+    args.num_heads = attention_param_.num_heads_;
+    args.head_dim = head_dim_;
+    args.q = qkv_->Get() + token_begin * 3 * width_;
+    args.k = args.q + width_;
+    args.v = args.q + 2 * width_;
+    args.qkv_stride = 3 * width_;
+    args.o = attention_->Get() + token_begin * width_;
+    args.o_stride = width_;
+    args.lse = lse_->Get() + token_begin * attention_param_.num_heads_;
+    args.delta = nullptr;
+    args.scale = T(1) / std::sqrt(T(head_dim_));
+    args.causal = attention_param_.causal_;
+    args.o_diff = nullptr;
+    args.q_diff = nullptr;
+    args.k_diff = nullptr;
+    args.v_diff = nullptr;
+    if (Layer<T>::isTraining()) {
+      args.delta = delta_->Get() + token_begin * attention_param_.num_heads_;
+      args.o_diff = attention_diff_->Get() + token_begin * width_;
+      args.q_diff = qkv_diff_->Get() + token_begin * 3 * width_;
+      args.k_diff = args.q_diff + width_;
+      args.v_diff = args.q_diff + 2 * width_;
+    }
+    return args;
+  }
+
+ public:
+  AttentionLayer(DNNMark<T> *p_dnnmark)
+  : Layer<T>(p_dnnmark),
+    attention_param_() {
+    Layer<T>::has_learnable_params_ = true;
+  }
+
+  AttentionParam *getAttentionParam() { return &attention_param_; }
+
+  void Setup() {
+    // Set up indispensable stuff here
+    Layer<T>::Setup();
+
+    // Set up attention related data
+    if (input_dim_.n_ != 0 && input_dim_.c_ != 0 &&
+        input_dim_.h_ != 0 && input_dim_.w_ != 0) {
+      //
+      // Standalone mode
+      //
+
+      // Compute dimension of output data
+      ComputeOutputDim();
+
+      // Set top tensor
+      top_desc_.Set(output_dim_.n_,
+                    output_dim_.c_,
+                    output_dim_.h_,
+                    output_dim_.w_);
+
+      // Prepare top data
+      int top_size = output_dim_.n_ *
+                     output_dim_.c_ *
+                     output_dim_.h_ *
+                     output_dim_.w_;
+      for (int i = 0; i < num_tops_; i++) {
+        top_chunk_ids_.push_back(
+          data_manager_->CreateData(top_size));
+        tops_.push_back(
+          data_manager_->GetData(top_chunk_ids_[i]));
+        if (!Layer<T>::isTraining())
+          continue;
+        top_diff_chunk_ids_.push_back(
+          data_manager_->CreateData(top_size));
+        top_diffs_.push_back(
+          data_manager_->GetData(top_diff_chunk_ids_[i]));
+      }
+    }
+
+    int tokens = input_dim_.n_ * seq_len_;
+    weights_qkv_ = CreateParam(3 * width_ * width_, &weights_qkv_diff_);
+    weights_out_ = CreateParam(width_ * width_, &weights_out_diff_);
+    qkv_ = CreateData(tokens * 3 * width_);
+    attention_ = CreateData(tokens * width_);
+    lse_ = CreateData(tokens * attention_param_.num_heads_);
+    if (Layer<T>::isTraining()) {
+      qkv_diff_ = CreateData(tokens * 3 * width_);
+      attention_diff_ = CreateData(tokens * width_);
+      delta_ = CreateData(tokens * attention_param_.num_heads_);
+    }
+
+    scale_alpha_ = (T)1.0;
+    scale_beta_ = (T)0.0;
+  }
+
+  bool BackwardReadsTop() { return false; }
+
+  void ComputeOutputDim() {
+    int features = input_dim_.c_ * input_dim_.h_ * input_dim_.w_;
+    seq_len_ = attention_param_.seq_len_ > 0 ? attention_param_.seq_len_ :
+                                               input_dim_.c_;
+    CHECK_EQ(features % seq_len_, 0)
+      << Layer<T>::getLayerName() << ": " << features
+      << " input features per sample are no multiple of " << seq_len_
+      << " tokens";
+    width_ = features / seq_len_;
+    CHECK_EQ(width_ % attention_param_.num_heads_, 0)
+      << Layer<T>::getLayerName() << ": width " << width_
+      << " does not split into " << attention_param_.num_heads_ << " heads";
+    head_dim_ = width_ / attention_param_.num_heads_;
+    CHECK_LE(head_dim_, kMaxHeadDim)
+      << Layer<T>::getLayerName() << ": heads are at most " << kMaxHeadDim
+      << " wide";
+    output_dim_.n_ = input_dim_.n_;
+    output_dim_.c_ = input_dim_.c_;
+    output_dim_.h_ = input_dim_.h_;
+    output_dim_.w_ = input_dim_.w_;
+  }
+
+  void ForwardPropagation() {
+    if (Layer<T>::isDataFillRequired()) {
+      // Fill the bottom data
+      for (int i = 0; i < num_bottoms_; i++) {
+        bottoms_[i]->Filler();
+      }
+    }
+
+    int tokens = batch_n_ * seq_len_;
+    T *qkv = qkv_->Get() + batch_begin_ * seq_len_ * 3 * width_;
+    AttentionArgs<T> args = Args();
+
+    // Attention forward computation
+    cudaProfilerStart();
+    for (int i = 0; i < num_bottoms_; i++) {
+      // T(QKV) = W_qkv * T(X)
+      DNNMarkGEMM(Blas(), false, false,
+                  3 * width_, tokens, width_,
+                  &scale_alpha_,
+                  weights_qkv_->Get(), 3 * width_,
+                  BottomPtr(i), width_,
+                  &scale_beta_,
+                  qkv, 3 * width_);
+      DNNMarkAttentionForward(Stream(), args);
+      // T(Y) = W_out * T(O)
+      DNNMarkGEMM(Blas(), false, false,
+                  width_, tokens, width_,
+                  &scale_alpha_,
+                  weights_out_->Get(), width_,
+                  args.o, width_,
+                  &scale_beta_,
+                  TopPtr(i), width_);
+    }
+    cudaProfilerStop();
+  }
+
+  void BackwardPropagation() {
+    if (Layer<T>::isDataFillRequired()) {
+      // Fill the top and top diff data
+      for (int i = 0; i < num_tops_; i++) {
+        tops_[i]->Filler();
+        top_diffs_[i]->Filler();
+      }
+      // Fill the bottom data
+      for (int i = 0; i < num_bottoms_; i++) {
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
+      }
+    }
+
+    int tokens = batch_n_ * seq_len_;
+    T *o_diff = attention_diff_->Get() + batch_begin_ * seq_len_ * width_;
+    AttentionArgs<T> args = Args();
+
+    // Attention backward computation
+    cudaProfilerStart();
+    for (int i = 0; i < num_tops_; i++) {
+      // T(dO) = T(W_out) * T(dY)
+      DNNMarkGEMM(Blas(), true, false,
+                  width_, tokens, width_,
+                  &scale_alpha_,
+                  weights_out_->Get(), width_,
+                  TopDiffPtr(i), width_,
+                  &scale_beta_,
+                  o_diff, width_);
+      // d(W_out) = T(dY) * O
+      DNNMarkGEMM(Blas(), false, true,
+                  width_, width_, tokens,
+                  &scale_alpha_,
+                  TopDiffPtr(i), width_,
+                  args.o, width_,
+                  &scale_beta_,
+                  weights_out_diff_->Get(), width_);
+      DNNMarkAttentionBackward(Stream(), args);
+      // d(W_qkv) = T(dQKV) * X
+      DNNMarkGEMM(Blas(), false, true,
+                  3 * width_, width_, tokens,
+                  &scale_alpha_,
+                  args.q_diff, 3 * width_,
+                  BottomPtr(i), width_,
+                  &scale_beta_,
+                  weights_qkv_diff_->Get(), 3 * width_);
+      // T(dX) = T(W_qkv) * T(dQKV)
+      DNNMarkGEMM(Blas(), true, false,
+                  width_, tokens, 3 * width_,
+                  &scale_alpha_,
+                  weights_qkv_->Get(), 3 * width_,
+                  args.q_diff, 3 * width_,
+                  &scale_beta_,
+                  BottomDiffPtr(i), width_);
+    }
+    cudaProfilerStop();
+  }
+
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_LAYERS_ATTENTION_LAYER_H_
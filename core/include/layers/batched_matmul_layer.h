@@ -0,0 +1,338 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef CORE_INCLUDE_LAYERS_BATCHED_MATMUL_LAYER_H_
+#define CORE_INCLUDE_LAYERS_BATCHED_MATMUL_LAYER_H_
+
+#include "dnn_layer.h"
+
+namespace dnnmark {
+
+//
+// Per-head matrix products of the tokens of a sample. Tokens are rows of
+// features elements, head h owns columns [h * K, (h + 1) * K) of them and
+// is multiplied by a K x P operand, or the transpose of a P x K one. The
+// products of head h write columns [h * P, (h + 1) * P) of the output
+// tokens. Shared operands are learned like weights and multiply the rows
+// of all samples in one GEMM per head. Otherwise every sample has its own
+// operands and the samples of a head are one strided batched GEMM.
+//
+
+template <typename T>
+class BatchedMatMulLayer : public Layer<T> {
+  // using declaration for calling member from base class
+  using Layer<T>::p_dnnmark_;
+  using Layer<T>::layer_id_;
+  using Layer<T>::input_dim_;
+  using Layer<T>::output_dim_;
+  using Layer<T>::bottom_desc_;
+  using Layer<T>::top_desc_;
+  using Layer<T>::data_manager_;
+
+  using Layer<T>::num_bottoms_;
+  using Layer<T>::bottoms_;
+  using Layer<T>::bottom_chunk_ids_;
+  using Layer<T>::bottom_diffs_;
+  using Layer<T>::bottom_diff_chunk_ids_;
+
+  using Layer<T>::num_tops_;
+  using Layer<T>::tops_;
+  using Layer<T>::top_chunk_ids_;
+  using Layer<T>::top_diffs_;
+  using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::param_chunk_ids_;
+  using Layer<T>::param_diff_chunk_ids_;
+  using Layer<T>::state_chunk_ids_;
+  using Layer<T>::batch_begin_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
+
+ private:
+  BatchedMatMulParam bmm_param_;
+
+  int seq_len_;
+  // Features of an input token and the part of a head
+  int features_;
+  int head_size_;
+  T scale_alpha_;
+  T scale_beta_;
+
+  // Operands of all heads, of all samples unless shared
+  Data<T> *operands_;
+  Data<T> *operands_diff_;
+
+  cublasHandle_t Blas() {
+    return p_dnnmark_->getRunMode() == COMPOSED ?
+           p_dnnmark_->GetHandle()->GetBlas(layer_id_) :
+           p_dnnmark_->GetHandle()->GetBlas();
+  }
+
+  int OperandSize() { return head_size_ * bmm_param_.output_cols_; }
+
+ public:
+  BatchedMatMulLayer(DNNMark<T> *p_dnnmark)
+  : Layer<T>(p_dnnmark),
+    bmm_param_() {
+  }
+
+  BatchedMatMulParam *getBatchedMatMulParam() { return &bmm_param_; }
+
+  void Setup() {
+    // Only shared operands are learned
+    Layer<T>::has_learnable_params_ = bmm_param_.shared_;
+
+    // Set up indispensable stuff here
+    Layer<T>::Setup();
+
+    // Set up batched matrix multiplication related data
+    if (input_dim_.n_ != 0 && input_dim_.c_ != 0 &&
+        input_dim_.h_ != 0 && input_dim_.w_ != 0) {
+      //
+      // Standalone mode
+      //
+
+      // Compute dimension of output data
+      ComputeOutputDim();
+
+      // Set top tensor
+      top_desc_.Set(output_dim_.n_,
+                    output_dim_.c_,
+                    output_dim_.h_,
+                    output_dim_.w_);
+
+      // Prepare top data
+      int top_size = output_dim_.n_ *
+                     output_dim_.c_ *
+                     output_dim_.h_ *
+                     output_dim_.w_;
+      for (int i = 0; i < num_tops_; i++) {
+        top_chunk_ids_.push_back(
+          data_manager_->CreateData(top_size));
+        tops_.push_back(
+          data_manager_->GetData(top_chunk_ids_[i]));
+        if (!Layer<T>::isTraining())
+          continue;
+        top_diff_chunk_ids_.push_back(
+          data_manager_->CreateData(top_size));
+        top_diffs_.push_back(
+          data_manager_->GetData(top_diff_chunk_ids_[i]));
+      }
+    }
+
+    // Per-sample operands are inputs of the layer, kept as state
+    int operands_size = (bmm_param_.shared_ ? 1 : input_dim_.n_) *
+                        bmm_param_.num_heads_ * OperandSize();
+    int operands_chunk_id = data_manager_->CreateData(operands_size);
+    operands_ = data_manager_->GetData(operands_chunk_id);
+    if (bmm_param_.shared_)
+      param_chunk_ids_.push_back(operands_chunk_id);
+    else
+      state_chunk_ids_.push_back(operands_chunk_id);
+    if (Layer<T>::isTraining()) {
+      int operands_diff_chunk_id = data_manager_->CreateData(operands_size);
+      operands_diff_ = data_manager_->GetData(operands_diff_chunk_id);
+      if (bmm_param_.shared_)
+        param_diff_chunk_ids_.push_back(operands_diff_chunk_id);
+    }
+
+    // Fill the operand data
+    operands_->Filler();
+
+    scale_alpha_ = (T)1.0;
+    scale_beta_ = (T)0.0;
+  }
+
+  bool BackwardReadsTop() { return false; }
+
+  void ComputeOutputDim() {
+    int features = input_dim_.c_ * input_dim_.h_ * input_dim_.w_;
+    seq_len_ = bmm_param_.seq_len_ > 0 ? bmm_param_.seq_len_ :
+                                         input_dim_.c_;
+    CHECK_EQ(features % seq_len_, 0)
+      << Layer<T>::getLayerName() << ": " << features
+      << " input features per sample are no multiple of " << seq_len_
+      << " tokens";
+    features_ = features / seq_len_;
+    CHECK_EQ(features_ % bmm_param_.num_heads_, 0)
+      << Layer<T>::getLayerName() << ": " << features_
+      << " features per token do not split into " << bmm_param_.num_heads_
+      << " heads";
+    head_size_ = features_ / bmm_param_.num_heads_;
+    output_dim_.n_ = input_dim_.n_;
+    output_dim_.c_ = seq_len_;
+    output_dim_.h_ = bmm_param_.num_heads_ * bmm_param_.output_cols_;
+    output_dim_.w_ = 1;
+  }
+
+  void ForwardPropagation() {
+    if (Layer<T>::isDataFillRequired()) {
+      // Fill the bottom data
+      for (int i = 0; i < num_bottoms_; i++) {
+        bottoms_[i]->Filler();
+      }
+    }
+
+    // Prepare CuBLAS parameters, matrices are column major so the
+    // transposed products T(Y_h) = T(B_h) * T(X_h) are computed
+    int heads = bmm_param_.num_heads_;
+    int K = head_size_;
+    int P = bmm_param_.output_cols_;
+    int lda = bmm_param_.transpose_ ? K : P;
+    int ldb = features_;
+    int ldc = heads * P;
+
+    // Batched matrix multiplication forward computation
+    cudaProfilerStart();
+    for (int i = 0; i < num_bottoms_; i++) {
+      for (int h = 0; h < heads; h++) {
+        T *x = BottomPtr(i) + h * K;
+        T *y = TopPtr(i) + h * P;
+        if (bmm_param_.shared_) {
+          DNNMarkGEMM(Blas(), bmm_param_.transpose_, false,
+                      P, batch_n_ * seq_len_, K,
+                      &scale_alpha_,
+                      operands_->Get() + h * OperandSize(), lda,
+                      x, ldb,
+                      &scale_beta_,
+                      y, ldc);
+          continue;
+        }
+        DNNMarkBatchedGEMM(Blas(), bmm_param_.transpose_, false,
+                           P, seq_len_, K,
+                           &scale_alpha_,
+                           operands_->Get() +
+                           (batch_begin_ * heads + h) * OperandSize(),
+                           lda, (long long)heads * OperandSize(),
+                           x, ldb, (long long)seq_len_ * features_,
+                           &scale_beta_,
+                           y, ldc, (long long)seq_len_ * heads * P,
+                           batch_n_);
+      }
+    }
+    cudaProfilerStop();
+  }
+
+  void BackwardPropagation() {
+    if (Layer<T>::isDataFillRequired()) {
+      // Fill the top and top diff data
+      for (int i = 0; i < num_tops_; i++) {
+        tops_[i]->Filler();
+        top_diffs_[i]->Filler();
+      }
+      // Fill the bottom data
+      for (int i = 0; i < num_bottoms_; i++) {
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
+      }
+    }
+
+    int heads = bmm_param_.num_heads_;
+    int K = head_size_;
+    int P = bmm_param_.output_cols_;
+    bool transpose = bmm_param_.transpose_;
+    int ld_operand = transpose ? K : P;
+    int ld_x = features_;
+    int ld_y = heads * P;
+    // Operands of a head are one batch apart, those of a sample follow
+    // the batch view unless shared
+    int operand_begin = bmm_param_.shared_ ? 0 : batch_begin_ * heads;
+    long long stride_operand = (long long)heads * OperandSize();
+    long long stride_x = (long long)seq_len_ * features_;
+    long long stride_y = (long long)seq_len_ * heads * P;
+
+    // Batched matrix multiplication backward computation
+    cudaProfilerStart();
+    for (int i = 0; i < num_tops_; i++) {
+      for (int h = 0; h < heads; h++) {
+        T *x = BottomPtr(i) + h * K;
+        T *dx = BottomDiffPtr(i) + h * K;
+        T *dy = TopDiffPtr(i) + h * P;
+        T *b = operands_->Get() + (operand_begin + h) * OperandSize();
+        T *db = operands_diff_->Get() + (operand_begin + h) * OperandSize();
+        if (bmm_param_.shared_) {
+          // T(dX_h) = B_h * T(dY_h), or T(B_h) * T(dY_h) if transposed
+          DNNMarkGEMM(Blas(), !transpose, false,
+                      K, batch_n_ * seq_len_, P,
+                      &scale_alpha_,
+                      b, ld_operand,
+                      dy, ld_y,
+                      &scale_beta_,
+                      dx, ld_x);
+          // d(B_h) = T(X_h) * dY_h over the rows of all samples
+          if (transpose)
+            DNNMarkGEMM(Blas(), false, true,
+                        K, P, batch_n_ * seq_len_,
+                        &scale_alpha_,
+                        x, ld_x,
+                        dy, ld_y,
+                        &scale_beta_,
+                        db, K);
+          else
+            DNNMarkGEMM(Blas(), false, true,
+                        P, K, batch_n_ * seq_len_,
+                        &scale_alpha_,
+                        dy, ld_y,
+                        x, ld_x,
+                        &scale_beta_,
+                        db, P);
+          continue;
+        }
+        DNNMarkBatchedGEMM(Blas(), !transpose, false,
+                           K, seq_len_, P,
+                           &scale_alpha_,
+                           b, ld_operand, stride_operand,
+                           dy, ld_y, stride_y,
+                           &scale_beta_,
+                           dx, ld_x, stride_x,
+                           batch_n_);
+        if (transpose)
+          DNNMarkBatchedGEMM(Blas(), false, true,
+                             K, P, seq_len_,
+                             &scale_alpha_,
+                             x, ld_x, stride_x,
+                             dy, ld_y, stride_y,
+                             &scale_beta_,
+                             db, K, stride_operand,
+                             batch_n_);
+        else
+          DNNMarkBatchedGEMM(Blas(), false, true,
+                             P, K, seq_len_,
+                             &scale_alpha_,
+                             dy, ld_y, stride_y,
+                             x, ld_x, stride_x,
+                             &scale_beta_,
+                             db, P, stride_operand,
+                             batch_n_);
+      }
+    }
+    cudaProfilerStop();
+  }
+
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_LAYERS_BATCHED_MATMUL_LAYER_H_
@@ -23,7 +23,11 @@
 #ifndef CORE_INCLUDE_LAYERS_BN_LAYER_H_ 
 #define CORE_INCLUDE_LAYERS_BN_LAYER_H_
 
+#include <cmath>
+#include <vector>
+
 #include "dnn_layer.h"
+#include "kernels.h"
 
 namespace dnnmark {
 
@@ -50,6 +54,15 @@ class BatchNormLayer : public Layer<T> {
   using Layer<T>::top_chunk_ids_;
   using Layer<T>::top_diffs_;
   using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::param_chunk_ids_;
+  using Layer<T>::state_chunk_ids_;
+  using Layer<T>::param_diff_chunk_ids_;
+  using Layer<T>::batch_begin_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
 
  private:
   BatchNormParam bn_param_;
@@ -71,14 +84,26 @@ class BatchNormLayer : public Layer<T> {
   int bn_saved_mean_chunk_id_;
   Data<T> *bn_saved_inv_variance_;
   int bn_saved_inv_variance_chunk_id_;
+  // Saved statistics of the current batch view, every equally sized
+  // view keeps its own until its backward pass
+  int saved_offset_;
+
+  // Normalization and a ReLU fused into one pass by the fusion pass
+  bool fused_relu_;
+  Data<T> *fused_scale_;
+  int fused_scale_chunk_id_;
+  Data<T> *fused_shift_;
+  int fused_shift_chunk_id_;
 
  public:
   BatchNormLayer(DNNMark<T> *p_dnnmark)
   : Layer<T>(p_dnnmark),
-    bn_param_() {
+    bn_param_(), saved_offset_(0), fused_relu_(false) {
+    Layer<T>::has_learnable_params_ = true;
   }
 
   BatchNormParam *getBatchNormParam() { return &bn_param_; }
+  bool isFused() { return fused_relu_; }
 
   void Setup() {
     // Set up indispensable stuff here
@@ -98,19 +123,28 @@ class BatchNormLayer : public Layer<T> {
       bn_specifics_size_ = input_dim_.c_;
     }
     
-    //Initialize bn_scale_, bn_scale_diffs_, bn_bias_, bn_bias_diffs_, bn_running_mean_, and bn_running_inv_variance_
+    //Initialize bn_scale_, bn_bias_, bn_running_mean_, bn_running_inv_variance_, and the gradients of the first two
     bn_scale_chunk_id_ = data_manager_->CreateData(bn_specifics_size_);
     bn_scale_ = data_manager_->GetData(bn_scale_chunk_id_);
-    bn_scale_diffs_chunk_id_ = data_manager_->CreateData(bn_specifics_size_);
-    bn_scale_diffs_ = data_manager_->GetData(bn_scale_diffs_chunk_id_);
     bn_bias_chunk_id_ = data_manager_->CreateData(bn_specifics_size_);
     bn_bias_ = data_manager_->GetData(bn_bias_chunk_id_);
-    bn_bias_diffs_chunk_id_ = data_manager_->CreateData(bn_specifics_size_);
-    bn_bias_diffs_ = data_manager_->GetData(bn_bias_diffs_chunk_id_);
     bn_running_mean_chunk_id_ = data_manager_->CreateData(bn_specifics_size_);
     bn_running_mean_ = data_manager_->GetData(bn_running_mean_chunk_id_);
     bn_running_inv_variance_chunk_id_ = data_manager_->CreateData(bn_specifics_size_);
     bn_running_inv_variance_ = data_manager_->GetData(bn_running_inv_variance_chunk_id_);
+    param_chunk_ids_.push_back(bn_scale_chunk_id_);
+    param_chunk_ids_.push_back(bn_bias_chunk_id_);
+    state_chunk_ids_.push_back(bn_running_mean_chunk_id_);
+    state_chunk_ids_.push_back(bn_running_inv_variance_chunk_id_);
+    if (Layer<T>::isTraining()) {
+      bn_scale_diffs_chunk_id_ =
+        data_manager_->CreateData(bn_specifics_size_);
+      bn_scale_diffs_ = data_manager_->GetData(bn_scale_diffs_chunk_id_);
+      bn_bias_diffs_chunk_id_ = data_manager_->CreateData(bn_specifics_size_);
+      bn_bias_diffs_ = data_manager_->GetData(bn_bias_diffs_chunk_id_);
+      param_diff_chunk_ids_.push_back(bn_scale_diffs_chunk_id_);
+      param_diff_chunk_ids_.push_back(bn_bias_diffs_chunk_id_);
+    }
 
     bn_scale_->Filler();
     bn_bias_->Filler();
@@ -118,10 +152,13 @@ class BatchNormLayer : public Layer<T> {
     bn_running_inv_variance_->Filler();
 
     //All of these tensors use the bn_specifics_ tensor descriptor
-    if(bn_param_.save_intermediates_) {
-      bn_saved_mean_chunk_id_ = data_manager_->CreateData(bn_specifics_size_);
+    // Saved statistics are only used by the training passes
+    // Room for the statistics of up to one view per sample
+    if(bn_param_.save_intermediates_ && Layer<T>::isTraining()) {
+      int saved_size = bn_specifics_size_ * input_dim_.n_;
+      bn_saved_mean_chunk_id_ = data_manager_->CreateData(saved_size);
       bn_saved_mean_ = data_manager_->GetData(bn_saved_mean_chunk_id_);
-      bn_saved_inv_variance_chunk_id_ = data_manager_->CreateData(bn_specifics_size_);
+      bn_saved_inv_variance_chunk_id_ = data_manager_->CreateData(saved_size);
       bn_saved_inv_variance_ = data_manager_->GetData(bn_saved_inv_variance_chunk_id_);
 
       bn_saved_mean_->Filler();
@@ -153,10 +190,13 @@ class BatchNormLayer : public Layer<T> {
                      output_dim_.h_ *
                      output_dim_.w_;
       for (int i = 0; i < num_tops_; i++) {
-        top_chunk_ids_.push_back(
+        top_chunk_ids_.push_back(Layer<T>::isInPlace() ?
+          bottom_chunk_ids_[i] :
           data_manager_->CreateData(top_size));
         tops_.push_back(
           data_manager_->GetData(top_chunk_ids_[i]));
+        if (!Layer<T>::isTraining())
+          continue;
         top_diff_chunk_ids_.push_back(
           data_manager_->CreateData(top_size));
         top_diffs_.push_back(
@@ -166,6 +206,24 @@ class BatchNormLayer : public Layer<T> {
     }
   }
 
+  void SetBatchView(int begin, int n) {
+    Layer<T>::SetBatchView(begin, n);
+    saved_offset_ = (begin / n) * bn_specifics_size_;
+  }
+
+  // Saved statistics of the current view, null when none are kept
+  T *SavedMeanPtr() {
+    return bn_saved_mean_ ? bn_saved_mean_->Get() + saved_offset_ : nullptr;
+  }
+  T *SavedInvVariancePtr() {
+    return bn_saved_inv_variance_ ?
+           bn_saved_inv_variance_->Get() + saved_offset_ : nullptr;
+  }
+
+  // The gradient is taken with respect to the saved batch statistics
+  // and the normalized input, which is recomputed from the bottom
+  bool BackwardReadsTop() { return false; }
+
   void ComputeOutputDim() {
     output_dim_.n_ = input_dim_.n_;
     output_dim_.c_ = input_dim_.c_;
@@ -173,9 +231,63 @@ class BatchNormLayer : public Layer<T> {
     output_dim_.w_ = input_dim_.w_;
   }
 
+  // Running statistics replace the batch ones when configured and
+  // whenever no backward pass follows
+  bool usesGlobalStats() {
+    return bn_param_.use_global_stats_ || !Layer<T>::isTraining();
+  }
+
+  // With global statistics the layer is the affine map
+  // y = x * scale + shift, scale = gamma / sqrt(var + eps) and
+  // shift = beta - mean * scale, one entry per parameter
+  void GetAffineFactors(std::vector<T> *scale, std::vector<T> *shift) {
+    CHECK(usesGlobalStats());
+    std::vector<T> gamma(bn_specifics_size_), beta(bn_specifics_size_);
+    std::vector<T> mean(bn_specifics_size_), var(bn_specifics_size_);
+    size_t bytes = bn_specifics_size_ * sizeof(T);
+    CUDA_CALL(cudaMemcpy(gamma.data(), bn_scale_->Get(), bytes,
+                         cudaMemcpyDeviceToHost));
+    CUDA_CALL(cudaMemcpy(beta.data(), bn_bias_->Get(), bytes,
+                         cudaMemcpyDeviceToHost));
+    CUDA_CALL(cudaMemcpy(mean.data(), bn_running_mean_->Get(), bytes,
+                         cudaMemcpyDeviceToHost));
+    CUDA_CALL(cudaMemcpy(var.data(), bn_running_inv_variance_->Get(), bytes,
+                         cudaMemcpyDeviceToHost));
+    scale->resize(bn_specifics_size_);
+    shift->resize(bn_specifics_size_);
+    for (int i = 0; i < bn_specifics_size_; i++) {
+      // Filled variances may be negative, keep the factors finite
+      (*scale)[i] = gamma[i] / std::sqrt(std::fabs(var[i]) +
+                                         bn_param_.epsilon_);
+      (*shift)[i] = beta[i] - mean[i] * (*scale)[i];
+    }
+  }
+
+  // Apply the normalization and the following in-place ReLU in one pass
+  void FuseActivation() {
+    std::vector<T> scale, shift;
+    GetAffineFactors(&scale, &shift);
+    size_t bytes = bn_specifics_size_ * sizeof(T);
+    // Fusing again refreshes the factors in the same chunks
+    if (!fused_relu_) {
+      fused_scale_chunk_id_ = data_manager_->CreateData(bn_specifics_size_);
+      fused_scale_ = data_manager_->GetData(fused_scale_chunk_id_);
+      fused_shift_chunk_id_ = data_manager_->CreateData(bn_specifics_size_);
+      fused_shift_ = data_manager_->GetData(fused_shift_chunk_id_);
+    }
+    CUDA_CALL(cudaMemcpy(fused_scale_->Get(), scale.data(), bytes,
+                         cudaMemcpyHostToDevice));
+    CUDA_CALL(cudaMemcpy(fused_shift_->Get(), shift.data(), bytes,
+                         cudaMemcpyHostToDevice));
+    fused_relu_ = true;
+  }
+
   void ForwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    // The producer of the bottom already computed this layer in place
+    if (Layer<T>::isAbsorbed())
+      return;
+
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
         bottoms_[i]->Filler();
@@ -184,7 +296,40 @@ class BatchNormLayer : public Layer<T> {
 
     // Batch normalization forward computation
     cudaProfilerStart();
+    if (fused_relu_) {
+      for (int i = 0; i < num_bottoms_; i++)
+        DNNMarkScaleShiftActivation(
+          p_dnnmark_->getRunMode() == COMPOSED ?
+          p_dnnmark_->GetHandle()->GetStream(layer_id_):
+          p_dnnmark_->GetHandle()->GetStream(),
+          batch_n_ * input_dim_.c_ * input_dim_.h_ * input_dim_.w_,
+          bn_specifics_size_,
+          bn_param_.mode_ == CUDNN_BATCHNORM_SPATIAL ?
+          input_dim_.h_ * input_dim_.w_ : 1,
+          BottomPtr(i), fused_scale_->Get(), fused_shift_->Get(),
+          TopPtr(i), true);
+      cudaProfilerStop();
+      return;
+    }
     for (int i = 0; i < num_bottoms_; i++) {
+      if (usesGlobalStats()) {
+        CUDNN_CALL(cudnnBatchNormalizationForwardInference(
+                p_dnnmark_->getRunMode() == COMPOSED ?
+                p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
+                p_dnnmark_->GetHandle()->GetCudnn(),
+                bn_param_.mode_,
+                DataType<T>::one,
+                DataType<T>::zero,
+                bottom_desc_.Get(), BottomPtr(i),
+                top_desc_.Get(), TopPtr(i),
+                bn_specifics_desc_.Get(),
+                bn_scale_->Get(),
+                bn_bias_->Get(),
+                bn_running_mean_->Get(),
+                bn_running_inv_variance_->Get(),
+                bn_param_.epsilon_));
+        continue;
+      }
       CUDNN_CALL(cudnnBatchNormalizationForwardTraining(
               p_dnnmark_->getRunMode() == COMPOSED ?
               p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
@@ -192,8 +337,8 @@ class BatchNormLayer : public Layer<T> {
               bn_param_.mode_,
               DataType<T>::one,
               DataType<T>::zero,
-              bottom_desc_.Get(), bottoms_[i]->Get(),
-              top_desc_.Get(), tops_[i]->Get(),
+              bottom_desc_.Get(), BottomPtr(i),
+              top_desc_.Get(), TopPtr(i),
               bn_specifics_desc_.Get(),
               bn_scale_->Get(),
               bn_bias_->Get(),
@@ -201,8 +346,8 @@ class BatchNormLayer : public Layer<T> {
               bn_running_mean_->Get(),
               bn_running_inv_variance_->Get(),
               bn_param_.epsilon_,
-              bn_saved_mean_->Get(),
-              bn_saved_inv_variance_->Get()
+              SavedMeanPtr(),
+              SavedInvVariancePtr()
               ));
     }
     cudaProfilerStop();
@@ -210,8 +355,7 @@ class BatchNormLayer : public Layer<T> {
   }
 
   void BackwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the top and top diff data
       for (int i = 0; i < num_tops_; i++) {
         tops_[i]->Filler();
@@ -219,7 +363,8 @@ class BatchNormLayer : public Layer<T> {
       }
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
-        bottoms_[i]->Filler();
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
       }
     }
 
@@ -235,16 +380,16 @@ class BatchNormLayer : public Layer<T> {
               DataType<T>::zero,
               DataType<T>::one,
               DataType<T>::zero,
-              bottom_desc_.Get(), bottoms_[i]->Get(),
-              top_desc_.Get(), top_diffs_[i]->Get(),
-              bottom_desc_.Get(), bottom_diffs_[i]->Get(),
+              bottom_desc_.Get(), BottomPtr(i),
+              top_desc_.Get(), TopDiffPtr(i),
+              bottom_desc_.Get(), BottomDiffPtr(i),
               bn_specifics_desc_.Get(),
               bn_scale_->Get(),
               bn_scale_diffs_->Get(),
               bn_bias_diffs_->Get(),
               bn_param_.epsilon_,
-              bn_saved_mean_->Get(),
-              bn_saved_inv_variance_->Get()
+              SavedMeanPtr(),
+              SavedInvVariancePtr()
               ));
     }
     cudaProfilerStop();
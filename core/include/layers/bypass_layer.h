@@ -50,6 +50,12 @@ class BypassLayer : public Layer<T> {
   using Layer<T>::top_chunk_ids_;
   using Layer<T>::top_diffs_;
   using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::batch_begin_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
 
  private:
   BypassParam bypass_param_;
@@ -91,6 +97,8 @@ class BypassLayer : public Layer<T> {
           data_manager_->CreateData(top_size));
         tops_.push_back(
           data_manager_->GetData(top_chunk_ids_[i]));
+        if (!Layer<T>::isTraining())
+          continue;
         top_diff_chunk_ids_.push_back(
           data_manager_->CreateData(top_size));
         top_diffs_.push_back(
@@ -100,6 +108,9 @@ class BypassLayer : public Layer<T> {
     }
   }
 
+  bool BackwardReadsBottom() { return false; }
+  bool BackwardReadsTop() { return false; }
+
   void ComputeOutputDim() {
     output_dim_.n_ = input_dim_.n_;
     output_dim_.c_ = input_dim_.c_;
@@ -108,8 +119,7 @@ class BypassLayer : public Layer<T> {
   }
 
   void ForwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
         bottoms_[i]->Filler();
@@ -119,13 +129,16 @@ class BypassLayer : public Layer<T> {
     // Bypass forwards - copy bottom data to top.
     cudaProfilerStart();
     for (int i = 0; i < num_bottoms_; i++) {
-      CUDA_CALL(cudaMemcpy(tops_[i]->Get(),
-                           bottoms_[i]->Get(),
-                           sizeof(T)*input_dim_.n_
+      CUDA_CALL(cudaMemcpyAsync(TopPtr(i),
+                           BottomPtr(i),
+                           sizeof(T)*batch_n_
                                     *input_dim_.c_
                                     *input_dim_.h_
                                     *input_dim_.w_,
-                           cudaMemcpyDeviceToDevice
+                           cudaMemcpyDeviceToDevice,
+                           p_dnnmark_->getRunMode() == COMPOSED ?
+                           p_dnnmark_->GetHandle()->GetStream(layer_id_):
+                           p_dnnmark_->GetHandle()->GetStream()
                            ));
     }
     cudaProfilerStop();
@@ -133,8 +146,7 @@ class BypassLayer : public Layer<T> {
   }
 
   void BackwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the top and top diff data
       for (int i = 0; i < num_tops_; i++) {
         tops_[i]->Filler();
@@ -142,20 +154,24 @@ class BypassLayer : public Layer<T> {
       }
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
-        bottoms_[i]->Filler();
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
       }
     }
 
     // Bypass backwards - copy top_diff data to bottom_diff
     cudaProfilerStart();
     for (int i = 0; i < num_tops_; i++) {
-      CUDA_CALL(cudaMemcpy(top_diffs_[i]->Get(),
-                           bottom_diffs_[i]->Get(),
-                           sizeof(T)*input_dim_.n_
+      CUDA_CALL(cudaMemcpyAsync(BottomDiffPtr(i),
+                           TopDiffPtr(i),
+                           sizeof(T)*batch_n_
                                     *input_dim_.c_
                                     *input_dim_.h_
                                     *input_dim_.w_,
-                           cudaMemcpyDeviceToDevice
+                           cudaMemcpyDeviceToDevice,
+                           p_dnnmark_->getRunMode() == COMPOSED ?
+                           p_dnnmark_->GetHandle()->GetStream(layer_id_):
+                           p_dnnmark_->GetHandle()->GetStream()
                            ));
     }
     cudaProfilerStop();
@@ -23,7 +23,13 @@
 #ifndef CORE_INCLUDE_LAYERS_CONV_LAYER_H_ 
 #define CORE_INCLUDE_LAYERS_CONV_LAYER_H_
 
+#include <vector>
+#include <limits>
+#include <algorithm>
+
 #include "dnn_layer.h"
+#include "autotuner.h"
+#include "kernels.h"
 
 namespace dnnmark {
 
@@ -49,7 +55,15 @@ class ConvolutionLayer : public Layer<T> {
   using Layer<T>::tops_;
   using Layer<T>::top_chunk_ids_;
   using Layer<T>::top_diffs_;
-  using Layer<T>::top_diff_chunk_ids_; 
+  using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::param_chunk_ids_;
+  using Layer<T>::param_diff_chunk_ids_; 
+  using Layer<T>::batch_begin_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
 
  private:
   ConvolutionParam conv_param_;
@@ -73,13 +87,65 @@ class ConvolutionLayer : public Layer<T> {
   void *fwd_workspace_;
   void *bwd_data_workspace_;
   void *bwd_filter_workspace_;
+
+  // Measured algorithms per direction, only kept under a workspace budget
+  std::vector<AlgoCandidate> candidates_[NUM_CONV_DIRECTIONS];
+
+  // Bias and activation epilogue set up by the fusion pass. A folded
+  // BN scales a copy of the weights, the parameters stay as trained.
+  // cuDNN 7.1 runs the epilogue inside the convolution, older versions
+  // apply it with a kernel afterwards, at unit scale.
+  bool fused_;
+  bool epilogue_relu_;
+  Data<T> *folded_weights_;
+  int folded_weights_chunk_id_;
+  Data<T> *bias_;
+  int bias_chunk_id_;
+  Data<T> *epilogue_scale_;
+  DataTensor<T> bias_desc_;
+  ActivationDesc<T> epilogue_desc_;
+
+  // Algorithm of the measured candidates needing the least workspace,
+  // the fastest one breaking ties
+  int LeastWorkspace(ConvDirection direction, int fastest) {
+    int algo = fastest;
+    size_t size = std::numeric_limits<size_t>::max();
+    for (auto &candidate : candidates_[direction])
+      if (candidate.workspace_size_ < size) {
+        algo = candidate.algo_;
+        size = candidate.workspace_size_;
+      }
+    return algo;
+  }
+
+  // Workspaces are only reallocated when a larger one is needed
+  void GrowWorkspace(size_t size, void **workspace, size_t *workspace_size) {
+    if (size <= *workspace_size)
+      return;
+    CUDA_CALL(cudaFree(*workspace));
+    CUDA_CALL(cudaMalloc(workspace, size));
+    *workspace_size = size;
+  }
+
  public:
   ConvolutionLayer(DNNMark<T> *p_dnnmark)
   : Layer<T>(p_dnnmark),
-    conv_param_(), desc_() {
+    conv_param_(), desc_(),
+    fwd_workspace_(nullptr),
+    bwd_data_workspace_(nullptr),
+    bwd_filter_workspace_(nullptr),
+    fused_(false), epilogue_relu_(false),
+    folded_weights_(nullptr), epilogue_scale_(nullptr) {
     Layer<T>::has_learnable_params_ = true;
   }
 
+  ~ConvolutionLayer() {
+    // Workspaces live as long as the layer so that passes can be repeated
+    CUDA_CALL(cudaFree(fwd_workspace_));
+    CUDA_CALL(cudaFree(bwd_data_workspace_));
+    CUDA_CALL(cudaFree(bwd_filter_workspace_));
+  }
+
   ConvolutionParam *getConvParam() { return &conv_param_; }
 
   void Setup() {
@@ -115,6 +181,8 @@ class ConvolutionLayer : public Layer<T> {
           data_manager_->CreateData(top_size));
         tops_.push_back(
           data_manager_->GetData(top_chunk_ids_[i]));
+        if (!Layer<T>::isTraining())
+          continue;
         top_diff_chunk_ids_.push_back(
           data_manager_->CreateData(top_size));
         top_diffs_.push_back(
@@ -130,25 +198,58 @@ class ConvolutionLayer : public Layer<T> {
                        conv_param_.kernel_size_w_;
     weights_chunk_id_ = data_manager_->CreateData(weights_size);
     weights_ = data_manager_->GetData(weights_chunk_id_);
-    weights_diff_chunk_id_ =
-      data_manager_->CreateData(weights_size);
-    weights_diff_ = data_manager_->GetData(weights_diff_chunk_id_);
+    param_chunk_ids_.push_back(weights_chunk_id_);
+    if (Layer<T>::isTraining()) {
+      weights_diff_chunk_id_ =
+        data_manager_->CreateData(weights_size);
+      weights_diff_ = data_manager_->GetData(weights_diff_chunk_id_);
+      param_diff_chunk_ids_.push_back(weights_diff_chunk_id_);
+    }
 
     // Fill the weight data
     weights_->Filler();
 
-    // Set up convolution forward algorithm related parameters
-    CUDNN_CALL(cudnnGetConvolutionForwardAlgorithm(
+    // Timing every algorithm replaces the heuristic choice when autotuning,
+    // the search may use whatever device memory is left. Under a workspace
+    // budget all measured algorithms are kept for the planner, which starts
+    // every direction from its smallest workspace.
+    bool autotune = conv_param_.autotune_ ||
+                    p_dnnmark_->getAutotuneParam()->enabled_;
+    bool plan = p_dnnmark_->getWorkspaceBudget() > 0;
+    size_t free_memory = 0, total_memory;
+    if (autotune || plan)
+      CUDA_CALL(cudaMemGetInfo(&free_memory, &total_memory));
+    ConvAutotuner<T> autotuner(
         p_dnnmark_->getRunMode() == COMPOSED ?
         p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
         p_dnnmark_->GetHandle()->GetCudnn(),
-        bottom_desc_.Get(),
-        desc_.GetFilter(),
-        desc_.GetConv(),
-        top_desc_.Get(),
-        conv_param_.conv_fwd_pref_,
-        -1,
-        &fwd_algo_));
+        Layer<T>::getLayerName(), input_dim_, conv_param_,
+        &bottom_desc_, &desc_, &top_desc_,
+        *p_dnnmark_->getAutotuneParam(),
+        std::min(free_memory, conv_param_.workspace_limit_),
+        p_dnnmark_->isDeterministic());
+
+    // Set up convolution forward algorithm related parameters
+    if (plan)
+      fwd_algo_ = static_cast<cudnnConvolutionFwdAlgo_t>(LeastWorkspace(
+          CONV_FWD, autotuner.Forward(bottoms_[0]->Get(), weights_->Get(),
+                                      tops_[0]->Get(),
+                                      &candidates_[CONV_FWD])));
+    else if (autotune)
+      fwd_algo_ = autotuner.Forward(bottoms_[0]->Get(), weights_->Get(),
+                                    tops_[0]->Get());
+    else
+      CUDNN_CALL(cudnnGetConvolutionForwardAlgorithm(
+          p_dnnmark_->getRunMode() == COMPOSED ?
+          p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
+          p_dnnmark_->GetHandle()->GetCudnn(),
+          bottom_desc_.Get(),
+          desc_.GetFilter(),
+          desc_.GetConv(),
+          top_desc_.Get(),
+          conv_param_.conv_fwd_pref_,
+          conv_param_.workspace_limit_,
+          &fwd_algo_));
   
     CUDNN_CALL(cudnnGetConvolutionForwardWorkspaceSize(
         p_dnnmark_->getRunMode() == COMPOSED ?
@@ -164,17 +265,33 @@ class ConvolutionLayer : public Layer<T> {
     CUDA_CALL(cudaMalloc(&fwd_workspace_, fwd_workspace_size_));
 
     // Set up convolution backward algorithm related parameters
-    CUDNN_CALL(cudnnGetConvolutionBackwardFilterAlgorithm(
-        p_dnnmark_->getRunMode() == COMPOSED ?
-        p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
-        p_dnnmark_->GetHandle()->GetCudnn(),
-        bottom_desc_.Get(),
-        top_desc_.Get(),
-        desc_.GetConv(),
-        desc_.GetFilter(),
-        conv_param_.conv_bwd_filter_pref_,
-        -1,
-        &bwd_filter_algo_));
+    if (!Layer<T>::isTraining())
+      return;
+    if (plan)
+      bwd_filter_algo_ = static_cast<cudnnConvolutionBwdFilterAlgo_t>(
+          LeastWorkspace(CONV_BWD_FILTER, autotuner.BackwardFilter(
+              bottoms_[0]->Get(), top_diffs_[0]->Get(),
+              weights_diff_->Get(), &candidates_[CONV_BWD_FILTER])));
+    else if (autotune)
+      bwd_filter_algo_ = autotuner.BackwardFilter(bottoms_[0]->Get(),
+                                                  top_diffs_[0]->Get(),
+                                                  weights_diff_->Get());
+    else
+      CUDNN_CALL(cudnnGetConvolutionBackwardFilterAlgorithm(
+          p_dnnmark_->getRunMode() == COMPOSED ?
+          p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
+          p_dnnmark_->GetHandle()->GetCudnn(),
+          bottom_desc_.Get(),
+          top_desc_.Get(),
+          desc_.GetConv(),
+          desc_.GetFilter(),
+          conv_param_.conv_bwd_filter_pref_,
+          conv_param_.workspace_limit_,
+          &bwd_filter_algo_));
+    // The heuristics do not know about determinism, this one always is
+    if (p_dnnmark_->isDeterministic() &&
+        !isDeterministicAlgo(CONV_BWD_FILTER, bwd_filter_algo_))
+      bwd_filter_algo_ = CUDNN_CONVOLUTION_BWD_FILTER_ALGO_1;
   
     CUDNN_CALL(cudnnGetConvolutionBackwardFilterWorkspaceSize(
         p_dnnmark_->getRunMode() == COMPOSED ?
@@ -189,17 +306,30 @@ class ConvolutionLayer : public Layer<T> {
 
     CUDA_CALL(cudaMalloc(&bwd_filter_workspace_, bwd_filter_workspace_size_));
 
-    CUDNN_CALL(cudnnGetConvolutionBackwardDataAlgorithm(
-        p_dnnmark_->getRunMode() == COMPOSED ?
-        p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
-        p_dnnmark_->GetHandle()->GetCudnn(),
-        desc_.GetFilter(),
-        top_desc_.Get(),
-        desc_.GetConv(),
-        bottom_desc_.Get(),
-        conv_param_.conv_bwd_data_pref_,
-        -1,
-        &bwd_data_algo_));
+    if (plan)
+      bwd_data_algo_ = static_cast<cudnnConvolutionBwdDataAlgo_t>(
+          LeastWorkspace(CONV_BWD_DATA, autotuner.BackwardData(
+              weights_->Get(), top_diffs_[0]->Get(),
+              bottom_diffs_[0]->Get(), &candidates_[CONV_BWD_DATA])));
+    else if (autotune)
+      bwd_data_algo_ = autotuner.BackwardData(weights_->Get(),
+                                              top_diffs_[0]->Get(),
+                                              bottom_diffs_[0]->Get());
+    else
+      CUDNN_CALL(cudnnGetConvolutionBackwardDataAlgorithm(
+          p_dnnmark_->getRunMode() == COMPOSED ?
+          p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
+          p_dnnmark_->GetHandle()->GetCudnn(),
+          desc_.GetFilter(),
+          top_desc_.Get(),
+          desc_.GetConv(),
+          bottom_desc_.Get(),
+          conv_param_.conv_bwd_data_pref_,
+          conv_param_.workspace_limit_,
+          &bwd_data_algo_));
+    if (p_dnnmark_->isDeterministic() &&
+        !isDeterministicAlgo(CONV_BWD_DATA, bwd_data_algo_))
+      bwd_data_algo_ = CUDNN_CONVOLUTION_BWD_DATA_ALGO_1;
   
     CUDNN_CALL(cudnnGetConvolutionBackwardDataWorkspaceSize(
         p_dnnmark_->getRunMode() == COMPOSED ?
@@ -215,6 +345,83 @@ class ConvolutionLayer : public Layer<T> {
     CUDA_CALL(cudaMalloc(&bwd_data_workspace_, bwd_data_workspace_size_));
   }
 
+  void SetBatchView(int begin, int n) {
+    Layer<T>::SetBatchView(begin, n);
+
+    // The algorithms stay, their workspaces grow if the view needs more
+    cudnnHandle_t cudnn = p_dnnmark_->getRunMode() == COMPOSED ?
+                          p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
+                          p_dnnmark_->GetHandle()->GetCudnn();
+    size_t size;
+    CUDNN_CALL(cudnnGetConvolutionForwardWorkspaceSize(
+        cudnn, bottom_desc_.Get(), desc_.GetFilter(), desc_.GetConv(),
+        top_desc_.Get(), fwd_algo_, &size));
+    GrowWorkspace(size, &fwd_workspace_, &fwd_workspace_size_);
+    if (!Layer<T>::isTraining())
+      return;
+    CUDNN_CALL(cudnnGetConvolutionBackwardFilterWorkspaceSize(
+        cudnn, bottom_desc_.Get(), top_desc_.Get(), desc_.GetConv(),
+        desc_.GetFilter(), bwd_filter_algo_, &size));
+    GrowWorkspace(size, &bwd_filter_workspace_, &bwd_filter_workspace_size_);
+    CUDNN_CALL(cudnnGetConvolutionBackwardDataWorkspaceSize(
+        cudnn, desc_.GetFilter(), top_desc_.Get(), desc_.GetConv(),
+        bottom_desc_.Get(), bwd_data_algo_, &size));
+    GrowWorkspace(size, &bwd_data_workspace_, &bwd_data_workspace_size_);
+  }
+
+  bool BackwardReadsTop() { return false; }
+
+  const std::vector<AlgoCandidate> &getCandidates(ConvDirection direction) {
+    return candidates_[direction];
+  }
+
+  int getAlgorithm(ConvDirection direction) {
+    switch (direction) {
+      case CONV_FWD: return fwd_algo_;
+      case CONV_BWD_FILTER: return bwd_filter_algo_;
+      default: return bwd_data_algo_;
+    }
+  }
+
+  // Switch one direction to another algorithm, its workspace is resized
+  // to exactly what the algorithm needs
+  void SetAlgorithm(ConvDirection direction, int algo) {
+    cudnnHandle_t cudnn = p_dnnmark_->getRunMode() == COMPOSED ?
+                          p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
+                          p_dnnmark_->GetHandle()->GetCudnn();
+    void **workspace;
+    size_t *workspace_size;
+    switch (direction) {
+      case CONV_FWD:
+        fwd_algo_ = static_cast<cudnnConvolutionFwdAlgo_t>(algo);
+        CUDNN_CALL(cudnnGetConvolutionForwardWorkspaceSize(
+            cudnn, bottom_desc_.Get(), desc_.GetFilter(), desc_.GetConv(),
+            top_desc_.Get(), fwd_algo_, &fwd_workspace_size_));
+        workspace = &fwd_workspace_;
+        workspace_size = &fwd_workspace_size_;
+        break;
+      case CONV_BWD_FILTER:
+        bwd_filter_algo_ = static_cast<cudnnConvolutionBwdFilterAlgo_t>(algo);
+        CUDNN_CALL(cudnnGetConvolutionBackwardFilterWorkspaceSize(
+            cudnn, bottom_desc_.Get(), top_desc_.Get(), desc_.GetConv(),
+            desc_.GetFilter(), bwd_filter_algo_,
+            &bwd_filter_workspace_size_));
+        workspace = &bwd_filter_workspace_;
+        workspace_size = &bwd_filter_workspace_size_;
+        break;
+      default:
+        bwd_data_algo_ = static_cast<cudnnConvolutionBwdDataAlgo_t>(algo);
+        CUDNN_CALL(cudnnGetConvolutionBackwardDataWorkspaceSize(
+            cudnn, desc_.GetFilter(), top_desc_.Get(), desc_.GetConv(),
+            bottom_desc_.Get(), bwd_data_algo_, &bwd_data_workspace_size_));
+        workspace = &bwd_data_workspace_;
+        workspace_size = &bwd_data_workspace_size_;
+        break;
+    }
+    CUDA_CALL(cudaFree(*workspace));
+    CUDA_CALL(cudaMalloc(workspace, *workspace_size));
+  }
+
   void ComputeOutputDim() {
     output_dim_.n_ = input_dim_.n_;
     output_dim_.c_ = conv_param_.output_num_;
@@ -226,10 +433,134 @@ class ConvolutionLayer : public Layer<T> {
       conv_param_.stride_v_ + 1;
   }
 
+  // Fold a following batch normalization with global statistics into the
+  // weights and a bias (scale and shift are per output channel, null when
+  // there is none) and optionally apply a ReLU, all in one kernel
+  void FuseEpilogue(const std::vector<T> *scale,
+                    const std::vector<T> *shift,
+                    bool relu) {
+    int num_filters = conv_param_.output_num_;
+    std::vector<T> bias(num_filters, 0);
+    if (scale != nullptr) {
+      CHECK_EQ(scale->size(), num_filters);
+      int filter_size = weights_->getSize() / num_filters;
+      std::vector<T> weights(weights_->getSize());
+      CUDA_CALL(cudaMemcpy(weights.data(), weights_->Get(),
+                           weights.size() * sizeof(T),
+                           cudaMemcpyDeviceToHost));
+      for (int k = 0; k < num_filters; k++)
+        for (int j = 0; j < filter_size; j++)
+          weights[k * filter_size + j] *= (*scale)[k];
+      if (folded_weights_ == nullptr) {
+        folded_weights_chunk_id_ = data_manager_->CreateData(weights.size());
+        folded_weights_ = data_manager_->GetData(folded_weights_chunk_id_);
+      }
+      CUDA_CALL(cudaMemcpy(folded_weights_->Get(), weights.data(),
+                           weights.size() * sizeof(T),
+                           cudaMemcpyHostToDevice));
+      bias = *shift;
+    }
+    // Fusing again refreshes the folded factors in the same chunks
+    if (!fused_) {
+      bias_chunk_id_ = data_manager_->CreateData(num_filters);
+      bias_ = data_manager_->GetData(bias_chunk_id_);
+    }
+    CUDA_CALL(cudaMemcpy(bias_->Get(), bias.data(), num_filters * sizeof(T),
+                         cudaMemcpyHostToDevice));
+    epilogue_relu_ = relu;
+#if CUDNN_VERSION >= 7100
+    bias_desc_.Set(1, num_filters, 1, 1);
+
+    ActivationParam activation_param;
+    activation_param.mode_ = relu ? CUDNN_ACTIVATION_RELU :
+                                    CUDNN_ACTIVATION_IDENTITY;
+    epilogue_desc_.Set(activation_param);
+
+    // cuDNN only supports the identity epilogue with this algorithm
+    if (!relu &&
+        fwd_algo_ != CUDNN_CONVOLUTION_FWD_ALGO_IMPLICIT_PRECOMP_GEMM) {
+      fwd_algo_ = CUDNN_CONVOLUTION_FWD_ALGO_IMPLICIT_PRECOMP_GEMM;
+      CUDNN_CALL(cudnnGetConvolutionForwardWorkspaceSize(
+          p_dnnmark_->getRunMode() == COMPOSED ?
+          p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
+          p_dnnmark_->GetHandle()->GetCudnn(),
+          bottom_desc_.Get(),
+          desc_.GetFilter(),
+          desc_.GetConv(),
+          top_desc_.Get(),
+          fwd_algo_,
+          &fwd_workspace_size_));
+      CUDA_CALL(cudaFree(fwd_workspace_));
+      CUDA_CALL(cudaMalloc(&fwd_workspace_, fwd_workspace_size_));
+    }
+    // A workspace budget may not move the forward off this algorithm
+    if (!candidates_[CONV_FWD].empty()) {
+      AlgoCandidate fixed = {fwd_algo_, 0, fwd_workspace_size_};
+      for (auto &candidate : candidates_[CONV_FWD])
+        if (candidate.algo_ == fwd_algo_)
+          fixed = candidate;
+      candidates_[CONV_FWD].assign(1, fixed);
+    }
+#else
+    if (!fused_) {
+      std::vector<T> ones(num_filters, 1);
+      epilogue_scale_ =
+        data_manager_->GetData(data_manager_->CreateData(num_filters));
+      CUDA_CALL(cudaMemcpy(epilogue_scale_->Get(), ones.data(),
+                           num_filters * sizeof(T),
+                           cudaMemcpyHostToDevice));
+    }
+#endif
+    fused_ = true;
+  }
+
+  bool isFused() { return fused_; }
+
+  // Forward of the fused layer on bottom i
+  void FusedForward(int i) {
+    const T *weights = folded_weights_ ? folded_weights_->Get() :
+                                         weights_->Get();
+#if CUDNN_VERSION >= 7100
+    CUDNN_CALL(cudnnConvolutionBiasActivationForward(
+              p_dnnmark_->getRunMode() == COMPOSED ?
+              p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
+              p_dnnmark_->GetHandle()->GetCudnn(),
+              DataType<T>::one,
+              bottom_desc_.Get(), BottomPtr(i),
+              desc_.GetFilter(), weights,
+              desc_.GetConv(),
+              fwd_algo_, fwd_workspace_, fwd_workspace_size_,
+              DataType<T>::zero,
+              top_desc_.Get(), TopPtr(i),
+              bias_desc_.Get(), bias_->Get(),
+              epilogue_desc_.Get(),
+              top_desc_.Get(), TopPtr(i)));
+#else
+    CUDNN_CALL(cudnnConvolutionForward(
+              p_dnnmark_->getRunMode() == COMPOSED ?
+              p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
+              p_dnnmark_->GetHandle()->GetCudnn(),
+              DataType<T>::one,
+              bottom_desc_.Get(), BottomPtr(i),
+              desc_.GetFilter(), weights,
+              desc_.GetConv(),
+              fwd_algo_, fwd_workspace_, fwd_workspace_size_,
+              DataType<T>::zero,
+              top_desc_.Get(), TopPtr(i)));
+    DNNMarkScaleShiftActivation(
+      p_dnnmark_->getRunMode() == COMPOSED ?
+      p_dnnmark_->GetHandle()->GetStream(layer_id_):
+      p_dnnmark_->GetHandle()->GetStream(),
+      batch_n_ * output_dim_.c_ * output_dim_.h_ * output_dim_.w_,
+      output_dim_.c_, output_dim_.h_ * output_dim_.w_,
+      TopPtr(i), epilogue_scale_->Get(), bias_->Get(), TopPtr(i),
+      epilogue_relu_);
+#endif
+  }
+
   void ForwardPropagation() {
     // Fill the bottom data
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       for (int i = 0; i < num_bottoms_; i++) {
         bottoms_[i]->Filler();
       }
@@ -237,27 +568,26 @@ class ConvolutionLayer : public Layer<T> {
     // Convolution forward computation
     cudaProfilerStart();
     for (int i = 0; i < num_bottoms_; i++) {
+      if (fused_) {
+        FusedForward(i);
+        continue;
+      }
       CUDNN_CALL(cudnnConvolutionForward(
                 p_dnnmark_->getRunMode() == COMPOSED ?
                 p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
                 p_dnnmark_->GetHandle()->GetCudnn(),
                 DataType<T>::one,
-                bottom_desc_.Get(), bottoms_[i]->Get(),
+                bottom_desc_.Get(), BottomPtr(i),
                 desc_.GetFilter(), weights_->Get(),
                 desc_.GetConv(),
                 fwd_algo_, fwd_workspace_, fwd_workspace_size_,
                 DataType<T>::zero,
-                top_desc_.Get(), tops_[i]->Get()));
+                top_desc_.Get(), TopPtr(i)));
     }
     cudaProfilerStop();
-
-    // TODO: evaluate the necessity of freeing memory here
-    // Free the workspace
-    CUDA_CALL(cudaFree(fwd_workspace_));
   }
   void BackwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the top data and top diff data
       for (int i = 0; i < num_tops_; i++) {
         tops_[i]->Filler();
@@ -265,7 +595,8 @@ class ConvolutionLayer : public Layer<T> {
       }
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
-        bottoms_[i]->Filler();
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
       }
     }
 
@@ -277,8 +608,8 @@ class ConvolutionLayer : public Layer<T> {
                 p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
                 p_dnnmark_->GetHandle()->GetCudnn(),
                 DataType<T>::one,
-                bottom_desc_.Get(), bottoms_[i]->Get(),
-                top_desc_.Get(), top_diffs_[i]->Get(),
+                bottom_desc_.Get(), BottomPtr(i),
+                top_desc_.Get(), TopDiffPtr(i),
                 desc_.GetConv(),
                 bwd_filter_algo_,
                 bwd_filter_workspace_, bwd_filter_workspace_size_,
@@ -290,19 +621,14 @@ class ConvolutionLayer : public Layer<T> {
                 p_dnnmark_->GetHandle()->GetCudnn(),
                 DataType<T>::one,
                 desc_.GetFilter(), weights_->Get(),
-                top_desc_.Get(), top_diffs_[i]->Get(),
+                top_desc_.Get(), TopDiffPtr(i),
                 desc_.GetConv(),
                 bwd_data_algo_,
                 bwd_data_workspace_, bwd_data_workspace_size_,
                 DataType<T>::zero,
-                bottom_desc_.Get(), bottoms_[i]->Get()));
+                bottom_desc_.Get(), BottomDiffPtr(i)));
     }
     cudaProfilerStop();
-
-    // TODO: evaluate the necessity of freeing memory here
-    // Free the workspace
-    CUDA_CALL(cudaFree(bwd_data_workspace_));
-    CUDA_CALL(cudaFree(bwd_filter_workspace_));
   }
 
 };
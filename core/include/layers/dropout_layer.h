@@ -50,6 +50,12 @@ class DropoutLayer : public Layer<T> {
   using Layer<T>::top_chunk_ids_;
   using Layer<T>::top_diffs_;
   using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::batch_begin_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
 
  private:
   DropoutParam dropout_param_;
@@ -58,11 +64,24 @@ class DropoutLayer : public Layer<T> {
   void *random_states_;
   size_t reserve_space_size_;
   void *reserve_space_;
+
+  // Part of the reserve space that belongs to the current batch view
+  size_t view_reserve_space_size_;
+  size_t view_reserve_space_offset_;
  
  public:
   DropoutLayer(DNNMark<T> *p_dnnmark)
   : Layer<T>(p_dnnmark),
-    dropout_param_() {
+    dropout_param_(), dropout_desc_(nullptr),
+    random_states_(nullptr), reserve_space_(nullptr),
+    view_reserve_space_size_(0), view_reserve_space_offset_(0) {
+  }
+
+  ~DropoutLayer() {
+    CUDA_CALL(cudaFree(random_states_));
+    CUDA_CALL(cudaFree(reserve_space_));
+    if (dropout_desc_ != nullptr)
+      CUDNN_CALL(cudnnDestroyDropoutDescriptor(dropout_desc_));
   }
 
   DropoutParam *getDropoutParam() { return &dropout_param_; }
@@ -72,27 +91,30 @@ class DropoutLayer : public Layer<T> {
     Layer<T>::Setup();
 
     // Set up dropout related data
-
-
-    CUDNN_CALL(cudnnCreateDropoutDescriptor(&dropout_desc_));
-    CUDNN_CALL(cudnnDropoutGetReserveSpaceSize(bottom_desc_.Get(), &reserve_space_size_));
-    CUDNN_CALL(cudnnDropoutGetStatesSize(p_dnnmark_->getRunMode() == COMPOSED ?
-                                         p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
-                                         p_dnnmark_->GetHandle()->GetCudnn(),
-                                         &random_states_size_));
-    
-    CUDA_CALL(cudaMalloc(&random_states_, random_states_size_));
-    
-    CUDNN_CALL(cudnnSetDropoutDescriptor(dropout_desc_,
-                                         p_dnnmark_->getRunMode() == COMPOSED ?
-                                         p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
-                                         p_dnnmark_->GetHandle()->GetCudnn(),
-                                         dropout_param_.dropout_p_,
-                                         random_states_,
-                                         random_states_size_,
-                                         dropout_param_.random_seed_));
-
-    CUDA_CALL(cudaMalloc(&reserve_space_, reserve_space_size_));
+    // Inference applies no mask, the layer is the identity
+    if (Layer<T>::isTraining()) {
+      CUDNN_CALL(cudnnCreateDropoutDescriptor(&dropout_desc_));
+      CUDNN_CALL(cudnnDropoutGetReserveSpaceSize(bottom_desc_.Get(), &reserve_space_size_));
+      CUDNN_CALL(cudnnDropoutGetStatesSize(p_dnnmark_->getRunMode() == COMPOSED ?
+                                           p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
+                                           p_dnnmark_->GetHandle()->GetCudnn(),
+                                           &random_states_size_));
+
+      CUDA_CALL(cudaMalloc(&random_states_, random_states_size_));
+
+      CUDNN_CALL(cudnnSetDropoutDescriptor(dropout_desc_,
+                                           p_dnnmark_->getRunMode() == COMPOSED ?
+                                           p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
+                                           p_dnnmark_->GetHandle()->GetCudnn(),
+                                           dropout_param_.dropout_p_,
+                                           random_states_,
+                                           random_states_size_,
+                                           dropout_param_.random_seed_));
+
+      CUDA_CALL(cudaMalloc(&reserve_space_, reserve_space_size_));
+      view_reserve_space_size_ = reserve_space_size_;
+      view_reserve_space_offset_ = 0;
+    }
 
     if (input_dim_.n_ != 0 && input_dim_.c_ != 0 &&
         input_dim_.h_ != 0 && input_dim_.w_ != 0) {
@@ -115,11 +137,15 @@ class DropoutLayer : public Layer<T> {
                      output_dim_.h_ *
                      output_dim_.w_;
       for (int i = 0; i < num_tops_; i++) {
-        top_chunk_ids_.push_back(
+        top_chunk_ids_.push_back(Layer<T>::isInPlace() ?
+          bottom_chunk_ids_[i] :
           data_manager_->CreateData(top_size));
         tops_.push_back(
           data_manager_->GetData(top_chunk_ids_[i]));
-        top_diff_chunk_ids_.push_back(
+        if (!Layer<T>::isTraining())
+          continue;
+        top_diff_chunk_ids_.push_back(Layer<T>::isInPlace() ?
+          bottom_diff_chunk_ids_[i] :
           data_manager_->CreateData(top_size));
         top_diffs_.push_back(
           data_manager_->GetData(top_diff_chunk_ids_[i]));
@@ -128,6 +154,24 @@ class DropoutLayer : public Layer<T> {
     }
   }
 
+  void SetBatchView(int begin, int n) {
+    Layer<T>::SetBatchView(begin, n);
+    if (!Layer<T>::isTraining())
+      return;
+
+    // Each equally sized view keeps its own mask in the reserve space
+    CUDNN_CALL(cudnnDropoutGetReserveSpaceSize(bottom_desc_.Get(),
+                                               &view_reserve_space_size_));
+    view_reserve_space_offset_ = (begin / n) * view_reserve_space_size_;
+    if (view_reserve_space_offset_ + view_reserve_space_size_ >
+        reserve_space_size_)
+      view_reserve_space_offset_ = 0;
+  }
+
+  // The gradient only needs the mask kept in the reserve space
+  bool BackwardReadsBottom() { return false; }
+  bool BackwardReadsTop() { return false; }
+
   void ComputeOutputDim() {
     output_dim_.n_ = input_dim_.n_;
     output_dim_.c_ = input_dim_.c_;
@@ -136,8 +180,7 @@ class DropoutLayer : public Layer<T> {
   }
 
   void ForwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
         bottoms_[i]->Filler();
@@ -147,28 +190,33 @@ class DropoutLayer : public Layer<T> {
     // Dropout forwards
     cudaProfilerStart();
     for (int i = 0; i < num_bottoms_; i++) {
+      if (!Layer<T>::isTraining()) {
+        if (TopPtr(i) != BottomPtr(i))
+          CUDA_CALL(cudaMemcpyAsync(TopPtr(i), BottomPtr(i),
+                                    sizeof(T) * batch_n_ * input_dim_.c_ *
+                                    input_dim_.h_ * input_dim_.w_,
+                                    cudaMemcpyDeviceToDevice,
+                                    p_dnnmark_->getRunMode() == COMPOSED ?
+                                    p_dnnmark_->GetHandle()->GetStream(layer_id_):
+                                    p_dnnmark_->GetHandle()->GetStream()));
+        continue;
+      }
       CUDNN_CALL(cudnnDropoutForward(
               p_dnnmark_->getRunMode() == COMPOSED ?
               p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
               p_dnnmark_->GetHandle()->GetCudnn(),
               dropout_desc_,
-              bottom_desc_.Get(), bottoms_[i]->Get(),
-              top_desc_.Get(), tops_[i]->Get(),
-              reserve_space_,
-              reserve_space_size_
+              bottom_desc_.Get(), BottomPtr(i),
+              top_desc_.Get(), TopPtr(i),
+              static_cast<char *>(reserve_space_) + view_reserve_space_offset_,
+              view_reserve_space_size_
               ));
     }
     cudaProfilerStop();
-
-    //TODO: Evaluate the necessity of freeing memory here
-    CUDA_CALL(cudaFree(random_states_));
-    CUDA_CALL(cudaFree(reserve_space_));
-    CUDNN_CALL(cudnnDestroyDropoutDescriptor(dropout_desc_));
   }
 
   void BackwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the top and top diff data
       for (int i = 0; i < num_tops_; i++) {
         tops_[i]->Filler();
@@ -176,7 +224,8 @@ class DropoutLayer : public Layer<T> {
       }
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
-        bottoms_[i]->Filler();
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
       }
     }
 
@@ -188,18 +237,13 @@ class DropoutLayer : public Layer<T> {
               p_dnnmark_->GetHandle()->GetCudnn(layer_id_):
               p_dnnmark_->GetHandle()->GetCudnn(),
               dropout_desc_,
-              bottom_desc_.Get(), bottoms_[i]->Get(),
-              top_desc_.Get(), tops_[i]->Get(),
-              reserve_space_,
-              reserve_space_size_
+              top_desc_.Get(), TopDiffPtr(i),
+              bottom_desc_.Get(), BottomDiffPtr(i),
+              static_cast<char *>(reserve_space_) + view_reserve_space_offset_,
+              view_reserve_space_size_
               ));
     }
     cudaProfilerStop();
-
-    //TODO: Evaluate the necessity of freeing memory here
-    CUDA_CALL(cudaFree(random_states_));
-    CUDA_CALL(cudaFree(reserve_space_));
-    CUDNN_CALL(cudnnDestroyDropoutDescriptor(dropout_desc_));
   }
 
 };
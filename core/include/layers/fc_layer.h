@@ -50,6 +50,14 @@ class FullyConnectedLayer : public Layer<T> {
   using Layer<T>::top_chunk_ids_;
   using Layer<T>::top_diffs_;
   using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::param_chunk_ids_;
+  using Layer<T>::param_diff_chunk_ids_;
+  using Layer<T>::batch_begin_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
 
  private:
   FullyConnectedParam fc_param_;
@@ -105,6 +113,8 @@ class FullyConnectedLayer : public Layer<T> {
           data_manager_->CreateData(top_size));
         tops_.push_back(
           data_manager_->GetData(top_chunk_ids_[i]));
+        if (!Layer<T>::isTraining())
+          continue;
         top_diff_chunk_ids_.push_back(
           data_manager_->CreateData(top_size));
         top_diffs_.push_back(
@@ -120,9 +130,13 @@ class FullyConnectedLayer : public Layer<T> {
     int weights_size = num_rows_weights_ * num_cols_weights_;
     weights_chunk_id_ = data_manager_->CreateData(weights_size);
     weights_ = data_manager_->GetData(weights_chunk_id_);
-    weights_diff_chunk_id_ =
-      data_manager_->CreateData(weights_size);
-    weights_diff_ = data_manager_->GetData(weights_diff_chunk_id_);
+    param_chunk_ids_.push_back(weights_chunk_id_);
+    if (Layer<T>::isTraining()) {
+      weights_diff_chunk_id_ =
+        data_manager_->CreateData(weights_size);
+      weights_diff_ = data_manager_->GetData(weights_diff_chunk_id_);
+      param_diff_chunk_ids_.push_back(weights_diff_chunk_id_);
+    }
 
     // Fill the weight data
     weights_->Filler();
@@ -131,6 +145,8 @@ class FullyConnectedLayer : public Layer<T> {
     scale_beta_ = (T)0.0;
   }
 
+  bool BackwardReadsTop() { return false; }
+
   void ComputeOutputDim() {
     output_dim_.n_ = input_dim_.n_;
     output_dim_.c_ = fc_param_.output_num_;
@@ -139,8 +155,7 @@ class FullyConnectedLayer : public Layer<T> {
   }
 
   void ForwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
         bottoms_[i]->Filler();
@@ -149,7 +164,7 @@ class FullyConnectedLayer : public Layer<T> {
 
     // Prepare CuBLAS parameters
     int M = fc_param_.output_num_;
-    int N = input_dim_.n_;;
+    int N = batch_n_;
     int K = num_rows_weights_;
     int lda = K;
     int ldb = K;
@@ -161,37 +176,39 @@ class FullyConnectedLayer : public Layer<T> {
     cudaProfilerStart();
     for (int i = 0; i < num_bottoms_; i++) {
       // Y = T(W) * X                                                               
-      DNNMarkGEMM(p_dnnmark_->GetHandle()->GetBlas(),
+      DNNMarkGEMM(p_dnnmark_->getRunMode() == COMPOSED ?
+                  p_dnnmark_->GetHandle()->GetBlas(layer_id_):
+                  p_dnnmark_->GetHandle()->GetBlas(),
                   is_a_transpose, is_b_transpose,
                   M, N, K,
                   &scale_alpha_,
                   weights_->Get(), lda,
-                  bottoms_[i]->Get(), ldb,
+                  BottomPtr(i), ldb,
                   &scale_beta_,
-                  tops_[i]->Get(), ldc);
+                  TopPtr(i), ldc);
     }
     cudaProfilerStop();
 
   }
 
   void BackwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the top and top diff data
       for (int i = 0; i < num_tops_; i++) {
         tops_[i]->Filler();
-        tops_[i]->Filler();
+        top_diffs_[i]->Filler();
       }
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
-        bottoms_[i]->Filler();
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
       }
     }
 
     // Prepare CuBLAS parameters for calculating d(W)
     int M = num_rows_weights_; 
     int N = fc_param_.output_num_;
-    int K = input_dim_.n_;
+    int K = batch_n_;
     int lda = M;
     int ldb = N;
     int ldc = M;
@@ -202,19 +219,21 @@ class FullyConnectedLayer : public Layer<T> {
     cudaProfilerStart();
     for (int i = 0; i < num_tops_; i++) {
       // d(W) = X * T(d(Y))
-      DNNMarkGEMM(p_dnnmark_->GetHandle()->GetBlas(),
+      DNNMarkGEMM(p_dnnmark_->getRunMode() == COMPOSED ?
+                  p_dnnmark_->GetHandle()->GetBlas(layer_id_):
+                  p_dnnmark_->GetHandle()->GetBlas(),
                   is_a_transpose, is_b_transpose,
                   M, N, K,
                   &scale_alpha_,
-                  bottoms_[i]->Get(), lda,
-                  top_diffs_[i]->Get(), ldb,
+                  BottomPtr(i), lda,
+                  TopDiffPtr(i), ldb,
                   &scale_beta_,
                   weights_diff_->Get(), ldc);
     }
     cudaProfilerStop();
 
     M = num_rows_weights_;
-    N = input_dim_.n_;
+    N = batch_n_;
     K = fc_param_.output_num_;
     lda = M;
     ldb = K;
@@ -226,14 +245,16 @@ class FullyConnectedLayer : public Layer<T> {
     cudaProfilerStart();
     for (int i = 0; i < num_tops_; i++) {
       // d(X) = W * d(Y)
-      DNNMarkGEMM(p_dnnmark_->GetHandle()->GetBlas(),
+      DNNMarkGEMM(p_dnnmark_->getRunMode() == COMPOSED ?
+                  p_dnnmark_->GetHandle()->GetBlas(layer_id_):
+                  p_dnnmark_->GetHandle()->GetBlas(),
                   is_a_transpose, is_b_transpose,
                   M, N, K,
                   &scale_alpha_,
                   weights_->Get(), lda,
-                  top_diffs_[i]->Get(), ldb,
+                  TopDiffPtr(i), ldb,
                   &scale_beta_,
-                  bottom_diffs_[i]->Get(), ldc);
+                  BottomDiffPtr(i), ldc);
     }
     cudaProfilerStop();
   }
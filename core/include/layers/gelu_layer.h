@@ -0,0 +1,176 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_LAYERS_GELU_LAYER_H_
+#define CORE_INCLUDE_LAYERS_GELU_LAYER_H_
+
+#include "dnn_layer.h"
+#include "kernels.h"
+
+namespace dnnmark {
+
+template <typename T>
+class GELULayer : public Layer<T> {
+  // using declaration for calling member from base class
+  using Layer<T>::p_dnnmark_;
+  using Layer<T>::layer_id_;
+  using Layer<T>::input_dim_;
+  using Layer<T>::output_dim_;
+  using Layer<T>::bottom_desc_;
+  using Layer<T>::top_desc_;
+  using Layer<T>::data_manager_;
+
+  using Layer<T>::num_bottoms_;
+  using Layer<T>::bottoms_;
+  using Layer<T>::bottom_chunk_ids_;
+  using Layer<T>::bottom_diffs_;
+  using Layer<T>::bottom_diff_chunk_ids_;
+
+  using Layer<T>::num_tops_;
+  using Layer<T>::tops_;
+  using Layer<T>::top_chunk_ids_;
+  using Layer<T>::top_diffs_;
+  using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
+
+ private:
+  GELUParam gelu_param_;
+
+  cudaStream_t Stream() {
+    return p_dnnmark_->getRunMode() == COMPOSED ?
+           p_dnnmark_->GetHandle()->GetStream(layer_id_) :
+           p_dnnmark_->GetHandle()->GetStream();
+  }
+
+ public:
+  GELULayer(DNNMark<T> *p_dnnmark)
+  : Layer<T>(p_dnnmark),
+    gelu_param_() {
+  }
+
+  GELUParam *getGELUParam() { return &gelu_param_; }
+
+  void Setup() {
+    // Set up indispensable stuff here
+    Layer<T>::Setup();
+
+    // Set up GELU related data
+    if (input_dim_.n_ != 0 && input_dim_.c_ != 0 &&
+        input_dim_.h_ != 0 && input_dim_.w_ != 0) {
+      //
+      // Standalone mode
+      //
+
+      // Compute dimension of output data
+      ComputeOutputDim();
+
+      // Set top tensor
+      top_desc_.Set(output_dim_.n_,
+                    output_dim_.c_,
+                    output_dim_.h_,
+                    output_dim_.w_);
+
+      // Prepare top data
+      int top_size = output_dim_.n_ *
+                     output_dim_.c_ *
+                     output_dim_.h_ *
+                     output_dim_.w_;
+      for (int i = 0; i < num_tops_; i++) {
+        top_chunk_ids_.push_back(Layer<T>::isInPlace() ?
+          bottom_chunk_ids_[i] :
+          data_manager_->CreateData(top_size));
+        tops_.push_back(
+          data_manager_->GetData(top_chunk_ids_[i]));
+        if (!Layer<T>::isTraining())
+          continue;
+        top_diff_chunk_ids_.push_back(Layer<T>::isInPlace() ?
+          bottom_diff_chunk_ids_[i] :
+          data_manager_->CreateData(top_size));
+        top_diffs_.push_back(
+          data_manager_->GetData(top_diff_chunk_ids_[i]));
+      }
+    }
+  }
+
+  // The gradient is computed from the input
+  bool BackwardReadsTop() { return false; }
+
+  void ComputeOutputDim() {
+    output_dim_.n_ = input_dim_.n_;
+    output_dim_.c_ = input_dim_.c_;
+    output_dim_.h_ = input_dim_.h_;
+    output_dim_.w_ = input_dim_.w_;
+  }
+
+  void ForwardPropagation() {
+    if (Layer<T>::isDataFillRequired()) {
+      // Fill the bottom data
+      for (int i = 0; i < num_bottoms_; i++) {
+        bottoms_[i]->Filler();
+      }
+    }
+
+    int size = batch_n_ * input_dim_.c_ * input_dim_.h_ * input_dim_.w_;
+
+    // GELU forward computation
+    cudaProfilerStart();
+    for (int i = 0; i < num_bottoms_; i++) {
+      DNNMarkGELUForward(Stream(), size, gelu_param_.approximate_,
+                         BottomPtr(i), TopPtr(i));
+    }
+    cudaProfilerStop();
+  }
+
+  void BackwardPropagation() {
+    if (Layer<T>::isDataFillRequired()) {
+      // Fill the top and top diff data
+      for (int i = 0; i < num_tops_; i++) {
+        tops_[i]->Filler();
+        top_diffs_[i]->Filler();
+      }
+      // Fill the bottom data
+      for (int i = 0; i < num_bottoms_; i++) {
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
+      }
+    }
+
+    int size = batch_n_ * input_dim_.c_ * input_dim_.h_ * input_dim_.w_;
+
+    // GELU backward computation
+    cudaProfilerStart();
+    for (int i = 0; i < num_tops_; i++) {
+      DNNMarkGELUBackward(Stream(), size, gelu_param_.approximate_,
+                          BottomPtr(i), TopDiffPtr(i), BottomDiffPtr(i));
+    }
+    cudaProfilerStop();
+  }
+
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_LAYERS_GELU_LAYER_H_
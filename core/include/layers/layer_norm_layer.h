@@ -0,0 +1,244 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef CORE_INCLUDE_LAYERS_LAYER_NORM_LAYER_H_
+#define CORE_INCLUDE_LAYERS_LAYER_NORM_LAYER_H_
+
+#include "dnn_layer.h"
+#include "kernels.h"
+
+namespace dnnmark {
+
+//
+// Layer normalization of the tokens of a sample. The input holds seq_len
+// tokens per sample, each normalized over its features and then scaled
+// and shifted per feature. The output has the shape of the input.
+//
+
+template <typename T>
+class LayerNormLayer : public Layer<T> {
+  // using declaration for calling member from base class
+  using Layer<T>::p_dnnmark_;
+  using Layer<T>::layer_id_;
+  using Layer<T>::input_dim_;
+  using Layer<T>::output_dim_;
+  using Layer<T>::bottom_desc_;
+  using Layer<T>::top_desc_;
+  using Layer<T>::data_manager_;
+
+  using Layer<T>::num_bottoms_;
+  using Layer<T>::bottoms_;
+  using Layer<T>::bottom_chunk_ids_;
+  using Layer<T>::bottom_diffs_;
+  using Layer<T>::bottom_diff_chunk_ids_;
+
+  using Layer<T>::num_tops_;
+  using Layer<T>::tops_;
+  using Layer<T>::top_chunk_ids_;
+  using Layer<T>::top_diffs_;
+  using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::param_chunk_ids_;
+  using Layer<T>::param_diff_chunk_ids_;
+  using Layer<T>::batch_begin_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
+
+ private:
+  LayerNormParam ln_param_;
+
+  int seq_len_;
+  int features_;
+
+  // Scale and shift per feature
+  Data<T> *gamma_;
+  Data<T> *beta_;
+  Data<T> *gamma_diff_;
+  Data<T> *beta_diff_;
+  // Mean and reciprocal standard deviation of every token
+  Data<T> *mean_;
+  Data<T> *rstd_;
+  // Gamma and beta gradients of every chunk of rows, training only
+  Data<T> *partials_;
+
+  cudaStream_t Stream() {
+    return p_dnnmark_->getRunMode() == COMPOSED ?
+           p_dnnmark_->GetHandle()->GetStream(layer_id_) :
+           p_dnnmark_->GetHandle()->GetStream();
+  }
+
+  Data<T> *CreateData(int size) {
+    return data_manager_->GetData(data_manager_->CreateData(size));
+  }
+
+  // Learnable tensor and its gradient
+  Data<T> *CreateParam(int size, Data<T> **diff) {
+    int chunk_id = data_manager_->CreateData(size);
+    Data<T> *param = data_manager_->GetData(chunk_id);
+    param_chunk_ids_.push_back(chunk_id);
+    param->Filler();
+    if (Layer<T>::isTraining()) {
+      int diff_chunk_id = data_manager_->CreateData(size);
+      param_diff_chunk_ids_.push_back(diff_chunk_id);
+      *diff = data_manager_->GetData(diff_chunk_id);
+    }
+    return param;
+  }
+
+ public:
+  LayerNormLayer(DNNMark<T> *p_dnnmark)
+  : Layer<T>(p_dnnmark),
+    ln_param_() {
+    Layer<T>::has_learnable_params_ = true;
+  }
+
+  LayerNormParam *getLayerNormParam() { return &ln_param_; }
+
+  void Setup() {
+    // Set up indispensable stuff here
+    Layer<T>::Setup();
+
+    // Set up layer normalization related data
+    if (input_dim_.n_ != 0 && input_dim_.c_ != 0 &&
+        input_dim_.h_ != 0 && input_dim_.w_ != 0) {
+      //
+      // Standalone mode
+      //
+
+      // Compute dimension of output data
+      ComputeOutputDim();
+
+      // Set top tensor
+      top_desc_.Set(output_dim_.n_,
+                    output_dim_.c_,
+                    output_dim_.h_,
+                    output_dim_.w_);
+
+      // Prepare top data
+      int top_size = output_dim_.n_ *
+                     output_dim_.c_ *
+                     output_dim_.h_ *
+                     output_dim_.w_;
+      for (int i = 0; i < num_tops_; i++) {
+        top_chunk_ids_.push_back(
+          data_manager_->CreateData(top_size));
+        tops_.push_back(
+          data_manager_->GetData(top_chunk_ids_[i]));
+        if (!Layer<T>::isTraining())
+          continue;
+        top_diff_chunk_ids_.push_back(
+          data_manager_->CreateData(top_size));
+        top_diffs_.push_back(
+          data_manager_->GetData(top_diff_chunk_ids_[i]));
+      }
+    }
+
+    gamma_ = CreateParam(features_, &gamma_diff_);
+    beta_ = CreateParam(features_, &beta_diff_);
+    mean_ = CreateData(input_dim_.n_ * seq_len_);
+    rstd_ = CreateData(input_dim_.n_ * seq_len_);
+    if (Layer<T>::isTraining()) {
+      int rows = input_dim_.n_ * seq_len_;
+      partials_ = CreateData(2 * features_ *
+        ((rows + kLayerNormRowChunk - 1) / kLayerNormRowChunk));
+    }
+  }
+
+  // The gradient is computed from the input and its statistics
+  bool BackwardReadsTop() { return false; }
+
+  void ComputeOutputDim() {
+    int features = input_dim_.c_ * input_dim_.h_ * input_dim_.w_;
+    seq_len_ = ln_param_.seq_len_ > 0 ? ln_param_.seq_len_ : input_dim_.c_;
+    CHECK_EQ(features % seq_len_, 0)
+      << Layer<T>::getLayerName() << ": " << features
+      << " input features per sample are no multiple of " << seq_len_
+      << " tokens";
+    features_ = features / seq_len_;
+    output_dim_.n_ = input_dim_.n_;
+    output_dim_.c_ = input_dim_.c_;
+    output_dim_.h_ = input_dim_.h_;
+    output_dim_.w_ = input_dim_.w_;
+  }
+
+  void ForwardPropagation() {
+    if (Layer<T>::isDataFillRequired()) {
+      // Fill the bottom data
+      for (int i = 0; i < num_bottoms_; i++) {
+        bottoms_[i]->Filler();
+      }
+    }
+
+    int rows = batch_n_ * seq_len_;
+    int row_begin = batch_begin_ * seq_len_;
+
+    // Layer normalization forward computation
+    cudaProfilerStart();
+    for (int i = 0; i < num_bottoms_; i++) {
+      DNNMarkLayerNormForward(Stream(), rows, features_,
+                              (T)ln_param_.epsilon_, BottomPtr(i),
+                              gamma_->Get(), beta_->Get(), TopPtr(i),
+                              mean_->Get() + row_begin,
+                              rstd_->Get() + row_begin);
+    }
+    cudaProfilerStop();
+  }
+
+  void BackwardPropagation() {
+    if (Layer<T>::isDataFillRequired()) {
+      // Fill the top and top diff data
+      for (int i = 0; i < num_tops_; i++) {
+        tops_[i]->Filler();
+        top_diffs_[i]->Filler();
+      }
+      // Fill the bottom data
+      for (int i = 0; i < num_bottoms_; i++) {
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
+      }
+    }
+
+    int rows = batch_n_ * seq_len_;
+    int row_begin = batch_begin_ * seq_len_;
+
+    // Layer normalization backward computation, the statistics are those
+    // of the last forward pass
+    cudaProfilerStart();
+    for (int i = 0; i < num_tops_; i++) {
+      DNNMarkLayerNormBackward(Stream(), rows, features_, BottomPtr(i),
+                               TopDiffPtr(i), gamma_->Get(),
+                               mean_->Get() + row_begin,
+                               rstd_->Get() + row_begin,
+                               BottomDiffPtr(i), gamma_diff_->Get(),
+                               beta_diff_->Get(), partials_->Get());
+    }
+    cudaProfilerStop();
+  }
+
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_LAYERS_LAYER_NORM_LAYER_H_
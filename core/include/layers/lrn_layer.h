@@ -50,6 +50,12 @@ class LRNLayer : public Layer<T> {
   using Layer<T>::top_chunk_ids_;
   using Layer<T>::top_diffs_;
   using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::batch_begin_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
 
  private:
   LRNParam lrn_param_;
@@ -98,6 +104,8 @@ class LRNLayer : public Layer<T> {
           data_manager_->CreateData(top_size));
         tops_.push_back(
           data_manager_->GetData(top_chunk_ids_[i]));
+        if (!Layer<T>::isTraining())
+          continue;
         top_diff_chunk_ids_.push_back(
           data_manager_->CreateData(top_size));
         top_diffs_.push_back(
@@ -114,8 +122,7 @@ class LRNLayer : public Layer<T> {
   }
 
   void ForwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
         bottoms_[i]->Filler();
@@ -132,16 +139,15 @@ class LRNLayer : public Layer<T> {
              desc_.Get(),
              lrn_param_.mode_,
              DataType<T>::one, 
-             bottom_desc_.Get(), bottoms_[i]->Get(),
+             bottom_desc_.Get(), BottomPtr(i),
              DataType<T>::zero,
-             top_desc_.Get(), tops_[i]->Get()));
+             top_desc_.Get(), TopPtr(i)));
     }
     cudaProfilerStop();
 
   }
   void BackwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the top and top diff data
       for (int i = 0; i < num_tops_; i++) {
         tops_[i]->Filler();
@@ -149,7 +155,8 @@ class LRNLayer : public Layer<T> {
       }
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
-        bottoms_[i]->Filler();
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
       }
     }
 
@@ -163,13 +170,13 @@ class LRNLayer : public Layer<T> {
              desc_.Get(),
              lrn_param_.mode_,
              DataType<T>::one, 
-             top_desc_.Get(), tops_[i]->Get(),
-             top_desc_.Get(), top_diffs_[i]->Get(),
+             top_desc_.Get(), TopPtr(i),
+             top_desc_.Get(), TopDiffPtr(i),
              bottom_desc_.Get(),
-             bottoms_[i]->Get(),
+             BottomPtr(i),
              DataType<T>::zero,
              bottom_desc_.Get(),
-             bottom_diffs_[i]->Get()));
+             BottomDiffPtr(i)));
     }
     cudaProfilerStop();
   }
@@ -0,0 +1,479 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_LAYERS_RNN_LAYER_H_
+#define CORE_INCLUDE_LAYERS_RNN_LAYER_H_
+
+#include <vector>
+
+#include "dnn_layer.h"
+#include "kernels.h"
+
+namespace dnnmark {
+
+//
+// Stacked LSTM or GRU, unidirectional or bidirectional. Sequences are
+// laid out sample major, step t of sample s starts at (s * T + t) times
+// the step size. Per layer and direction, the input projection of all
+// steps is one GEMM, each step then runs the recurrent GEMM and a fused
+// kernel for the gate nonlinearities. Backward propagates through time
+// the same way and computes the input weight and data gradients of all
+// steps with one GEMM each. Backward overwrites the gate activations
+// with their gradients, so it needs the forward pass before it.
+//
+
+template <typename T>
+class RNNLayer : public Layer<T> {
+  // using declaration for calling member from base class
+  using Layer<T>::p_dnnmark_;
+  using Layer<T>::layer_id_;
+  using Layer<T>::input_dim_;
+  using Layer<T>::output_dim_;
+  using Layer<T>::bottom_desc_;
+  using Layer<T>::top_desc_;
+  using Layer<T>::data_manager_;
+
+  using Layer<T>::num_bottoms_;
+  using Layer<T>::bottoms_;
+  using Layer<T>::bottom_chunk_ids_;
+  using Layer<T>::bottom_diffs_;
+  using Layer<T>::bottom_diff_chunk_ids_;
+
+  using Layer<T>::num_tops_;
+  using Layer<T>::tops_;
+  using Layer<T>::top_chunk_ids_;
+  using Layer<T>::top_diffs_;
+  using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::param_chunk_ids_;
+  using Layer<T>::param_diff_chunk_ids_;
+  using Layer<T>::batch_begin_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
+
+ private:
+  RNNParam rnn_param_;
+
+  int seq_len_;
+  // Step size of the input of the first layer
+  int input_size_;
+  int num_gates_;
+  int num_dirs_;
+  T scale_alpha_;
+  T scale_beta_;
+
+  // Outputs of all but the last layer, which writes the top
+  std::vector<Data<T> *> outputs_;
+  std::vector<Data<T> *> output_diffs_;
+
+  // Per layer and direction, at layer * num_dirs_ + direction
+  std::vector<Data<T> *> weights_x_;
+  std::vector<Data<T> *> weights_h_;
+  std::vector<Data<T> *> biases_;
+  std::vector<Data<T> *> weights_x_diff_;
+  std::vector<Data<T> *> weights_h_diff_;
+  std::vector<Data<T> *> biases_diff_;
+  // Input projections, kept as gate activations for backward
+  std::vector<Data<T> *> gates_;
+  // LSTM cell states, GRU recurrent candidate terms
+  std::vector<Data<T> *> cells_;
+
+  // Recurrent projection of one step, gradients carried between steps
+  Data<T> *recur_;
+  Data<T> *h_diff_;
+  Data<T> *c_diff_;
+  // Sums the bias gradients over all steps
+  Data<T> *ones_;
+
+  bool isLSTM() { return Layer<T>::getLayerType() == LSTM; }
+
+  cublasHandle_t Blas() {
+    return p_dnnmark_->getRunMode() == COMPOSED ?
+           p_dnnmark_->GetHandle()->GetBlas(layer_id_) :
+           p_dnnmark_->GetHandle()->GetBlas();
+  }
+
+  cudaStream_t Stream() {
+    return p_dnnmark_->getRunMode() == COMPOSED ?
+           p_dnnmark_->GetHandle()->GetStream(layer_id_) :
+           p_dnnmark_->GetHandle()->GetStream();
+  }
+
+  Data<T> *CreateData(int size) {
+    return data_manager_->GetData(data_manager_->CreateData(size));
+  }
+
+  // Learnable tensor and its gradient
+  Data<T> *CreateParam(int size, std::vector<Data<T> *> *diffs) {
+    int chunk_id = data_manager_->CreateData(size);
+    Data<T> *param = data_manager_->GetData(chunk_id);
+    param_chunk_ids_.push_back(chunk_id);
+    param->Filler();
+    if (Layer<T>::isTraining()) {
+      int diff_chunk_id = data_manager_->CreateData(size);
+      param_diff_chunk_ids_.push_back(diff_chunk_id);
+      diffs->push_back(data_manager_->GetData(diff_chunk_id));
+    }
+    return param;
+  }
+
+  int InputSize(int layer) {
+    return layer == 0 ? input_size_ : num_dirs_ * rnn_param_.hidden_size_;
+  }
+
+ public:
+  RNNLayer(DNNMark<T> *p_dnnmark)
+  : Layer<T>(p_dnnmark),
+    rnn_param_() {
+    Layer<T>::has_learnable_params_ = true;
+  }
+
+  RNNParam *getRNNParam() { return &rnn_param_; }
+
+  void Setup() {
+    // Set up indispensable stuff here
+    Layer<T>::Setup();
+
+    // Set up recurrent related data
+    if (input_dim_.n_ != 0 && input_dim_.c_ != 0 &&
+        input_dim_.h_ != 0 && input_dim_.w_ != 0) {
+      //
+      // Standalone mode
+      //
+
+      // Compute dimension of output data
+      ComputeOutputDim();
+
+      // Set top tensor
+      top_desc_.Set(output_dim_.n_,
+                    output_dim_.c_,
+                    output_dim_.h_,
+                    output_dim_.w_);
+
+      // Prepare top data
+      int top_size = output_dim_.n_ *
+                     output_dim_.c_ *
+                     output_dim_.h_ *
+                     output_dim_.w_;
+      for (int i = 0; i < num_tops_; i++) {
+        top_chunk_ids_.push_back(
+          data_manager_->CreateData(top_size));
+        tops_.push_back(
+          data_manager_->GetData(top_chunk_ids_[i]));
+        if (!Layer<T>::isTraining())
+          continue;
+        top_diff_chunk_ids_.push_back(
+          data_manager_->CreateData(top_size));
+        top_diffs_.push_back(
+          data_manager_->GetData(top_diff_chunk_ids_[i]));
+      }
+    }
+
+    int n = input_dim_.n_;
+    int hidden = rnn_param_.hidden_size_;
+    num_gates_ = isLSTM() ? 4 : 3;
+    for (int l = 0; l < rnn_param_.num_layers_; l++) {
+      if (l + 1 < rnn_param_.num_layers_) {
+        outputs_.push_back(CreateData(n * seq_len_ * num_dirs_ * hidden));
+        if (Layer<T>::isTraining())
+          output_diffs_.push_back(
+            CreateData(n * seq_len_ * num_dirs_ * hidden));
+      }
+      for (int d = 0; d < num_dirs_; d++) {
+        weights_x_.push_back(CreateParam(num_gates_ * hidden * InputSize(l),
+                                         &weights_x_diff_));
+        weights_h_.push_back(CreateParam(num_gates_ * hidden * hidden,
+                                         &weights_h_diff_));
+        // GRU keeps the recurrent bias apart, it is reset gated
+        biases_.push_back(CreateParam((isLSTM() ? 1 : 2) * num_gates_ *
+                                      hidden, &biases_diff_));
+        gates_.push_back(CreateData(n * seq_len_ * num_gates_ * hidden));
+        cells_.push_back(CreateData(n * seq_len_ * hidden));
+      }
+    }
+    recur_ = CreateData(n * num_gates_ * hidden);
+    if (Layer<T>::isTraining()) {
+      h_diff_ = CreateData(n * hidden);
+      c_diff_ = CreateData(n * hidden);
+      std::vector<T> ones(n * seq_len_, T(1));
+      ones_ = CreateData(n * seq_len_);
+      CUDA_CALL(cudaMemcpy(ones_->Get(), ones.data(), ones.size() * sizeof(T),
+                           cudaMemcpyHostToDevice));
+    }
+
+    scale_alpha_ = (T)1.0;
+    scale_beta_ = (T)0.0;
+  }
+
+  void ComputeOutputDim() {
+    int features = input_dim_.c_ * input_dim_.h_ * input_dim_.w_;
+    seq_len_ = rnn_param_.seq_len_ > 0 ? rnn_param_.seq_len_ :
+                                         input_dim_.c_;
+    CHECK_EQ(features % seq_len_, 0)
+      << Layer<T>::getLayerName() << ": " << features
+      << " input features per sample are no multiple of " << seq_len_
+      << " steps";
+    input_size_ = features / seq_len_;
+    num_dirs_ = rnn_param_.bidirectional_ ? 2 : 1;
+    output_dim_.n_ = input_dim_.n_;
+    output_dim_.c_ = seq_len_;
+    output_dim_.h_ = num_dirs_ * rnn_param_.hidden_size_;
+    output_dim_.w_ = 1;
+  }
+
+  void ForwardPropagation() {
+    if (Layer<T>::isDataFillRequired()) {
+      // Fill the bottom data
+      for (int i = 0; i < num_bottoms_; i++) {
+        bottoms_[i]->Filler();
+      }
+    }
+
+    int n = batch_n_;
+    int hidden = rnn_param_.hidden_size_;
+    int gate_size = num_gates_ * hidden;
+    int hidden_stride = seq_len_ * num_dirs_ * hidden;
+    // Per sample buffers follow the batch view
+    int gate_begin = batch_begin_ * seq_len_ * gate_size;
+    int cell_begin = batch_begin_ * seq_len_ * hidden;
+    int output_begin = batch_begin_ * hidden_stride;
+
+    // Recurrent forward computation
+    cudaProfilerStart();
+    for (int i = 0; i < num_bottoms_; i++) {
+      for (int l = 0; l < rnn_param_.num_layers_; l++) {
+        T *x = l == 0 ? BottomPtr(i) :
+                        outputs_[l - 1]->Get() + output_begin;
+        T *y = l + 1 == rnn_param_.num_layers_ ? TopPtr(i) :
+               outputs_[l]->Get() + output_begin;
+        for (int d = 0; d < num_dirs_; d++) {
+          int k = l * num_dirs_ + d;
+          T *gates = gates_[k]->Get() + gate_begin;
+          T *cells = cells_[k]->Get() + cell_begin;
+
+          // Input projection of all steps, G = W_x * X
+          DNNMarkGEMM(Blas(), false, false,
+                      gate_size, n * seq_len_, InputSize(l),
+                      &scale_alpha_,
+                      weights_x_[k]->Get(), gate_size,
+                      x, InputSize(l),
+                      &scale_beta_,
+                      gates, gate_size);
+
+          // The backward direction runs from the last step
+          for (int s = 0; s < seq_len_; s++) {
+            int t = d == 0 ? s : seq_len_ - 1 - s;
+            int prev = d == 0 ? t - 1 : t + 1;
+            T *h_prev = s > 0 ? y + (prev * num_dirs_ + d) * hidden :
+                                nullptr;
+            RNNStep<T> step;
+            step.n = n;
+            step.hidden = hidden;
+            step.gates = gates + t * gate_size;
+            step.gate_stride = seq_len_ * gate_size;
+            step.recur = s > 0 ? recur_->Get() : nullptr;
+            step.bias = biases_[k]->Get();
+            step.cell = cells + t * hidden;
+            step.cell_prev = s > 0 && isLSTM() ? cells + prev * hidden :
+                                                 nullptr;
+            step.cell_stride = seq_len_ * hidden;
+            step.h = y + (t * num_dirs_ + d) * hidden;
+            step.h_prev = h_prev;
+            step.hidden_stride = hidden_stride;
+            step.h_diff = nullptr;
+            step.c_diff = nullptr;
+            step.carry = false;
+
+            // R = W_h * h_prev
+            if (s > 0)
+              DNNMarkGEMM(Blas(), false, false,
+                          gate_size, n, hidden,
+                          &scale_alpha_,
+                          weights_h_[k]->Get(), gate_size,
+                          h_prev, hidden_stride,
+                          &scale_beta_,
+                          recur_->Get(), gate_size);
+            if (isLSTM())
+              DNNMarkLSTMForwardStep(Stream(), step);
+            else
+              DNNMarkGRUForwardStep(Stream(), step);
+          }
+        }
+      }
+    }
+    cudaProfilerStop();
+  }
+
+  void BackwardPropagation() {
+    if (Layer<T>::isDataFillRequired()) {
+      // Fill the top and top diff data
+      for (int i = 0; i < num_tops_; i++) {
+        tops_[i]->Filler();
+        top_diffs_[i]->Filler();
+      }
+      // Fill the bottom data
+      for (int i = 0; i < num_bottoms_; i++) {
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
+      }
+    }
+
+    int n = batch_n_;
+    int hidden = rnn_param_.hidden_size_;
+    int gate_size = num_gates_ * hidden;
+    int hidden_stride = seq_len_ * num_dirs_ * hidden;
+    int gate_begin = batch_begin_ * seq_len_ * gate_size;
+    int cell_begin = batch_begin_ * seq_len_ * hidden;
+    int output_begin = batch_begin_ * hidden_stride;
+    T one = (T)1.0;
+
+    // Recurrent backward computation through time
+    cudaProfilerStart();
+    for (int i = 0; i < num_tops_; i++) {
+      for (int l = rnn_param_.num_layers_ - 1; l >= 0; l--) {
+        T *x = l == 0 ? BottomPtr(i) :
+                        outputs_[l - 1]->Get() + output_begin;
+        T *dx = l == 0 ? BottomDiffPtr(i) :
+                         output_diffs_[l - 1]->Get() + output_begin;
+        bool last = l + 1 == rnn_param_.num_layers_;
+        T *y = last ? TopPtr(i) : outputs_[l]->Get() + output_begin;
+        T *dy = last ? TopDiffPtr(i) :
+                       output_diffs_[l]->Get() + output_begin;
+        for (int d = 0; d < num_dirs_; d++) {
+          int k = l * num_dirs_ + d;
+          T *gates = gates_[k]->Get() + gate_begin;
+          T *cells = cells_[k]->Get() + cell_begin;
+          T *weights_h_diff = weights_h_diff_[k]->Get();
+          CUDA_CALL(cudaMemsetAsync(weights_h_diff, 0,
+                                    gate_size * hidden * sizeof(T),
+                                    Stream()));
+
+          // Steps in the reverse order of forward
+          for (int s = 0; s < seq_len_; s++) {
+            int t = d == 0 ? seq_len_ - 1 - s : s;
+            int prev = d == 0 ? t - 1 : t + 1;
+            bool has_prev = prev >= 0 && prev < seq_len_;
+            T *h_prev = has_prev ? y + (prev * num_dirs_ + d) * hidden :
+                                   nullptr;
+            RNNStep<T> step;
+            step.n = n;
+            step.hidden = hidden;
+            step.gates = gates + t * gate_size;
+            step.gate_stride = seq_len_ * gate_size;
+            step.recur = recur_->Get();
+            step.bias = biases_[k]->Get();
+            step.cell = cells + t * hidden;
+            step.cell_prev = has_prev && isLSTM() ?
+                             cells + prev * hidden : nullptr;
+            step.cell_stride = seq_len_ * hidden;
+            step.h = dy + (t * num_dirs_ + d) * hidden;
+            step.h_prev = h_prev;
+            step.hidden_stride = hidden_stride;
+            step.h_diff = h_diff_->Get();
+            step.c_diff = c_diff_->Get();
+            step.carry = s > 0;
+
+            if (isLSTM())
+              DNNMarkLSTMBackwardStep(Stream(), step);
+            else
+              DNNMarkGRUBackwardStep(Stream(), step);
+            if (!has_prev)
+              continue;
+
+            // Gradient of the recurrent projection, the gate gradients
+            // for LSTM and its own for GRU
+            T *d_recur = isLSTM() ? step.gates : recur_->Get();
+            int d_recur_ld = isLSTM() ? step.gate_stride : gate_size;
+            // d(h_prev) = T(W_h) * d(R), added to the GRU update path
+            DNNMarkGEMM(Blas(), true, false,
+                        hidden, n, gate_size,
+                        &scale_alpha_,
+                        weights_h_[k]->Get(), gate_size,
+                        d_recur, d_recur_ld,
+                        isLSTM() ? &scale_beta_ : &one,
+                        h_diff_->Get(), hidden);
+            // d(W_h) += d(R) * T(h_prev)
+            DNNMarkGEMM(Blas(), false, true,
+                        gate_size, hidden, n,
+                        &scale_alpha_,
+                        d_recur, d_recur_ld,
+                        h_prev, hidden_stride,
+                        &one,
+                        weights_h_diff, gate_size);
+          }
+
+          // d(W_x) = d(G) * T(X) over all steps
+          DNNMarkGEMM(Blas(), false, true,
+                      gate_size, InputSize(l), n * seq_len_,
+                      &scale_alpha_,
+                      gates, gate_size,
+                      x, InputSize(l),
+                      &scale_beta_,
+                      weights_x_diff_[k]->Get(), gate_size);
+          // d(b) = d(G) * 1
+          T *bias_diff = biases_diff_[k]->Get();
+          DNNMarkGEMM(Blas(), false, false,
+                      gate_size, 1, n * seq_len_,
+                      &scale_alpha_,
+                      gates, gate_size,
+                      ones_->Get(), n * seq_len_,
+                      &scale_beta_,
+                      bias_diff, gate_size);
+          if (!isLSTM()) {
+            // Recurrent bias, the reset and update parts equal the input
+            // ones and the candidate part was left in the cells
+            DNNMarkGEMM(Blas(), false, false,
+                        2 * hidden, 1, n * seq_len_,
+                        &scale_alpha_,
+                        gates, gate_size,
+                        ones_->Get(), n * seq_len_,
+                        &scale_beta_,
+                        bias_diff + gate_size, 2 * hidden);
+            DNNMarkGEMM(Blas(), false, false,
+                        hidden, 1, n * seq_len_,
+                        &scale_alpha_,
+                        cells, hidden,
+                        ones_->Get(), n * seq_len_,
+                        &scale_beta_,
+                        bias_diff + gate_size + 2 * hidden, hidden);
+          }
+          // d(X) = T(W_x) * d(G), both directions add up
+          DNNMarkGEMM(Blas(), true, false,
+                      InputSize(l), n * seq_len_, gate_size,
+                      &scale_alpha_,
+                      weights_x_[k]->Get(), gate_size,
+                      gates, gate_size,
+                      d == 0 ? &scale_beta_ : &one,
+                      dx, InputSize(l));
+        }
+      }
+    }
+    cudaProfilerStop();
+  }
+
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_LAYERS_RNN_LAYER_H_
@@ -50,6 +50,12 @@ class SoftmaxLayer : public Layer<T> {
   using Layer<T>::top_chunk_ids_;
   using Layer<T>::top_diffs_;
   using Layer<T>::top_diff_chunk_ids_;
+  using Layer<T>::batch_begin_;
+  using Layer<T>::batch_n_;
+  using Layer<T>::BottomPtr;
+  using Layer<T>::BottomDiffPtr;
+  using Layer<T>::TopPtr;
+  using Layer<T>::TopDiffPtr;
 
  private:
   SoftmaxParam softmax_param_;
@@ -92,6 +98,8 @@ class SoftmaxLayer : public Layer<T> {
           data_manager_->CreateData(top_size));
         tops_.push_back(
           data_manager_->GetData(top_chunk_ids_[i]));
+        if (!Layer<T>::isTraining())
+          continue;
         top_diff_chunk_ids_.push_back(
           data_manager_->CreateData(top_size));
         top_diffs_.push_back(
@@ -109,8 +117,7 @@ class SoftmaxLayer : public Layer<T> {
   }
 
   void ForwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
         bottoms_[i]->Filler();
@@ -127,17 +134,16 @@ class SoftmaxLayer : public Layer<T> {
               softmax_param_.algo_,
               softmax_param_.mode_,
               DataType<T>::one,                                                  
-              bottom_desc_.Get(), bottoms_[i]->Get(),
+              bottom_desc_.Get(), BottomPtr(i),
               DataType<T>::zero,
-              top_desc_.Get(), tops_[i]->Get()));
+              top_desc_.Get(), TopPtr(i)));
     }
     cudaProfilerStop();
 
   }
 
   void BackwardPropagation() {
-    if (p_dnnmark_->getRunMode() == STANDALONE ||
-        !previous_layer_name_.compare("null")) {
+    if (Layer<T>::isDataFillRequired()) {
       // Fill the top and top diff data
       for (int i = 0; i < num_tops_; i++) {
         tops_[i]->Filler();
@@ -145,7 +151,8 @@ class SoftmaxLayer : public Layer<T> {
       }
       // Fill the bottom data
       for (int i = 0; i < num_bottoms_; i++) {
-        bottoms_[i]->Filler();
+        if (!bottoms_[i]->hasSource())
+          bottoms_[i]->Filler();
       }
     }
 
@@ -159,11 +166,11 @@ class SoftmaxLayer : public Layer<T> {
               softmax_param_.algo_,
               softmax_param_.mode_,
               DataType<T>::one,
-              top_desc_.Get(), tops_[i]->Get(),
-              top_desc_.Get(), top_diffs_[i]->Get(),
+              top_desc_.Get(), TopPtr(i),
+              top_desc_.Get(), TopDiffPtr(i),
               DataType<T>::zero,
               bottom_desc_.Get(),
-              bottom_diffs_[i]->Get()));
+              BottomDiffPtr(i)));
     }
     cudaProfilerStop();
   }
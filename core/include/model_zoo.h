@@ -0,0 +1,96 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_MODEL_ZOO_H_
+#define CORE_INCLUDE_MODEL_ZOO_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// Builds well-known networks with the DNNMark builder at a given batch
+// size and input resolution:
+//
+// vgg16, vgg19      Simonyan & Zisserman, configurations D and E
+// resnet18          He et al., basic blocks
+// resnet50          He et al., bottleneck blocks, stride on the 3x3
+//                   convolution as in ResNet v1.5
+// inception_v1      Szegedy et al. (GoogLeNet) without auxiliary heads
+// mobilenet_v1      Howard et al., width multiplier 1.0
+//
+// DNNMark networks are chains of one-input layers, so residual
+// additions, concatenations and depthwise convolutions have no layer to
+// map to. Those are replaced as described by Report(), never silently.
+//
+
+template <typename T>
+class ModelZoo {
+ private:
+  DNNMark<T> *p_dnnmark_;
+  std::string model_;
+  DataDim input_dim_;
+
+  // Layer the next one reads from and the shape of its output
+  std::string previous_layer_;
+  DataDim dim_;
+  int num_layers_;
+  // Topology features replaced by something else, with their count
+  std::vector<std::pair<std::string, int>> replacements_;
+
+  void Replace(const std::string &feature);
+  DataDim InputDim() const;
+  void CheckDim(const std::string &name) const;
+
+  void Conv(const std::string &name, int output_num, int kernel_size,
+            int stride, int pad);
+  void Pool(const std::string &name, cudnnPoolingMode_t mode,
+            int kernel_size, int stride, int pad);
+  void GlobalAvgPool(const std::string &name);
+  void BatchNorm(const std::string &name);
+  void ReLU(const std::string &name);
+  void LRN(const std::string &name);
+  void FullyConnected(const std::string &name, int output_num);
+  void Dropout(const std::string &name, float dropout_p);
+  void Softmax(const std::string &name);
+
+  void BuildVGG(const std::vector<int> &blocks);
+  void BuildResNet(const std::vector<int> &blocks, bool bottleneck);
+  void BuildInceptionV1();
+  void BuildMobileNetV1();
+
+ public:
+  ModelZoo(DNNMark<T> *p_dnnmark);
+  static const std::vector<std::string> &Models();
+  int Build(const std::string &model, int batch_size, int resolution);
+  void Report();
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_MODEL_ZOO_H_
@@ -0,0 +1,118 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_OFFLOAD_H_
+#define CORE_INCLUDE_OFFLOAD_H_
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnn_utility.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// Activation offload of a composed chain model to pinned host memory.
+// Selected layer tops live in a small ring of device staging slots. A top
+// is copied to the host once its consumer has run forward, and copied back
+// ahead of its backward use, all on a copy stream that runs concurrently
+// with the compute stream. Time the compute stream spends waiting on the
+// copies is reported as stall.
+//
+
+template <typename T>
+class Offload {
+ private:
+  struct Slot {
+    T *ptr;
+    // Recorded when the last user of the slot is done with it
+    cudaEvent_t free;
+  };
+
+  DNNMark<T> *p_dnnmark_;
+  int num_layers_;
+  int num_units_;
+  int num_slots_;
+
+  // Chain in forward order, in-place layers form a unit with their
+  // producer, everything below is indexed by unit
+  std::vector<std::vector<Layer<T> *>> units_;
+  std::vector<Data<T> *> activations_;
+  std::vector<bool> offloaded_;
+  // Slot every offloaded top currently occupies
+  std::vector<int> slot_of_;
+
+  // Pinned host pool and the offset of every offloaded top in it
+  T *host_pool_;
+  std::vector<size_t> host_offset_;
+  size_t host_bytes_;
+  size_t slot_bytes_;
+
+  std::vector<Slot> slots_;
+  std::deque<int> free_slots_;
+
+  cudaStream_t compute_stream_;
+  cudaStream_t copy_stream_;
+  // Per layer, the offloaded top may be read again
+  std::vector<cudaEvent_t> consumed_;
+  std::vector<cudaEvent_t> prefetched_;
+  // Stall measurement around every wait of the compute stream
+  std::vector<std::pair<cudaEvent_t, cudaEvent_t>> stall_events_;
+  int num_stalls_;
+
+  // Measurements in milliseconds
+  float baseline_step_time_;
+  float step_time_;
+  float offload_stall_time_;
+  float prefetch_stall_time_;
+
+  int AcquireSlot(int unit);
+  void Stall(const cudaEvent_t &event);
+  float StallTime(int begin, int end);
+  void Prefetch(const std::vector<int> &order, int *next);
+
+ public:
+  Offload(DNNMark<T> *p_dnnmark);
+  ~Offload();
+  int Setup();
+  int Train();
+  void Report();
+
+  int getNumOffloaded();
+  float getBaselineStepTime() { return baseline_step_time_; }
+  float getStepTime() { return step_time_; }
+  // Compute stream blocked until a slot was written back to the host
+  float getOffloadStallTime() { return offload_stall_time_; }
+  // Compute stream blocked on a prefetch that arrived late
+  float getPrefetchStallTime() { return prefetch_stall_time_; }
+  size_t getSavedDeviceBytes() {
+    return host_bytes_ - std::min(host_bytes_, num_slots_ * slot_bytes_);
+  }
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_OFFLOAD_H_
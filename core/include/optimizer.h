@@ -0,0 +1,79 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_OPTIMIZER_H_
+#define CORE_INCLUDE_OPTIMIZER_H_
+
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnnmark.h"
+#include "kernels.h"
+
+namespace dnnmark {
+
+//
+// Parameter update after the backward pass. Every learnable chunk of the
+// model (convolution and fully connected weights, batch normalization
+// scale and bias) is updated by multi-tensor kernels, so a step is one
+// launch for SGD and Adam and three for LAMB regardless of the number of
+// layers.
+//
+
+template <typename T>
+class Optimizer {
+ private:
+  DNNMark<T> *p_dnnmark_;
+  OptimizerParam *param_;
+
+  int num_tensors_;
+  size_t num_elements_;
+  // Momentum or first and second moments, one chunk each per tensor
+  std::vector<int> state_chunk_ids_;
+
+  // Launch description and the device memory behind its arrays
+  MultiTensorList<T> list_;
+  T **device_ptrs_;
+  int *device_ints_;
+  // Squared norms of the weights and updates for LAMB
+  T *norms_;
+  // Per block sums of the norms, reduced in a fixed order
+  T *partials_;
+
+  // Number of updates applied, for the Adam bias correction
+  int step_;
+
+ public:
+  Optimizer(DNNMark<T> *p_dnnmark);
+  ~Optimizer();
+  int Setup();
+  // Enqueue one update on the default stream
+  int Step();
+
+  int getNumTensors() { return num_tensors_; }
+  size_t getNumElements() { return num_elements_; }
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_OPTIMIZER_H_
@@ -0,0 +1,82 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_PARAM_SWEEP_H_
+#define CORE_INCLUDE_PARAM_SWEEP_H_
+
+#include <string>
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnn_utility.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// Expands layer parameters given as lists or ranges into the cartesian
+// product of configurations and times each of them in this process. The
+// handle and the general configuration of the model are shared by all
+// points, only the layers are parsed and set up again.
+//
+
+template <typename T>
+class ParamSweep {
+ private:
+  struct Axis {
+    // Line of the config holding the swept parameter
+    int line;
+    std::string label;
+    std::string var;
+    std::vector<std::string> values;
+  };
+  struct Point {
+    std::vector<std::string> values;
+    // Average time per iteration in milliseconds
+    float forward_time;
+    float backward_time;
+  };
+
+  DNNMark<T> *p_dnnmark_;
+  int num_iterations_;
+  std::vector<std::string> lines_;
+  std::vector<Axis> axes_;
+  std::vector<Point> points_;
+
+  void ReadConfig(const std::string &config_file);
+  std::string PointConfig(const std::vector<int> &choice);
+  Point Measure(const std::vector<int> &choice);
+
+ public:
+  ParamSweep(DNNMark<T> *p_dnnmark, const std::string &config_file,
+             int num_iterations = 10);
+  int Run();
+  // One row per point, written as CSV when a file name is given
+  void Report(const std::string &csv_file = "");
+
+  int getNumPoints();
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_PARAM_SWEEP_H_
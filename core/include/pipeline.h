@@ -0,0 +1,101 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_PIPELINE_H_
+#define CORE_INCLUDE_PIPELINE_H_
+
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnn_utility.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// Micro-batch pipeline-parallel execution of a composed model.
+// The layer list is partitioned into contiguous stages of balanced cost,
+// each stage runs on its own stream and micro-batches are streamed
+// through the stages following a GPipe or 1F1B schedule.
+// Several micro-batches may be forwarded before their backward, so
+// layers keep what their backward needs per batch view: dropout its
+// mask and batch normalization its saved statistics.
+//
+
+template <typename T>
+class Pipeline {
+ private:
+  struct StageOp {
+    int microbatch;
+    bool forward;
+  };
+
+  DNNMark<T> *p_dnnmark_;
+  int num_microbatches_;
+  int num_stages_;
+  int batch_size_;
+  int microbatch_size_;
+
+  // Layers of each stage in forward order
+  std::vector<std::vector<Layer<T> *>> stages_;
+  std::vector<cudaStream_t> streams_;
+
+  // Cross stage dependencies, indexed by stage * microbatches + microbatch
+  std::vector<cudaEvent_t> fwd_done_;
+  std::vector<cudaEvent_t> bwd_done_;
+
+  // Timing of every stage operation and of the whole run
+  std::vector<cudaEvent_t> op_start_;
+  std::vector<cudaEvent_t> op_stop_;
+  std::vector<bool> op_issued_;
+  cudaEvent_t run_start_;
+  std::vector<cudaEvent_t> run_stop_;
+
+  // Measurements of the last run
+  std::vector<float> stage_busy_time_;
+  float makespan_;
+  bool last_run_training_;
+
+  std::vector<float> ProfileLayers();
+  void Partition(const std::vector<float> &layer_costs);
+  std::vector<StageOp> BuildSchedule(int stage, bool training);
+  void IssueOp(int stage, const StageOp &op);
+  int Run(bool training);
+
+ public:
+  Pipeline(DNNMark<T> *p_dnnmark);
+  ~Pipeline();
+  int Setup();
+  int Forward();
+  int Train();
+  void Report();
+
+  int getNumStages() { return num_stages_; }
+  float getMakespan() { return makespan_; }
+  float getStageUtilization(int stage);
+  float getBubbleFraction();
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_PIPELINE_H_
@@ -0,0 +1,107 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_PROTOTXT_IMPORTER_H_
+#define CORE_INCLUDE_PROTOTXT_IMPORTER_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// Message of the protobuf text format, as written in Caffe prototxt files.
+// Fields keep their order and may repeat, values are kept as text.
+//
+
+struct PrototxtMessage {
+  int line_;
+  std::vector<std::pair<std::string, std::string>> scalars_;
+  std::vector<std::pair<std::string, std::shared_ptr<PrototxtMessage>>>
+    messages_;
+
+  PrototxtMessage()
+  : line_(0) {}
+
+  bool Has(const std::string &field) const;
+  // First value of a scalar field, or the default when it is absent
+  std::string Get(const std::string &field,
+                  const std::string &default_value = "") const;
+  std::vector<std::string> GetAll(const std::string &field) const;
+  // First sub-message of the field, null when it is absent
+  const PrototxtMessage *Child(const std::string &field) const;
+  std::vector<const PrototxtMessage *> Children(
+      const std::string &field) const;
+};
+
+//
+// Builds the layers of a Caffe network definition with the DNNMark
+// builder, without any protobuf dependency. The network has to be a
+// deploy definition whose input shape is given by input/input_dim,
+// input_shape or an Input layer. Layers and parameters DNNMark has no
+// counterpart for are fatal errors naming the line of the layer.
+//
+// Convolution     -> [Convolution]     Pooling      -> [Pooling]
+// LRN             -> [LRN]             ReLU/Sigmoid/TanH -> [Activation]
+// InnerProduct    -> [FullyConnected]  Softmax(WithLoss) -> [Softmax]
+// BatchNorm+Scale -> [BatchNorm]       Dropout      -> [Dropout]
+//
+
+template <typename T>
+class PrototxtImporter {
+ private:
+  DNNMark<T> *p_dnnmark_;
+  std::string file_;
+  // DNNMark layer producing each blob, "null" for the network input
+  std::map<std::string, std::string> producers_;
+  // Shape of each blob, followed through the layers
+  std::map<std::string, DataDim> shapes_;
+  // Blobs written by batch normalization, a Scale layer on them is
+  // the affine part DNNMark computes in the same layer
+  std::set<std::string> bn_blobs_;
+
+  int num_layers_;
+  int num_folded_;
+  int num_skipped_;
+
+  void AddInput(const std::string &blob, const std::vector<std::string> &dims,
+                int batch_size, int line);
+  void ImportLayer(const PrototxtMessage &layer);
+
+ public:
+  PrototxtImporter(DNNMark<T> *p_dnnmark);
+  // The batch of the input is replaced when batch_size is positive
+  int Import(const std::string &file, int batch_size = 0);
+  void Report();
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_PROTOTXT_IMPORTER_H_
@@ -0,0 +1,100 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_REMATERIALIZATION_H_
+#define CORE_INCLUDE_REMATERIALIZATION_H_
+
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnn_utility.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// Gradient checkpointing of a composed chain model under a memory budget.
+// Only a subset of layer tops (checkpoints) is kept from forward until
+// backward, the others are released after their last forward use and
+// recomputed segment by segment from the preceding checkpoint in backward.
+//
+
+template <typename T>
+class Rematerialization {
+ private:
+  DNNMark<T> *p_dnnmark_;
+  int num_layers_;
+  int num_units_;
+
+  // Chain in forward order, in-place layers form a unit with their
+  // producer, and the top each unit produces
+  std::vector<std::vector<Layer<T> *>> units_;
+  std::vector<Data<T> *> activations_;
+  std::vector<size_t> activation_bytes_;
+  size_t total_activation_bytes_;
+
+  // Forward cost of every unit measured in warmup, in milliseconds
+  std::vector<float> forward_costs_;
+  float baseline_step_time_;
+
+  // Current plan
+  size_t budget_;
+  std::vector<bool> checkpoint_;
+  float planned_recompute_cost_;
+  size_t planned_peak_bytes_;
+
+  // Measurements of the last training step
+  size_t resident_bytes_;
+  size_t peak_resident_bytes_;
+  float step_time_;
+
+  void Profile();
+  // Cheapest checkpoint set with no recompute segment above the bound,
+  // returns the recompute cost or a negative value when infeasible
+  float SolveForBound(size_t segment_bound, size_t checkpoint_budget,
+                      std::vector<bool> *checkpoint);
+  void ForwardUnit(int unit);
+  void BackwardUnit(int unit);
+  void Release(int unit);
+  void Acquire(int unit);
+
+ public:
+  Rematerialization(DNNMark<T> *p_dnnmark);
+  int Setup();
+  int Plan(size_t budget);
+  int Train();
+  void Report();
+
+  int getNumCheckpoints();
+  float getBaselineStepTime() { return baseline_step_time_; }
+  float getStepTime() { return step_time_; }
+  float getRecomputeOverhead() { return step_time_ - baseline_step_time_; }
+  size_t getPeakActivationBytes() { return peak_resident_bytes_; }
+  size_t getSavedActivationBytes() {
+    return total_activation_bytes_ - peak_resident_bytes_;
+  }
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_REMATERIALIZATION_H_
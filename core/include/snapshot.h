@@ -0,0 +1,93 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_SNAPSHOT_H_
+#define CORE_INCLUDE_SNAPSHOT_H_
+
+#include <string>
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// Snapshot of the tensors a model starts from: the parameters and
+// running statistics of every layer and the random inputs of the data
+// fill layers. Loading one replaces the random data of Initialize with
+// trained weights, whose sparsity and value distribution random data
+// does not reproduce. Fusion folds into separate chunks, so the saved
+// parameters are always the unfolded ones.
+//
+// File layout, integers in host byte order:
+//   char   magic[8]        "DNNMSNAP"
+//   uint32 version
+//   uint32 num_tensors
+//   per tensor:
+//     uint32 name_length, char name[name_length]   e.g. "conv1.param0"
+//     uint32 dtype                                  cudnnDataType_t
+//     uint32 rank, uint64 dims[rank]
+//     uint64 offset, uint64 bytes                   payload location
+//   raw payloads, each starting at a multiple of kAlignment
+//
+// The file is mapped and the payloads are copied from the mapping
+// straight into their chunks, so loading costs page faults and the
+// copies rather than any parsing of the values.
+//
+
+template <typename T>
+class Snapshot {
+ private:
+  struct Tensor {
+    std::string name_;
+    int chunk_id_;
+    std::vector<unsigned long long> dims_;
+  };
+
+  DNNMark<T> *p_dnnmark_;
+  // Tensors of the model in layer order
+  std::vector<Tensor> tensors_;
+
+  // Outcome of the last Save or Load
+  int num_tensors_;
+  int num_skipped_;
+  unsigned long long bytes_;
+  double time_;
+
+  void Collect();
+
+ public:
+  static const int kVersion = 1;
+  static const int kAlignment = 64;
+
+  Snapshot(DNNMark<T> *p_dnnmark);
+  int Save(const std::string &file);
+  // Tensors missing from the file keep their current data
+  int Load(const std::string &file);
+  void Report();
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_SNAPSHOT_H_
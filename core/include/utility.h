@@ -24,6 +24,7 @@
 #define CORE_INCLUDE_UTILITY_H_
 
 #include <string>
+#include <vector>
 #include <algorithm>
 #include <cctype>
 #include <functional>
@@ -45,6 +46,21 @@ void TrimStrRight(std::string *s);
 void SplitStr(const std::string &s, std::string *var, std::string *val,
               std::string delimiter = "=");
 
+//
+// Split a list value like "1,2,4" into trimmed items
+//
+
+void SplitList(const std::string &s, std::vector<std::string> *items,
+               char delimiter = ',');
+
+//
+// Sweep values are lists "1,3,5" or inclusive integer ranges
+// "begin:end[:step]", expanded into one value per configuration
+//
+
+bool isSweepValue(const std::string &s);
+void ExpandSweepValue(const std::string &s, std::vector<std::string> *values);
+
 //
 // Detect useless str
 //
@@ -0,0 +1,74 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CORE_INCLUDE_WORKSPACE_PLANNER_H_
+#define CORE_INCLUDE_WORKSPACE_PLANNER_H_
+
+#include <vector>
+#include <glog/logging.h>
+
+#include "common.h"
+#include "dnnmark.h"
+
+namespace dnnmark {
+
+//
+// Convolution algorithm selection under one workspace budget shared by
+// all convolution layers. Every direction of every layer is a choice
+// among its measured algorithms; the planner picks one per choice so that
+// the workspaces together fit the budget and the summed time is minimal.
+// This is a multiple-choice knapsack, solved exactly over the budget cut
+// into kBudgetSteps units with workspaces rounded up, so the result never
+// exceeds the budget.
+//
+
+template <typename T>
+class WorkspacePlanner {
+ private:
+  struct Choice {
+    ConvolutionLayer<T> *layer_;
+    ConvDirection direction_;
+    // Fastest first
+    std::vector<AlgoCandidate> candidates_;
+    int chosen_;
+  };
+
+  static const int kBudgetSteps = 4096;
+
+  DNNMark<T> *p_dnnmark_;
+  size_t budget_;
+  std::vector<Choice> choices_;
+  // False when even the smallest workspaces do not fit
+  bool feasible_;
+
+ public:
+  WorkspacePlanner(DNNMark<T> *p_dnnmark);
+  // Choose and apply the algorithms, after Setup of every layer
+  int Plan();
+  void Report();
+
+  bool isFeasible() { return feasible_; }
+};
+
+} // namespace dnnmark
+
+#endif // CORE_INCLUDE_WORKSPACE_PLANNER_H_
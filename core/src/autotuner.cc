@@ -0,0 +1,288 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "autotuner.h"
+
+namespace dnnmark {
+
+//
+// AutotuneCache class definition
+//
+
+std::unique_ptr<AutotuneCache> AutotuneCache::instance_ = nullptr;
+
+AutotuneCache *AutotuneCache::GetInstance() {
+  if (instance_.get())
+    return instance_.get();
+  instance_.reset(new AutotuneCache());
+  return instance_.get();
+}
+
+void AutotuneCache::Open(const std::string &file) {
+  if (file == file_)
+    return;
+  file_ = file;
+  entries_.clear();
+
+  // A missing file only means nothing was tuned yet
+  std::ifstream is(file_);
+  std::string line;
+  while (std::getline(is, line)) {
+    std::istringstream iss(line);
+    std::string key;
+    Entry entry;
+    if (iss >> key >> entry.algo_ >> entry.time_ >> entry.workspace_size_)
+      entries_[key] = entry;
+    else if (!line.empty())
+      LOG(WARNING) << "Malformed autotune cache line in " << file_
+                   << ": " << line;
+  }
+}
+
+bool AutotuneCache::Lookup(const std::string &key, int *algo, float *time,
+                           size_t *workspace_size) {
+  auto it = entries_.find(key);
+  if (it == entries_.end())
+    return false;
+  *algo = it->second.algo_;
+  *time = it->second.time_;
+  *workspace_size = it->second.workspace_size_;
+  return true;
+}
+
+void AutotuneCache::Store(const std::string &key, int algo, float time,
+                          size_t workspace_size) {
+  entries_[key] = {algo, time, workspace_size};
+  std::ofstream os(file_, std::ios::app);
+  os << key << " " << algo << " " << time << " " << workspace_size
+     << std::endl;
+  LOG_IF(WARNING, !os) << "Cannot write the autotune cache " << file_;
+}
+
+const std::string &AutotuneCache::getFingerprint() {
+  if (!fingerprint_.empty())
+    return fingerprint_;
+  int device;
+  cudaDeviceProp prop;
+  int cuda_version;
+  CUDA_CALL(cudaGetDevice(&device));
+  CUDA_CALL(cudaGetDeviceProperties(&prop, device));
+  CUDA_CALL(cudaRuntimeGetVersion(&cuda_version));
+  std::ostringstream oss;
+  oss << prop.name << "_sm" << prop.major << prop.minor
+      << "_cuda" << cuda_version << "_cudnn" << cudnnGetVersion();
+  fingerprint_ = oss.str();
+  // Keys are whitespace separated in the file
+  std::replace(fingerprint_.begin(), fingerprint_.end(), ' ', '_');
+  return fingerprint_;
+}
+
+//
+// ConvAutotuner class definition
+//
+
+template <typename T>
+ConvAutotuner<T>::ConvAutotuner(cudnnHandle_t cudnn,
+                                const std::string &layer_name,
+                                const DataDim &input_dim,
+                                const ConvolutionParam &conv_param,
+                                DataTensor<T> *bottom_desc,
+                                ConvolutionDesc<T> *desc,
+                                DataTensor<T> *top_desc,
+                                const AutotuneParam &autotune_param,
+                                size_t workspace_limit,
+                                bool deterministic)
+: cudnn_(cudnn), layer_name_(layer_name),
+  bottom_desc_(bottom_desc->Get()),
+  filter_desc_(desc->GetFilter()),
+  conv_desc_(desc->GetConv()),
+  top_desc_(top_desc->Get()),
+  input_dim_(input_dim), conv_param_(conv_param),
+  autotune_param_(autotune_param),
+  workspace_limit_(workspace_limit), deterministic_(deterministic) {}
+
+template <typename T>
+const std::string &ConvAutotuner<T>::Shape() {
+  if (!shape_.empty())
+    return shape_;
+  AutotuneCache::GetInstance()->Open(autotune_param_.cache_file_);
+  std::ostringstream oss;
+  oss << "n" << input_dim_.n_ << "c" << input_dim_.c_
+      << "h" << input_dim_.h_ << "w" << input_dim_.w_
+      << "_k" << conv_param_.output_num_
+      << "r" << conv_param_.kernel_size_h_
+      << "s" << conv_param_.kernel_size_w_
+      << "_p" << conv_param_.pad_h_ << "x" << conv_param_.pad_w_
+      << "_u" << conv_param_.stride_u_ << "x" << conv_param_.stride_v_
+      << "_d" << conv_param_.upscale_x_ << "x" << conv_param_.upscale_y_
+      << (conv_param_.mode_ == CUDNN_CONVOLUTION ? "_conv" : "_xcorr")
+      << (deterministic_ ? "_deterministic" : "")
+      << (sizeof(T) == sizeof(double) ? "/double" : "/float")
+      << "/NCHW/" << AutotuneCache::GetInstance()->getFingerprint();
+  shape_ = oss.str();
+  return shape_;
+}
+
+template <typename T>
+int ConvAutotuner<T>::Search(
+    ConvDirection direction, int num_algos,
+    const std::function<cudnnStatus_t(int, size_t *)> &query,
+    const std::function<cudnnStatus_t(int, void *, size_t)> &run,
+    std::vector<AlgoCandidate> *candidates) {
+  AutotuneCache *cache = AutotuneCache::GetInstance();
+  std::string key = std::string(ConvDirectionName(direction)) + "/" +
+                    Shape();
+  int best_algo = -1;
+  float best_time = 0;
+  size_t best_size = 0;
+  bool cached = candidates == nullptr &&
+                cache->Lookup(key, &best_algo, &best_time, &best_size) &&
+                best_size <= workspace_limit_;
+
+  if (!cached) {
+    cudaStream_t stream;
+    CUDNN_CALL(cudnnGetStream(cudnn_, &stream));
+    Timer timer;
+    best_algo = -1;
+    for (int algo = 0; algo < num_algos; algo++) {
+      size_t size;
+      if ((deterministic_ && !isDeterministicAlgo(direction, algo)) ||
+          query(algo, &size) != CUDNN_STATUS_SUCCESS ||
+          size > workspace_limit_)
+        continue;
+      void *workspace = nullptr;
+      if (size > 0 && cudaMalloc(&workspace, size) != cudaSuccess) {
+        // Clear the error, the algorithm simply does not fit
+        cudaGetLastError();
+        continue;
+      }
+      // Some algorithms only reject the problem when launched
+      bool supported = true;
+      for (int i = 0; i < autotune_param_.warmup_ && supported; i++)
+        supported = run(algo, workspace, size) == CUDNN_STATUS_SUCCESS;
+      if (supported) {
+        timer.Start(stream);
+        for (int i = 0; i < autotune_param_.repetitions_; i++)
+          CUDNN_CALL(run(algo, workspace, size));
+        timer.Stop(stream);
+        float time = timer.Elapsed() / autotune_param_.repetitions_;
+        if (candidates != nullptr)
+          candidates->push_back({algo, time, size});
+        if (best_algo < 0 || time < best_time) {
+          best_algo = algo;
+          best_time = time;
+          best_size = size;
+        }
+      }
+      CUDA_CALL(cudaFree(workspace));
+    }
+    CHECK_GE(best_algo, 0) << layer_name_ << ": no "
+                           << ConvDirectionName(direction)
+                           << " algorithm fits the workspace limit";
+    cache->Store(key, best_algo, best_time, best_size);
+    if (candidates != nullptr)
+      std::sort(candidates->begin(), candidates->end(),
+                [](const AlgoCandidate &a, const AlgoCandidate &b) {
+                  return a.time_ < b.time_;
+                });
+  }
+
+  std::cout << "[Autotune] " << layer_name_ << " "
+            << ConvDirectionName(direction)
+            << ": algorithm " << best_algo << std::fixed
+            << std::setprecision(3) << ", " << best_time << " ms, "
+            << best_size / 1024.0 / 1024.0 << " MB workspace"
+            << (cached ? " (cached)" : "") << std::defaultfloat << std::endl;
+  return best_algo;
+}
+
+template <typename T>
+cudnnConvolutionFwdAlgo_t ConvAutotuner<T>::Forward(
+    const T *bottom, const T *weights, T *top,
+    std::vector<AlgoCandidate> *candidates) {
+  return static_cast<cudnnConvolutionFwdAlgo_t>(Search(
+      CONV_FWD, CUDNN_CONVOLUTION_FWD_ALGO_COUNT,
+      [&](int algo, size_t *size) {
+        return cudnnGetConvolutionForwardWorkspaceSize(
+            cudnn_, bottom_desc_, filter_desc_, conv_desc_, top_desc_,
+            static_cast<cudnnConvolutionFwdAlgo_t>(algo), size);
+      },
+      [&](int algo, void *workspace, size_t size) {
+        return cudnnConvolutionForward(
+            cudnn_, DataType<T>::one, bottom_desc_, bottom,
+            filter_desc_, weights, conv_desc_,
+            static_cast<cudnnConvolutionFwdAlgo_t>(algo), workspace, size,
+            DataType<T>::zero, top_desc_, top);
+      }, candidates));
+}
+
+template <typename T>
+cudnnConvolutionBwdFilterAlgo_t ConvAutotuner<T>::BackwardFilter(
+    const T *bottom, const T *top_diff, T *weights_diff,
+    std::vector<AlgoCandidate> *candidates) {
+  return static_cast<cudnnConvolutionBwdFilterAlgo_t>(Search(
+      CONV_BWD_FILTER, CUDNN_CONVOLUTION_BWD_FILTER_ALGO_COUNT,
+      [&](int algo, size_t *size) {
+        return cudnnGetConvolutionBackwardFilterWorkspaceSize(
+            cudnn_, bottom_desc_, top_desc_, conv_desc_, filter_desc_,
+            static_cast<cudnnConvolutionBwdFilterAlgo_t>(algo), size);
+      },
+      [&](int algo, void *workspace, size_t size) {
+        return cudnnConvolutionBackwardFilter(
+            cudnn_, DataType<T>::one, bottom_desc_, bottom,
+            top_desc_, top_diff, conv_desc_,
+            static_cast<cudnnConvolutionBwdFilterAlgo_t>(algo),
+            workspace, size,
+            DataType<T>::zero, filter_desc_, weights_diff);
+      }, candidates));
+}
+
+template <typename T>
+cudnnConvolutionBwdDataAlgo_t ConvAutotuner<T>::BackwardData(
+    const T *weights, const T *top_diff, T *bottom_diff,
+    std::vector<AlgoCandidate> *candidates) {
+  return static_cast<cudnnConvolutionBwdDataAlgo_t>(Search(
+      CONV_BWD_DATA, CUDNN_CONVOLUTION_BWD_DATA_ALGO_COUNT,
+      [&](int algo, size_t *size) {
+        return cudnnGetConvolutionBackwardDataWorkspaceSize(
+            cudnn_, filter_desc_, top_desc_, conv_desc_, bottom_desc_,
+            static_cast<cudnnConvolutionBwdDataAlgo_t>(algo), size);
+      },
+      [&](int algo, void *workspace, size_t size) {
+        return cudnnConvolutionBackwardData(
+            cudnn_, DataType<T>::one, filter_desc_, weights,
+            top_desc_, top_diff, conv_desc_,
+            static_cast<cudnnConvolutionBwdDataAlgo_t>(algo),
+            workspace, size,
+            DataType<T>::zero, bottom_desc_, bottom_diff);
+      }, candidates));
+}
+
+// Explicit instantiation
+template class ConvAutotuner<TestType>;
+
+} // namespace dnnmark
@@ -0,0 +1,119 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <iomanip>
+
+#include "batch_sweep.h"
+
+namespace dnnmark {
+
+//
+// BatchSweep class definition
+//
+
+template <typename T>
+BatchSweep<T>::BatchSweep(DNNMark<T> *p_dnnmark, int num_iterations)
+: p_dnnmark_(p_dnnmark), num_iterations_(num_iterations) {
+  CHECK_GT(num_iterations_, 0);
+}
+
+template <typename T>
+void BatchSweep<T>::SetBatchSize(int n) {
+  for (int i = 0; i < p_dnnmark_->getNumLayers(); i++)
+    p_dnnmark_->GetLayerByID(i)->SetBatchView(0, n);
+}
+
+template <typename T>
+int BatchSweep<T>::Run() {
+  const std::vector<int> &sizes = p_dnnmark_->getBatchSweep();
+  CHECK(!sizes.empty()) << "No batch_sweep configured";
+  bool training = p_dnnmark_->isTraining();
+  bool data_fill_enabled = p_dnnmark_->isDataFillEnabled();
+
+  points_.clear();
+  Timer timer;
+  for (auto n : sizes) {
+    SetBatchSize(n);
+
+    // One untimed step generates the input and settles the workspaces
+    p_dnnmark_->setDataFillEnabled(data_fill_enabled);
+    p_dnnmark_->Forward();
+    if (training) {
+      p_dnnmark_->Backward();
+      p_dnnmark_->Update();
+    }
+    p_dnnmark_->setDataFillEnabled(false);
+
+    Point point = {n, 0, 0, 0};
+    for (int iter = 0; iter < num_iterations_; iter++) {
+      timer.Start();
+      p_dnnmark_->Forward();
+      timer.Stop();
+      point.forward_time += timer.Elapsed();
+      if (!training)
+        continue;
+      timer.Start();
+      p_dnnmark_->Backward();
+      timer.Stop();
+      point.backward_time += timer.Elapsed();
+      timer.Start();
+      p_dnnmark_->Update();
+      timer.Stop();
+      point.update_time += timer.Elapsed();
+    }
+    point.forward_time /= num_iterations_;
+    point.backward_time /= num_iterations_;
+    point.update_time /= num_iterations_;
+    points_.push_back(point);
+    LOG(INFO) << "BatchSweep: batch " << n << " done";
+  }
+
+  // Back to the whole allocated batch
+  for (int i = 0; i < p_dnnmark_->getNumLayers(); i++) {
+    Layer<T> *layer = p_dnnmark_->GetLayerByID(i);
+    layer->SetBatchView(0, layer->getInputDim()->n_);
+  }
+  p_dnnmark_->setDataFillEnabled(data_fill_enabled);
+  return 0;
+}
+
+template <typename T>
+void BatchSweep<T>::Report() {
+  for (auto &point : points_) {
+    float latency = point.forward_time + point.backward_time +
+                    point.update_time;
+    std::cout << std::fixed << std::setprecision(3)
+              << "[BatchSweep] n: " << point.batch_size
+              << " forward: " << point.forward_time << " ms"
+              << " backward: " << point.backward_time << " ms"
+              << " optimizer: " << point.update_time << " ms"
+              << " latency: " << latency << " ms"
+              << std::setprecision(1)
+              << " throughput: " << point.batch_size * 1000.0 / latency
+              << " samples/s" << std::defaultfloat << std::endl;
+  }
+}
+
+// Explicit instantiation
+template class BatchSweep<TestType>;
+
+} // namespace dnnmark
@@ -0,0 +1,96 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <iomanip>
+
+#include "checksum.h"
+
+namespace dnnmark {
+
+//
+// Checksum class definition
+//
+
+template <typename T>
+Checksum<T>::Checksum(DNNMark<T> *p_dnnmark)
+: p_dnnmark_(p_dnnmark) {}
+
+template <typename T>
+void Checksum<T>::Add(const std::string &name, int chunk_id) {
+  Data<T> *data = DataManager<T>::GetInstance()->GetData(chunk_id);
+  std::vector<T> host(data->getSize());
+  CUDA_CALL(cudaMemcpy(host.data(), data->Get(), host.size() * sizeof(T),
+                       cudaMemcpyDeviceToHost));
+  const unsigned char *bytes =
+    reinterpret_cast<const unsigned char *>(host.data());
+  unsigned long long hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < host.size() * sizeof(T); i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  checksums_.push_back(std::make_pair(name, hash));
+}
+
+template <typename T>
+int Checksum<T>::Compute() {
+  checksums_.clear();
+  CUDA_CALL(cudaDeviceSynchronize());
+  for (int i = 0; i < p_dnnmark_->getNumLayers(); i++) {
+    Layer<T> *layer = p_dnnmark_->GetLayerByID(i);
+    std::string name = layer->getLayerName();
+    for (int j = 0; j < layer->getNumTops(); j++)
+      Add(name + ".top" + std::to_string(j), layer->getTopChunkID(j));
+    for (int j = 0; j < layer->getNumBottomDiffs(); j++)
+      Add(name + ".bottom_diff" + std::to_string(j),
+          layer->getBottomDiffChunkID(j));
+    for (int j = 0; j < layer->getNumParams(); j++) {
+      Add(name + ".param" + std::to_string(j), layer->getParamChunkID(j));
+      if (p_dnnmark_->isTraining())
+        Add(name + ".param_diff" + std::to_string(j),
+            layer->getParamDiffChunkID(j));
+    }
+  }
+  return 0;
+}
+
+template <typename T>
+void Checksum<T>::Report() {
+  for (auto &checksum : checksums_)
+    std::cout << "[Checksum] " << checksum.first << ": " << std::hex
+              << std::setw(16) << std::setfill('0') << checksum.second
+              << std::dec << std::setfill(' ') << std::endl;
+}
+
+template <typename T>
+int Checksum<T>::CountMismatches(const Checksum<T> &other) {
+  CHECK_EQ(checksums_.size(), other.checksums_.size());
+  int mismatches = 0;
+  for (size_t i = 0; i < checksums_.size(); i++)
+    if (checksums_[i].second != other.checksums_[i].second)
+      mismatches++;
+  return mismatches;
+}
+
+// Explicit instantiation
+template class Checksum<TestType>;
+
+} // namespace dnnmark
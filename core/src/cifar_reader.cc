@@ -0,0 +1,119 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include "cifar_reader.h"
+#include "kernels.h"
+
+namespace dnnmark {
+
+//
+// CifarReader class definition
+//
+
+template <typename T>
+CifarReader<T>::CifarReader(const std::vector<std::string> &files)
+: num_records_(0), file_(0), record_(0),
+  staging_(nullptr), staging_records_(0) {
+  CHECK(!files.empty()) << "No CIFAR-10 files given";
+  for (auto &file : files) {
+    MappedFile mapped;
+    mapped.fd_ = open(file.c_str(), O_RDONLY);
+    CHECK_GE(mapped.fd_, 0) << "Cannot open " << file;
+    struct stat st;
+    CHECK_EQ(fstat(mapped.fd_, &st), 0) << "Cannot stat " << file;
+    mapped.size_ = st.st_size;
+    CHECK_EQ(mapped.size_ % kRecordSize, 0)
+      << file << " is not a CIFAR-10 binary batch";
+    CHECK_GT(mapped.size_, 0) << file << " is empty";
+    void *addr = mmap(nullptr, mapped.size_, PROT_READ, MAP_PRIVATE,
+                      mapped.fd_, 0);
+    CHECK(addr != MAP_FAILED) << "Cannot map " << file;
+    // Records are consumed front to back
+    madvise(addr, mapped.size_, MADV_SEQUENTIAL);
+    mapped.records_ = static_cast<const unsigned char *>(addr);
+    mapped.num_records_ = mapped.size_ / kRecordSize;
+    num_records_ += mapped.num_records_;
+    files_.push_back(mapped);
+  }
+  LOG(INFO) << "CIFAR-10: " << num_records_ << " records in "
+            << files_.size() << " files";
+}
+
+template <typename T>
+CifarReader<T>::~CifarReader() {
+  CUDA_CALL(cudaFree(staging_));
+  for (auto &mapped : files_) {
+    munmap(const_cast<unsigned char *>(mapped.records_), mapped.size_);
+    close(mapped.fd_);
+  }
+}
+
+template <typename T>
+void CifarReader<T>::Next(T *dst, int n, cudaStream_t stream) {
+  if (n > staging_records_) {
+    CUDA_CALL(cudaFree(staging_));
+    CUDA_CALL(cudaMalloc(&staging_, static_cast<size_t>(n) * kRecordSize));
+    staging_records_ = n;
+  }
+
+  // One copy per contiguous run of records within a file
+  int copied = 0;
+  while (copied < n) {
+    const MappedFile &mapped = files_[file_];
+    int count = std::min(n - copied, mapped.num_records_ - record_);
+    CUDA_CALL(cudaMemcpyAsync(
+        staging_ + static_cast<size_t>(copied) * kRecordSize,
+        mapped.records_ + static_cast<size_t>(record_) * kRecordSize,
+        static_cast<size_t>(count) * kRecordSize,
+        cudaMemcpyHostToDevice, stream));
+    copied += count;
+    record_ += count;
+    if (record_ == mapped.num_records_) {
+      record_ = 0;
+      file_ = (file_ + 1) % files_.size();
+    }
+  }
+
+  DNNMarkCifarToNCHW<T>(stream, n, staging_, dst);
+}
+
+template <typename T>
+const unsigned char *CifarReader<T>::GetRecord(long long index) {
+  index %= num_records_;
+  for (auto &mapped : files_) {
+    if (index < mapped.num_records_)
+      return mapped.records_ + index * kRecordSize;
+    index -= mapped.num_records_;
+  }
+  return nullptr;
+}
+
+// Explicit instantiation
+template class CifarReader<TestType>;
+
+} // namespace dnnmark
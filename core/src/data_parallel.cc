@@ -0,0 +1,399 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <iomanip>
+#include <thread>
+
+#include "data_parallel.h"
+
+namespace dnnmark {
+
+//
+// DataParallel class definition
+//
+
+template <typename T>
+DataParallel<T>::DataParallel(const std::string &config_file,
+                              int num_replicas)
+: config_file_(config_file), num_replicas_(num_replicas),
+  num_layers_(0), batch_size_(0), gradient_bytes_(0), bucket_size_(0),
+  isolated_compute_time_(0), comm_time_(0),
+  overlapped_exposed_comm_time_(0) {
+  CHECK_GT(num_replicas_, 0);
+  CUDA_CALL(cudaEventCreate(&start_));
+}
+
+template <typename T>
+DataParallel<T>::~DataParallel() {
+  // Replicas go first since their handles are bound to our streams
+  replicas_.clear();
+  for (auto blas : comm_blas_)
+    CUBLAS_CALL(cublasDestroy(blas));
+  for (auto stream : streams_)
+    CUDA_CALL(cudaStreamDestroy(stream));
+  for (auto stream : comm_streams_)
+    CUDA_CALL(cudaStreamDestroy(stream));
+  for (auto event : step_done_)
+    CUDA_CALL(cudaEventDestroy(event));
+  for (auto &events : bucket_ready_)
+    for (auto event : events)
+      CUDA_CALL(cudaEventDestroy(event));
+  for (auto event : compute_done_)
+    CUDA_CALL(cudaEventDestroy(event));
+  for (auto event : comm_done_)
+    CUDA_CALL(cudaEventDestroy(event));
+  CUDA_CALL(cudaEventDestroy(start_));
+}
+
+template <typename T>
+int DataParallel<T>::Setup() {
+  LOG(INFO) << "DataParallel: Setup " << num_replicas_ << " replicas";
+
+  // Every replica needs a handle per layer, count them first
+  {
+    DNNMark<T> probe;
+    probe.ParseAllConfig(config_file_);
+    num_layers_ = probe.getNumLayers();
+    CHECK(probe.isTraining()) << "Data-parallel training needs mode=training";
+  }
+
+  streams_.resize(num_replicas_);
+  comm_streams_.resize(num_replicas_);
+  comm_blas_.resize(num_replicas_);
+  step_done_.resize(num_replicas_);
+  compute_done_.resize(num_replicas_);
+  comm_done_.resize(num_replicas_);
+  for (int r = 0; r < num_replicas_; r++) {
+    CUDA_CALL(cudaStreamCreateWithFlags(&streams_[r],
+                                        cudaStreamNonBlocking));
+    CUDA_CALL(cudaStreamCreateWithFlags(&comm_streams_[r],
+                                        cudaStreamNonBlocking));
+    CUBLAS_CALL(cublasCreate(&comm_blas_[r]));
+    CUBLAS_CALL(cublasSetStream(comm_blas_[r], comm_streams_[r]));
+    CUDA_CALL(cudaEventCreateWithFlags(&step_done_[r],
+                                       cudaEventDisableTiming));
+    CUDA_CALL(cudaEventCreate(&compute_done_[r]));
+    CUDA_CALL(cudaEventCreate(&comm_done_[r]));
+
+    replicas_.emplace_back(new DNNMark<T>(num_layers_));
+    DNNMark<T> *replica = replicas_.back().get();
+    replica->ParseAllConfig(config_file_);
+
+    // Layers that define their input take an equal share of the batch
+    for (int i = 0; i < num_layers_; i++) {
+      DataDim *input_dim = replica->GetLayerByID(i)->getInputDim();
+      if (input_dim->n_ == 0)
+        continue;
+      if (r == 0 && batch_size_ == 0)
+        batch_size_ = input_dim->n_;
+      CHECK_GE(input_dim->n_, num_replicas_)
+        << "Batch is smaller than the number of replicas";
+      LOG_IF(WARNING, input_dim->n_ % num_replicas_ != 0)
+        << "Batch size " << input_dim->n_ << " is not divisible by "
+        << num_replicas_ << " replicas, the remainder is dropped";
+      input_dim->n_ /= num_replicas_;
+    }
+    replica->Initialize();
+
+    for (int i = 0; i < num_layers_; i++)
+      replica->GetHandle()->SetStream(i, streams_[r]);
+
+    // Collect gradients of all learnable layers
+    DataManager<T> *data_manager = DataManager<T>::GetInstance();
+    gradients_.push_back(std::vector<Data<T> *>());
+    for (int i = 0; i < num_layers_; i++) {
+      Layer<T> *layer = replica->GetLayerByID(i);
+      for (int j = 0; j < layer->getNumParams(); j++)
+        gradients_[r].push_back(
+          data_manager->GetData(layer->getParamDiffChunkID(j)));
+    }
+
+    // Warm up and generate the input once, outside the timed region
+    replica->Forward();
+    replica->Backward();
+    replica->setDataFillEnabled(false);
+  }
+
+  gradient_bytes_ = 0;
+  for (auto gradient : gradients_[0])
+    gradient_bytes_ += gradient->getSize() * sizeof(T);
+
+  bucket_size_ = replicas_[0]->getAllreduceBucketSize();
+  AssignBuckets();
+  bucket_ready_.resize(num_replicas_);
+  for (int r = 0; r < num_replicas_; r++) {
+    bucket_ready_[r].resize(buckets_.size());
+    for (auto &event : bucket_ready_[r])
+      CUDA_CALL(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+  }
+
+  CUDA_CALL(cudaDeviceSynchronize());
+  return 0;
+}
+
+template <typename T>
+void DataParallel<T>::AssignBuckets() {
+  // Position of the first gradient of every layer in gradients_
+  std::vector<int> first_gradient(num_layers_ + 1, 0);
+  for (int i = 0; i < num_layers_; i++)
+    first_gradient[i + 1] = first_gradient[i] +
+      replicas_[0]->GetLayerByID(i)->getNumParams();
+
+  // Walk the layers in backward order, a bucket is closed by the layer
+  // that brings it to the bucket size, the last one by the first layer
+  buckets_.clear();
+  bucket_closers_.clear();
+  std::vector<int> bucket;
+  size_t bucket_bytes = 0;
+  int last_learnable = -1;
+  for (int i = num_layers_ - 1; i >= 0; i--) {
+    if (!replicas_[0]->GetLayerByID(i)->hasLearnableParams())
+      continue;
+    last_learnable = i;
+    for (int g = first_gradient[i]; g < first_gradient[i + 1]; g++) {
+      bucket.push_back(g);
+      bucket_bytes += gradients_[0][g]->getSize() * sizeof(T);
+    }
+    if (bucket_bytes >= bucket_size_) {
+      bucket_closers_[i] = buckets_.size();
+      buckets_.push_back(bucket);
+      bucket.clear();
+      bucket_bytes = 0;
+    }
+  }
+  if (!bucket.empty()) {
+    bucket_closers_[last_learnable] = buckets_.size();
+    buckets_.push_back(bucket);
+  }
+  LOG(INFO) << "DataParallel: " << buckets_.size() << " gradient buckets";
+}
+
+template <typename T>
+void DataParallel<T>::ComputeStep(int replica) {
+  CUDA_CALL(cudaStreamWaitEvent(streams_[replica], start_, 0));
+  replicas_[replica]->Forward();
+  replicas_[replica]->Backward();
+  CUDA_CALL(cudaEventRecord(compute_done_[replica], streams_[replica]));
+}
+
+template <typename T>
+void DataParallel<T>::OnGradientReady(int replica, Layer<T> *layer) {
+  auto closer = bucket_closers_.find(layer->getLayerId());
+  if (closer == bucket_closers_.end())
+    return;
+  int bucket = closer->second;
+  CUDA_CALL(cudaEventRecord(bucket_ready_[replica][bucket],
+                            streams_[replica]));
+  {
+    std::lock_guard<std::mutex> lock(bucket_mutex_);
+    bucket_fill_count_[bucket]++;
+  }
+  bucket_cv_.notify_one();
+}
+
+template <typename T>
+void DataParallel<T>::Communicator() {
+  for (int b = 0; b < buckets_.size(); b++) {
+    {
+      std::unique_lock<std::mutex> lock(bucket_mutex_);
+      bucket_cv_.wait(lock, [this, b] {
+        return bucket_fill_count_[b] == num_replicas_;
+      });
+    }
+    // Each replica reads its neighbour's gradients from the first step on
+    for (int r = 0; r < num_replicas_; r++)
+      for (int s = 0; s < num_replicas_; s++)
+        CUDA_CALL(cudaStreamWaitEvent(comm_streams_[r],
+                                      bucket_ready_[s][b], 0));
+    RingAllReduce(buckets_[b]);
+  }
+}
+
+template <typename T>
+void DataParallel<T>::RingAllReduce(const std::vector<int> &gradient_ids) {
+  int R = num_replicas_;
+  if (R == 1)
+    return;
+
+  // Replica r receives from r - 1 and sends to r + 1. Each tensor is cut
+  // into R segments. In R - 1 reduce-scatter steps every replica adds the
+  // incoming segment to its own, after which replica r holds the full sum
+  // of segment r + 1. In R - 1 all-gather steps the sums travel around
+  // the ring. Every replica moves 2 (R - 1) / R of the gradient bytes.
+  T alpha = 1.0;
+  for (int step = 0; step < 2 * (R - 1); step++) {
+    bool reduce = step < R - 1;
+    int k = reduce ? step : step - (R - 1);
+    for (int r = 0; r < R; r++) {
+      int src = (r - 1 + R) % R;
+      int dst = (r + 1) % R;
+      int seg = reduce ? ((src - k) % R + R) % R :
+                         ((src + 1 - k) % R + R) % R;
+      if (step > 0) {
+        // Read what the predecessor produced and do not overwrite what
+        // the successor is still reading
+        CUDA_CALL(cudaStreamWaitEvent(comm_streams_[r], step_done_[src], 0));
+        CUDA_CALL(cudaStreamWaitEvent(comm_streams_[r], step_done_[dst], 0));
+      }
+      for (auto g : gradient_ids) {
+        long long size = gradients_[r][g]->getSize();
+        long long begin = size * seg / R;
+        int n = size * (seg + 1) / R - begin;
+        if (n == 0)
+          continue;
+        T *x = gradients_[src][g]->Get() + begin;
+        T *y = gradients_[r][g]->Get() + begin;
+        if (reduce)
+          DNNMarkAXPY(comm_blas_[r], n, &alpha, x, y);
+        else
+          CUDA_CALL(cudaMemcpyAsync(y, x, n * sizeof(T),
+                                    cudaMemcpyDeviceToDevice,
+                                    comm_streams_[r]));
+      }
+    }
+    for (int r = 0; r < R; r++)
+      CUDA_CALL(cudaEventRecord(step_done_[r], comm_streams_[r]));
+  }
+}
+
+template <typename T>
+float DataParallel<T>::ExposedCommTime() {
+  float compute_end = 0, comm_end = 0, elapsed;
+  for (int r = 0; r < num_replicas_; r++) {
+    CUDA_CALL(cudaEventSynchronize(comm_done_[r]));
+    CUDA_CALL(cudaEventElapsedTime(&elapsed, start_, compute_done_[r]));
+    compute_end = std::max(compute_end, elapsed);
+    CUDA_CALL(cudaEventElapsedTime(&elapsed, start_, comm_done_[r]));
+    comm_end = std::max(comm_end, elapsed);
+  }
+  return std::max(0.0f, comm_end - compute_end);
+}
+
+template <typename T>
+int DataParallel<T>::Run() {
+  CHECK_EQ(replicas_.size(), num_replicas_) << "Replicas are not set up";
+  compute_time_.assign(num_replicas_, 0);
+  float elapsed;
+
+  // A replica running alone
+  CUDA_CALL(cudaDeviceSynchronize());
+  CUDA_CALL(cudaEventRecord(start_, streams_[0]));
+  ComputeStep(0);
+  CUDA_CALL(cudaEventSynchronize(compute_done_[0]));
+  CUDA_CALL(cudaEventElapsedTime(&isolated_compute_time_,
+                                 start_, compute_done_[0]));
+
+  // Baseline: all replicas compute, each from its own host thread,
+  // then the gradients are reduced in one go
+  CUDA_CALL(cudaDeviceSynchronize());
+  CUDA_CALL(cudaEventRecord(start_, 0));
+  {
+    std::vector<std::thread> workers;
+    for (int r = 0; r < num_replicas_; r++)
+      workers.emplace_back(&DataParallel<T>::ComputeStep, this, r);
+    for (auto &worker : workers)
+      worker.join();
+  }
+  for (int r = 0; r < num_replicas_; r++)
+    for (int s = 0; s < num_replicas_; s++)
+      CUDA_CALL(cudaStreamWaitEvent(comm_streams_[r], compute_done_[s], 0));
+  std::vector<int> all_gradients(gradients_[0].size());
+  for (int g = 0; g < all_gradients.size(); g++)
+    all_gradients[g] = g;
+  RingAllReduce(all_gradients);
+  for (int r = 0; r < num_replicas_; r++)
+    CUDA_CALL(cudaEventRecord(comm_done_[r], comm_streams_[r]));
+  comm_time_ = ExposedCommTime();
+  for (int r = 0; r < num_replicas_; r++) {
+    CUDA_CALL(cudaEventElapsedTime(&elapsed, start_, compute_done_[r]));
+    compute_time_[r] = elapsed;
+  }
+
+  // Overlapped: buckets are reduced while backward is still running
+  CUDA_CALL(cudaDeviceSynchronize());
+  bucket_fill_count_.assign(buckets_.size(), 0);
+  for (int r = 0; r < num_replicas_; r++)
+    replicas_[r]->AddGradientReadyHook([this, r](Layer<T> *layer) {
+      OnGradientReady(r, layer);
+    });
+  CUDA_CALL(cudaEventRecord(start_, 0));
+  {
+    std::thread communicator(&DataParallel<T>::Communicator, this);
+    std::vector<std::thread> workers;
+    for (int r = 0; r < num_replicas_; r++)
+      workers.emplace_back(&DataParallel<T>::ComputeStep, this, r);
+    for (auto &worker : workers)
+      worker.join();
+    communicator.join();
+  }
+  for (int r = 0; r < num_replicas_; r++) {
+    replicas_[r]->ClearGradientReadyHooks();
+    CUDA_CALL(cudaEventRecord(comm_done_[r], comm_streams_[r]));
+  }
+  overlapped_exposed_comm_time_ = ExposedCommTime();
+  return 0;
+}
+
+template <typename T>
+float DataParallel<T>::getComputeTime() {
+  return *std::max_element(compute_time_.begin(), compute_time_.end());
+}
+
+template <typename T>
+void DataParallel<T>::Report(float baseline_step_time) {
+  if (baseline_step_time <= 0)
+    baseline_step_time = getStepTime();
+  // Strong scaling: the global batch stays the same for every R
+  float efficiency = baseline_step_time / (num_replicas_ * getStepTime());
+  float throughput = (batch_size_ / num_replicas_) * num_replicas_ /
+                     getStepTime() * 1000;
+  std::cout << std::fixed << std::setprecision(3)
+            << "[DataParallel] R: " << num_replicas_
+            << " compute: " << getIsolatedComputeTime() << " ms"
+            << " (shared device: " << getComputeTime() << " ms)"
+            << " comm: " << getCommTime() << " ms"
+            << " (" << gradient_bytes_ / 1024.0 / 1024.0 << " MB)"
+            << " step: " << getStepTime() << " ms"
+            << " throughput: " << std::setprecision(1) << throughput
+            << " samples/s"
+            << " efficiency: " << 100 * efficiency << "%"
+            << std::defaultfloat << std::endl;
+  if (num_replicas_ == 1)
+    return;
+  float hidden = getCommTime() > 0 ?
+    1 - getOverlappedExposedCommTime() / getCommTime() : 0;
+  std::cout << std::fixed << std::setprecision(3)
+            << "[DataParallel] Overlap: " << getNumBuckets() << " buckets of "
+            << bucket_size_ / 1024.0 / 1024.0 << " MB"
+            << " exposed comm: " << getOverlappedExposedCommTime() << " ms"
+            << " (after backward: " << getCommTime() << " ms)"
+            << " hidden: " << std::setprecision(1) << 100 * hidden << "%"
+            << " step: " << std::setprecision(3) << getOverlappedStepTime()
+            << " ms" << std::defaultfloat << std::endl;
+}
+
+// Explicit instantiation
+template class DataParallel<TestType>;
+
+} // namespace dnnmark
+
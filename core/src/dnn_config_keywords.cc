@@ -45,13 +45,6 @@ bool isLayerSection(const std::string &s) {
          != layer_section_keywords.end();
 }
 
-bool isKeywordExist(const std::string &s,
-                    const std::vector<std::string> &config_keywords) {
-  return std::find(config_keywords.begin(),
-                   config_keywords.end(), s)
-         != config_keywords.end();
-}
-
 }
 
 
@@ -31,6 +31,8 @@ Handle::Handle() {
   CUBLAS_CALL(cublasCreate(&blas_handles_[0]));
   num_cudnn_handles_ = 1;
   num_blas_handles_ = 1;
+  streams_ = new cudaStream_t[1];
+  streams_[0] = 0;
 }
 
 Handle::Handle(int num) {
@@ -43,6 +45,10 @@ Handle::Handle(int num) {
   for (int i = 0; i < num; i++)
     CUBLAS_CALL(cublasCreate(&blas_handles_[i]));
   num_blas_handles_ = num;
+
+  streams_ = new cudaStream_t[num];
+  for (int i = 0; i < num; i++)
+    streams_[i] = 0;
 }
 
 Handle::~Handle() {
@@ -52,6 +58,33 @@ Handle::~Handle() {
   for (int i = 0; i < num_blas_handles_; i++)
     CUBLAS_CALL(cublasDestroy(blas_handles_[i]));
   delete []blas_handles_;
+  delete []streams_;
+}
+
+void Handle::Grow(int num) {
+  if (num <= num_cudnn_handles_)
+    return;
+  cudnnHandle_t *cudnn_handles = new cudnnHandle_t[num];
+  cublasHandle_t *blas_handles = new cublasHandle_t[num];
+  cudaStream_t *streams = new cudaStream_t[num];
+  for (int i = 0; i < num_cudnn_handles_; i++) {
+    cudnn_handles[i] = cudnn_handles_[i];
+    blas_handles[i] = blas_handles_[i];
+    streams[i] = streams_[i];
+  }
+  for (int i = num_cudnn_handles_; i < num; i++) {
+    CUDNN_CALL(cudnnCreate(&cudnn_handles[i]));
+    CUBLAS_CALL(cublasCreate(&blas_handles[i]));
+    streams[i] = 0;
+  }
+  delete []cudnn_handles_;
+  delete []blas_handles_;
+  delete []streams_;
+  cudnn_handles_ = cudnn_handles;
+  blas_handles_ = blas_handles;
+  streams_ = streams;
+  num_cudnn_handles_ = num;
+  num_blas_handles_ = num;
 }
 
 cudnnHandle_t Handle::GetCudnn() { return cudnn_handles_[0]; }
@@ -59,6 +92,40 @@ cudnnHandle_t Handle::GetCudnn(int index) { return cudnn_handles_[index]; }
 cublasHandle_t Handle::GetBlas() { return blas_handles_[0]; }
 cublasHandle_t Handle::GetBlas(int index) { return blas_handles_[index]; }
 
+void Handle::SetStream(int index, cudaStream_t stream) {
+  CUDNN_CALL(cudnnSetStream(cudnn_handles_[index], stream));
+  CUBLAS_CALL(cublasSetStream(blas_handles_[index], stream));
+  streams_[index] = stream;
+}
+
+cudaStream_t Handle::GetStream() { return streams_[0]; }
+cudaStream_t Handle::GetStream(int index) { return streams_[index]; }
+
+Timer::Timer() {
+  CUDA_CALL(cudaEventCreate(&start_));
+  CUDA_CALL(cudaEventCreate(&stop_));
+}
+
+Timer::~Timer() {
+  CUDA_CALL(cudaEventDestroy(start_));
+  CUDA_CALL(cudaEventDestroy(stop_));
+}
+
+void Timer::Start(cudaStream_t stream) {
+  CUDA_CALL(cudaEventRecord(start_, stream));
+}
+
+void Timer::Stop(cudaStream_t stream) {
+  CUDA_CALL(cudaEventRecord(stop_, stream));
+}
+
+float Timer::Elapsed() {
+  float elapsed = 0;
+  CUDA_CALL(cudaEventSynchronize(stop_));
+  CUDA_CALL(cudaEventElapsedTime(&elapsed, start_, stop_));
+  return elapsed;
+}
+
 Descriptor::Descriptor()
 : set_(false) {}
 
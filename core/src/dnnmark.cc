@@ -20,9 +20,16 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <algorithm>
+#include <limits>
 #include "cudnn.h"
 
 #include "dnnmark.h"
+#include "fusion.h"
+#include "in_place.h"
+#include "optimizer.h"
+#include "snapshot.h"
+#include "workspace_planner.h"
 
 namespace dnnmark {
 
@@ -32,497 +39,1044 @@ namespace dnnmark {
 
 template <typename T>
 DNNMark<T>::DNNMark()
-: run_mode_(NONE), handle_(), num_layers_added_(0) {}
+: run_mode_(NONE), mode_(TRAINING), handle_(), num_layers_added_(0),
+  data_fill_enabled_(true), refill_each_iteration_(false),
+  deterministic_(false),
+  pipeline_microbatches_(1), pipeline_stages_(1),
+  pipeline_schedule_(ONE_F_ONE_B),
+  num_replicas_(1), allreduce_bucket_size_(25 * 1024 * 1024),
+  offload_slots_(4), fusion_enabled_(true), in_place_enabled_(true),
+  workspace_budget_(0) {}
 
 template <typename T>
 DNNMark<T>::DNNMark(int num_layers)
-: run_mode_(NONE), handle_(num_layers), num_layers_added_(0) {}
-
-template <typename T>
-void DNNMark<T>::SetLayerParams(LayerType layer_type,
-                    int current_layer_id,
-                    const std::string &var,
-                    const std::string &val) {
-  DataDim *input_dim; 
-  ConvolutionParam *conv_param;
-  PoolingParam *pool_param;
-  LRNParam *lrn_param;
-  ActivationParam *activation_param;
-  FullyConnectedParam *fc_param;
-  SoftmaxParam *softmax_param;
-  BatchNormParam *bn_param;
-  DropoutParam *dropout_param;
-  BypassParam *bypass_param;
-  CHECK_GT(num_layers_added_, 0);
-
-  switch(layer_type) {
-    case CONVOLUTION: {
-      // Obtain the data dimension and parameters variable
-      // within specified layer
-      input_dim = std::dynamic_pointer_cast<ConvolutionLayer<T>>
-                  (layers_map_[current_layer_id])->getInputDim();
-      conv_param = std::dynamic_pointer_cast<ConvolutionLayer<T>>
-                   (layers_map_[current_layer_id])->getConvParam();
-
-      if(isKeywordExist(var, data_config_keywords))
-        break;
-
-      // Process all the corresponding keywords in config
-      if(isKeywordExist(var, conv_config_keywords)) {
-        if (!var.compare("conv_mode")) {
-          if (!val.compare("convolution"))
-            conv_param->mode_ = CUDNN_CONVOLUTION;
-          else if (!val.compare("cross_correlation"))
-            conv_param->mode_ = CUDNN_CROSS_CORRELATION;
-        } else if (!var.compare("num_output")) {
-          conv_param->output_num_ = atoi(val.c_str());
-        } else if (!var.compare("kernel_size")) {
-          conv_param->kernel_size_h_ = atoi(val.c_str());
-          conv_param->kernel_size_w_ = atoi(val.c_str());
-        } else if (!var.compare("pad")) {
-          conv_param->pad_h_ = atoi(val.c_str());
-          conv_param->pad_w_ = atoi(val.c_str());
-        } else if (!var.compare("stride")) {
-          conv_param->stride_u_ = atoi(val.c_str());
-          conv_param->stride_v_ = atoi(val.c_str());
-        } else if (!var.compare("kernel_size_h")) {
-          conv_param->kernel_size_h_ = atoi(val.c_str());
-        } else if (!var.compare("kernel_size_w")) {
-          conv_param->kernel_size_w_ = atoi(val.c_str());
-        } else if (!var.compare("pad_h")) {
-          conv_param->pad_h_ = atoi(val.c_str());
-        } else if (!var.compare("pad_w")) {
-          conv_param->pad_w_ = atoi(val.c_str());
-        } else if (!var.compare("stride_h")) {
-          conv_param->stride_u_ = atoi(val.c_str());
-        } else if (!var.compare("stride_w")) {
-          conv_param->stride_v_ = atoi(val.c_str());
-        } else if (!var.compare("conv_fwd_pref")) {
-          if (!val.compare("no_workspace"))
-            conv_param->conv_fwd_pref_ = CUDNN_CONVOLUTION_FWD_NO_WORKSPACE;
-          else if (!val.compare("fastest"))
-            conv_param->conv_fwd_pref_ = CUDNN_CONVOLUTION_FWD_PREFER_FASTEST;
-          else if (!val.compare("specify_workspace_limit"))
-            conv_param->conv_fwd_pref_ =
-              CUDNN_CONVOLUTION_FWD_SPECIFY_WORKSPACE_LIMIT;
-        } else if (!var.compare("conv_bwd_filter_pref")) {
-          if (!val.compare("no_workspace"))
-            conv_param->conv_bwd_filter_pref_ =
-              CUDNN_CONVOLUTION_BWD_FILTER_NO_WORKSPACE;
-          else if (!val.compare("fastest"))
-            conv_param->conv_bwd_filter_pref_ =
-              CUDNN_CONVOLUTION_BWD_FILTER_PREFER_FASTEST;
-          else if (!val.compare("specify_workspace_limit"))
-            conv_param->conv_bwd_filter_pref_ =
-              CUDNN_CONVOLUTION_BWD_FILTER_SPECIFY_WORKSPACE_LIMIT;
-        } else if (!var.compare("conv_bwd_data_pref")) {
-          if (!val.compare("no_workspace"))
-            conv_param->conv_bwd_data_pref_ =
-              CUDNN_CONVOLUTION_BWD_DATA_NO_WORKSPACE;
-          else if (!val.compare("fastest"))
-            conv_param->conv_bwd_data_pref_ =
-              CUDNN_CONVOLUTION_BWD_DATA_PREFER_FASTEST;
-          else if (!val.compare("specify_workspace_limit"))
-            conv_param->conv_bwd_data_pref_ =
-              CUDNN_CONVOLUTION_BWD_DATA_SPECIFY_WORKSPACE_LIMIT;
-        }
-      } else {
-        LOG(FATAL) << var << ": Keywords not exists" << std::endl;
-      }
-      break;
-    } // End of case CONVOLUTION
-    case POOLING: {
-      // Obtain the data dimension and parameters variable within layer class
-      input_dim = std::dynamic_pointer_cast<PoolingLayer<T>>
-                  (layers_map_[current_layer_id])->getInputDim();
-      pool_param = std::dynamic_pointer_cast<PoolingLayer<T>>
-                   (layers_map_[current_layer_id])->getPoolParam();
-
-      if(isKeywordExist(var, data_config_keywords))
-        break;
-
-      // Process all the keywords in config
-      if(isKeywordExist(var, pool_config_keywords)) {
-        if (!var.compare("pool_mode")) {
-          if (!val.compare("max"))
-            pool_param->mode_ = CUDNN_POOLING_MAX;
-          else if (!val.compare("avg_include_padding"))
-            pool_param->mode_ = CUDNN_POOLING_AVERAGE_COUNT_INCLUDE_PADDING;
-          else if (!val.compare("avg_exclude_padding"))
-            pool_param->mode_ = CUDNN_POOLING_AVERAGE_COUNT_EXCLUDE_PADDING;
-        } else if (!var.compare("kernel_size")) {
-          pool_param->kernel_size_h_ = atoi(val.c_str());
-          pool_param->kernel_size_w_ = atoi(val.c_str());
-        } else if (!var.compare("pad")) {
-          pool_param->pad_h_ = atoi(val.c_str());
-          pool_param->pad_w_ = atoi(val.c_str());
-        } else if (!var.compare("stride")) {
-          pool_param->stride_h_ = atoi(val.c_str());
-          pool_param->stride_w_ = atoi(val.c_str());
-        } else if (!var.compare("kernel_size_h")) {
-          pool_param->kernel_size_h_ = atoi(val.c_str());
-        } else if (!var.compare("kernel_size_w")) {
-          pool_param->kernel_size_w_ = atoi(val.c_str());
-        } else if (!var.compare("pad_h")) {
-          pool_param->pad_h_ = atoi(val.c_str());
-        } else if (!var.compare("pad_w")) {
-          pool_param->pad_w_ = atoi(val.c_str());
-        } else if (!var.compare("stride_h")) {
-          pool_param->stride_h_ = atoi(val.c_str());
-        } else if (!var.compare("stride_w")) {
-          pool_param->stride_w_ = atoi(val.c_str());
-        }
-      } else {
-        LOG(FATAL) << var << ": Keywords not exists" << std::endl;
-      }
-      break;
-    } // End of case POOLING
-    case LRN: {
-      // Obtain the data dimension and parameters variable within layer class
-      input_dim = std::dynamic_pointer_cast<LRNLayer<T>>
-                  (layers_map_[current_layer_id])->getInputDim();
-      lrn_param = std::dynamic_pointer_cast<LRNLayer<T>>
-                   (layers_map_[current_layer_id])->getLRNParam();
-
-      if(isKeywordExist(var, data_config_keywords))
-        break;
-
-      // Process all the keywords in config
-      if(isKeywordExist(var, lrn_config_keywords)) {
-        if (!var.compare("lrn_mode")) {
-          if (!val.compare("cross_channel_dim1"))
-            lrn_param->mode_ = CUDNN_LRN_CROSS_CHANNEL_DIM1;
-        } else if (!var.compare("local_size")) {
-          lrn_param->local_size_ = atoi(val.c_str());
-        } else if (!var.compare("alpha")) {
-          lrn_param->alpha_ = atof(val.c_str());
-        } else if (!var.compare("beta")) {
-          lrn_param->beta_ = atof(val.c_str());
-        } else if (!var.compare("k")) {
-          lrn_param->k_ = atof(val.c_str());
-        }
-      } else {
-        LOG(FATAL) << var << ": Keywords not exists" << std::endl;
-      }
-      break;
-    } // End of case LRN
-    case ACTIVATION: {
-      // Obtain the data dimension and parameters variable within layer class
-      input_dim = std::dynamic_pointer_cast<ActivationLayer<T>>
-                  (layers_map_[current_layer_id])->getInputDim();
-      activation_param = std::dynamic_pointer_cast<ActivationLayer<T>>
-                   (layers_map_[current_layer_id])->getActivationParam();
-
-      if(isKeywordExist(var, data_config_keywords))
-        break;
-
-      // Process all the keywords in config
-      if(isKeywordExist(var, activation_config_keywords)) {
-        if (!var.compare("activation_mode")) {
-          if (!val.compare("sigmoid"))
-            activation_param->mode_ = CUDNN_ACTIVATION_SIGMOID;
-          else if (!val.compare("relu"))
-            activation_param->mode_ = CUDNN_ACTIVATION_RELU;
-          else if (!val.compare("tanh"))
-            activation_param->mode_ = CUDNN_ACTIVATION_TANH;
-          else if (!val.compare("relu"))
-            activation_param->mode_ = CUDNN_ACTIVATION_CLIPPED_RELU;
-        }
-      } else {
-        LOG(FATAL) << var << ": Keywords not exists" << std::endl;
-      }
-      break;
-    } // End of case ACTIVATION
-    case FC: {
-      // Obtain the data dimension and parameters variable within layer class
-      input_dim = std::dynamic_pointer_cast<FullyConnectedLayer<T>>
-                  (layers_map_[current_layer_id])->getInputDim();
-      fc_param = std::dynamic_pointer_cast<FullyConnectedLayer<T>>
-                 (layers_map_[current_layer_id])->getFullyConnectedParam();
-
-      if(isKeywordExist(var, data_config_keywords))
-        break;
-
-      // Process all the keywords in config
-      if(isKeywordExist(var, fc_config_keywords)) {
-        if (!var.compare("num_output")) {
-          fc_param->output_num_ = atoi(val.c_str());
-        }
-      } else {
-        LOG(FATAL) << var << ": Keywords not exists" << std::endl;
-      }
-      break;
-    } // End of case FC
-    case SOFTMAX: {
-      // Obtain the data dimension and parameters variable within layer class
-      input_dim = std::dynamic_pointer_cast<SoftmaxLayer<T>>
-                  (layers_map_[current_layer_id])->getInputDim();
-      softmax_param = std::dynamic_pointer_cast<SoftmaxLayer<T>>
-                 (layers_map_[current_layer_id])->getSoftmaxParam();
-
-      if(isKeywordExist(var, data_config_keywords))
-        break;
-
-      // Process all the keywords in config
-      if(isKeywordExist(var, softmax_config_keywords)) {
-        if (!var.compare("softmax_algo")) {
-          if (!val.compare("fast"))
-            softmax_param->algo_ = CUDNN_SOFTMAX_FAST;
-          else if (!val.compare("accurate"))
-            softmax_param->algo_ = CUDNN_SOFTMAX_ACCURATE;
-          else if (!val.compare("log"))
-            softmax_param->algo_ = CUDNN_SOFTMAX_LOG;
-        }
-        if (!var.compare("softmax_mode")) {
-          if (!val.compare("instance"))
-            softmax_param->mode_ = CUDNN_SOFTMAX_MODE_INSTANCE;
-          else if (!val.compare("channel"))
-            softmax_param->mode_ = CUDNN_SOFTMAX_MODE_CHANNEL;
-        }
-      } else {
-        LOG(FATAL) << var << ": Keywords not exists" << std::endl;
-      }
-      break;
-    } // End of case SOFTMAX
-    case BN: {
-      // Obtain the data dimension and parameters variable within layer class
-      input_dim = std::dynamic_pointer_cast<BatchNormLayer<T>>
-                  (layers_map_[current_layer_id])->getInputDim();
-      bn_param = std::dynamic_pointer_cast<BatchNormLayer<T>>
-                 (layers_map_[current_layer_id])->getBatchNormParam();
-
-      if(isKeywordExist(var, data_config_keywords))
-        break;
-
-      // Process all the keywords in config
-      if(isKeywordExist(var, bn_config_keywords)) {
-        if(!var.compare("batchnorm_mode")) {
-          if(!val.compare("per_activation"))
-            bn_param->mode_ = CUDNN_BATCHNORM_PER_ACTIVATION;
-          else if (!val.compare("spatial"))
-            bn_param->mode_ = CUDNN_BATCHNORM_SPATIAL;
-        }
-        if(!var.compare("save_intermediates")) {
-          if(!val.compare("true"))
-            bn_param->save_intermediates_ = true;
-          else if (!val.compare("false"))
-            bn_param->save_intermediates_ = false;
-        }
-        if(!var.compare("exp_avg_factor")) {
-          bn_param->exp_avg_factor_ = atof(val.c_str());
-        }
-        if(!var.compare("epsilon")) {
-          bn_param->epsilon_ = atof(val.c_str());
-        }
-      } else {
-        LOG(FATAL) << var << ": Keywords not exists" << std::endl;
-      }
-      break;
-    } // End of case BN
-    case DROPOUT: {
-      // Obtain the data dimension and parameters variable within layer class
-      input_dim = std::dynamic_pointer_cast<DropoutLayer<T>>
-                  (layers_map_[current_layer_id])->getInputDim();
-      dropout_param = std::dynamic_pointer_cast<DropoutLayer<T>>
-                 (layers_map_[current_layer_id])->getDropoutParam();
-
-      if(isKeywordExist(var, data_config_keywords))
-        break;
-
-      // Process all the keywords in config
-      if(isKeywordExist(var, dropout_config_keywords)) {
-        if(!var.compare("dropout_probability")) {
-          dropout_param->dropout_p_ = atof(val.c_str());
-        }
-        if(!var.compare("random_seed")) {
-          dropout_param->random_seed_ = atoi(val.c_str());
-        }
-      } else {
-        LOG(FATAL) << var << ": Keywords not exists" << std::endl;
+: run_mode_(NONE), mode_(TRAINING), handle_(num_layers),
+  num_layers_added_(0),
+  data_fill_enabled_(true), refill_each_iteration_(false),
+  deterministic_(false),
+  pipeline_microbatches_(1), pipeline_stages_(1),
+  pipeline_schedule_(ONE_F_ONE_B),
+  num_replicas_(1), allreduce_bucket_size_(25 * 1024 * 1024),
+  offload_slots_(4), fusion_enabled_(true), in_place_enabled_(true),
+  workspace_budget_(0) {}
+
+namespace {
+
+// Value parsers of the setter tables, false when the value is malformed
+// or below the minimum
+template <typename V>
+bool ParseInt(const std::string &val, V *field,
+              long long min = std::numeric_limits<long long>::min()) {
+  char *end;
+  long long value = strtoll(val.c_str(), &end, 10);
+  if (val.empty() || *end != '\0' || value < min)
+    return false;
+  *field = value;
+  return true;
+}
+
+template <typename V>
+bool ParseReal(const std::string &val, V *field) {
+  char *end;
+  double value = strtod(val.c_str(), &end);
+  if (val.empty() || *end != '\0')
+    return false;
+  *field = value;
+  return true;
+}
+
+// Megabytes into bytes
+bool ParseMB(const std::string &val, size_t *field, bool allow_zero) {
+  double mb;
+  if (!ParseReal(val, &mb) || mb < 0 || (mb == 0 && !allow_zero))
+    return false;
+  *field = mb * 1024 * 1024;
+  return true;
+}
+
+bool ParseBool(const std::string &val, bool *field) {
+  if (!val.compare("true"))
+    *field = true;
+  else if (!val.compare("false"))
+    *field = false;
+  else
+    return false;
+  return true;
+}
+
+template <typename V>
+bool ParseOption(const std::string &val,
+                 std::initializer_list<std::pair<const char *, V>> options,
+                 V *field) {
+  for (auto &option : options)
+    if (!val.compare(option.first)) {
+      *field = option.second;
+      return true;
+    }
+  return false;
+}
+
+// Parameters of the layer types, the setter tables guarantee the type
+template <typename T>
+ConvolutionParam *Conv(Layer<T> *layer) {
+  return static_cast<ConvolutionLayer<T> *>(layer)->getConvParam();
+}
+template <typename T>
+PoolingParam *Pool(Layer<T> *layer) {
+  return static_cast<PoolingLayer<T> *>(layer)->getPoolParam();
+}
+template <typename T>
+LRNParam *Lrn(Layer<T> *layer) {
+  return static_cast<LRNLayer<T> *>(layer)->getLRNParam();
+}
+template <typename T>
+ActivationParam *Activation(Layer<T> *layer) {
+  return static_cast<ActivationLayer<T> *>(layer)->getActivationParam();
+}
+template <typename T>
+FullyConnectedParam *Fc(Layer<T> *layer) {
+  return static_cast<FullyConnectedLayer<T> *>(layer)
+    ->getFullyConnectedParam();
+}
+template <typename T>
+SoftmaxParam *Softmax(Layer<T> *layer) {
+  return static_cast<SoftmaxLayer<T> *>(layer)->getSoftmaxParam();
+}
+template <typename T>
+BatchNormParam *Bn(Layer<T> *layer) {
+  return static_cast<BatchNormLayer<T> *>(layer)->getBatchNormParam();
+}
+template <typename T>
+DropoutParam *Dropout(Layer<T> *layer) {
+  return static_cast<DropoutLayer<T> *>(layer)->getDropoutParam();
+}
+template <typename T>
+BypassParam *Bypass(Layer<T> *layer) {
+  return static_cast<BypassLayer<T> *>(layer)->getBypassParam();
+}
+template <typename T>
+RNNParam *Rnn(Layer<T> *layer) {
+  return static_cast<RNNLayer<T> *>(layer)->getRNNParam();
+}
+template <typename T>
+BatchedMatMulParam *Bmm(Layer<T> *layer) {
+  return static_cast<BatchedMatMulLayer<T> *>(layer)->getBatchedMatMulParam();
+}
+template <typename T>
+LayerNormParam *Ln(Layer<T> *layer) {
+  return static_cast<LayerNormLayer<T> *>(layer)->getLayerNormParam();
+}
+template <typename T>
+GELUParam *Gelu(Layer<T> *layer) {
+  return static_cast<GELULayer<T> *>(layer)->getGELUParam();
+}
+template <typename T>
+AttentionParam *Attention(Layer<T> *layer) {
+  return static_cast<AttentionLayer<T> *>(layer)->getAttentionParam();
+}
+
+} // namespace
+
+template <typename T>
+const typename DNNMark<T>::GeneralSetterTable &
+DNNMark<T>::GetGeneralSetters() {
+  typedef DNNMark<T> D;
+  typedef const std::string S;
+  static const GeneralSetterTable setters = {
+    {"run_mode", [](D *d, S &val) {
+      return ParseOption(val, {{"none", NONE}, {"standalone", STANDALONE},
+                               {"composed", COMPOSED}}, &d->run_mode_);
+    }},
+    {"mode", [](D *d, S &val) {
+      return ParseOption(val, {{"training", TRAINING},
+                               {"inference", INFERENCE}}, &d->mode_);
+    }},
+    {"pipeline_microbatches", [](D *d, S &val) {
+      return ParseInt(val, &d->pipeline_microbatches_, 1);
+    }},
+    {"pipeline_stages", [](D *d, S &val) {
+      return ParseInt(val, &d->pipeline_stages_, 1);
+    }},
+    {"pipeline_schedule", [](D *d, S &val) {
+      return ParseOption(val, {{"gpipe", GPIPE}, {"1f1b", ONE_F_ONE_B}},
+                         &d->pipeline_schedule_);
+    }},
+    {"replicas", [](D *d, S &val) {
+      return ParseInt(val, &d->num_replicas_, 1);
+    }},
+    {"allreduce_bucket_mb", [](D *d, S &val) {
+      return ParseMB(val, &d->allreduce_bucket_size_, true);
+    }},
+    {"memory_budget", [](D *d, S &val) {
+      // One or more budgets in MB, e.g. memory_budget=512,256,128
+      std::vector<std::string> budgets;
+      SplitList(val, &budgets);
+      d->memory_budgets_.clear();
+      for (auto &budget : budgets) {
+        size_t bytes;
+        if (!ParseMB(budget, &bytes, false))
+          return false;
+        d->memory_budgets_.push_back(bytes);
       }
-      break;
-    } // End of case DROPOUT
-    case BYPASS: {
-      // Obtain the data dimension and parameters variable within layer class
-      input_dim = std::dynamic_pointer_cast<BypassLayer<T>>
-                  (layers_map_[current_layer_id])->getInputDim();
-      bypass_param = std::dynamic_pointer_cast<BypassLayer<T>>
-                 (layers_map_[current_layer_id])->getBypassParam();
-
-      if(isKeywordExist(var, data_config_keywords))
-        break;
-
-      // Process all the keywords in config
-      if(!isKeywordExist(var, bypass_config_keywords)) {
-        LOG(FATAL) << var << ": Keywords not exists" << std::endl;
+      return true;
+    }},
+    {"offload_layers", [](D *d, S &val) {
+      // Layer names or "all"
+      SplitList(val, &d->offload_layers_);
+      return true;
+    }},
+    {"offload_slots", [](D *d, S &val) {
+      return ParseInt(val, &d->offload_slots_, 2);
+    }},
+    {"fusion", [](D *d, S &val) {
+      return ParseBool(val, &d->fusion_enabled_);
+    }},
+    {"in_place", [](D *d, S &val) {
+      return ParseBool(val, &d->in_place_enabled_);
+    }},
+    {"batch_sweep", [](D *d, S &val) {
+      std::vector<std::string> sizes;
+      SplitList(val, &sizes);
+      d->batch_sweep_.clear();
+      for (auto &size : sizes) {
+        int n;
+        if (!ParseInt(size, &n, 1))
+          return false;
+        d->batch_sweep_.push_back(n);
       }
-      break;
-    } // End of case BYPASS
-    default: {
-      LOG(WARNING) << "NOT supported layer";
-      break;
-    } // End of case default
+      return true;
+    }},
+    {"optimizer", [](D *d, S &val) {
+      return ParseOption(val, {{"none", NO_OPTIMIZER},
+                               {"sgd", SGD_MOMENTUM}, {"adam", ADAM},
+                               {"lamb", LAMB}}, &d->optimizer_param_.type_);
+    }},
+    {"learning_rate", [](D *d, S &val) {
+      return ParseReal(val, &d->optimizer_param_.learning_rate_);
+    }},
+    {"momentum", [](D *d, S &val) {
+      return ParseReal(val, &d->optimizer_param_.momentum_);
+    }},
+    {"weight_decay", [](D *d, S &val) {
+      return ParseReal(val, &d->optimizer_param_.weight_decay_);
+    }},
+    {"adam_beta1", [](D *d, S &val) {
+      return ParseReal(val, &d->optimizer_param_.beta1_);
+    }},
+    {"adam_beta2", [](D *d, S &val) {
+      return ParseReal(val, &d->optimizer_param_.beta2_);
+    }},
+    {"adam_epsilon", [](D *d, S &val) {
+      return ParseReal(val, &d->optimizer_param_.epsilon_);
+    }},
+    {"autotune", [](D *d, S &val) {
+      return ParseBool(val, &d->autotune_param_.enabled_);
+    }},
+    {"autotune_cache", [](D *d, S &val) {
+      d->autotune_param_.cache_file_ = val;
+      return true;
+    }},
+    {"autotune_warmup", [](D *d, S &val) {
+      // The first launch tells whether an algorithm is supported
+      return ParseInt(val, &d->autotune_param_.warmup_, 1);
+    }},
+    {"autotune_repetitions", [](D *d, S &val) {
+      return ParseInt(val, &d->autotune_param_.repetitions_, 1);
+    }},
+    {"workspace_budget", [](D *d, S &val) {
+      return ParseMB(val, &d->workspace_budget_, false);
+    }},
+    {"deterministic", [](D *d, S &val) {
+      return ParseBool(val, &d->deterministic_);
+    }},
+    {"input_pipeline", [](D *d, S &val) {
+      return ParseBool(val, &d->input_param_.pipeline_);
+    }},
+    {"prefetch_slots", [](D *d, S &val) {
+      return ParseInt(val, &d->input_param_.prefetch_slots_, 1);
+    }},
+    {"input_workers", [](D *d, S &val) {
+      return ParseInt(val, &d->input_param_.num_workers_, 1);
+    }},
+    {"augment", [](D *d, S &val) {
+      return ParseBool(val, &d->input_param_.augment_);
+    }},
+    {"crop_pad", [](D *d, S &val) {
+      return ParseInt(val, &d->input_param_.crop_pad_, 0);
+    }},
+    {"refill_each_iteration", [](D *d, S &val) {
+      return ParseBool(val, &d->refill_each_iteration_);
+    }},
+    {"snapshot", [](D *d, S &val) {
+      d->snapshot_file_ = val;
+      return true;
+    }}
+  };
+  return setters;
+}
 
-  }
+template <typename T>
+const typename DNNMark<T>::LayerSetterTable &
+DNNMark<T>::GetLayerSetters(LayerType layer_type) {
+  typedef DNNMark<T> D;
+  typedef Layer<T> L;
+  typedef const std::string S;
 
-  // Set data configuration at last, since all layers share same parameters
-  if(isKeywordExist(var, data_config_keywords)) {
-    if (!var.compare("n")) {
-      input_dim->n_ = atoi(val.c_str());
-    } else if (!var.compare("c")) {
-      input_dim->c_ = atoi(val.c_str());
-    } else if (!var.compare("h")) {
-      input_dim->h_ = atoi(val.c_str());
-    } else if (!var.compare("w")) {
-      input_dim->w_ = atoi(val.c_str());
-    } else if (!var.compare("name")) {
-      layers_map_[current_layer_id]->setLayerName(val.c_str());
-      name_id_map_[val] = current_layer_id;
-    } else if (!var.compare("previous_layer")) {
-      layers_map_[current_layer_id]->setPrevLayerName(val.c_str());
-    }
-  }
+  // Tables of the type specific keywords merged with the data keywords,
+  // built on first use
+  static const std::map<LayerType, LayerSetterTable> tables = []() {
+    // Data keywords every layer type accepts
+    const LayerSetterTable data_setters = {
+      {"name", [](D *d, L *layer, S &val) {
+        // Layers are connected by name
+        if (val.empty() || d->isLayerExist(val))
+          return false;
+        layer->setLayerName(val.c_str());
+        d->name_id_map_[val] = layer->getLayerId();
+        return true;
+      }},
+      {"previous_layer", [](D *d, L *layer, S &val) {
+        layer->setPrevLayerName(val.c_str());
+        return true;
+      }},
+      {"n", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &layer->getInputDim()->n_);
+      }},
+      {"c", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &layer->getInputDim()->c_);
+      }},
+      {"h", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &layer->getInputDim()->h_);
+      }},
+      {"w", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &layer->getInputDim()->w_);
+      }},
+      {"data_source", [](D *d, L *layer, S &val) {
+        // random, or cifar10: followed by the binary batch files
+        if (!val.compare("random"))
+          layer->setDataSource("");
+        else if (!val.compare(0, 8, "cifar10:"))
+          layer->setDataSource(val);
+        else
+          return false;
+        return true;
+      }}
+    };
+
+    const LayerSetterTable conv_setters = {
+      {"conv_mode", [](D *d, L *layer, S &val) {
+        return ParseOption(val, {{"convolution", CUDNN_CONVOLUTION},
+                                 {"cross_correlation",
+                                  CUDNN_CROSS_CORRELATION}},
+                           &Conv(layer)->mode_);
+      }},
+      {"num_output", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Conv(layer)->output_num_);
+      }},
+      {"kernel_size", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Conv(layer)->kernel_size_h_) &&
+               ParseInt(val, &Conv(layer)->kernel_size_w_);
+      }},
+      {"pad", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Conv(layer)->pad_h_) &&
+               ParseInt(val, &Conv(layer)->pad_w_);
+      }},
+      {"stride", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Conv(layer)->stride_u_) &&
+               ParseInt(val, &Conv(layer)->stride_v_);
+      }},
+      {"kernel_size_h", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Conv(layer)->kernel_size_h_);
+      }},
+      {"kernel_size_w", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Conv(layer)->kernel_size_w_);
+      }},
+      {"pad_h", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Conv(layer)->pad_h_);
+      }},
+      {"pad_w", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Conv(layer)->pad_w_);
+      }},
+      {"stride_h", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Conv(layer)->stride_u_);
+      }},
+      {"stride_w", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Conv(layer)->stride_v_);
+      }},
+      {"conv_fwd_pref", [](D *d, L *layer, S &val) {
+        return ParseOption(val, {
+          {"no_workspace", CUDNN_CONVOLUTION_FWD_NO_WORKSPACE},
+          {"fastest", CUDNN_CONVOLUTION_FWD_PREFER_FASTEST},
+          {"specify_workspace_limit",
+           CUDNN_CONVOLUTION_FWD_SPECIFY_WORKSPACE_LIMIT}},
+          &Conv(layer)->conv_fwd_pref_);
+      }},
+      {"conv_bwd_filter_pref", [](D *d, L *layer, S &val) {
+        return ParseOption(val, {
+          {"no_workspace", CUDNN_CONVOLUTION_BWD_FILTER_NO_WORKSPACE},
+          {"fastest", CUDNN_CONVOLUTION_BWD_FILTER_PREFER_FASTEST},
+          {"specify_workspace_limit",
+           CUDNN_CONVOLUTION_BWD_FILTER_SPECIFY_WORKSPACE_LIMIT}},
+          &Conv(layer)->conv_bwd_filter_pref_);
+      }},
+      {"conv_bwd_data_pref", [](D *d, L *layer, S &val) {
+        return ParseOption(val, {
+          {"no_workspace", CUDNN_CONVOLUTION_BWD_DATA_NO_WORKSPACE},
+          {"fastest", CUDNN_CONVOLUTION_BWD_DATA_PREFER_FASTEST},
+          {"specify_workspace_limit",
+           CUDNN_CONVOLUTION_BWD_DATA_SPECIFY_WORKSPACE_LIMIT}},
+          &Conv(layer)->conv_bwd_data_pref_);
+      }},
+      {"workspace_limit", [](D *d, L *layer, S &val) {
+        // In MB, the heuristic choice is limited as well
+        ConvolutionParam *conv_param = Conv(layer);
+        if (!ParseMB(val, &conv_param->workspace_limit_, true))
+          return false;
+        conv_param->conv_fwd_pref_ =
+          CUDNN_CONVOLUTION_FWD_SPECIFY_WORKSPACE_LIMIT;
+        conv_param->conv_bwd_filter_pref_ =
+          CUDNN_CONVOLUTION_BWD_FILTER_SPECIFY_WORKSPACE_LIMIT;
+        conv_param->conv_bwd_data_pref_ =
+          CUDNN_CONVOLUTION_BWD_DATA_SPECIFY_WORKSPACE_LIMIT;
+        return true;
+      }},
+      {"autotune", [](D *d, L *layer, S &val) {
+        return ParseBool(val, &Conv(layer)->autotune_);
+      }}
+    };
+
+    const LayerSetterTable pool_setters = {
+      {"pool_mode", [](D *d, L *layer, S &val) {
+        return ParseOption(val, {
+          {"max", CUDNN_POOLING_MAX},
+          {"avg_include_padding", CUDNN_POOLING_AVERAGE_COUNT_INCLUDE_PADDING},
+          {"avg_exclude_padding", CUDNN_POOLING_AVERAGE_COUNT_EXCLUDE_PADDING}},
+          &Pool(layer)->mode_);
+      }},
+      {"kernel_size", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Pool(layer)->kernel_size_h_) &&
+               ParseInt(val, &Pool(layer)->kernel_size_w_);
+      }},
+      {"pad", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Pool(layer)->pad_h_) &&
+               ParseInt(val, &Pool(layer)->pad_w_);
+      }},
+      {"stride", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Pool(layer)->stride_h_) &&
+               ParseInt(val, &Pool(layer)->stride_w_);
+      }},
+      {"kernel_size_h", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Pool(layer)->kernel_size_h_);
+      }},
+      {"kernel_size_w", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Pool(layer)->kernel_size_w_);
+      }},
+      {"pad_h", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Pool(layer)->pad_h_);
+      }},
+      {"pad_w", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Pool(layer)->pad_w_);
+      }},
+      {"stride_h", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Pool(layer)->stride_h_);
+      }},
+      {"stride_w", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Pool(layer)->stride_w_);
+      }}
+    };
+
+    const LayerSetterTable lrn_setters = {
+      {"lrn_mode", [](D *d, L *layer, S &val) {
+        return ParseOption(val, {
+          {"cross_channel_dim1", CUDNN_LRN_CROSS_CHANNEL_DIM1}},
+          &Lrn(layer)->mode_);
+      }},
+      {"local_size", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Lrn(layer)->local_size_);
+      }},
+      {"alpha", [](D *d, L *layer, S &val) {
+        return ParseReal(val, &Lrn(layer)->alpha_);
+      }},
+      {"beta", [](D *d, L *layer, S &val) {
+        return ParseReal(val, &Lrn(layer)->beta_);
+      }},
+      {"k", [](D *d, L *layer, S &val) {
+        return ParseReal(val, &Lrn(layer)->k_);
+      }}
+    };
+
+    const LayerSetterTable activation_setters = {
+      {"activation_mode", [](D *d, L *layer, S &val) {
+        return ParseOption(val, {
+          {"sigmoid", CUDNN_ACTIVATION_SIGMOID},
+          {"relu", CUDNN_ACTIVATION_RELU},
+          {"tanh", CUDNN_ACTIVATION_TANH}},
+          &Activation(layer)->mode_);
+      }}
+    };
+
+    const LayerSetterTable fc_setters = {
+      {"num_output", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Fc(layer)->output_num_);
+      }}
+    };
+
+    const LayerSetterTable softmax_setters = {
+      {"softmax_algo", [](D *d, L *layer, S &val) {
+        return ParseOption(val, {
+          {"fast", CUDNN_SOFTMAX_FAST},
+          {"accurate", CUDNN_SOFTMAX_ACCURATE},
+          {"log", CUDNN_SOFTMAX_LOG}},
+          &Softmax(layer)->algo_);
+      }},
+      {"softmax_mode", [](D *d, L *layer, S &val) {
+        return ParseOption(val, {
+          {"instance", CUDNN_SOFTMAX_MODE_INSTANCE},
+          {"channel", CUDNN_SOFTMAX_MODE_CHANNEL}},
+          &Softmax(layer)->mode_);
+      }}
+    };
+
+    const LayerSetterTable bn_setters = {
+      {"batchnorm_mode", [](D *d, L *layer, S &val) {
+        return ParseOption(val, {
+          {"per_activation", CUDNN_BATCHNORM_PER_ACTIVATION},
+          {"spatial", CUDNN_BATCHNORM_SPATIAL}},
+          &Bn(layer)->mode_);
+      }},
+      {"save_intermediates", [](D *d, L *layer, S &val) {
+        return ParseBool(val, &Bn(layer)->save_intermediates_);
+      }},
+      {"exp_avg_factor", [](D *d, L *layer, S &val) {
+        return ParseReal(val, &Bn(layer)->exp_avg_factor_);
+      }},
+      {"epsilon", [](D *d, L *layer, S &val) {
+        return ParseReal(val, &Bn(layer)->epsilon_);
+      }},
+      {"use_global_stats", [](D *d, L *layer, S &val) {
+        return ParseBool(val, &Bn(layer)->use_global_stats_);
+      }}
+    };
+
+    const LayerSetterTable dropout_setters = {
+      {"dropout_probability", [](D *d, L *layer, S &val) {
+        return ParseReal(val, &Dropout(layer)->dropout_p_);
+      }},
+      {"random_seed", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Dropout(layer)->random_seed_, 0);
+      }}
+    };
+
+    const LayerSetterTable bypass_setters = {};
+
+    const LayerSetterTable rnn_setters = {
+      {"hidden_size", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Rnn(layer)->hidden_size_);
+      }},
+      {"num_layers", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Rnn(layer)->num_layers_);
+      }},
+      {"seq_len", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Rnn(layer)->seq_len_);
+      }},
+      {"bidirectional", [](D *d, L *layer, S &val) {
+        return ParseBool(val, &Rnn(layer)->bidirectional_);
+      }}
+    };
+
+    const LayerSetterTable bmm_setters = {
+      {"num_heads", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Bmm(layer)->num_heads_);
+      }},
+      {"output_cols", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Bmm(layer)->output_cols_);
+      }},
+      {"seq_len", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Bmm(layer)->seq_len_);
+      }},
+      {"transpose", [](D *d, L *layer, S &val) {
+        return ParseBool(val, &Bmm(layer)->transpose_);
+      }},
+      {"shared", [](D *d, L *layer, S &val) {
+        return ParseBool(val, &Bmm(layer)->shared_);
+      }}
+    };
+
+    const LayerSetterTable ln_setters = {
+      {"seq_len", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Ln(layer)->seq_len_);
+      }},
+      {"epsilon", [](D *d, L *layer, S &val) {
+        return ParseReal(val, &Ln(layer)->epsilon_);
+      }}
+    };
+
+    const LayerSetterTable gelu_setters = {
+      {"approximate", [](D *d, L *layer, S &val) {
+        return ParseBool(val, &Gelu(layer)->approximate_);
+      }}
+    };
+
+    const LayerSetterTable attention_setters = {
+      {"num_heads", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Attention(layer)->num_heads_);
+      }},
+      {"seq_len", [](D *d, L *layer, S &val) {
+        return ParseInt(val, &Attention(layer)->seq_len_);
+      }},
+      {"causal", [](D *d, L *layer, S &val) {
+        return ParseBool(val, &Attention(layer)->causal_);
+      }}
+    };
+
+    std::map<LayerType, LayerSetterTable> tables = {
+      {CONVOLUTION, conv_setters},
+      {POOLING, pool_setters},
+      {LRN, lrn_setters},
+      {ACTIVATION, activation_setters},
+      {FC, fc_setters},
+      {SOFTMAX, softmax_setters},
+      {BN, bn_setters},
+      {DROPOUT, dropout_setters},
+      {BYPASS, bypass_setters},
+      {LSTM, rnn_setters},
+      {GRU, rnn_setters},
+      {BATCHED_MATMUL, bmm_setters},
+      {LAYER_NORM, ln_setters},
+      {GELU, gelu_setters},
+      {ATTENTION, attention_setters}
+    };
+    for (auto &table : tables)
+      table.second.insert(data_setters.begin(), data_setters.end());
+    return tables;
+  }();
+  return tables.at(layer_type);
 }
 
 template <typename T>
 int DNNMark<T>::ParseAllConfig(const std::string &config_file) {
-  // TODO: use multithread in the future
-  // Parse DNNMark specific config
-  ParseGeneralConfig(config_file);
+  std::ifstream is(config_file.c_str(), std::ifstream::in);
+  CHECK(is.is_open()) << "Cannot open " << config_file;
+  return ParseConfig(is, config_file, true, true);
+}
 
-  // Parse Layers config
-  ParseLayerConfig(config_file);
+template <typename T>
+int DNNMark<T>::ParseAllConfig(std::istream &is) {
+  return ParseConfig(is, "<config>", true, true);
 }
 
 template <typename T>
 int DNNMark<T>::ParseGeneralConfig(const std::string &config_file) {
-  std::ifstream is;
-  is.open(config_file.c_str(), std::ifstream::in);
-  LOG(INFO) << "Search and parse general DNNMark configuration";
+  std::ifstream is(config_file.c_str(), std::ifstream::in);
+  CHECK(is.is_open()) << "Cannot open " << config_file;
+  return ParseConfig(is, config_file, true, false);
+}
+
+template <typename T>
+int DNNMark<T>::ParseGeneralConfig(std::istream &is) {
+  return ParseConfig(is, "<config>", true, false);
+}
+
+template <typename T>
+int DNNMark<T>::ParseLayerConfig(const std::string &config_file) {
+  std::ifstream is(config_file.c_str(), std::ifstream::in);
+  CHECK(is.is_open()) << "Cannot open " << config_file;
+  return ParseConfig(is, config_file, false, true);
+}
 
-  // TODO: insert assert regarding run_mode_
+template <typename T>
+int DNNMark<T>::ParseLayerConfig(std::istream &is) {
+  return ParseConfig(is, "<config>", false, true);
+}
 
-  // Parse DNNMark config
-  std::string s;
+template <typename T>
+int DNNMark<T>::ParseConfig(std::istream &is, const std::string &source,
+                            bool general, bool layers) {
+  LOG(INFO) << "Parse configuration " << source;
+  const GeneralSetterTable &general_setters = GetGeneralSetters();
+  const LayerSetterTable *layer_setters = nullptr;
+  Layer<T> *layer = nullptr;
   bool is_general_section = false;
-  while (!is.eof()) {
-    // Obtain the string in one line
-    std::getline(is, s);
-    TrimStr(&s);
+  std::string s, section, var, val;
+  int line = 0;
+  int section_line = 0;
+
+  // A layer is complete once its section ends
+  auto check_layer = [&]() {
+    if (layer == nullptr)
+      return;
+    std::string error = CheckLayer(layer);
+    LOG_IF(FATAL, !error.empty())
+      << source << ":" << section_line << ": " << section << " "
+      << layer->getLayerName() << ": " << error;
+  };
 
-    // Check the specific configuration section markers
-    if (isCommentStr(s) || isEmptyStr(s)) {
+  while (std::getline(is, s)) {
+    line++;
+    TrimStr(&s);
+    if (s.empty() || s[0] == '#')
       continue;
-    } else if (isGeneralSection(s)) {
-      is_general_section = true;
+
+    // Section markers
+    if (s[0] == '[') {
+      check_layer();
+      is_general_section = isGeneralSection(s);
+      layer = nullptr;
+      section = s;
+      section_line = line;
+      if (is_general_section)
+        continue;
+      auto type = layer_type_map.find(s);
+      LOG_IF(FATAL, type == layer_type_map.end())
+        << source << ":" << line << ": Unknown section " << s;
+      if (!layers)
+        continue;
+      LOG(INFO) << "Add " << s << " layer";
+      layer = CreateLayer(type->second);
+      layer_setters = &GetLayerSetters(type->second);
       continue;
-    } else if (isLayerSection(s)) {
-      is_general_section = false;
-      break;
-    } else if (is_general_section) {
-      // Obtain the acutal variable and value
-      std::string var;
-      std::string val;
-      SplitStr(s, &var, &val);
-
-      // Process all the keywords in config
-      if(isKeywordExist(var, dnnmark_config_keywords)) {
-        if (!var.compare("run_mode")) {
-          if (!val.compare("none"))
-            run_mode_ = NONE;
-          else if(!val.compare("standalone"))
-            run_mode_ = STANDALONE;
-          else if(!val.compare("composed"))
-            run_mode_ = COMPOSED;
-          else
-            std::cerr << "Unknown run mode" << std::endl;
-        }
-      } else {
-        LOG(FATAL) << var << ": Keywords not exists" << std::endl;
-      }
+    }
+
+    LOG_IF(FATAL, s.find('=') == std::string::npos)
+      << source << ":" << line << ": Expected variable=value: " << s;
+    LOG_IF(FATAL, section.empty())
+      << source << ":" << line << ": " << s << " is outside of any section";
+    SplitStr(s, &var, &val);
+
+    if (is_general_section) {
+      if (!general)
+        continue;
+      auto setter = general_setters.find(var);
+      LOG_IF(FATAL, setter == general_setters.end())
+        << source << ":" << line << ": " << var
+        << ": Keywords not exists in " << section;
+      LOG_IF(FATAL, !setter->second(this, val))
+        << source << ":" << line << ": Invalid value of " << var << ": "
+        << val;
+    } else if (layer != nullptr) {
+      auto setter = layer_setters->find(var);
+      LOG_IF(FATAL, setter == layer_setters->end())
+        << source << ":" << line << ": " << var
+        << ": Keywords not exists in " << section;
+      // A data source lists files, any other list is a sweep
+      LOG_IF(FATAL, var.compare("data_source") && isSweepValue(val))
+        << source << ":" << line << ": " << var << "=" << val
+        << " describes several configurations, expand it with ParamSweep";
+      LOG_IF(FATAL, !setter->second(this, layer, val))
+        << source << ":" << line << ": Invalid value of " << var << ": "
+        << val;
     }
   }
+  check_layer();
 
-  is.close();
   return 0;
 }
 
 template <typename T>
-int DNNMark<T>::ParseLayerConfig(const std::string &config_file) {
-  std::ifstream is;
-  is.open(config_file.c_str(), std::ifstream::in);
-
-  // Parse DNNMark config
-  std::string s;
-  int current_layer_id;
-  LayerType layer_type;
-  bool is_layer_section = false;
-
-  LOG(INFO) << "Search and parse layer configuration";
-  while (!is.eof()) {
-    // Obtain the string in one line
-    std::getline(is, s);
-    TrimStr(&s);
+Layer<T> *DNNMark<T>::CreateLayer(LayerType layer_type) {
+  int layer_id = num_layers_added_;
+  std::shared_ptr<Layer<T>> layer;
+  if (layer_type == CONVOLUTION)
+    layer = std::make_shared<ConvolutionLayer<T>>(this);
+  else if (layer_type == POOLING)
+    layer = std::make_shared<PoolingLayer<T>>(this);
+  else if (layer_type == LRN)
+    layer = std::make_shared<LRNLayer<T>>(this);
+  else if (layer_type == ACTIVATION)
+    layer = std::make_shared<ActivationLayer<T>>(this);
+  else if (layer_type == FC)
+    layer = std::make_shared<FullyConnectedLayer<T>>(this);
+  else if (layer_type == SOFTMAX)
+    layer = std::make_shared<SoftmaxLayer<T>>(this);
+  else if (layer_type == BN)
+    layer = std::make_shared<BatchNormLayer<T>>(this);
+  else if (layer_type == DROPOUT)
+    layer = std::make_shared<DropoutLayer<T>>(this);
+  else if (layer_type == BYPASS)
+    layer = std::make_shared<BypassLayer<T>>(this);
+  else if (layer_type == LSTM || layer_type == GRU)
+    layer = std::make_shared<RNNLayer<T>>(this);
+  else if (layer_type == BATCHED_MATMUL)
+    layer = std::make_shared<BatchedMatMulLayer<T>>(this);
+  else if (layer_type == LAYER_NORM)
+    layer = std::make_shared<LayerNormLayer<T>>(this);
+  else if (layer_type == GELU)
+    layer = std::make_shared<GELULayer<T>>(this);
+  else if (layer_type == ATTENTION)
+    layer = std::make_shared<AttentionLayer<T>>(this);
+  else
+    LOG(FATAL) << "NOT supported layer";
+  layer->setLayerId(layer_id);
+  layer->setLayerType(layer_type);
+  layers_map_.emplace(layer_id, layer);
+  num_layers_added_++;
+  return layer.get();
+}
 
-    // Check the specific configuration section markers
-    if (isCommentStr(s) || isEmptyStr(s)){
-      continue;
-    } else if (isGeneralSection(s)) {
-      is_layer_section = false;
-    } else if (isLayerSection(s)) {
-      is_layer_section = true;
-      layer_type = layer_type_map.at(s);
-      LOG(INFO) << "Add "
-                << s
-                << " layer";
-      // Create a layer in the main class
-      current_layer_id = num_layers_added_;
-      if (layer_type == CONVOLUTION)
-        layers_map_.emplace(current_layer_id,
-          std::make_shared<ConvolutionLayer<T>>(this));
-      else if (layer_type == POOLING)
-        layers_map_.emplace(current_layer_id,
-          std::make_shared<PoolingLayer<T>>(this));
-      else if (layer_type == LRN)
-        layers_map_.emplace(current_layer_id,
-          std::make_shared<LRNLayer<T>>(this));
-      else if (layer_type == ACTIVATION)
-        layers_map_.emplace(current_layer_id,
-          std::make_shared<ActivationLayer<T>>(this));
-      else if (layer_type == FC)
-        layers_map_.emplace(current_layer_id,
-          std::make_shared<FullyConnectedLayer<T>>(this));
-      else if (layer_type == SOFTMAX)
-        layers_map_.emplace(current_layer_id,
-          std::make_shared<SoftmaxLayer<T>>(this));
-      else if (layer_type == BN)
-        layers_map_.emplace(current_layer_id,
-          std::make_shared<BatchNormLayer<T>>(this));
-      else if (layer_type == DROPOUT)
-        layers_map_.emplace(current_layer_id,
-          std::make_shared<DropoutLayer<T>>(this));
-      else if (layer_type == BYPASS)
-	      layers_map_.emplace(current_layer_id,
-	        std::make_shared<BypassLayer<T>>(this));
-      layers_map_[current_layer_id]->setLayerId(current_layer_id);
-      layers_map_[current_layer_id]->setLayerType(layer_type);
-      num_layers_added_++;
-      continue;
-    } else if (is_layer_section) {
-      // Obtain the acutal variable and value
-      std::string var;
-      std::string val;
-      SplitStr(s, &var, &val);
+template <typename T>
+std::string DNNMark<T>::CheckLayer(Layer<T> *layer) {
+  std::string previous_layer = layer->getPrevLayerName();
+  DataDim *dim = layer->getInputDim();
+  if (layer->getLayerName().empty())
+    return "name is missing";
+  if (run_mode_ == STANDALONE || !previous_layer.compare("null")) {
+    if (dim->n_ < 1 || dim->c_ < 1 || dim->h_ < 1 || dim->w_ < 1)
+      return "n, c, h and w of a first layer have to be positive";
+  } else if (!isLayerExist(previous_layer)) {
+    return "previous layer " + previous_layer + " is not defined before";
+  }
 
-      // Obtain the data dimension and parameters variable within layer class
-      SetLayerParams(layer_type,
-                     current_layer_id,
-                     var, val);
+  switch (layer->getLayerType()) {
+    case CONVOLUTION: {
+      ConvolutionParam *param = Conv(layer);
+      if (param->output_num_ < 1)
+        return "num_output has to be positive";
+      if (param->kernel_size_h_ < 1 || param->kernel_size_w_ < 1)
+        return "kernel size has to be positive";
+      if (param->pad_h_ < 0 || param->pad_w_ < 0)
+        return "pad cannot be negative";
+      if (param->stride_u_ < 1 || param->stride_v_ < 1)
+        return "stride has to be positive";
+      break;
+    }
+    case POOLING: {
+      PoolingParam *param = Pool(layer);
+      if (param->kernel_size_h_ < 1 || param->kernel_size_w_ < 1)
+        return "kernel size has to be positive";
+      if (param->pad_h_ < 0 || param->pad_w_ < 0)
+        return "pad cannot be negative";
+      if (param->stride_h_ < 1 || param->stride_w_ < 1)
+        return "stride has to be positive";
+      break;
     }
+    case LRN:
+      if (Lrn(layer)->local_size_ < 1)
+        return "local_size has to be positive";
+      break;
+    case FC:
+      if (Fc(layer)->output_num_ < 1)
+        return "num_output has to be positive";
+      break;
+    case BN:
+      if (Bn(layer)->epsilon_ < CUDNN_BN_MIN_EPSILON)
+        return "epsilon is below CUDNN_BN_MIN_EPSILON";
+      break;
+    case DROPOUT:
+      if (Dropout(layer)->dropout_p_ < 0 || Dropout(layer)->dropout_p_ >= 1)
+        return "dropout_probability has to be in [0, 1)";
+      break;
+    case LSTM:
+    case GRU:
+      if (Rnn(layer)->hidden_size_ < 1)
+        return "hidden_size has to be positive";
+      if (Rnn(layer)->num_layers_ < 1)
+        return "num_layers has to be positive";
+      if (Rnn(layer)->seq_len_ < 0)
+        return "seq_len cannot be negative";
+      break;
+    case BATCHED_MATMUL:
+      if (Bmm(layer)->num_heads_ < 1)
+        return "num_heads has to be positive";
+      if (Bmm(layer)->output_cols_ < 1)
+        return "output_cols has to be positive";
+      if (Bmm(layer)->seq_len_ < 0)
+        return "seq_len cannot be negative";
+      break;
+    case LAYER_NORM:
+      if (Ln(layer)->seq_len_ < 0)
+        return "seq_len cannot be negative";
+      if (Ln(layer)->epsilon_ <= 0)
+        return "epsilon has to be positive";
+      break;
+    case ATTENTION:
+      if (Attention(layer)->num_heads_ < 1)
+        return "num_heads has to be positive";
+      if (Attention(layer)->seq_len_ < 0)
+        return "seq_len cannot be negative";
+      break;
+    default:
+      break;
   }
+  return "";
+}
 
-  is.close();
-  return 0;
+template <typename T>
+DNNMark<T> &DNNMark<T>::Set(const std::string &var, const std::string &val) {
+  auto setter = GetGeneralSetters().find(var);
+  LOG_IF(FATAL, setter == GetGeneralSetters().end())
+    << var << ": Keywords not exists in [DNNMark]";
+  LOG_IF(FATAL, !setter->second(this, val))
+    << "Invalid value of " << var << ": " << val;
+  return *this;
+}
+
+template <typename T>
+Layer<T> *DNNMark<T>::AddLayer(LayerType layer_type, const std::string &name,
+                               const std::string &previous_layer,
+                               const DataDim &input_dim) {
+  LOG_IF(FATAL, isLayerExist(name)) << "Layer " << name << " already exists";
+  Layer<T> *layer = CreateLayer(layer_type);
+  layer->setLayerName(name.c_str());
+  layer->setPrevLayerName(previous_layer.c_str());
+  // Setup derives the input of other layers from their previous one
+  if (run_mode_ == STANDALONE || !previous_layer.compare("null"))
+    *layer->getInputDim() = input_dim;
+  name_id_map_[name] = layer->getLayerId();
+  return layer;
+}
+
+template <typename T>
+template <typename P>
+DNNMark<T> &DNNMark<T>::AddLayer(LayerType layer_type,
+                                 const std::string &name,
+                                 const std::string &previous_layer,
+                                 const DataDim &input_dim, const P &param,
+                                 P *(*get_param)(Layer<T> *)) {
+  Layer<T> *layer = AddLayer(layer_type, name, previous_layer, input_dim);
+  *get_param(layer) = param;
+  std::string error = CheckLayer(layer);
+  LOG_IF(FATAL, !error.empty()) << "Layer " << name << ": " << error;
+  return *this;
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddConvolution(const std::string &name,
+                                       const std::string &previous_layer,
+                                       const ConvolutionParam &param,
+                                       const DataDim &input_dim) {
+  return AddLayer(CONVOLUTION, name, previous_layer, input_dim, param,
+                  &Conv<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddPooling(const std::string &name,
+                                   const std::string &previous_layer,
+                                   const PoolingParam &param,
+                                   const DataDim &input_dim) {
+  return AddLayer(POOLING, name, previous_layer, input_dim, param,
+                  &Pool<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddLRN(const std::string &name,
+                               const std::string &previous_layer,
+                               const LRNParam &param,
+                               const DataDim &input_dim) {
+  return AddLayer(LRN, name, previous_layer, input_dim, param, &Lrn<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddActivation(const std::string &name,
+                                      const std::string &previous_layer,
+                                      const ActivationParam &param,
+                                      const DataDim &input_dim) {
+  return AddLayer(ACTIVATION, name, previous_layer, input_dim, param,
+                  &Activation<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddFullyConnected(const std::string &name,
+                                          const std::string &previous_layer,
+                                          const FullyConnectedParam &param,
+                                          const DataDim &input_dim) {
+  return AddLayer(FC, name, previous_layer, input_dim, param, &Fc<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddSoftmax(const std::string &name,
+                                   const std::string &previous_layer,
+                                   const SoftmaxParam &param,
+                                   const DataDim &input_dim) {
+  return AddLayer(SOFTMAX, name, previous_layer, input_dim, param,
+                  &Softmax<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddBatchNorm(const std::string &name,
+                                     const std::string &previous_layer,
+                                     const BatchNormParam &param,
+                                     const DataDim &input_dim) {
+  return AddLayer(BN, name, previous_layer, input_dim, param, &Bn<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddDropout(const std::string &name,
+                                   const std::string &previous_layer,
+                                   const DropoutParam &param,
+                                   const DataDim &input_dim) {
+  return AddLayer(DROPOUT, name, previous_layer, input_dim, param,
+                  &Dropout<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddBypass(const std::string &name,
+                                  const std::string &previous_layer,
+                                  const DataDim &input_dim) {
+  return AddLayer(BYPASS, name, previous_layer, input_dim, BypassParam(),
+                  &Bypass<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddLSTM(const std::string &name,
+                                const std::string &previous_layer,
+                                const RNNParam &param,
+                                const DataDim &input_dim) {
+  return AddLayer(LSTM, name, previous_layer, input_dim, param, &Rnn<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddGRU(const std::string &name,
+                               const std::string &previous_layer,
+                               const RNNParam &param,
+                               const DataDim &input_dim) {
+  return AddLayer(GRU, name, previous_layer, input_dim, param, &Rnn<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddBatchedMatMul(const std::string &name,
+                                         const std::string &previous_layer,
+                                         const BatchedMatMulParam &param,
+                                         const DataDim &input_dim) {
+  return AddLayer(BATCHED_MATMUL, name, previous_layer, input_dim, param,
+                  &Bmm<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddLayerNorm(const std::string &name,
+                                     const std::string &previous_layer,
+                                     const LayerNormParam &param,
+                                     const DataDim &input_dim) {
+  return AddLayer(LAYER_NORM, name, previous_layer, input_dim, param, &Ln<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddGELU(const std::string &name,
+                                const std::string &previous_layer,
+                                const GELUParam &param,
+                                const DataDim &input_dim) {
+  return AddLayer(GELU, name, previous_layer, input_dim, param, &Gelu<T>);
+}
+
+template <typename T>
+DNNMark<T> &DNNMark<T>::AddAttention(const std::string &name,
+                                     const std::string &previous_layer,
+                                     const AttentionParam &param,
+                                     const DataDim &input_dim) {
+  return AddLayer(ATTENTION, name, previous_layer, input_dim, param,
+                  &Attention<T>);
+}
+
+template <typename T>
+void DNNMark<T>::ClearLayers() {
+  // Planning objects refer to the layers
+  fusion_.reset();
+  in_place_.reset();
+  optimizer_.reset();
+  workspace_planner_.reset();
+  input_pipelines_.clear();
+  layers_map_.clear();
+  name_id_map_.clear();
+  num_layers_added_ = 0;
 }
 
 template <typename T>
@@ -530,6 +1084,35 @@ int DNNMark<T>::Initialize() {
   LOG(INFO) << "DNNMark: Initialize...";
   LOG(INFO) << "Running mode: " << run_mode_;
   LOG(INFO) << "Number of Layers: " << layers_map_.size();
+
+  // Composed layers run on the handles of their layer id, and builders
+  // and importers may have added more layers than the handles created
+  if (run_mode_ == COMPOSED && handle_.num_cudnn() < num_layers_added_) {
+    LOG(INFO) << "Growing handles from " << handle_.num_cudnn() << " to "
+              << num_layers_added_;
+    handle_.Grow(num_layers_added_);
+  }
+
+  // Allocate for the largest batch of a sweep, smaller ones are views
+  if (!batch_sweep_.empty()) {
+    int max_n = *std::max_element(batch_sweep_.begin(), batch_sweep_.end());
+    for (auto it = layers_map_.begin(); it != layers_map_.end(); it++)
+      if (it->second->getInputDim()->n_ != 0)
+        it->second->getInputDim()->n_ = max_n;
+  }
+
+  // Fused layers run in place, which has to be known before their setup
+  if (run_mode_ == COMPOSED && fusion_enabled_) {
+    fusion_ = std::make_shared<Fusion<T>>(this);
+    fusion_->Plan();
+  }
+  // Aliasing decided after fusion, which already runs absorbed layers
+  // in place
+  if (run_mode_ == COMPOSED && in_place_enabled_) {
+    in_place_ = std::make_shared<InPlace<T>>(this);
+    in_place_->Plan();
+  }
+
   for (auto it = layers_map_.begin(); it != layers_map_.end(); it++) {
     LOG(INFO) << "Layer type: " << it->second->getLayerType();
     if (it->second->getLayerType() == CONVOLUTION) {
@@ -568,12 +1151,94 @@ int DNNMark<T>::Initialize() {
       LOG(INFO) << "DNNMark: Setup parameters of Bypass layer";
       std::dynamic_pointer_cast<BypassLayer<T>>(it->second)->Setup();
     }
+    if (it->second->getLayerType() == LSTM ||
+        it->second->getLayerType() == GRU) {
+      LOG(INFO) << "DNNMark: Setup parameters of Recurrent layer";
+      std::dynamic_pointer_cast<RNNLayer<T>>(it->second)->Setup();
+    }
+    if (it->second->getLayerType() == BATCHED_MATMUL) {
+      LOG(INFO) << "DNNMark: Setup parameters of BatchedMatMul layer";
+      std::dynamic_pointer_cast<BatchedMatMulLayer<T>>(it->second)->Setup();
+    }
+    if (it->second->getLayerType() == LAYER_NORM) {
+      LOG(INFO) << "DNNMark: Setup parameters of LayerNorm layer";
+      std::dynamic_pointer_cast<LayerNormLayer<T>>(it->second)->Setup();
+    }
+    if (it->second->getLayerType() == GELU) {
+      LOG(INFO) << "DNNMark: Setup parameters of GELU layer";
+      std::dynamic_pointer_cast<GELULayer<T>>(it->second)->Setup();
+    }
+    if (it->second->getLayerType() == ATTENTION) {
+      LOG(INFO) << "DNNMark: Setup parameters of Attention layer";
+      std::dynamic_pointer_cast<AttentionLayer<T>>(it->second)->Setup();
+    }
+  }
+
+  // Random input generated here, outside of any timed region
+  if (data_fill_enabled_)
+    for (auto it = layers_map_.begin(); it != layers_map_.end(); it++)
+      if (it->second->isDataFillLayer())
+        it->second->FillData();
+
+  // Trained weights replace the random ones before fusion folds them
+  if (!snapshot_file_.empty())
+    LoadSnapshot(snapshot_file_);
+
+  if (fusion_)
+    fusion_->Apply();
+
+  // Every convolution has measured its algorithms, and fusion fixed the
+  // ones it depends on
+  if (workspace_budget_ > 0) {
+    workspace_planner_ = std::make_shared<WorkspacePlanner<T>>(this);
+    workspace_planner_->Plan();
+  }
+
+  if (optimizer_param_.type_ != NO_OPTIMIZER) {
+    CHECK(isTraining()) << "An optimizer requires mode=training";
+    optimizer_ = std::make_shared<Optimizer<T>>(this);
+    optimizer_->Setup();
   }
   return 0;
 }
 
+template <typename T>
+int DNNMark<T>::SaveSnapshot(const std::string &file) {
+  Snapshot<T> snapshot(this);
+  snapshot.Save(file);
+  snapshot.Report();
+  return 0;
+}
+
+template <typename T>
+int DNNMark<T>::LoadSnapshot(const std::string &file) {
+  Snapshot<T> snapshot(this);
+  snapshot.Load(file);
+  snapshot.Report();
+  // Fused layers compute with factors derived from the old parameters
+  if (fusion_)
+    fusion_->Refold();
+  return 0;
+}
+
+template <typename T>
+Layer<T> *DNNMark<T>::GetSoleConsumer(Layer<T> *layer) {
+  Layer<T> *consumer = nullptr;
+  for (auto it = layers_map_.begin(); it != layers_map_.end(); it++) {
+    if (it->second->getPrevLayerName() != layer->getLayerName())
+      continue;
+    if (consumer != nullptr)
+      return nullptr;
+    consumer = it->second.get();
+  }
+  return consumer;
+}
+
 template <typename T>
 int DNNMark<T>::RunAll() {
+  // Every layer runs its backward right after its forward
+  CHECK(isTraining()) << "DNNMark: RunAll needs mode=training, inference "
+                      << "has no gradient buffers, run Forward instead";
   for (auto it = layers_map_.begin(); it != layers_map_.end(); it++) {
     if (it->second->getLayerType() == CONVOLUTION) {
       std::dynamic_pointer_cast<ConvolutionLayer<T>>(it->second)
@@ -629,8 +1294,39 @@ int DNNMark<T>::RunAll() {
       std::dynamic_pointer_cast<BypassLayer<T>>(it->second)
         ->BackwardPropagation();
     }
+    if (it->second->getLayerType() == LSTM ||
+        it->second->getLayerType() == GRU) {
+      std::dynamic_pointer_cast<RNNLayer<T>>(it->second)
+        ->ForwardPropagation();
+      std::dynamic_pointer_cast<RNNLayer<T>>(it->second)
+        ->BackwardPropagation();
+    }
+    if (it->second->getLayerType() == BATCHED_MATMUL) {
+      std::dynamic_pointer_cast<BatchedMatMulLayer<T>>(it->second)
+        ->ForwardPropagation();
+      std::dynamic_pointer_cast<BatchedMatMulLayer<T>>(it->second)
+        ->BackwardPropagation();
+    }
+    if (it->second->getLayerType() == LAYER_NORM) {
+      std::dynamic_pointer_cast<LayerNormLayer<T>>(it->second)
+        ->ForwardPropagation();
+      std::dynamic_pointer_cast<LayerNormLayer<T>>(it->second)
+        ->BackwardPropagation();
+    }
+    if (it->second->getLayerType() == GELU) {
+      std::dynamic_pointer_cast<GELULayer<T>>(it->second)
+        ->ForwardPropagation();
+      std::dynamic_pointer_cast<GELULayer<T>>(it->second)
+        ->BackwardPropagation();
+    }
+    if (it->second->getLayerType() == ATTENTION) {
+      std::dynamic_pointer_cast<AttentionLayer<T>>(it->second)
+        ->ForwardPropagation();
+      std::dynamic_pointer_cast<AttentionLayer<T>>(it->second)
+        ->BackwardPropagation();
+    }
   }
-  return 0;
+  return Update();
 }
 
 template <typename T>
@@ -690,12 +1386,47 @@ int DNNMark<T>::Forward() {
         ->ForwardPropagation();
       LOG(INFO) << "DNNMark: Running Bypass forward: FINISHED";
     }
+    if (it->second->getLayerType() == LSTM ||
+        it->second->getLayerType() == GRU) {
+      LOG(INFO) << "DNNMark: Running Recurrent forward: STARTED";
+      std::dynamic_pointer_cast<RNNLayer<T>>(it->second)
+        ->ForwardPropagation();
+      LOG(INFO) << "DNNMark: Running Recurrent forward: FINISHED";
+    }
+    if (it->second->getLayerType() == BATCHED_MATMUL) {
+      LOG(INFO) << "DNNMark: Running BatchedMatMul forward: STARTED";
+      std::dynamic_pointer_cast<BatchedMatMulLayer<T>>(it->second)
+        ->ForwardPropagation();
+      LOG(INFO) << "DNNMark: Running BatchedMatMul forward: FINISHED";
+    }
+    if (it->second->getLayerType() == LAYER_NORM) {
+      LOG(INFO) << "DNNMark: Running LayerNorm forward: STARTED";
+      std::dynamic_pointer_cast<LayerNormLayer<T>>(it->second)
+        ->ForwardPropagation();
+      LOG(INFO) << "DNNMark: Running LayerNorm forward: FINISHED";
+    }
+    if (it->second->getLayerType() == GELU) {
+      LOG(INFO) << "DNNMark: Running GELU forward: STARTED";
+      std::dynamic_pointer_cast<GELULayer<T>>(it->second)
+        ->ForwardPropagation();
+      LOG(INFO) << "DNNMark: Running GELU forward: FINISHED";
+    }
+    if (it->second->getLayerType() == ATTENTION) {
+      LOG(INFO) << "DNNMark: Running Attention forward: STARTED";
+      std::dynamic_pointer_cast<AttentionLayer<T>>(it->second)
+        ->ForwardPropagation();
+      LOG(INFO) << "DNNMark: Running Attention forward: FINISHED";
+    }
   }
   return 0;
 }
 
 template <typename T>
 int DNNMark<T>::Backward() {
+  if (!isTraining()) {
+    LOG(WARNING) << "DNNMark: No backward pass in inference mode";
+    return 0;
+  }
   for (auto it = layers_map_.rbegin(); it != layers_map_.rend(); it++) {
     if (it->second->getLayerType() == CONVOLUTION) {
       LOG(INFO) << "DNNMark: Running convolution backward: STARTED";
@@ -751,10 +1482,52 @@ int DNNMark<T>::Backward() {
         ->BackwardPropagation();
       LOG(INFO) << "DNNMark: Running Bypass backward: FINISHED";
     }
+    if (it->second->getLayerType() == LSTM ||
+        it->second->getLayerType() == GRU) {
+      LOG(INFO) << "DNNMark: Running Recurrent backward: STARTED";
+      std::dynamic_pointer_cast<RNNLayer<T>>(it->second)
+        ->BackwardPropagation();
+      LOG(INFO) << "DNNMark: Running Recurrent backward: FINISHED";
+    }
+    if (it->second->getLayerType() == BATCHED_MATMUL) {
+      LOG(INFO) << "DNNMark: Running BatchedMatMul backward: STARTED";
+      std::dynamic_pointer_cast<BatchedMatMulLayer<T>>(it->second)
+        ->BackwardPropagation();
+      LOG(INFO) << "DNNMark: Running BatchedMatMul backward: FINISHED";
+    }
+    if (it->second->getLayerType() == LAYER_NORM) {
+      LOG(INFO) << "DNNMark: Running LayerNorm backward: STARTED";
+      std::dynamic_pointer_cast<LayerNormLayer<T>>(it->second)
+        ->BackwardPropagation();
+      LOG(INFO) << "DNNMark: Running LayerNorm backward: FINISHED";
+    }
+    if (it->second->getLayerType() == GELU) {
+      LOG(INFO) << "DNNMark: Running GELU backward: STARTED";
+      std::dynamic_pointer_cast<GELULayer<T>>(it->second)
+        ->BackwardPropagation();
+      LOG(INFO) << "DNNMark: Running GELU backward: FINISHED";
+    }
+    if (it->second->getLayerType() == ATTENTION) {
+      LOG(INFO) << "DNNMark: Running Attention backward: STARTED";
+      std::dynamic_pointer_cast<AttentionLayer<T>>(it->second)
+        ->BackwardPropagation();
+      LOG(INFO) << "DNNMark: Running Attention backward: FINISHED";
+    }
+    // Weight gradients of this layer are final from here on
+    if (it->second->hasLearnableParams())
+      for (auto &hook : gradient_ready_hooks_)
+        hook(it->second.get());
   }
   return 0;
 }
 
+template <typename T>
+int DNNMark<T>::Update() {
+  if (optimizer_ == nullptr)
+    return 0;
+  LOG(INFO) << "DNNMark: Running optimizer update";
+  return optimizer_->Step();
+}
 
 // Explicit instantiation
 template class DNNMark<TestType>;
@@ -0,0 +1,345 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <iomanip>
+
+#include "dry_run.h"
+#include "fusion.h"
+#include "in_place.h"
+
+namespace dnnmark {
+
+//
+// DryRun class definition
+//
+
+template <typename T>
+DryRun<T>::DryRun(DNNMark<T> *p_dnnmark)
+: p_dnnmark_(p_dnnmark), input_bytes_(0) {}
+
+template <typename T>
+void DryRun<T>::InferShape(Layer<T> *layer) {
+  if (p_dnnmark_->getRunMode() == COMPOSED &&
+      layer->getPrevLayerName().compare("null")) {
+    CHECK(p_dnnmark_->isLayerExist(layer->getPrevLayerName()))
+      << "Unknown previous layer " << layer->getPrevLayerName()
+      << " of " << layer->getLayerName();
+    *layer->getInputDim() =
+      *p_dnnmark_->GetLayerByName(layer->getPrevLayerName())->getOutputDim();
+  }
+  DataDim *input = layer->getInputDim();
+  CHECK(input->n_ > 0 && input->c_ > 0 && input->h_ > 0 && input->w_ > 0)
+    << "Input dimension of " << layer->getLayerName() << " is not set";
+  layer->ComputeOutputDim();
+  DataDim *output = layer->getOutputDim();
+  CHECK(output->c_ > 0 && output->h_ > 0 && output->w_ > 0)
+    << "Invalid output dimension of " << layer->getLayerName();
+}
+
+template <typename T>
+typename DryRun<T>::LayerSummary DryRun<T>::Summarize(Layer<T> *layer) {
+  LayerSummary summary = {layer, 0, 0, 0, 0, 0, 0, 0};
+  DataDim *in = layer->getInputDim();
+  DataDim *out = layer->getOutputDim();
+  double n = in->n_;
+  double in_elems = n * in->c_ * in->h_ * in->w_;
+  double out_elems = n * out->c_ * out->h_ * out->w_;
+  size_t state_elems = 0;
+  // Tensors kept inside the layer from forward to backward
+  size_t reserve_elems = 0;
+
+  switch (layer->getLayerType()) {
+    case CONVOLUTION: {
+      ConvolutionParam *param =
+        dynamic_cast<ConvolutionLayer<T> *>(layer)->getConvParam();
+      size_t window = (size_t)in->c_ * param->kernel_size_h_ *
+                      param->kernel_size_w_;
+      summary.num_params = window * param->output_num_;
+      summary.fwd_flops = 2.0 * out_elems * window;
+      summary.bwd_data_flops = summary.fwd_flops;
+      summary.bwd_filter_flops = summary.fwd_flops;
+      summary.workspace_bytes =
+        3 * window * out->h_ * out->w_ * sizeof(T);
+      break;
+    }
+    case FC: {
+      size_t fan_in = (size_t)in->c_ * in->h_ * in->w_;
+      summary.num_params = fan_in * out->c_;
+      summary.fwd_flops = 2.0 * n * fan_in * out->c_;
+      summary.bwd_data_flops = summary.fwd_flops;
+      summary.bwd_filter_flops = summary.fwd_flops;
+      break;
+    }
+    case POOLING: {
+      PoolingParam *param =
+        dynamic_cast<PoolingLayer<T> *>(layer)->getPoolParam();
+      double window = param->kernel_size_h_ * param->kernel_size_w_;
+      summary.fwd_flops = out_elems * window;
+      summary.bwd_data_flops = out_elems * window;
+      break;
+    }
+    case LRN: {
+      LRNParam *param = dynamic_cast<LRNLayer<T> *>(layer)->getLRNParam();
+      summary.fwd_flops = in_elems * (param->local_size_ + 3);
+      summary.bwd_data_flops = 2 * summary.fwd_flops;
+      break;
+    }
+    case BN: {
+      BatchNormParam *param =
+        dynamic_cast<BatchNormLayer<T> *>(layer)->getBatchNormParam();
+      size_t specifics = param->mode_ == CUDNN_BATCHNORM_PER_ACTIVATION ?
+                         (size_t)in->c_ * in->h_ * in->w_ : in->c_;
+      // Scale and bias are learnable, running and saved statistics not
+      summary.num_params = 2 * specifics;
+      state_elems = (p_dnnmark_->isTraining() ? 4 : 2) * specifics;
+      // Mean, variance, normalization and affine transform
+      summary.fwd_flops = 5 * in_elems;
+      summary.bwd_data_flops = 7 * in_elems;
+      summary.bwd_filter_flops = 2 * in_elems;
+      break;
+    }
+    case SOFTMAX:
+      // Exponent, sum and division
+      summary.fwd_flops = 3 * in_elems;
+      summary.bwd_data_flops = 3 * in_elems;
+      break;
+    case LSTM:
+    case GRU: {
+      RNNParam *param = dynamic_cast<RNNLayer<T> *>(layer)->getRNNParam();
+      bool lstm = layer->getLayerType() == LSTM;
+      double steps = out->c_;
+      double hidden = param->hidden_size_;
+      double gates = (lstm ? 4 : 3) * hidden;
+      int dirs = param->bidirectional_ ? 2 : 1;
+      for (int l = 0; l < param->num_layers_; l++) {
+        double layer_input = l == 0 ? in_elems / n / steps : dirs * hidden;
+        summary.num_params += dirs * (size_t)(gates * (layer_input + hidden) +
+                                              (lstm ? 1 : 2) * gates);
+        // Input projection of all steps, recurrent one after the first
+        summary.fwd_flops += dirs * 2.0 * n * gates *
+                             (steps * layer_input + (steps - 1) * hidden);
+      }
+      summary.bwd_data_flops = summary.fwd_flops;
+      summary.bwd_filter_flops = summary.fwd_flops;
+      // Gate activations and cell states of every step, outputs of the
+      // inner layers and their gradients
+      reserve_elems = n * steps * param->num_layers_ * dirs *
+                      (gates + hidden) +
+                      (p_dnnmark_->isTraining() ? 2 : 1) *
+                      n * steps * (param->num_layers_ - 1) * dirs * hidden;
+      break;
+    }
+    case BATCHED_MATMUL: {
+      BatchedMatMulParam *param =
+        dynamic_cast<BatchedMatMulLayer<T> *>(layer)->getBatchedMatMulParam();
+      size_t operand = in_elems / n / out->c_ / param->num_heads_ *
+                       param->output_cols_;
+      summary.fwd_flops = 2.0 * out_elems * operand / param->output_cols_;
+      summary.bwd_data_flops = summary.fwd_flops;
+      summary.bwd_filter_flops = summary.fwd_flops;
+      // Per-sample operands are inputs, with their gradients
+      if (param->shared_)
+        summary.num_params = param->num_heads_ * operand;
+      else
+        reserve_elems = (p_dnnmark_->isTraining() ? 2 : 1) *
+                        n * param->num_heads_ * operand;
+      break;
+    }
+    case LAYER_NORM: {
+      double tokens = n * in->c_;
+      LayerNormParam *param =
+        dynamic_cast<LayerNormLayer<T> *>(layer)->getLayerNormParam();
+      if (param->seq_len_ > 0)
+        tokens = n * param->seq_len_;
+      summary.num_params = 2 * (size_t)(in_elems / tokens);
+      // Mean, variance, normalization and affine transform as batch norm
+      summary.fwd_flops = 5 * in_elems;
+      summary.bwd_data_flops = 7 * in_elems;
+      summary.bwd_filter_flops = 2 * in_elems;
+      // Mean and reciprocal standard deviation of every token
+      reserve_elems = 2 * tokens;
+      // Gamma and beta gradient partials of every chunk of tokens
+      if (p_dnnmark_->isTraining())
+        summary.workspace_bytes = summary.num_params * sizeof(T) *
+          (size_t)std::ceil(tokens / kLayerNormRowChunk);
+      break;
+    }
+    case GELU:
+      // The tanh approximation, counting tanh as one
+      summary.fwd_flops = 8 * in_elems;
+      summary.bwd_data_flops = 14 * in_elems;
+      break;
+    case ATTENTION: {
+      AttentionParam *param =
+        dynamic_cast<AttentionLayer<T> *>(layer)->getAttentionParam();
+      double seq_len = param->seq_len_ > 0 ? param->seq_len_ : in->c_;
+      double tokens = n * seq_len;
+      double width = in_elems / tokens;
+      // Causal queries see half of the keys on average
+      double scores = (param->causal_ ? 0.5 : 1.0) * n * seq_len * seq_len *
+                      width;
+      summary.num_params = 4 * (size_t)(width * width);
+      // Projections, then scores and weighted values
+      summary.fwd_flops = 8.0 * tokens * width * width + 4.0 * scores;
+      // Backward recomputes the scores once per pass over keys and queries
+      summary.bwd_data_flops = 8.0 * tokens * width * width + 14.0 * scores;
+      summary.bwd_filter_flops = 8.0 * tokens * width * width;
+      // Projections, attention output and log-sum-exp per query and head,
+      // their gradients when training
+      reserve_elems = (p_dnnmark_->isTraining() ? 2 : 1) *
+                      tokens * (4 * width + param->num_heads_);
+      break;
+    }
+    case ACTIVATION:
+    case DROPOUT:
+      summary.fwd_flops = in_elems;
+      summary.bwd_data_flops = in_elems;
+      break;
+    default:
+      break;
+  }
+
+  size_t top_bytes = (size_t)out_elems * sizeof(T);
+  if (!p_dnnmark_->isTraining()) {
+    // Only the forward pass and its workspace remain
+    summary.bwd_data_flops = 0;
+    summary.bwd_filter_flops = 0;
+    summary.workspace_bytes /= 3;
+    summary.param_bytes = (summary.num_params + state_elems) * sizeof(T);
+    summary.activation_bytes = layer->isInPlace() ? 0 : top_bytes;
+    summary.activation_bytes += reserve_elems * sizeof(T);
+    return summary;
+  }
+  summary.param_bytes = (2 * summary.num_params + state_elems) * sizeof(T);
+  if (!layer->isInPlace())
+    summary.activation_bytes = 2 * top_bytes;
+  else if (layer->getLayerType() == BN)
+    // Batch normalization keeps a separate top diff when in place
+    summary.activation_bytes = top_bytes;
+  summary.activation_bytes += reserve_elems * sizeof(T);
+  return summary;
+}
+
+template <typename T>
+std::string DryRun<T>::TypeName(LayerType type) {
+  for (auto &entry : layer_type_map)
+    if (entry.second == type)
+      return entry.first.substr(1, entry.first.size() - 2);
+  return "Unknown";
+}
+
+template <typename T>
+int DryRun<T>::Run() {
+  // The planning passes only set flags on the parsed layers
+  if (p_dnnmark_->getRunMode() == COMPOSED) {
+    if (p_dnnmark_->isFusionEnabled())
+      Fusion<T>(p_dnnmark_).Plan();
+    if (p_dnnmark_->isInPlaceEnabled())
+      InPlace<T>(p_dnnmark_).Plan();
+  }
+
+  summaries_.clear();
+  input_bytes_ = 0;
+  for (int i = 0; i < p_dnnmark_->getNumLayers(); i++) {
+    Layer<T> *layer = p_dnnmark_->GetLayerByID(i);
+    InferShape(layer);
+    summaries_.push_back(Summarize(layer));
+    if (p_dnnmark_->getRunMode() == STANDALONE ||
+        !layer->getPrevLayerName().compare("null")) {
+      DataDim *in = layer->getInputDim();
+      input_bytes_ += (p_dnnmark_->isTraining() ? 2 : 1) *
+                      (size_t)in->n_ * in->c_ * in->h_ * in->w_ * sizeof(T);
+    }
+  }
+  return 0;
+}
+
+template <typename T>
+size_t DryRun<T>::getPeakBytes() {
+  size_t bytes = input_bytes_;
+  for (auto &summary : summaries_)
+    bytes += summary.param_bytes + summary.activation_bytes +
+             summary.workspace_bytes;
+  return bytes;
+}
+
+template <typename T>
+void DryRun<T>::Report() {
+  const double MB = 1024.0 * 1024.0;
+  const double GFLOP = 1e9;
+  size_t num_params = 0, param_bytes = 0;
+  size_t activation_bytes = 0, workspace_bytes = 0;
+  double fwd_flops = 0, bwd_flops = 0;
+
+  std::cout << "[DryRun] " << std::left
+            << std::setw(16) << "layer" << std::setw(16) << "type"
+            << std::setw(24) << "output (NxCxHxW)" << std::right
+            << std::setw(12) << "params"
+            << std::setw(10) << "fwd GF" << std::setw(10) << "bwd-d GF"
+            << std::setw(10) << "bwd-f GF"
+            << std::setw(12) << "act MB" << std::setw(12) << "ws MB"
+            << std::endl;
+  for (auto &summary : summaries_) {
+    Layer<T> *layer = summary.layer;
+    DataDim *out = layer->getOutputDim();
+    std::string shape = std::to_string(out->n_) + "x" +
+                        std::to_string(out->c_) + "x" +
+                        std::to_string(out->h_) + "x" +
+                        std::to_string(out->w_);
+    std::cout << std::fixed << std::setprecision(2)
+              << "[DryRun] " << std::left
+              << std::setw(16) << layer->getLayerName()
+              << std::setw(16) << TypeName(layer->getLayerType())
+              << std::setw(24) << shape << std::right
+              << std::setw(12) << summary.num_params
+              << std::setw(10) << summary.fwd_flops / GFLOP
+              << std::setw(10) << summary.bwd_data_flops / GFLOP
+              << std::setw(10) << summary.bwd_filter_flops / GFLOP
+              << std::setw(12) << summary.activation_bytes / MB
+              << std::setw(12) << summary.workspace_bytes / MB
+              << std::defaultfloat << std::endl;
+    num_params += summary.num_params;
+    param_bytes += summary.param_bytes;
+    activation_bytes += summary.activation_bytes;
+    workspace_bytes += summary.workspace_bytes;
+    fwd_flops += summary.fwd_flops;
+    bwd_flops += summary.bwd_data_flops + summary.bwd_filter_flops;
+  }
+  std::cout << std::fixed << std::setprecision(2)
+            << "[DryRun] Total: " << summaries_.size() << " layers "
+            << num_params << " params"
+            << " forward: " << fwd_flops / GFLOP << " GFLOP"
+            << " backward: " << bwd_flops / GFLOP << " GFLOP"
+            << std::defaultfloat << std::endl;
+  std::cout << std::fixed << std::setprecision(2)
+            << "[DryRun] Memory: params " << param_bytes / MB << " MB"
+            << " activations " << (activation_bytes + input_bytes_) / MB
+            << " MB workspace " << workspace_bytes / MB << " MB"
+            << " peak " << getPeakBytes() / MB << " MB"
+            << std::defaultfloat << std::endl;
+}
+
+// Explicit instantiation
+template class DryRun<TestType>;
+
+} // namespace dnnmark
@@ -0,0 +1,201 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <iomanip>
+
+#include "fusion.h"
+
+namespace dnnmark {
+
+//
+// Fusion class definition
+//
+
+template <typename T>
+Fusion<T>::Fusion(DNNMark<T> *p_dnnmark)
+: p_dnnmark_(p_dnnmark), applied_(false) {
+  CHECK_EQ(p_dnnmark_->getRunMode(), COMPOSED)
+    << "Fusion requires composed mode";
+}
+
+template <typename T>
+bool Fusion<T>::isReLU(Layer<T> *layer) {
+  if (layer == nullptr || layer->getLayerType() != ACTIVATION)
+    return false;
+  return dynamic_cast<ActivationLayer<T> *>(layer)
+           ->getActivationParam()->mode_ == CUDNN_ACTIVATION_RELU;
+}
+
+template <typename T>
+bool Fusion<T>::isFoldable(Layer<T> *layer) {
+  // Only fixed per-channel statistics turn into a per-filter scale
+  if (layer == nullptr || layer->getLayerType() != BN)
+    return false;
+  BatchNormLayer<T> *bn_layer = dynamic_cast<BatchNormLayer<T> *>(layer);
+  return bn_layer->usesGlobalStats() &&
+         bn_layer->getBatchNormParam()->mode_ == CUDNN_BATCHNORM_SPATIAL;
+}
+
+template <typename T>
+int Fusion<T>::Plan() {
+  groups_.clear();
+  for (int i = 0; i < p_dnnmark_->getNumLayers(); i++) {
+    Layer<T> *layer = p_dnnmark_->GetLayerByID(i);
+    if (layer->isAbsorbed())
+      continue;
+    Group group;
+    group.layers.push_back(layer);
+    group.bytes_saved = 0;
+    group.time_before = 0;
+    group.time_after = 0;
+    Layer<T> *next = p_dnnmark_->GetSoleConsumer(layer);
+    if (layer->getLayerType() == CONVOLUTION) {
+      group.pattern = "conv";
+      if (isFoldable(next)) {
+        group.pattern += "+bn";
+        group.layers.push_back(next);
+        next = p_dnnmark_->GetSoleConsumer(next);
+      }
+      if (isReLU(next)) {
+        group.pattern += "+relu";
+        group.layers.push_back(next);
+      }
+    } else if (layer->getLayerType() == BN &&
+               dynamic_cast<BatchNormLayer<T> *>(layer)
+                 ->usesGlobalStats() &&
+               isReLU(next)) {
+      group.pattern = "bn+relu";
+      group.layers.push_back(next);
+    }
+    if (group.layers.size() == 1)
+      continue;
+    for (int j = 1; j < group.layers.size(); j++) {
+      group.layers[j]->setInPlace(true);
+      group.layers[j]->setAbsorbed(true);
+    }
+    groups_.push_back(group);
+    LOG(INFO) << "Fusion: planned " << group.pattern << " at "
+              << layer->getLayerName();
+  }
+  return 0;
+}
+
+template <typename T>
+float Fusion<T>::TimeForward(const std::vector<Layer<T> *> &layers) {
+  Timer timer;
+  for (int iter = 0; iter < 2; iter++) {
+    timer.Start();
+    for (auto layer : layers)
+      layer->ForwardPropagation();
+    timer.Stop();
+  }
+  return timer.Elapsed();
+}
+
+template <typename T>
+int Fusion<T>::Apply() {
+  bool data_fill_enabled = p_dnnmark_->isDataFillEnabled();
+  p_dnnmark_->setDataFillEnabled(false);
+  for (auto &group : groups_) {
+    // Every absorbed layer saves writing and reading back one
+    // intermediate top of the size of the producer's top
+    Layer<T> *producer = group.layers[0];
+    DataDim *dim = producer->getOutputDim();
+    size_t top_bytes = (size_t)dim->n_ * dim->c_ * dim->h_ * dim->w_ *
+                       sizeof(T);
+    group.bytes_saved = 2 * top_bytes * (group.layers.size() - 1);
+
+    // Unfused, the absorbed layers run in place one after the other
+    for (int j = 1; j < group.layers.size(); j++)
+      group.layers[j]->setAbsorbed(false);
+    group.time_before = TimeForward(group.layers);
+    for (int j = 1; j < group.layers.size(); j++)
+      group.layers[j]->setAbsorbed(true);
+
+    Fuse(group);
+    group.time_after = TimeForward(group.layers);
+  }
+  p_dnnmark_->setDataFillEnabled(data_fill_enabled);
+  applied_ = true;
+  return 0;
+}
+
+template <typename T>
+void Fusion<T>::Fuse(const Group &group) {
+  Layer<T> *producer = group.layers[0];
+  if (producer->getLayerType() == CONVOLUTION) {
+    std::vector<T> scale, shift;
+    bool folded = group.layers[1]->getLayerType() == BN;
+    if (folded)
+      dynamic_cast<BatchNormLayer<T> *>(group.layers[1])
+        ->GetAffineFactors(&scale, &shift);
+    dynamic_cast<ConvolutionLayer<T> *>(producer)->FuseEpilogue(
+      folded ? &scale : nullptr, folded ? &shift : nullptr,
+      isReLU(group.layers.back()));
+  } else {
+    dynamic_cast<BatchNormLayer<T> *>(producer)->FuseActivation();
+  }
+}
+
+template <typename T>
+int Fusion<T>::Refold() {
+  // Before Apply, the parameters are folded when Apply runs
+  if (!applied_)
+    return 0;
+  for (auto &group : groups_)
+    Fuse(group);
+  return 0;
+}
+
+template <typename T>
+void Fusion<T>::Report() {
+  const double MB = 1024.0 * 1024.0;
+  size_t total_bytes = 0;
+  float total_before = 0, total_after = 0;
+  for (auto &group : groups_) {
+    std::string layers = group.layers[0]->getLayerName();
+    for (int j = 1; j < group.layers.size(); j++)
+      layers += "," + group.layers[j]->getLayerName();
+    std::cout << std::fixed << std::setprecision(2)
+              << "[Fusion] " << group.pattern << " (" << layers << ")"
+              << " bytes saved: " << group.bytes_saved / MB << " MB"
+              << std::setprecision(3)
+              << " forward: " << group.time_before << " ms -> "
+              << group.time_after << " ms"
+              << std::defaultfloat << std::endl;
+    total_bytes += group.bytes_saved;
+    total_before += group.time_before;
+    total_after += group.time_after;
+  }
+  std::cout << std::fixed << std::setprecision(2)
+            << "[Fusion] Total: " << getNumFusions() << " fusions"
+            << " bytes saved: " << total_bytes / MB << " MB"
+            << std::setprecision(3)
+            << " time saved: " << total_before - total_after << " ms"
+            << std::defaultfloat << std::endl;
+}
+
+// Explicit instantiation
+template class Fusion<TestType>;
+
+} // namespace dnnmark
+
@@ -67,5 +67,62 @@ void DNNMarkGEMM(cublasHandle_t handle,
                           c, ldc));
 }
 
-} // namespace dnnmark
+template <>
+void DNNMarkBatchedGEMM(cublasHandle_t handle,
+                        bool is_a_transpose, bool is_b_transpose,
+                        int m, int n, int k,
+                        float *alpha,
+                        float *a, int lda, long long stride_a,
+                        float *b, int ldb, long long stride_b,
+                        float *beta,
+                        float *c, int ldc, long long stride_c,
+                        int batch_count) {
+  cublasOperation_t transa = is_a_transpose ? CUBLAS_OP_T : CUBLAS_OP_N;
+  cublasOperation_t transb = is_b_transpose ? CUBLAS_OP_T : CUBLAS_OP_N;
+  CUBLAS_CALL(cublasSgemmStridedBatched(handle,
+                                        transa, transb,
+                                        m, n, k,
+                                        alpha,
+                                        a, lda, stride_a,
+                                        b, ldb, stride_b,
+                                        beta,
+                                        c, ldc, stride_c,
+                                        batch_count));
+}
 
+template <>
+void DNNMarkBatchedGEMM(cublasHandle_t handle,
+                        bool is_a_transpose, bool is_b_transpose,
+                        int m, int n, int k,
+                        double *alpha,
+                        double *a, int lda, long long stride_a,
+                        double *b, int ldb, long long stride_b,
+                        double *beta,
+                        double *c, int ldc, long long stride_c,
+                        int batch_count) {
+  cublasOperation_t transa = is_a_transpose ? CUBLAS_OP_T : CUBLAS_OP_N;
+  cublasOperation_t transb = is_b_transpose ? CUBLAS_OP_T : CUBLAS_OP_N;
+  CUBLAS_CALL(cublasDgemmStridedBatched(handle,
+                                        transa, transb,
+                                        m, n, k,
+                                        alpha,
+                                        a, lda, stride_a,
+                                        b, ldb, stride_b,
+                                        beta,
+                                        c, ldc, stride_c,
+                                        batch_count));
+}
+
+template <>
+void DNNMarkAXPY(cublasHandle_t handle, int n,
+                 float *alpha, float *x, float *y) {
+  CUBLAS_CALL(cublasSaxpy(handle, n, alpha, x, 1, y, 1));
+}
+
+template <>
+void DNNMarkAXPY(cublasHandle_t handle, int n,
+                 double *alpha, double *x, double *y) {
+  CUBLAS_CALL(cublasDaxpy(handle, n, alpha, x, 1, y, 1));
+}
+
+} // namespace dnnmark
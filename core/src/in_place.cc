@@ -0,0 +1,142 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <iomanip>
+
+#include "in_place.h"
+
+namespace dnnmark {
+
+//
+// InPlace class definition
+//
+
+template <typename T>
+InPlace<T>::InPlace(DNNMark<T> *p_dnnmark)
+: p_dnnmark_(p_dnnmark) {
+  CHECK_EQ(p_dnnmark_->getRunMode(), COMPOSED)
+    << "In-place analysis requires composed mode";
+}
+
+template <typename T>
+Layer<T> *InPlace<T>::Producer(Layer<T> *layer) {
+  if (!layer->getPrevLayerName().compare("null"))
+    return nullptr;
+  return p_dnnmark_->GetLayerByName(layer->getPrevLayerName());
+}
+
+template <typename T>
+bool InPlace<T>::isCandidate(Layer<T> *layer) {
+  if (layer->isInPlace())
+    return false;
+  LayerType type = layer->getLayerType();
+  if (type != ACTIVATION && type != DROPOUT && type != BN && type != GELU)
+    return false;
+  // Batch normalization and GELU need their input for the gradient, so
+  // they only qualify once no backward pass reads the bottom
+  bool training = p_dnnmark_->isTraining();
+  if (training && layer->BackwardReadsBottom())
+    return false;
+
+  // The first layer generates its own input
+  Layer<T> *producer = Producer(layer);
+  if (producer == nullptr)
+    return false;
+  // Inference dropout is the identity and never writes
+  if (!training && type == DROPOUT)
+    return true;
+  if (p_dnnmark_->GetSoleConsumer(producer) != layer)
+    return false;
+  if (!training)
+    return true;
+
+  // Walk the layers already sharing the bottom chunk
+  for (Layer<T> *shared = producer; shared != nullptr;
+       shared = shared->isInPlace() ? Producer(shared) : nullptr) {
+    if (shared->BackwardReadsTop())
+      return false;
+    if (shared->isInPlace() && shared->BackwardReadsBottom())
+      return false;
+  }
+  return true;
+}
+
+template <typename T>
+int InPlace<T>::Plan() {
+  layers_.clear();
+  for (int i = 0; i < p_dnnmark_->getNumLayers(); i++) {
+    Layer<T> *layer = p_dnnmark_->GetLayerByID(i);
+    if (!isCandidate(layer))
+      continue;
+    layer->setInPlace(true);
+    layers_.push_back(layer);
+    LOG(INFO) << "InPlace: " << layer->getLayerName() << " overwrites "
+              << layer->getPrevLayerName();
+  }
+  return 0;
+}
+
+template <typename T>
+size_t InPlace<T>::BytesSaved(Layer<T> *layer) {
+  DataDim *dim = layer->getOutputDim();
+  size_t top_bytes = (size_t)dim->n_ * dim->c_ * dim->h_ * dim->w_ *
+                     sizeof(T);
+  bool diff_aliased = p_dnnmark_->isTraining() &&
+                      layer->getTopDiffChunkID(0) ==
+                      Producer(layer)->getTopDiffChunkID(0);
+  return diff_aliased ? 2 * top_bytes : top_bytes;
+}
+
+template <typename T>
+void InPlace<T>::Report() {
+  const double MB = 1024.0 * 1024.0;
+  size_t analysis_bytes = 0, fusion_bytes = 0;
+  int num_fused = 0;
+  for (int i = 0; i < p_dnnmark_->getNumLayers(); i++) {
+    Layer<T> *layer = p_dnnmark_->GetLayerByID(i);
+    if (!layer->isInPlace())
+      continue;
+    size_t bytes = BytesSaved(layer);
+    std::cout << std::fixed << std::setprecision(2)
+              << "[InPlace] " << layer->getLayerName()
+              << (layer->isAbsorbed() ? " (fused)" : "")
+              << " bytes saved: " << bytes / MB << " MB"
+              << std::defaultfloat << std::endl;
+    if (layer->isAbsorbed()) {
+      fusion_bytes += bytes;
+      num_fused++;
+    } else {
+      analysis_bytes += bytes;
+    }
+  }
+  std::cout << std::fixed << std::setprecision(2)
+            << "[InPlace] Total: " << getNumInPlace() + num_fused
+            << " layers bytes saved: "
+            << (analysis_bytes + fusion_bytes) / MB << " MB"
+            << " (" << fusion_bytes / MB << " MB by fusion)"
+            << std::defaultfloat << std::endl;
+}
+
+// Explicit instantiation
+template class InPlace<TestType>;
+
+} // namespace dnnmark
@@ -0,0 +1,252 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <chrono>
+#include <random>
+#include <iomanip>
+
+#include "input_pipeline.h"
+
+namespace dnnmark {
+
+namespace {
+
+// Per-channel statistics of the CIFAR-10 training set, other inputs are
+// normalized with a neutral mean and deviation
+const float kCifarMean[3] = {0.4914f, 0.4822f, 0.4465f};
+const float kCifarStd[3] = {0.2470f, 0.2435f, 0.2616f};
+
+double NowMs() {
+  return std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+//
+// InputPipeline class definition
+//
+
+template <typename T>
+InputPipeline<T>::InputPipeline(const InputParam &param, const DataDim &dim,
+                                const std::shared_ptr<CifarReader<T>> &reader)
+: param_(param), dim_(dim), reader_(reader),
+  image_size_(dim.c_ * dim.h_ * dim.w_),
+  stop_(false), next_produce_(0), next_consume_(0),
+  prepare_time_(0), wait_time_(0), first_consume_(0), last_consume_(0) {
+  CHECK_GE(param_.prefetch_slots_, 1);
+  CHECK_GE(param_.num_workers_, 1);
+  if (reader_)
+    CHECK_EQ(image_size_, CifarReader<T>::kImageSize);
+
+  slots_.resize(param_.prefetch_slots_);
+  for (int i = 0; i < param_.prefetch_slots_; i++) {
+    CUDA_CALL(cudaMallocHost(&slots_[i].host_,
+                             dim_.n_ * image_size_ * sizeof(T)));
+    CUDA_CALL(cudaEventCreateWithFlags(&slots_[i].copied_,
+                                       cudaEventDisableTiming));
+    slots_[i].state_ = FREE;
+    slots_[i].batch_ = i;
+  }
+  for (int i = 0; i < param_.num_workers_; i++)
+    workers_.push_back(std::thread(&InputPipeline<T>::Worker, this));
+}
+
+template <typename T>
+InputPipeline<T>::~InputPipeline() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  for (auto &worker : workers_)
+    worker.join();
+  for (auto &slot : slots_) {
+    CUDA_CALL(cudaEventSynchronize(slot.copied_));
+    CUDA_CALL(cudaEventDestroy(slot.copied_));
+    CUDA_CALL(cudaFreeHost(slot.host_));
+  }
+}
+
+template <typename T>
+void InputPipeline<T>::Worker() {
+  while (true) {
+    long long batch;
+    Slot *slot;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (stop_)
+        return;
+      batch = next_produce_++;
+      slot = &slots_[batch % slots_.size()];
+      cond_.wait(lock, [&] {
+        return stop_ || (slot->state_ == FREE && slot->batch_ == batch);
+      });
+      if (stop_)
+        return;
+      slot->state_ = FILLING;
+    }
+
+    // The previous batch of the slot may still be on its way to the device
+    CUDA_CALL(cudaEventSynchronize(slot->copied_));
+    double start = NowMs();
+    Prepare(batch, slot->host_);
+    double elapsed = NowMs() - start;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      slot->state_ = READY;
+      prepare_time_ += elapsed;
+    }
+    cond_.notify_all();
+  }
+}
+
+template <typename T>
+void InputPipeline<T>::Prepare(long long batch, T *dst) {
+  int channels = dim_.c_, h = dim_.h_, w = dim_.w_;
+  int plane = h * w;
+  std::vector<unsigned char> synthetic(reader_ ? 0 : image_size_);
+  for (int i = 0; i < dim_.n_; i++) {
+    long long index = batch * dim_.n_ + i;
+    const unsigned char *pixels;
+    if (reader_) {
+      // Skip the label byte
+      pixels = reader_->GetRecord(index) + 1;
+    } else {
+      unsigned long long state = index * 0x9E3779B97F4A7C15ULL + 1;
+      for (int j = 0; j < image_size_; j++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        synthetic[j] = state >> 56;
+      }
+      pixels = synthetic.data();
+    }
+
+    // Crop offset and mirror are reproducible from the image index
+    int dy = 0, dx = 0;
+    bool mirror = false;
+    if (param_.augment_) {
+      std::mt19937 rng(index);
+      std::uniform_int_distribution<int> offset(-param_.crop_pad_,
+                                                param_.crop_pad_);
+      dy = offset(rng);
+      dx = offset(rng);
+      mirror = rng() & 1;
+    }
+
+    T *image = dst + static_cast<size_t>(i) * image_size_;
+    for (int c = 0; c < channels; c++) {
+      // (p / 255 - mean) / std as one multiply-add, zero padding included
+      T mean = channels == 3 ? kCifarMean[c] : T(0.5);
+      T std = channels == 3 ? kCifarStd[c] : T(0.25);
+      T scale = T(1) / (T(255) * std);
+      T shift = -mean / std;
+      for (int y = 0; y < h; y++) {
+        T *row = image + c * plane + y * w;
+        int sy = y + dy;
+        if (sy < 0 || sy >= h) {
+          for (int x = 0; x < w; x++)
+            row[x] = shift;
+          continue;
+        }
+        const unsigned char *src = pixels + c * plane + sy * w;
+        if (!mirror && dx == 0) {
+          // Contiguous rows, the common case the compiler vectorizes
+          for (int x = 0; x < w; x++)
+            row[x] = src[x] * scale + shift;
+          continue;
+        }
+        for (int x = 0; x < w; x++) {
+          int sx = (mirror ? w - 1 - x : x) + dx;
+          row[x] = sx >= 0 && sx < w ? src[sx] * scale + shift : shift;
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+void InputPipeline<T>::Consume(T *dst, int size) {
+  CHECK_EQ(size, dim_.n_ * image_size_);
+  double start = NowMs();
+  Slot *slot;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    slot = &slots_[next_consume_ % slots_.size()];
+    cond_.wait(lock, [&] {
+      return slot->state_ == READY && slot->batch_ == next_consume_;
+    });
+  }
+  double ready = NowMs();
+
+  CUDA_CALL(cudaMemcpyAsync(dst, slot->host_, size * sizeof(T),
+                            cudaMemcpyHostToDevice, 0));
+  CUDA_CALL(cudaEventRecord(slot->copied_, 0));
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot->state_ = FREE;
+    slot->batch_ += slots_.size();
+    // Filling the pipeline before the first batch is not a step
+    if (next_consume_ == 0)
+      first_consume_ = ready;
+    else
+      wait_time_ += ready - start;
+    last_consume_ = ready;
+    next_consume_++;
+  }
+  cond_.notify_all();
+}
+
+template <typename T>
+double InputPipeline<T>::getInputBoundFraction() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  double span = last_consume_ - first_consume_;
+  return span > 0 ? wait_time_ / span : 0;
+}
+
+template <typename T>
+void InputPipeline<T>::Report() {
+  double fraction = getInputBoundFraction();
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Batches the workers finished, the ones in flight are not counted
+  long long prepared = next_consume_;
+  for (auto &slot : slots_)
+    if (slot.state_ == READY)
+      prepared++;
+  std::cout << std::fixed << std::setprecision(3)
+            << "[InputPipeline] " << next_consume_ << " batches, "
+            << slots_.size() << " slots, " << workers_.size()
+            << " workers: prepare "
+            << (prepared > 0 ? prepare_time_ / prepared : 0)
+            << " ms per batch, wait "
+            << (next_consume_ > 1 ? wait_time_ / (next_consume_ - 1) : 0)
+            << " ms per batch, input-bound " << fraction * 100
+            << "% of step time" << std::defaultfloat << std::endl;
+}
+
+// Explicit instantiation
+template class InputPipeline<TestType>;
+
+} // namespace dnnmark
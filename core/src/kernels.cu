@@ -0,0 +1,988 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+
+#include "common.h"
+#include "kernels.h"
+
+namespace dnnmark {
+
+namespace {
+
+const int kThreadsPerBlock = 256;
+const int kMaxBlocks = 4096;
+
+inline int NumBlocks(int n) {
+  return std::min((n + kThreadsPerBlock - 1) / kThreadsPerBlock, kMaxBlocks);
+}
+
+template <typename T>
+__global__ void ScaleShiftActivationKernel(int n, int channels, int inner,
+                                           const T *x, const T *scale,
+                                           const T *shift, T *y, bool relu) {
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < n;
+       i += blockDim.x * gridDim.x) {
+    int c = (i / inner) % channels;
+    T v = x[i] * scale[c] + shift[c];
+    y[i] = relu && v < 0 ? T(0) : v;
+  }
+}
+
+// Philox4x32-10 counter-based generator: four random words from a 128-bit
+// counter and a 64-bit key, so every element is computed independently
+__device__ void Philox4x32(unsigned int *ctr, unsigned int k0,
+                           unsigned int k1) {
+  for (int round = 0; round < 10; round++) {
+    unsigned int hi0 = __umulhi(0xD2511F53u, ctr[0]);
+    unsigned int lo0 = 0xD2511F53u * ctr[0];
+    unsigned int hi1 = __umulhi(0xCD9E8D57u, ctr[2]);
+    unsigned int lo1 = 0xCD9E8D57u * ctr[2];
+    unsigned int c0 = hi1 ^ ctr[1] ^ k0;
+    unsigned int c2 = hi0 ^ ctr[3] ^ k1;
+    ctr[0] = c0;
+    ctr[1] = lo1;
+    ctr[2] = c2;
+    ctr[3] = lo0;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+}
+
+// Thread t produces elements 4t to 4t + 3 of the fill from counter
+// (t, offset)
+template <typename T>
+__global__ void FillUniformKernel(int n, unsigned int k0, unsigned int k1,
+                                  unsigned int offset, T *y) {
+  int num_words = (n + 3) / 4;
+  for (int t = blockIdx.x * blockDim.x + threadIdx.x; t < num_words;
+       t += blockDim.x * gridDim.x) {
+    unsigned int ctr[4] = {static_cast<unsigned int>(t), offset, 0, 0};
+    Philox4x32(ctr, k0, k1);
+    for (int j = 0; j < 4 && 4 * t + j < n; j++)
+      // Uniform in (0, 1], as curand's uniform generators
+      y[4 * t + j] = (ctr[j] + T(1)) * T(2.3283064365386963e-10);
+  }
+}
+
+// Per-channel statistics of the CIFAR-10 training set
+__constant__ float kCifarMean[3] = {0.4914f, 0.4822f, 0.4465f};
+__constant__ float kCifarStd[3] = {0.2470f, 0.2435f, 0.2616f};
+
+template <typename T>
+__global__ void CifarToNCHWKernel(int n, const unsigned char *records,
+                                  T *y) {
+  const int kPlane = 32 * 32;
+  const int kImage = 3 * kPlane;
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < n * kImage;
+       i += blockDim.x * gridDim.x) {
+    int image = i / kImage;
+    int j = i % kImage;
+    int c = j / kPlane;
+    T pixel = records[image * (kImage + 1) + 1 + j] / T(255);
+    y[i] = (pixel - kCifarMean[c]) / kCifarStd[c];
+  }
+}
+
+// Element range of the tensor the current block works on
+template <typename T>
+__device__ int ChunkTensor(const MultiTensorList<T> &list,
+                           int *begin, int *end) {
+  int t = list.block_tensor[blockIdx.x];
+  *begin = list.block_offset[blockIdx.x];
+  *end = *begin + kMultiTensorChunk;
+  if (*end > list.sizes[t])
+    *end = list.sizes[t];
+  return t;
+}
+
+template <typename T>
+__global__ void SGDMomentumKernel(MultiTensorList<T> list,
+                                  T lr, T momentum, T weight_decay) {
+  int begin, end;
+  int t = ChunkTensor(list, &begin, &end);
+  T *w = list.params[t];
+  const T *g = list.grads[t];
+  T *v = list.state1[t];
+  for (int i = begin + threadIdx.x; i < end; i += blockDim.x) {
+    T velocity = momentum * v[i] + g[i] + weight_decay * w[i];
+    v[i] = velocity;
+    w[i] -= lr * velocity;
+  }
+}
+
+// Bias corrected Adam direction, updates the moments in place
+template <typename T>
+__device__ T AdamDirection(T g, T *m, T *v, T beta1, T beta2, T epsilon,
+                           T bias_correction1, T bias_correction2) {
+  *m = beta1 * *m + (T(1) - beta1) * g;
+  *v = beta2 * *v + (T(1) - beta2) * g * g;
+  return (*m / bias_correction1) /
+         (sqrt(*v / bias_correction2) + epsilon);
+}
+
+template <typename T>
+__global__ void AdamKernel(MultiTensorList<T> list,
+                           T lr, T beta1, T beta2, T epsilon, T weight_decay,
+                           T bias_correction1, T bias_correction2) {
+  int begin, end;
+  int t = ChunkTensor(list, &begin, &end);
+  T *w = list.params[t];
+  const T *g = list.grads[t];
+  T *m = list.state1[t];
+  T *v = list.state2[t];
+  for (int i = begin + threadIdx.x; i < end; i += blockDim.x) {
+    T update = AdamDirection(g[i], &m[i], &v[i], beta1, beta2, epsilon,
+                             bias_correction1, bias_correction2);
+    w[i] -= lr * (update + weight_decay * w[i]);
+  }
+}
+
+// Block sums are stored in partials, which LAMBNormKernel adds up
+template <typename T>
+__global__ void LAMBDirectionKernel(MultiTensorList<T> list, T *norms,
+                                    T *partials,
+                                    T beta1, T beta2, T epsilon,
+                                    T weight_decay, T bias_correction1,
+                                    T bias_correction2) {
+  __shared__ T w_sum[kThreadsPerBlock];
+  __shared__ T u_sum[kThreadsPerBlock];
+  int begin, end;
+  int t = ChunkTensor(list, &begin, &end);
+  const T *w = list.params[t];
+  T *g = list.grads[t];
+  T *m = list.state1[t];
+  T *v = list.state2[t];
+  T w_partial = 0, u_partial = 0;
+  for (int i = begin + threadIdx.x; i < end; i += blockDim.x) {
+    T update = AdamDirection(g[i], &m[i], &v[i], beta1, beta2, epsilon,
+                             bias_correction1, bias_correction2) +
+               weight_decay * w[i];
+    g[i] = update;
+    w_partial += w[i] * w[i];
+    u_partial += update * update;
+  }
+  w_sum[threadIdx.x] = w_partial;
+  u_sum[threadIdx.x] = u_partial;
+  __syncthreads();
+  for (int s = blockDim.x / 2; s > 0; s >>= 1) {
+    if (threadIdx.x < s) {
+      w_sum[threadIdx.x] += w_sum[threadIdx.x + s];
+      u_sum[threadIdx.x] += u_sum[threadIdx.x + s];
+    }
+    __syncthreads();
+  }
+  if (threadIdx.x == 0) {
+    partials[2 * blockIdx.x] = w_sum[0];
+    partials[2 * blockIdx.x + 1] = u_sum[0];
+  }
+}
+
+// The first block of every tensor sums the partials of the tensor's blocks
+// in block order, so the norms do not depend on block scheduling
+template <typename T>
+__global__ void LAMBNormKernel(MultiTensorList<T> list, const T *partials,
+                               T *norms) {
+  for (int b = blockIdx.x * blockDim.x + threadIdx.x; b < list.num_blocks;
+       b += blockDim.x * gridDim.x) {
+    int t = list.block_tensor[b];
+    if (b > 0 && list.block_tensor[b - 1] == t)
+      continue;
+    T w_norm = 0, u_norm = 0;
+    for (int i = b; i < list.num_blocks && list.block_tensor[i] == t; i++) {
+      w_norm += partials[2 * i];
+      u_norm += partials[2 * i + 1];
+    }
+    norms[2 * t] = w_norm;
+    norms[2 * t + 1] = u_norm;
+  }
+}
+
+template <typename T>
+__global__ void LAMBApplyKernel(MultiTensorList<T> list, const T *norms,
+                                T lr) {
+  int begin, end;
+  int t = ChunkTensor(list, &begin, &end);
+  T *w = list.params[t];
+  const T *update = list.grads[t];
+  T w_norm = sqrt(norms[2 * t]);
+  T u_norm = sqrt(norms[2 * t + 1]);
+  T trust_ratio = w_norm > 0 && u_norm > 0 ? w_norm / u_norm : T(1);
+  for (int i = begin + threadIdx.x; i < end; i += blockDim.x)
+    w[i] -= lr * trust_ratio * update[i];
+}
+
+template <typename T>
+__device__ T Sigmoid(T x) {
+  return T(1) / (T(1) + exp(-x));
+}
+
+// Thread i handles hidden unit i % hidden of sequence i / hidden in all
+// gates, so the gates can be updated in place
+template <typename T>
+__global__ void LSTMForwardStepKernel(RNNStep<T> step) {
+  int hidden = step.hidden;
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < step.n * hidden;
+       i += blockDim.x * gridDim.x) {
+    int s = i / hidden;
+    int j = i % hidden;
+    T *gates = step.gates + s * step.gate_stride;
+    const T *recur = step.recur ? step.recur + s * 4 * hidden : nullptr;
+    T pre[4];
+    for (int k = 0; k < 4; k++)
+      pre[k] = gates[k * hidden + j] + step.bias[k * hidden + j] +
+               (recur ? recur[k * hidden + j] : T(0));
+    T input = Sigmoid(pre[0]);
+    T forget = Sigmoid(pre[1]);
+    T cell = tanh(pre[2]);
+    T output = Sigmoid(pre[3]);
+    T c_prev = step.cell_prev ? step.cell_prev[s * step.cell_stride + j] :
+                                T(0);
+    T c = forget * c_prev + input * cell;
+    gates[j] = input;
+    gates[hidden + j] = forget;
+    gates[2 * hidden + j] = cell;
+    gates[3 * hidden + j] = output;
+    step.cell[s * step.cell_stride + j] = c;
+    step.h[s * step.hidden_stride + j] = output * tanh(c);
+  }
+}
+
+template <typename T>
+__global__ void LSTMBackwardStepKernel(RNNStep<T> step) {
+  int hidden = step.hidden;
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < step.n * hidden;
+       i += blockDim.x * gridDim.x) {
+    int s = i / hidden;
+    int j = i % hidden;
+    T *gates = step.gates + s * step.gate_stride;
+    T input = gates[j];
+    T forget = gates[hidden + j];
+    T cell = gates[2 * hidden + j];
+    T output = gates[3 * hidden + j];
+    T c = step.cell[s * step.cell_stride + j];
+    T c_prev = step.cell_prev ? step.cell_prev[s * step.cell_stride + j] :
+                                T(0);
+    T dh = step.h[s * step.hidden_stride + j] +
+           (step.carry ? step.h_diff[i] : T(0));
+    T dc = step.carry ? step.c_diff[i] : T(0);
+    T tanh_c = tanh(c);
+    dc += dh * output * (T(1) - tanh_c * tanh_c);
+    gates[j] = dc * cell * input * (T(1) - input);
+    gates[hidden + j] = dc * c_prev * forget * (T(1) - forget);
+    gates[2 * hidden + j] = dc * input * (T(1) - cell * cell);
+    gates[3 * hidden + j] = dh * tanh_c * output * (T(1) - output);
+    step.c_diff[i] = dc * forget;
+  }
+}
+
+template <typename T>
+__global__ void GRUForwardStepKernel(RNNStep<T> step) {
+  int hidden = step.hidden;
+  const T *bias_x = step.bias;
+  const T *bias_h = step.bias + 3 * hidden;
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < step.n * hidden;
+       i += blockDim.x * gridDim.x) {
+    int s = i / hidden;
+    int j = i % hidden;
+    T *gates = step.gates + s * step.gate_stride;
+    const T *recur = step.recur ? step.recur + s * 3 * hidden : nullptr;
+    T reset = Sigmoid(gates[j] + bias_x[j] + bias_h[j] +
+                      (recur ? recur[j] : T(0)));
+    T update = Sigmoid(gates[hidden + j] + bias_x[hidden + j] +
+                       bias_h[hidden + j] +
+                       (recur ? recur[hidden + j] : T(0)));
+    T recur_cand = bias_h[2 * hidden + j] +
+                   (recur ? recur[2 * hidden + j] : T(0));
+    T cand = tanh(gates[2 * hidden + j] + bias_x[2 * hidden + j] +
+                  reset * recur_cand);
+    T h_prev = step.h_prev ? step.h_prev[s * step.hidden_stride + j] : T(0);
+    gates[j] = reset;
+    gates[hidden + j] = update;
+    gates[2 * hidden + j] = cand;
+    step.cell[s * step.cell_stride + j] = recur_cand;
+    step.h[s * step.hidden_stride + j] = (T(1) - update) * cand +
+                                         update * h_prev;
+  }
+}
+
+template <typename T>
+__global__ void GRUBackwardStepKernel(RNNStep<T> step) {
+  int hidden = step.hidden;
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < step.n * hidden;
+       i += blockDim.x * gridDim.x) {
+    int s = i / hidden;
+    int j = i % hidden;
+    T *gates = step.gates + s * step.gate_stride;
+    T *recur = step.recur + s * 3 * hidden;
+    T reset = gates[j];
+    T update = gates[hidden + j];
+    T cand = gates[2 * hidden + j];
+    T recur_cand = step.cell[s * step.cell_stride + j];
+    T h_prev = step.h_prev ? step.h_prev[s * step.hidden_stride + j] : T(0);
+    T dh = step.h[s * step.hidden_stride + j] +
+           (step.carry ? step.h_diff[i] : T(0));
+    T dcand = dh * (T(1) - update) * (T(1) - cand * cand);
+    T dupdate = dh * (h_prev - cand) * update * (T(1) - update);
+    T dreset = dcand * recur_cand * reset * (T(1) - reset);
+    gates[j] = dreset;
+    gates[hidden + j] = dupdate;
+    gates[2 * hidden + j] = dcand;
+    recur[j] = dreset;
+    recur[hidden + j] = dupdate;
+    recur[2 * hidden + j] = dcand * reset;
+    step.cell[s * step.cell_stride + j] = dcand * reset;
+    // The recurrent projection adds its part after the step
+    step.h_diff[i] = dh * update;
+  }
+}
+
+template <typename T>
+__device__ T GELU(T x, bool approximate, T *derivative) {
+  if (approximate) {
+    // sqrt(2 / pi)
+    const T kAlpha = T(0.7978845608028654);
+    const T kBeta = T(0.044715);
+    T t = tanh(kAlpha * (x + kBeta * x * x * x));
+    *derivative = T(0.5) * (T(1) + t) + T(0.5) * x * (T(1) - t * t) *
+                  kAlpha * (T(1) + T(3) * kBeta * x * x);
+    return T(0.5) * x * (T(1) + t);
+  }
+  // 1 / sqrt(2) and 1 / sqrt(2 * pi)
+  const T kSqrtHalf = T(0.7071067811865476);
+  const T kInvSqrt2Pi = T(0.3989422804014327);
+  T cdf = T(0.5) * (T(1) + erf(x * kSqrtHalf));
+  *derivative = cdf + x * kInvSqrt2Pi * exp(T(-0.5) * x * x);
+  return x * cdf;
+}
+
+template <typename T>
+__global__ void GELUForwardKernel(int n, bool approximate, const T *x,
+                                  T *y) {
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < n;
+       i += blockDim.x * gridDim.x) {
+    T derivative;
+    y[i] = GELU(x[i], approximate, &derivative);
+  }
+}
+
+template <typename T>
+__global__ void GELUBackwardKernel(int n, bool approximate, const T *x,
+                                   const T *y_diff, T *x_diff) {
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < n;
+       i += blockDim.x * gridDim.x) {
+    T derivative;
+    GELU(x[i], approximate, &derivative);
+    x_diff[i] = y_diff[i] * derivative;
+  }
+}
+
+// Sum of v over the threads of a block, returned to all of them. buffer
+// holds blockDim.x elements, a power of two.
+template <typename T>
+__device__ T BlockSum(T v, T *buffer) {
+  buffer[threadIdx.x] = v;
+  __syncthreads();
+  for (int s = blockDim.x / 2; s > 0; s >>= 1) {
+    if (threadIdx.x < s)
+      buffer[threadIdx.x] += buffer[threadIdx.x + s];
+    __syncthreads();
+  }
+  T sum = buffer[0];
+  __syncthreads();
+  return sum;
+}
+
+// A block per row, the variance is taken around the mean in a second pass
+template <typename T>
+__global__ void LayerNormForwardKernel(int rows, int features, T epsilon,
+                                       const T *x, const T *gamma,
+                                       const T *beta, T *y, T *mean,
+                                       T *rstd) {
+  __shared__ T buffer[kThreadsPerBlock];
+  for (int row = blockIdx.x; row < rows; row += gridDim.x) {
+    const T *x_row = x + (size_t)row * features;
+    T *y_row = y + (size_t)row * features;
+    T sum = 0;
+    for (int f = threadIdx.x; f < features; f += blockDim.x)
+      sum += x_row[f];
+    T row_mean = BlockSum(sum, buffer) / features;
+    T squares = 0;
+    for (int f = threadIdx.x; f < features; f += blockDim.x)
+      squares += (x_row[f] - row_mean) * (x_row[f] - row_mean);
+    T row_rstd = T(1) / sqrt(BlockSum(squares, buffer) / features +
+                             epsilon);
+    for (int f = threadIdx.x; f < features; f += blockDim.x)
+      y_row[f] = (x_row[f] - row_mean) * row_rstd * gamma[f] + beta[f];
+    if (threadIdx.x == 0) {
+      mean[row] = row_mean;
+      rstd[row] = row_rstd;
+    }
+  }
+}
+
+template <typename T>
+__global__ void LayerNormBackwardKernel(int rows, int features,
+                                        const T *x, const T *y_diff,
+                                        const T *gamma, const T *mean,
+                                        const T *rstd, T *x_diff) {
+  __shared__ T buffer[kThreadsPerBlock];
+  for (int row = blockIdx.x; row < rows; row += gridDim.x) {
+    const T *x_row = x + (size_t)row * features;
+    const T *dy_row = y_diff + (size_t)row * features;
+    T *dx_row = x_diff + (size_t)row * features;
+    T row_mean = mean[row];
+    T row_rstd = rstd[row];
+    T sum = 0, dot = 0;
+    for (int f = threadIdx.x; f < features; f += blockDim.x) {
+      T g = dy_row[f] * gamma[f];
+      sum += g;
+      dot += g * (x_row[f] - row_mean) * row_rstd;
+    }
+    T g_mean = BlockSum(sum, buffer) / features;
+    T g_dot = BlockSum(dot, buffer) / features;
+    for (int f = threadIdx.x; f < features; f += blockDim.x) {
+      T normalized = (x_row[f] - row_mean) * row_rstd;
+      dx_row[f] = row_rstd * (dy_row[f] * gamma[f] - g_mean -
+                              normalized * g_dot);
+    }
+  }
+}
+
+// Block (x, y) sums the rows of chunk y for its features, a thread per
+// feature so that reads are coalesced. Gamma partials come first, then
+// those of beta.
+template <typename T>
+__global__ void LayerNormParamPartialKernel(int rows, int features,
+                                            const T *x, const T *y_diff,
+                                            const T *mean, const T *rstd,
+                                            T *partials) {
+  int num_chunks = (rows + kLayerNormRowChunk - 1) / kLayerNormRowChunk;
+  for (int chunk = blockIdx.y; chunk < num_chunks; chunk += gridDim.y) {
+    int begin = chunk * kLayerNormRowChunk;
+    int end = min(begin + kLayerNormRowChunk, rows);
+    for (int f = blockIdx.x * blockDim.x + threadIdx.x; f < features;
+         f += blockDim.x * gridDim.x) {
+      T d_gamma = 0, d_beta = 0;
+      for (int row = begin; row < end; row++) {
+        size_t i = (size_t)row * features + f;
+        d_gamma += y_diff[i] * (x[i] - mean[row]) * rstd[row];
+        d_beta += y_diff[i];
+      }
+      partials[(size_t)chunk * features + f] = d_gamma;
+      partials[(size_t)(num_chunks + chunk) * features + f] = d_beta;
+    }
+  }
+}
+
+// A thread per feature adds the partials of the chunks in order, so the
+// gradients are the same on every run
+template <typename T>
+__global__ void LayerNormParamGradKernel(int num_chunks, int features,
+                                         const T *partials, T *gamma_diff,
+                                         T *beta_diff) {
+  for (int f = blockIdx.x * blockDim.x + threadIdx.x; f < features;
+       f += blockDim.x * gridDim.x) {
+    T d_gamma = 0, d_beta = 0;
+    for (int chunk = 0; chunk < num_chunks; chunk++) {
+      d_gamma += partials[(size_t)chunk * features + f];
+      d_beta += partials[(size_t)(num_chunks + chunk) * features + f];
+    }
+    gamma_diff[f] = d_gamma;
+    beta_diff[f] = d_beta;
+  }
+}
+
+// Start of head h of token t of the sample of block row blockIdx.y
+template <typename T>
+__device__ size_t AttentionOffset(const AttentionArgs<T> &args, int t,
+                                  int stride) {
+  int sample = blockIdx.y / args.num_heads;
+  int head = blockIdx.y % args.num_heads;
+  return ((size_t)sample * args.seq_len + t) * stride +
+         head * args.head_dim;
+}
+
+// Copy tokens [begin, begin + count) of a head of two tensors to shared
+// memory, token j of a tile at j * head_dim
+template <typename T>
+__device__ void LoadAttentionTile(const AttentionArgs<T> &args,
+                                  const T *a, int a_stride,
+                                  const T *b, int b_stride,
+                                  int begin, int count,
+                                  T *a_tile, T *b_tile) {
+  int d = args.head_dim;
+  for (int i = threadIdx.x; i < count * d; i += blockDim.x) {
+    a_tile[i] = a[AttentionOffset(args, begin + i / d, a_stride) + i % d];
+    b_tile[i] = b[AttentionOffset(args, begin + i / d, b_stride) + i % d];
+  }
+}
+
+// Block (x, y) handles kAttentionRows queries of head y % num_heads of
+// sample y / num_heads, a thread per query. The running maximum m and sum
+// l of the exponentials rescale the output accumulated so far whenever a
+// tile of keys raises the maximum.
+template <typename T>
+__global__ void AttentionForwardKernel(AttentionArgs<T> args) {
+  __shared__ T k_tile[kAttentionTile * kMaxHeadDim];
+  __shared__ T v_tile[kAttentionTile * kMaxHeadDim];
+  int d = args.head_dim;
+  int row = blockIdx.x * blockDim.x + threadIdx.x;
+  bool active = row < args.seq_len;
+  T q[kMaxHeadDim];
+  T o[kMaxHeadDim];
+  if (active) {
+    const T *q_row = args.q + AttentionOffset(args, row, args.qkv_stride);
+    for (int c = 0; c < d; c++) {
+      q[c] = q_row[c] * args.scale;
+      o[c] = 0;
+    }
+  }
+  T m = -INFINITY;
+  T l = 0;
+  // Causal blocks stop at the keys of their last query
+  int kv_end = args.causal ?
+               min(args.seq_len, (int)((blockIdx.x + 1) * blockDim.x)) :
+               args.seq_len;
+  for (int begin = 0; begin < kv_end; begin += kAttentionTile) {
+    int count = min(kAttentionTile, kv_end - begin);
+    __syncthreads();
+    LoadAttentionTile(args, args.k, args.qkv_stride, args.v, args.qkv_stride,
+                      begin, count, k_tile, v_tile);
+    __syncthreads();
+    if (!active)
+      continue;
+    if (args.causal)
+      count = min(count, row - begin + 1);
+    if (count <= 0)
+      continue;
+    T s[kAttentionTile];
+    T tile_max = m;
+    for (int j = 0; j < count; j++) {
+      T score = 0;
+      for (int c = 0; c < d; c++)
+        score += q[c] * k_tile[j * d + c];
+      s[j] = score;
+      tile_max = score > tile_max ? score : tile_max;
+    }
+    T correction = exp(m - tile_max);
+    l *= correction;
+    for (int c = 0; c < d; c++)
+      o[c] *= correction;
+    for (int j = 0; j < count; j++) {
+      T p = exp(s[j] - tile_max);
+      l += p;
+      for (int c = 0; c < d; c++)
+        o[c] += p * v_tile[j * d + c];
+    }
+    m = tile_max;
+  }
+  if (!active)
+    return;
+  T *o_row = args.o + AttentionOffset(args, row, args.o_stride);
+  for (int c = 0; c < d; c++)
+    o_row[c] = o[c] / l;
+  args.lse[(size_t)blockIdx.y * args.seq_len + row] = m + log(l);
+}
+
+// delta of query i is the sum of o * o_diff over its head, i indexes
+// lse and delta
+template <typename T>
+__global__ void AttentionDeltaKernel(AttentionArgs<T> args) {
+  int d = args.head_dim;
+  int total = args.n * args.num_heads * args.seq_len;
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < total;
+       i += blockDim.x * gridDim.x) {
+    int t = i % args.seq_len;
+    int head = (i / args.seq_len) % args.num_heads;
+    int sample = i / args.seq_len / args.num_heads;
+    size_t offset = ((size_t)sample * args.seq_len + t) * args.o_stride +
+                    head * d;
+    T sum = 0;
+    for (int c = 0; c < d; c++)
+      sum += args.o[offset + c] * args.o_diff[offset + c];
+    args.delta[i] = sum;
+  }
+}
+
+// A thread per key accumulates the key and value gradients over tiles of
+// queries, from the probabilities p = exp(s - lse)
+template <typename T>
+__global__ void AttentionBackwardKVKernel(AttentionArgs<T> args) {
+  __shared__ T q_tile[kAttentionTile * kMaxHeadDim];
+  __shared__ T do_tile[kAttentionTile * kMaxHeadDim];
+  int d = args.head_dim;
+  int row = blockIdx.x * blockDim.x + threadIdx.x;
+  bool active = row < args.seq_len;
+  size_t kv_offset = active ?
+                     AttentionOffset(args, row, args.qkv_stride) : 0;
+  T k[kMaxHeadDim];
+  T v[kMaxHeadDim];
+  T dk[kMaxHeadDim];
+  T dv[kMaxHeadDim];
+  if (active) {
+    for (int c = 0; c < d; c++) {
+      k[c] = args.k[kv_offset + c];
+      v[c] = args.v[kv_offset + c];
+      dk[c] = 0;
+      dv[c] = 0;
+    }
+  }
+  const T *lse = args.lse + (size_t)blockIdx.y * args.seq_len;
+  const T *delta = args.delta + (size_t)blockIdx.y * args.seq_len;
+  // Causal keys are only seen by later queries
+  int q_begin = args.causal ? blockIdx.x * blockDim.x : 0;
+  for (int begin = q_begin; begin < args.seq_len; begin += kAttentionTile) {
+    int count = min(kAttentionTile, args.seq_len - begin);
+    __syncthreads();
+    LoadAttentionTile(args, args.q, args.qkv_stride, args.o_diff, args.o_stride,
+                      begin, count, q_tile, do_tile);
+    __syncthreads();
+    if (!active)
+      continue;
+    for (int i = 0; i < count; i++) {
+      if (args.causal && begin + i < row)
+        continue;
+      T score = 0, dp = 0;
+      for (int c = 0; c < d; c++) {
+        score += q_tile[i * d + c] * k[c];
+        dp += do_tile[i * d + c] * v[c];
+      }
+      T p = exp(score * args.scale - lse[begin + i]);
+      T ds = p * (dp - delta[begin + i]) * args.scale;
+      for (int c = 0; c < d; c++) {
+        dv[c] += p * do_tile[i * d + c];
+        dk[c] += ds * q_tile[i * d + c];
+      }
+    }
+  }
+  if (!active)
+    return;
+  for (int c = 0; c < d; c++) {
+    args.k_diff[kv_offset + c] = dk[c];
+    args.v_diff[kv_offset + c] = dv[c];
+  }
+}
+
+// A thread per query accumulates its gradient over tiles of keys
+template <typename T>
+__global__ void AttentionBackwardQKernel(AttentionArgs<T> args) {
+  __shared__ T k_tile[kAttentionTile * kMaxHeadDim];
+  __shared__ T v_tile[kAttentionTile * kMaxHeadDim];
+  int d = args.head_dim;
+  int row = blockIdx.x * blockDim.x + threadIdx.x;
+  bool active = row < args.seq_len;
+  size_t q_offset = active ? AttentionOffset(args, row, args.qkv_stride) : 0;
+  size_t o_offset = active ? AttentionOffset(args, row, args.o_stride) : 0;
+  T q[kMaxHeadDim];
+  T d_o[kMaxHeadDim];
+  T dq[kMaxHeadDim];
+  T lse = 0, delta = 0;
+  if (active) {
+    for (int c = 0; c < d; c++) {
+      q[c] = args.q[q_offset + c];
+      d_o[c] = args.o_diff[o_offset + c];
+      dq[c] = 0;
+    }
+    lse = args.lse[(size_t)blockIdx.y * args.seq_len + row];
+    delta = args.delta[(size_t)blockIdx.y * args.seq_len + row];
+  }
+  int kv_end = args.causal ?
+               min(args.seq_len, (int)((blockIdx.x + 1) * blockDim.x)) :
+               args.seq_len;
+  for (int begin = 0; begin < kv_end; begin += kAttentionTile) {
+    int count = min(kAttentionTile, kv_end - begin);
+    __syncthreads();
+    LoadAttentionTile(args, args.k, args.qkv_stride, args.v, args.qkv_stride,
+                      begin, count, k_tile, v_tile);
+    __syncthreads();
+    if (!active)
+      continue;
+    if (args.causal)
+      count = min(count, row - begin + 1);
+    for (int j = 0; j < count; j++) {
+      T score = 0, dp = 0;
+      for (int c = 0; c < d; c++) {
+        score += q[c] * k_tile[j * d + c];
+        dp += d_o[c] * v_tile[j * d + c];
+      }
+      T p = exp(score * args.scale - lse);
+      T ds = p * (dp - delta) * args.scale;
+      for (int c = 0; c < d; c++)
+        dq[c] += ds * k_tile[j * d + c];
+    }
+  }
+  if (!active)
+    return;
+  for (int c = 0; c < d; c++)
+    args.q_diff[q_offset + c] = dq[c];
+}
+
+} // namespace
+
+template <typename T>
+void DNNMarkScaleShiftActivation(cudaStream_t stream, int n,
+                                 int channels, int inner,
+                                 const T *x, const T *scale, const T *shift,
+                                 T *y, bool relu) {
+  ScaleShiftActivationKernel<T><<<NumBlocks(n), kThreadsPerBlock, 0, stream>>>(
+    n, channels, inner, x, scale, shift, y, relu);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkFillUniform(cudaStream_t stream, int n,
+                        unsigned long long seed, unsigned int fill, T *y) {
+  int num_blocks = NumBlocks((n + 3) / 4);
+  FillUniformKernel<T><<<num_blocks, kThreadsPerBlock, 0, stream>>>(
+    n, seed & 0xFFFFFFFFu, seed >> 32, fill, y);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkCifarToNCHW(cudaStream_t stream, int n,
+                        const unsigned char *records, T *y) {
+  int num_blocks = NumBlocks(n * 3 * 32 * 32);
+  CifarToNCHWKernel<T><<<num_blocks, kThreadsPerBlock, 0, stream>>>(
+    n, records, y);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkSGDMomentumUpdate(cudaStream_t stream,
+                              const MultiTensorList<T> &list,
+                              T lr, T momentum, T weight_decay) {
+  SGDMomentumKernel<T><<<list.num_blocks, kThreadsPerBlock, 0, stream>>>(
+    list, lr, momentum, weight_decay);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkAdamUpdate(cudaStream_t stream, const MultiTensorList<T> &list,
+                       T lr, T beta1, T beta2, T epsilon, T weight_decay,
+                       T bias_correction1, T bias_correction2) {
+  AdamKernel<T><<<list.num_blocks, kThreadsPerBlock, 0, stream>>>(
+    list, lr, beta1, beta2, epsilon, weight_decay,
+    bias_correction1, bias_correction2);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkLAMBUpdate(cudaStream_t stream, const MultiTensorList<T> &list,
+                       T *norms, T *partials, T lr, T beta1, T beta2,
+                       T epsilon, T weight_decay, T bias_correction1,
+                       T bias_correction2) {
+  LAMBDirectionKernel<T><<<list.num_blocks, kThreadsPerBlock, 0, stream>>>(
+    list, norms, partials, beta1, beta2, epsilon, weight_decay,
+    bias_correction1, bias_correction2);
+  CUDA_CALL(cudaGetLastError());
+  int num_blocks = NumBlocks(list.num_blocks);
+  LAMBNormKernel<T><<<num_blocks, kThreadsPerBlock, 0, stream>>>(
+    list, partials, norms);
+  CUDA_CALL(cudaGetLastError());
+  LAMBApplyKernel<T><<<list.num_blocks, kThreadsPerBlock, 0, stream>>>(
+    list, norms, lr);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkLSTMForwardStep(cudaStream_t stream, const RNNStep<T> &step) {
+  int num_blocks = NumBlocks(step.n * step.hidden);
+  LSTMForwardStepKernel<T><<<num_blocks, kThreadsPerBlock, 0, stream>>>(step);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkLSTMBackwardStep(cudaStream_t stream, const RNNStep<T> &step) {
+  int num_blocks = NumBlocks(step.n * step.hidden);
+  LSTMBackwardStepKernel<T><<<num_blocks, kThreadsPerBlock, 0, stream>>>(
+    step);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkGRUForwardStep(cudaStream_t stream, const RNNStep<T> &step) {
+  int num_blocks = NumBlocks(step.n * step.hidden);
+  GRUForwardStepKernel<T><<<num_blocks, kThreadsPerBlock, 0, stream>>>(step);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkGRUBackwardStep(cudaStream_t stream, const RNNStep<T> &step) {
+  int num_blocks = NumBlocks(step.n * step.hidden);
+  GRUBackwardStepKernel<T><<<num_blocks, kThreadsPerBlock, 0, stream>>>(step);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkGELUForward(cudaStream_t stream, int n, bool approximate,
+                        const T *x, T *y) {
+  GELUForwardKernel<T><<<NumBlocks(n), kThreadsPerBlock, 0, stream>>>(
+    n, approximate, x, y);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkGELUBackward(cudaStream_t stream, int n, bool approximate,
+                         const T *x, const T *y_diff, T *x_diff) {
+  GELUBackwardKernel<T><<<NumBlocks(n), kThreadsPerBlock, 0, stream>>>(
+    n, approximate, x, y_diff, x_diff);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkLayerNormForward(cudaStream_t stream, int rows, int features,
+                             T epsilon, const T *x, const T *gamma,
+                             const T *beta, T *y, T *mean, T *rstd) {
+  int num_blocks = std::min(rows, kMaxBlocks);
+  LayerNormForwardKernel<T><<<num_blocks, kThreadsPerBlock, 0, stream>>>(
+    rows, features, epsilon, x, gamma, beta, y, mean, rstd);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkLayerNormBackward(cudaStream_t stream, int rows, int features,
+                              const T *x, const T *y_diff, const T *gamma,
+                              const T *mean, const T *rstd, T *x_diff,
+                              T *gamma_diff, T *beta_diff, T *partials) {
+  int num_blocks = std::min(rows, kMaxBlocks);
+  LayerNormBackwardKernel<T><<<num_blocks, kThreadsPerBlock, 0, stream>>>(
+    rows, features, x, y_diff, gamma, mean, rstd, x_diff);
+  CUDA_CALL(cudaGetLastError());
+  int num_chunks = (rows + kLayerNormRowChunk - 1) / kLayerNormRowChunk;
+  dim3 grid(NumBlocks(features), std::min(num_chunks, 65535));
+  LayerNormParamPartialKernel<T><<<grid, kThreadsPerBlock, 0, stream>>>(
+    rows, features, x, y_diff, mean, rstd, partials);
+  CUDA_CALL(cudaGetLastError());
+  num_blocks = NumBlocks(features);
+  LayerNormParamGradKernel<T><<<num_blocks, kThreadsPerBlock, 0, stream>>>(
+    num_chunks, features, partials, gamma_diff, beta_diff);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkAttentionForward(cudaStream_t stream,
+                             const AttentionArgs<T> &args) {
+  dim3 grid((args.seq_len + kAttentionRows - 1) / kAttentionRows,
+            args.n * args.num_heads);
+  AttentionForwardKernel<T><<<grid, kAttentionRows, 0, stream>>>(args);
+  CUDA_CALL(cudaGetLastError());
+}
+
+template <typename T>
+void DNNMarkAttentionBackward(cudaStream_t stream,
+                              const AttentionArgs<T> &args) {
+  int num_blocks = NumBlocks(args.n * args.num_heads * args.seq_len);
+  AttentionDeltaKernel<T><<<num_blocks, kThreadsPerBlock, 0, stream>>>(args);
+  CUDA_CALL(cudaGetLastError());
+  dim3 grid((args.seq_len + kAttentionRows - 1) / kAttentionRows,
+            args.n * args.num_heads);
+  AttentionBackwardKVKernel<T><<<grid, kAttentionRows, 0, stream>>>(args);
+  CUDA_CALL(cudaGetLastError());
+  AttentionBackwardQKernel<T><<<grid, kAttentionRows, 0, stream>>>(args);
+  CUDA_CALL(cudaGetLastError());
+}
+
+// Explicit instantiation
+
+template void DNNMarkScaleShiftActivation<float>(cudaStream_t, int, int, int,
+  const float *, const float *, const float *, float *, bool);
+template void DNNMarkScaleShiftActivation<double>(cudaStream_t, int, int, int,
+  const double *, const double *, const double *, double *, bool);
+
+template void DNNMarkFillUniform<float>(cudaStream_t, int,
+  unsigned long long, unsigned int, float *);
+template void DNNMarkFillUniform<double>(cudaStream_t, int,
+  unsigned long long, unsigned int, double *);
+
+template void DNNMarkCifarToNCHW<float>(cudaStream_t, int,
+  const unsigned char *, float *);
+template void DNNMarkCifarToNCHW<double>(cudaStream_t, int,
+  const unsigned char *, double *);
+
+template void DNNMarkSGDMomentumUpdate<float>(cudaStream_t,
+  const MultiTensorList<float> &, float, float, float);
+template void DNNMarkSGDMomentumUpdate<double>(cudaStream_t,
+  const MultiTensorList<double> &, double, double, double);
+template void DNNMarkAdamUpdate<float>(cudaStream_t,
+  const MultiTensorList<float> &, float, float, float, float, float,
+  float, float);
+template void DNNMarkAdamUpdate<double>(cudaStream_t,
+  const MultiTensorList<double> &, double, double, double, double, double,
+  double, double);
+template void DNNMarkLAMBUpdate<float>(cudaStream_t,
+  const MultiTensorList<float> &, float *, float *, float, float, float,
+  float, float, float, float);
+template void DNNMarkLAMBUpdate<double>(cudaStream_t,
+  const MultiTensorList<double> &, double *, double *, double, double,
+  double, double, double, double, double);
+
+template void DNNMarkLSTMForwardStep<float>(cudaStream_t,
+  const RNNStep<float> &);
+template void DNNMarkLSTMForwardStep<double>(cudaStream_t,
+  const RNNStep<double> &);
+template void DNNMarkLSTMBackwardStep<float>(cudaStream_t,
+  const RNNStep<float> &);
+template void DNNMarkLSTMBackwardStep<double>(cudaStream_t,
+  const RNNStep<double> &);
+template void DNNMarkGRUForwardStep<float>(cudaStream_t,
+  const RNNStep<float> &);
+template void DNNMarkGRUForwardStep<double>(cudaStream_t,
+  const RNNStep<double> &);
+template void DNNMarkGRUBackwardStep<float>(cudaStream_t,
+  const RNNStep<float> &);
+template void DNNMarkGRUBackwardStep<double>(cudaStream_t,
+  const RNNStep<double> &);
+
+template void DNNMarkGELUForward<float>(cudaStream_t, int, bool,
+  const float *, float *);
+template void DNNMarkGELUForward<double>(cudaStream_t, int, bool,
+  const double *, double *);
+template void DNNMarkGELUBackward<float>(cudaStream_t, int, bool,
+  const float *, const float *, float *);
+template void DNNMarkGELUBackward<double>(cudaStream_t, int, bool,
+  const double *, const double *, double *);
+
+template void DNNMarkLayerNormForward<float>(cudaStream_t, int, int, float,
+  const float *, const float *, const float *, float *, float *, float *);
+template void DNNMarkLayerNormForward<double>(cudaStream_t, int, int, double,
+  const double *, const double *, const double *, double *, double *,
+  double *);
+template void DNNMarkLayerNormBackward<float>(cudaStream_t, int, int,
+  const float *, const float *, const float *, const float *,
+  const float *, float *, float *, float *, float *);
+template void DNNMarkLayerNormBackward<double>(cudaStream_t, int, int,
+  const double *, const double *, const double *, const double *,
+  const double *, double *, double *, double *, double *);
+
+template void DNNMarkAttentionForward<float>(cudaStream_t,
+  const AttentionArgs<float> &);
+template void DNNMarkAttentionForward<double>(cudaStream_t,
+  const AttentionArgs<double> &);
+template void DNNMarkAttentionBackward<float>(cudaStream_t,
+  const AttentionArgs<float> &);
+template void DNNMarkAttentionBackward<double>(cudaStream_t,
+  const AttentionArgs<double> &);
+
+} // namespace dnnmark
+
@@ -0,0 +1,410 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <iostream>
+
+#include "model_zoo.h"
+
+namespace dnnmark {
+
+template <typename T>
+ModelZoo<T>::ModelZoo(DNNMark<T> *p_dnnmark)
+: p_dnnmark_(p_dnnmark), previous_layer_("null"), num_layers_(0) {}
+
+template <typename T>
+const std::vector<std::string> &ModelZoo<T>::Models() {
+  static const std::vector<std::string> models = {
+    "vgg16", "vgg19", "resnet18", "resnet50", "inception_v1", "mobilenet_v1"
+  };
+  return models;
+}
+
+template <typename T>
+int ModelZoo<T>::Build(const std::string &model, int batch_size,
+                       int resolution) {
+  LOG_IF(FATAL, batch_size < 1) << "Model zoo: Invalid batch size "
+                                << batch_size;
+  LOG_IF(FATAL, resolution < 1) << "Model zoo: Invalid resolution "
+                                << resolution;
+  model_ = model;
+  input_dim_ = DataDim(batch_size, 3, resolution, resolution);
+  dim_ = input_dim_;
+  previous_layer_ = "null";
+  p_dnnmark_->Set("run_mode", "composed");
+
+  if (model == "vgg16") {
+    BuildVGG({2, 2, 3, 3, 3});
+  } else if (model == "vgg19") {
+    BuildVGG({2, 2, 4, 4, 4});
+  } else if (model == "resnet18") {
+    BuildResNet({2, 2, 2, 2}, false);
+  } else if (model == "resnet50") {
+    BuildResNet({3, 4, 6, 3}, true);
+  } else if (model == "inception_v1") {
+    BuildInceptionV1();
+  } else if (model == "mobilenet_v1") {
+    BuildMobileNetV1();
+  } else {
+    std::string models;
+    for (auto &name : Models())
+      models += " " + name;
+    LOG(FATAL) << "Model zoo: Unknown model " << model << ", available:"
+               << models;
+  }
+  return 0;
+}
+
+template <typename T>
+void ModelZoo<T>::Replace(const std::string &feature) {
+  for (auto &replacement : replacements_)
+    if (replacement.first == feature) {
+      replacement.second++;
+      return;
+    }
+  LOG(WARNING) << "Model zoo: " << model_ << ": " << feature;
+  replacements_.push_back(std::make_pair(feature, 1));
+}
+
+template <typename T>
+DataDim ModelZoo<T>::InputDim() const {
+  // Only the first layer takes the input dimension
+  return previous_layer_ == "null" ? input_dim_ : DataDim();
+}
+
+template <typename T>
+void ModelZoo<T>::CheckDim(const std::string &name) const {
+  LOG_IF(FATAL, dim_.h_ < 1 || dim_.w_ < 1)
+    << "Model zoo: Resolution " << input_dim_.h_ << " is too small for "
+    << model_ << ", nothing is left of the input after " << name;
+}
+
+template <typename T>
+void ModelZoo<T>::Conv(const std::string &name, int output_num,
+                       int kernel_size, int stride, int pad) {
+  ConvolutionParam conv;
+  conv.output_num_ = output_num;
+  conv.kernel_size_h_ = conv.kernel_size_w_ = kernel_size;
+  conv.stride_u_ = conv.stride_v_ = stride;
+  conv.pad_h_ = conv.pad_w_ = pad;
+  p_dnnmark_->AddConvolution(name, previous_layer_, conv, InputDim());
+  dim_.c_ = output_num;
+  dim_.h_ = (dim_.h_ + 2 * pad - kernel_size) / stride + 1;
+  dim_.w_ = (dim_.w_ + 2 * pad - kernel_size) / stride + 1;
+  previous_layer_ = name;
+  num_layers_++;
+  CheckDim(name);
+}
+
+template <typename T>
+void ModelZoo<T>::Pool(const std::string &name, cudnnPoolingMode_t mode,
+                       int kernel_size, int stride, int pad) {
+  PoolingParam pool;
+  pool.mode_ = mode;
+  pool.kernel_size_h_ = pool.kernel_size_w_ = kernel_size;
+  pool.stride_h_ = pool.stride_w_ = stride;
+  pool.pad_h_ = pool.pad_w_ = pad;
+  p_dnnmark_->AddPooling(name, previous_layer_, pool, InputDim());
+  dim_.h_ = (dim_.h_ + 2 * pad - kernel_size) / stride + 1;
+  dim_.w_ = (dim_.w_ + 2 * pad - kernel_size) / stride + 1;
+  previous_layer_ = name;
+  num_layers_++;
+  CheckDim(name);
+}
+
+template <typename T>
+void ModelZoo<T>::GlobalAvgPool(const std::string &name) {
+  PoolingParam pool;
+  pool.mode_ = CUDNN_POOLING_AVERAGE_COUNT_INCLUDE_PADDING;
+  pool.kernel_size_h_ = dim_.h_;
+  pool.kernel_size_w_ = dim_.w_;
+  pool.stride_h_ = pool.stride_w_ = 1;
+  pool.pad_h_ = pool.pad_w_ = 0;
+  p_dnnmark_->AddPooling(name, previous_layer_, pool, InputDim());
+  dim_.h_ = dim_.w_ = 1;
+  previous_layer_ = name;
+  num_layers_++;
+}
+
+template <typename T>
+void ModelZoo<T>::BatchNorm(const std::string &name) {
+  BatchNormParam bn;
+  bn.mode_ = CUDNN_BATCHNORM_SPATIAL;
+  bn.epsilon_ = 1e-5;
+  p_dnnmark_->AddBatchNorm(name, previous_layer_, bn, InputDim());
+  previous_layer_ = name;
+  num_layers_++;
+}
+
+template <typename T>
+void ModelZoo<T>::ReLU(const std::string &name) {
+  ActivationParam activation;
+  activation.mode_ = CUDNN_ACTIVATION_RELU;
+  p_dnnmark_->AddActivation(name, previous_layer_, activation, InputDim());
+  previous_layer_ = name;
+  num_layers_++;
+}
+
+template <typename T>
+void ModelZoo<T>::LRN(const std::string &name) {
+  LRNParam lrn;
+  lrn.local_size_ = 5;
+  lrn.alpha_ = 0.0001;
+  lrn.beta_ = 0.75;
+  lrn.k_ = 1.0;
+  p_dnnmark_->AddLRN(name, previous_layer_, lrn, InputDim());
+  previous_layer_ = name;
+  num_layers_++;
+}
+
+template <typename T>
+void ModelZoo<T>::FullyConnected(const std::string &name, int output_num) {
+  FullyConnectedParam fc;
+  fc.output_num_ = output_num;
+  p_dnnmark_->AddFullyConnected(name, previous_layer_, fc, InputDim());
+  dim_.c_ = output_num;
+  dim_.h_ = dim_.w_ = 1;
+  previous_layer_ = name;
+  num_layers_++;
+}
+
+template <typename T>
+void ModelZoo<T>::Dropout(const std::string &name, float dropout_p) {
+  DropoutParam dropout;
+  dropout.dropout_p_ = dropout_p;
+  p_dnnmark_->AddDropout(name, previous_layer_, dropout, InputDim());
+  previous_layer_ = name;
+  num_layers_++;
+}
+
+template <typename T>
+void ModelZoo<T>::Softmax(const std::string &name) {
+  SoftmaxParam softmax;
+  softmax.mode_ = CUDNN_SOFTMAX_MODE_CHANNEL;
+  p_dnnmark_->AddSoftmax(name, previous_layer_, softmax, InputDim());
+  previous_layer_ = name;
+  num_layers_++;
+}
+
+template <typename T>
+void ModelZoo<T>::BuildVGG(const std::vector<int> &blocks) {
+  const int widths[] = {64, 128, 256, 512, 512};
+  for (size_t i = 0; i < blocks.size(); i++) {
+    for (int j = 0; j < blocks[i]; j++) {
+      std::string suffix = std::to_string(i + 1) + "_" + std::to_string(j + 1);
+      Conv("conv" + suffix, widths[i], 3, 1, 1);
+      ReLU("relu" + suffix);
+    }
+    Pool("pool" + std::to_string(i + 1), CUDNN_POOLING_MAX, 2, 2, 0);
+  }
+  for (int i = 6; i <= 7; i++) {
+    FullyConnected("fc" + std::to_string(i), 4096);
+    ReLU("relu" + std::to_string(i));
+    Dropout("drop" + std::to_string(i), 0.5);
+  }
+  FullyConnected("fc8", 1000);
+  Softmax("prob");
+}
+
+template <typename T>
+void ModelZoo<T>::BuildResNet(const std::vector<int> &blocks,
+                              bool bottleneck) {
+  Conv("conv1", 64, 7, 2, 3);
+  BatchNorm("bn_conv1");
+  ReLU("conv1_relu");
+  Pool("pool1", CUDNN_POOLING_MAX, 3, 2, 1);
+
+  const int widths[] = {64, 128, 256, 512};
+  for (size_t i = 0; i < blocks.size(); i++) {
+    for (int j = 0; j < blocks[i]; j++) {
+      std::string block = std::to_string(i + 2) + static_cast<char>('a' + j);
+      std::string res = "res" + block;
+      std::string bn = "bn" + block;
+      int stride = i > 0 && j == 0 ? 2 : 1;
+      int output_num = bottleneck ? 4 * widths[i] : widths[i];
+      std::string fork = previous_layer_;
+      DataDim fork_dim = dim_;
+
+      if (bottleneck) {
+        Conv(res + "_branch2a", widths[i], 1, 1, 0);
+        BatchNorm(bn + "_branch2a");
+        ReLU(res + "_branch2a_relu");
+        Conv(res + "_branch2b", widths[i], 3, stride, 1);
+        BatchNorm(bn + "_branch2b");
+        ReLU(res + "_branch2b_relu");
+        Conv(res + "_branch2c", output_num, 1, 1, 0);
+        BatchNorm(bn + "_branch2c");
+      } else {
+        Conv(res + "_branch2a", widths[i], 3, stride, 1);
+        BatchNorm(bn + "_branch2a");
+        ReLU(res + "_branch2a_relu");
+        Conv(res + "_branch2b", output_num, 3, 1, 1);
+        BatchNorm(bn + "_branch2b");
+      }
+
+      if (stride != 1 || fork_dim.c_ != output_num) {
+        std::string main_path = previous_layer_;
+        DataDim main_dim = dim_;
+        previous_layer_ = fork;
+        dim_ = fork_dim;
+        Conv(res + "_branch1", output_num, 1, stride, 0);
+        BatchNorm(bn + "_branch1");
+        Replace("projection shortcut computed without a consumer, its "
+                "gradient overwrites the one of the block input instead of "
+                "adding to it");
+        previous_layer_ = main_path;
+        dim_ = main_dim;
+      }
+      Replace("residual addition left out, the block output is its main "
+              "path alone");
+      ReLU(res + "_relu");
+    }
+  }
+
+  GlobalAvgPool("pool5");
+  FullyConnected("fc1000", 1000);
+  Softmax("prob");
+}
+
+template <typename T>
+void ModelZoo<T>::BuildInceptionV1() {
+  // Caffe rounds pooled sizes up, pad 1 gives the same sizes with cuDNN
+  Conv("conv1/7x7_s2", 64, 7, 2, 3);
+  ReLU("conv1/relu_7x7");
+  Pool("pool1/3x3_s2", CUDNN_POOLING_MAX, 3, 2, 1);
+  LRN("pool1/norm1");
+  Conv("conv2/3x3_reduce", 64, 1, 1, 0);
+  ReLU("conv2/relu_3x3_reduce");
+  Conv("conv2/3x3", 192, 3, 1, 1);
+  ReLU("conv2/relu_3x3");
+  LRN("conv2/norm2");
+  Pool("pool2/3x3_s2", CUDNN_POOLING_MAX, 3, 2, 1);
+
+  // Name, 1x1, 3x3 reduce, 3x3, 5x5 reduce, 5x5 and pool projection
+  struct Module {
+    const char *name_;
+    int widths_[6];
+  };
+  const Module modules[] = {
+    {"3a", {64, 96, 128, 16, 32, 32}},
+    {"3b", {128, 128, 192, 32, 96, 64}},
+    {"4a", {192, 96, 208, 16, 48, 64}},
+    {"4b", {160, 112, 224, 24, 64, 64}},
+    {"4c", {128, 128, 256, 24, 64, 64}},
+    {"4d", {112, 144, 288, 32, 64, 64}},
+    {"4e", {256, 160, 320, 32, 128, 128}},
+    {"5a", {256, 160, 320, 32, 128, 128}},
+    {"5b", {384, 192, 384, 48, 128, 128}}
+  };
+  for (auto &module : modules) {
+    std::string prefix = std::string("inception_") + module.name_ + "/";
+    const int *widths = module.widths_;
+    std::string fork = previous_layer_;
+    DataDim fork_dim = dim_;
+
+    Conv(prefix + "1x1", widths[0], 1, 1, 0);
+    ReLU(prefix + "relu_1x1");
+    previous_layer_ = fork;
+    dim_ = fork_dim;
+    Conv(prefix + "3x3_reduce", widths[1], 1, 1, 0);
+    ReLU(prefix + "relu_3x3_reduce");
+    Conv(prefix + "3x3", widths[2], 3, 1, 1);
+    ReLU(prefix + "relu_3x3");
+    previous_layer_ = fork;
+    dim_ = fork_dim;
+    Conv(prefix + "5x5_reduce", widths[3], 1, 1, 0);
+    ReLU(prefix + "relu_5x5_reduce");
+    Conv(prefix + "5x5", widths[4], 5, 1, 2);
+    ReLU(prefix + "relu_5x5");
+    previous_layer_ = fork;
+    dim_ = fork_dim;
+    Pool(prefix + "pool", CUDNN_POOLING_MAX, 3, 1, 1);
+    Conv(prefix + "pool_proj",
+         widths[0] + widths[2] + widths[4] + widths[5], 1, 1, 0);
+    ReLU(prefix + "relu_pool_proj");
+    Replace("1x1, 3x3 and 5x5 branches computed without a consumer, their "
+            "gradients overwrite each other at the module input");
+    Replace("concatenation left out, the pool projection is widened to the "
+            "concatenated width and feeds the next stage");
+
+    if (module.name_ == std::string("3b"))
+      Pool("pool3/3x3_s2", CUDNN_POOLING_MAX, 3, 2, 1);
+    else if (module.name_ == std::string("4e"))
+      Pool("pool4/3x3_s2", CUDNN_POOLING_MAX, 3, 2, 1);
+  }
+
+  // Training only heads on 4a and 4d
+  Replace("auxiliary classifier left out");
+  Replace("auxiliary classifier left out");
+  GlobalAvgPool("pool5/7x7_s1");
+  Dropout("pool5/drop_7x7_s1", 0.4);
+  FullyConnected("loss3/classifier", 1000);
+  Softmax("prob");
+}
+
+template <typename T>
+void ModelZoo<T>::BuildMobileNetV1() {
+  Conv("conv1", 32, 3, 2, 1);
+  BatchNorm("conv1_bn");
+  ReLU("conv1_relu");
+
+  // Output width and stride of each depthwise separable block
+  const int blocks[][2] = {
+    {64, 1}, {128, 2}, {128, 1}, {256, 2}, {256, 1}, {512, 2},
+    {512, 1}, {512, 1}, {512, 1}, {512, 1}, {512, 1},
+    {1024, 2}, {1024, 1}
+  };
+  int index = 1;
+  for (auto &block : blocks) {
+    std::string dw = "conv_dw_" + std::to_string(index);
+    std::string pw = "conv_pw_" + std::to_string(index);
+    Pool(dw, CUDNN_POOLING_AVERAGE_COUNT_INCLUDE_PADDING, 3, block[1], 1);
+    Replace("depthwise convolution replaced by 3x3 average pooling of the "
+            "same shape, without weights");
+    BatchNorm(dw + "_bn");
+    ReLU(dw + "_relu");
+    Conv(pw, block[0], 1, 1, 0);
+    BatchNorm(pw + "_bn");
+    ReLU(pw + "_relu");
+    index++;
+  }
+
+  GlobalAvgPool("pool6");
+  FullyConnected("fc7", 1000);
+  Softmax("prob");
+}
+
+template <typename T>
+void ModelZoo<T>::Report() {
+  std::cout << "[Model Zoo] " << model_ << ", input " << input_dim_.n_
+            << "x" << input_dim_.c_ << "x" << input_dim_.h_ << "x"
+            << input_dim_.w_ << ": " << num_layers_ << " layers" << std::endl;
+  if (replacements_.empty())
+    std::cout << "[Model Zoo] Topology is exact" << std::endl;
+  for (auto &replacement : replacements_)
+    std::cout << "[Model Zoo] " << replacement.second << " x "
+              << replacement.first << std::endl;
+}
+
+// Explicit instantiation
+template class ModelZoo<TestType>;
+
+} // namespace dnnmark
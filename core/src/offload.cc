@@ -0,0 +1,327 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <iomanip>
+
+#include "offload.h"
+
+namespace dnnmark {
+
+//
+// Offload class definition
+//
+
+template <typename T>
+Offload<T>::Offload(DNNMark<T> *p_dnnmark)
+: p_dnnmark_(p_dnnmark), num_layers_(0), num_units_(0), num_slots_(0),
+  host_pool_(nullptr), host_bytes_(0), slot_bytes_(0),
+  compute_stream_(0), copy_stream_(0), num_stalls_(0),
+  baseline_step_time_(0), step_time_(0),
+  offload_stall_time_(0), prefetch_stall_time_(0) {
+  CHECK_EQ(p_dnnmark_->getRunMode(), COMPOSED)
+    << "Offload requires composed mode";
+  CHECK(p_dnnmark_->isTraining()) << "Offload requires mode=training";
+}
+
+template <typename T>
+Offload<T>::~Offload() {
+  if (compute_stream_ == 0)
+    return;
+  CUDA_CALL(cudaDeviceSynchronize());
+  // Hand the model back with its own memory and the default stream
+  for (int i = 0; i < num_layers_; i++)
+    p_dnnmark_->GetHandle()->SetStream(i, 0);
+  for (int u = 0; u < num_units_; u++)
+    if (offloaded_[u])
+      activations_[u]->Acquire();
+  for (auto &slot : slots_) {
+    CUDA_CALL(cudaFree(slot.ptr));
+    CUDA_CALL(cudaEventDestroy(slot.free));
+  }
+  for (int u = 0; u < num_units_; u++) {
+    CUDA_CALL(cudaEventDestroy(consumed_[u]));
+    CUDA_CALL(cudaEventDestroy(prefetched_[u]));
+  }
+  for (auto &events : stall_events_) {
+    CUDA_CALL(cudaEventDestroy(events.first));
+    CUDA_CALL(cudaEventDestroy(events.second));
+  }
+  if (host_pool_ != nullptr)
+    CUDA_CALL(cudaFreeHost(host_pool_));
+  CUDA_CALL(cudaStreamDestroy(compute_stream_));
+  CUDA_CALL(cudaStreamDestroy(copy_stream_));
+}
+
+template <typename T>
+int Offload<T>::Setup() {
+  num_layers_ = p_dnnmark_->getNumLayers();
+  CHECK_GT(num_layers_, 0);
+
+  // Chains only, a top is consumed by the next layer and nothing else.
+  // In-place layers share the top of their producer and form a unit.
+  DataManager<T> *data_manager = DataManager<T>::GetInstance();
+  std::vector<int> unit_of(num_layers_);
+  for (int i = 0; i < num_layers_; i++) {
+    Layer<T> *layer = p_dnnmark_->GetLayerByID(i);
+    std::string expected = i == 0 ? "null" :
+                           p_dnnmark_->GetLayerByID(i - 1)->getLayerName();
+    CHECK_EQ(layer->getPrevLayerName(), expected)
+      << "Offload: layer " << layer->getLayerName()
+      << " does not follow " << expected << ", only chains are supported";
+    if (i == 0 || !layer->isInPlace()) {
+      units_.push_back(std::vector<Layer<T> *>());
+      activations_.push_back(data_manager->GetData(layer->getTopChunkID(0)));
+    }
+    units_.back().push_back(layer);
+    unit_of[i] = units_.size() - 1;
+  }
+  num_units_ = units_.size();
+
+  // The last top is the first one backward needs, it always stays
+  offloaded_.assign(num_units_, false);
+  for (auto &name : p_dnnmark_->getOffloadLayers()) {
+    if (!name.compare("all")) {
+      for (int u = 0; u < num_units_ - 1; u++)
+        offloaded_[u] = true;
+      continue;
+    }
+    CHECK(p_dnnmark_->isLayerExist(name)) << "Offload: no layer " << name;
+    int unit = unit_of[p_dnnmark_->GetLayerByName(name)->getLayerId()];
+    LOG_IF(WARNING, unit == num_units_ - 1)
+      << "Offload: the top of the last layer " << name << " is kept";
+    if (unit < num_units_ - 1)
+      offloaded_[unit] = true;
+  }
+
+  host_offset_.assign(num_units_, 0);
+  host_bytes_ = 0;
+  slot_bytes_ = 0;
+  for (int i = 0; i < num_units_; i++) {
+    if (!offloaded_[i])
+      continue;
+    size_t bytes = activations_[i]->getSize() * sizeof(T);
+    host_offset_[i] = host_bytes_ / sizeof(T);
+    host_bytes_ += bytes;
+    slot_bytes_ = std::max(slot_bytes_, bytes);
+  }
+  LOG_IF(WARNING, getNumOffloaded() == 0) << "Offload: no layer selected";
+  if (host_bytes_ > 0)
+    CUDA_CALL(cudaMallocHost(&host_pool_, host_bytes_));
+
+  // Two slots hold a top and its consumer's top, the rest is prefetch depth
+  num_slots_ = std::min(p_dnnmark_->getOffloadSlots(),
+                        std::max(2, getNumOffloaded()));
+  slots_.resize(num_slots_);
+  for (auto &slot : slots_) {
+    CUDA_CALL(cudaMalloc(&slot.ptr, slot_bytes_));
+    CUDA_CALL(cudaEventCreateWithFlags(&slot.free, cudaEventDisableTiming));
+  }
+  slot_of_.assign(num_units_, -1);
+  consumed_.resize(num_units_);
+  prefetched_.resize(num_units_);
+  for (int i = 0; i < num_units_; i++) {
+    CUDA_CALL(cudaEventCreateWithFlags(&consumed_[i],
+                                       cudaEventDisableTiming));
+    CUDA_CALL(cudaEventCreateWithFlags(&prefetched_[i],
+                                       cudaEventDisableTiming));
+  }
+
+  CUDA_CALL(cudaStreamCreateWithFlags(&compute_stream_,
+                                      cudaStreamNonBlocking));
+  CUDA_CALL(cudaStreamCreateWithFlags(&copy_stream_, cudaStreamNonBlocking));
+  for (int i = 0; i < num_layers_; i++)
+    p_dnnmark_->GetHandle()->SetStream(i, compute_stream_);
+
+  // Warm up on the whole model, this also fills the input data
+  p_dnnmark_->Forward();
+  p_dnnmark_->Backward();
+
+  bool data_fill_enabled = p_dnnmark_->isDataFillEnabled();
+  p_dnnmark_->setDataFillEnabled(false);
+  Timer timer;
+  timer.Start(compute_stream_);
+  p_dnnmark_->Forward();
+  p_dnnmark_->Backward();
+  timer.Stop(compute_stream_);
+  baseline_step_time_ = timer.Elapsed();
+  p_dnnmark_->setDataFillEnabled(data_fill_enabled);
+
+  // From here on offloaded tops only live in slots and on the host
+  for (int i = 0; i < num_units_; i++)
+    if (offloaded_[i])
+      activations_[i]->Release();
+  return 0;
+}
+
+template <typename T>
+void Offload<T>::Stall(const cudaEvent_t &event) {
+  if (num_stalls_ == stall_events_.size()) {
+    std::pair<cudaEvent_t, cudaEvent_t> events;
+    CUDA_CALL(cudaEventCreate(&events.first));
+    CUDA_CALL(cudaEventCreate(&events.second));
+    stall_events_.push_back(events);
+  }
+  // Anything between the two events is the compute stream waiting
+  CUDA_CALL(cudaEventRecord(stall_events_[num_stalls_].first,
+                            compute_stream_));
+  CUDA_CALL(cudaStreamWaitEvent(compute_stream_, event, 0));
+  CUDA_CALL(cudaEventRecord(stall_events_[num_stalls_].second,
+                            compute_stream_));
+  num_stalls_++;
+}
+
+template <typename T>
+float Offload<T>::StallTime(int begin, int end) {
+  float total = 0, elapsed;
+  for (int i = begin; i < end; i++) {
+    CUDA_CALL(cudaEventSynchronize(stall_events_[i].second));
+    CUDA_CALL(cudaEventElapsedTime(&elapsed, stall_events_[i].first,
+                                   stall_events_[i].second));
+    total += elapsed;
+  }
+  return total;
+}
+
+template <typename T>
+int Offload<T>::AcquireSlot(int unit) {
+  CHECK(!free_slots_.empty()) << "Offload: out of staging slots";
+  int slot = free_slots_.front();
+  free_slots_.pop_front();
+  slot_of_[unit] = slot;
+  activations_[unit]->Attach(slots_[slot].ptr);
+  return slot;
+}
+
+template <typename T>
+void Offload<T>::Prefetch(const std::vector<int> &order, int *next) {
+  // Bring tops back in the order backward needs them while slots last
+  while (*next < order.size() && !free_slots_.empty()) {
+    int unit = order[(*next)++];
+    int slot = AcquireSlot(unit);
+    CUDA_CALL(cudaStreamWaitEvent(copy_stream_, slots_[slot].free, 0));
+    CUDA_CALL(cudaMemcpyAsync(slots_[slot].ptr,
+                              host_pool_ + host_offset_[unit],
+                              activations_[unit]->getSize() * sizeof(T),
+                              cudaMemcpyHostToDevice, copy_stream_));
+    CUDA_CALL(cudaEventRecord(prefetched_[unit], copy_stream_));
+  }
+}
+
+template <typename T>
+int Offload<T>::Train() {
+  bool data_fill_enabled = p_dnnmark_->isDataFillEnabled();
+  p_dnnmark_->setDataFillEnabled(false);
+  Timer timer;
+
+  std::vector<int> order;
+  for (int i = num_units_ - 1; i >= 0; i--)
+    if (offloaded_[i])
+      order.push_back(i);
+
+  // The first step is a warmup
+  for (int iter = 0; iter < 2; iter++) {
+    CUDA_CALL(cudaDeviceSynchronize());
+    free_slots_.clear();
+    for (int s = 0; s < num_slots_; s++) {
+      CUDA_CALL(cudaEventRecord(slots_[s].free, compute_stream_));
+      free_slots_.push_back(s);
+    }
+    num_stalls_ = 0;
+    timer.Start(compute_stream_);
+
+    // Forward: write a top back to the host once its consumer has run
+    for (int i = 0; i < num_units_; i++) {
+      if (offloaded_[i]) {
+        int slot = AcquireSlot(i);
+        Stall(slots_[slot].free);
+      }
+      for (auto layer : units_[i])
+        layer->ForwardPropagation();
+      if (i > 0 && offloaded_[i - 1]) {
+        int slot = slot_of_[i - 1];
+        CUDA_CALL(cudaEventRecord(consumed_[i - 1], compute_stream_));
+        CUDA_CALL(cudaStreamWaitEvent(copy_stream_, consumed_[i - 1], 0));
+        CUDA_CALL(cudaMemcpyAsync(host_pool_ + host_offset_[i - 1],
+                                  slots_[slot].ptr,
+                                  activations_[i - 1]->getSize() * sizeof(T),
+                                  cudaMemcpyDeviceToHost, copy_stream_));
+        CUDA_CALL(cudaEventRecord(slots_[slot].free, copy_stream_));
+        free_slots_.push_back(slot);
+        slot_of_[i - 1] = -1;
+      }
+    }
+    int num_offload_stalls = num_stalls_;
+
+    // Backward: unit k reads its top, which unit k + 1 already waited
+    // for, and its bottom, the top of unit k - 1
+    int next = 0;
+    for (int k = num_units_ - 1; k >= 0; k--) {
+      Prefetch(order, &next);
+      if (k > 0 && offloaded_[k - 1]) {
+        CHECK_GE(slot_of_[k - 1], 0) << "Offload: prefetch not issued";
+        Stall(prefetched_[k - 1]);
+      }
+      for (auto it = units_[k].rbegin(); it != units_[k].rend(); it++)
+        (*it)->BackwardPropagation();
+      if (offloaded_[k]) {
+        int slot = slot_of_[k];
+        CUDA_CALL(cudaEventRecord(slots_[slot].free, compute_stream_));
+        free_slots_.push_back(slot);
+        slot_of_[k] = -1;
+      }
+    }
+    timer.Stop(compute_stream_);
+    step_time_ = timer.Elapsed();
+    offload_stall_time_ = StallTime(0, num_offload_stalls);
+    prefetch_stall_time_ = StallTime(num_offload_stalls, num_stalls_);
+  }
+
+  p_dnnmark_->setDataFillEnabled(data_fill_enabled);
+  return 0;
+}
+
+template <typename T>
+int Offload<T>::getNumOffloaded() {
+  return std::count(offloaded_.begin(), offloaded_.end(), true);
+}
+
+template <typename T>
+void Offload<T>::Report() {
+  const double MB = 1024.0 * 1024.0;
+  std::cout << std::fixed << std::setprecision(2)
+            << "[Offload] tops: " << getNumOffloaded() << "/" << num_units_
+            << " host: " << host_bytes_ / MB << " MB"
+            << " slots: " << num_slots_ << " x " << slot_bytes_ / MB << " MB"
+            << " device saved: " << getSavedDeviceBytes() / MB << " MB"
+            << std::setprecision(3)
+            << " step: " << getStepTime() << " ms"
+            << " baseline: " << getBaselineStepTime() << " ms"
+            << " prefetch stall: " << getPrefetchStallTime() << " ms"
+            << " offload stall: " << getOffloadStallTime() << " ms"
+            << std::defaultfloat << std::endl;
+}
+
+// Explicit instantiation
+template class Offload<TestType>;
+
+} // namespace dnnmark
+
@@ -0,0 +1,157 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+
+#include "optimizer.h"
+
+namespace dnnmark {
+
+//
+// Optimizer class definition
+//
+
+template <typename T>
+Optimizer<T>::Optimizer(DNNMark<T> *p_dnnmark)
+: p_dnnmark_(p_dnnmark), param_(p_dnnmark->getOptimizerParam()),
+  num_tensors_(0), num_elements_(0), list_(),
+  device_ptrs_(nullptr), device_ints_(nullptr), norms_(nullptr),
+  partials_(nullptr),
+  step_(0) {
+  CHECK_NE(param_->type_, NO_OPTIMIZER);
+}
+
+template <typename T>
+Optimizer<T>::~Optimizer() {
+  CUDA_CALL(cudaFree(device_ptrs_));
+  CUDA_CALL(cudaFree(device_ints_));
+  CUDA_CALL(cudaFree(norms_));
+  CUDA_CALL(cudaFree(partials_));
+}
+
+template <typename T>
+int Optimizer<T>::Setup() {
+  DataManager<T> *data_manager = DataManager<T>::GetInstance();
+  int num_states = param_->type_ == SGD_MOMENTUM ? 1 : 2;
+
+  // Host side tensor list, state pointers follow the gradients
+  std::vector<T *> params, grads, states[2];
+  std::vector<int> sizes, block_tensor, block_offset;
+  for (int i = 0; i < p_dnnmark_->getNumLayers(); i++) {
+    Layer<T> *layer = p_dnnmark_->GetLayerByID(i);
+    for (int j = 0; j < layer->getNumParams(); j++) {
+      Data<T> *param = data_manager->GetData(layer->getParamChunkID(j));
+      Data<T> *grad = data_manager->GetData(layer->getParamDiffChunkID(j));
+      int size = param->getSize();
+      params.push_back(param->Get());
+      grads.push_back(grad->Get());
+      for (int s = 0; s < num_states; s++) {
+        int chunk_id = data_manager->CreateData(size);
+        Data<T> *state = data_manager->GetData(chunk_id);
+        CUDA_CALL(cudaMemset(state->Get(), 0, size * sizeof(T)));
+        state_chunk_ids_.push_back(chunk_id);
+        states[s].push_back(state->Get());
+      }
+      for (int offset = 0; offset < size; offset += kMultiTensorChunk) {
+        block_tensor.push_back(sizes.size());
+        block_offset.push_back(offset);
+      }
+      sizes.push_back(size);
+      num_elements_ += size;
+    }
+  }
+  num_tensors_ = sizes.size();
+  CHECK_GT(num_tensors_, 0) << "No learnable parameters to update";
+  if (num_states < 2)
+    states[1].assign(num_tensors_, nullptr);
+
+  std::vector<T *> ptrs(params);
+  ptrs.insert(ptrs.end(), grads.begin(), grads.end());
+  ptrs.insert(ptrs.end(), states[0].begin(), states[0].end());
+  ptrs.insert(ptrs.end(), states[1].begin(), states[1].end());
+  std::vector<int> ints(sizes);
+  ints.insert(ints.end(), block_tensor.begin(), block_tensor.end());
+  ints.insert(ints.end(), block_offset.begin(), block_offset.end());
+  CUDA_CALL(cudaMalloc(&device_ptrs_, ptrs.size() * sizeof(T *)));
+  CUDA_CALL(cudaMemcpy(device_ptrs_, ptrs.data(), ptrs.size() * sizeof(T *),
+                       cudaMemcpyHostToDevice));
+  CUDA_CALL(cudaMalloc(&device_ints_, ints.size() * sizeof(int)));
+  CUDA_CALL(cudaMemcpy(device_ints_, ints.data(), ints.size() * sizeof(int),
+                       cudaMemcpyHostToDevice));
+
+  list_.num_tensors = num_tensors_;
+  list_.num_blocks = block_tensor.size();
+  list_.sizes = device_ints_;
+  list_.block_tensor = device_ints_ + num_tensors_;
+  list_.block_offset = device_ints_ + num_tensors_ + list_.num_blocks;
+  list_.params = device_ptrs_;
+  list_.grads = device_ptrs_ + num_tensors_;
+  list_.state1 = device_ptrs_ + 2 * num_tensors_;
+  list_.state2 = device_ptrs_ + 3 * num_tensors_;
+
+  if (param_->type_ == LAMB) {
+    CUDA_CALL(cudaMalloc(&norms_, 2 * num_tensors_ * sizeof(T)));
+    CUDA_CALL(cudaMalloc(&partials_, 2 * list_.num_blocks * sizeof(T)));
+  }
+
+  LOG(INFO) << "Optimizer: " << num_tensors_ << " tensors, "
+            << num_elements_ << " elements in "
+            << list_.num_blocks << " blocks";
+  return 0;
+}
+
+template <typename T>
+int Optimizer<T>::Step() {
+  step_++;
+  T lr = param_->learning_rate_;
+  T weight_decay = param_->weight_decay_;
+  T beta1 = param_->beta1_;
+  T beta2 = param_->beta2_;
+  T bias_correction1 = 1 - std::pow(param_->beta1_, step_);
+  T bias_correction2 = 1 - std::pow(param_->beta2_, step_);
+
+  cudaProfilerStart();
+  switch (param_->type_) {
+    case SGD_MOMENTUM:
+      DNNMarkSGDMomentumUpdate<T>(0, list_, lr, param_->momentum_,
+                                  weight_decay);
+      break;
+    case ADAM:
+      DNNMarkAdamUpdate<T>(0, list_, lr, beta1, beta2, param_->epsilon_,
+                           weight_decay, bias_correction1, bias_correction2);
+      break;
+    case LAMB:
+      DNNMarkLAMBUpdate<T>(0, list_, norms_, partials_, lr, beta1, beta2,
+                           param_->epsilon_, weight_decay,
+                           bias_correction1, bias_correction2);
+      break;
+    default:
+      LOG(FATAL) << "Unknown optimizer";
+  }
+  cudaProfilerStop();
+  return 0;
+}
+
+// Explicit instantiation
+template class Optimizer<TestType>;
+
+} // namespace dnnmark
@@ -0,0 +1,199 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "param_sweep.h"
+
+namespace dnnmark {
+
+//
+// ParamSweep class definition
+//
+
+template <typename T>
+ParamSweep<T>::ParamSweep(DNNMark<T> *p_dnnmark,
+                          const std::string &config_file,
+                          int num_iterations)
+: p_dnnmark_(p_dnnmark), num_iterations_(num_iterations) {
+  CHECK_GT(num_iterations_, 0);
+  ReadConfig(config_file);
+  p_dnnmark_->ParseGeneralConfig(config_file);
+}
+
+template <typename T>
+void ParamSweep<T>::ReadConfig(const std::string &config_file) {
+  std::ifstream is(config_file.c_str(), std::ifstream::in);
+  CHECK(is.is_open()) << "Cannot open " << config_file;
+  std::string s;
+  while (std::getline(is, s))
+    lines_.push_back(s);
+
+  // Swept parameters in layer sections, labeled with the layer name
+  bool is_layer_section = false;
+  int section_begin = 0;
+  std::string layer_name;
+  for (int i = 0; i < lines_.size(); i++) {
+    s = lines_[i];
+    TrimStr(&s);
+    if (isCommentStr(s) || isEmptyStr(s))
+      continue;
+    if (isGeneralSection(s) || isLayerSection(s)) {
+      is_layer_section = isLayerSection(s);
+      section_begin = axes_.size();
+      layer_name = s;
+      continue;
+    }
+    if (!is_layer_section)
+      continue;
+    std::string var, val;
+    SplitStr(s, &var, &val);
+    if (!var.compare("name")) {
+      layer_name = val;
+      for (int a = section_begin; a < axes_.size(); a++)
+        axes_[a].label = layer_name + "." + axes_[a].var;
+    }
+    // A data source lists files rather than configurations
+    if (!isSweepValue(val) || !var.compare("data_source"))
+      continue;
+    Axis axis;
+    axis.line = i;
+    axis.var = var;
+    axis.label = layer_name + "." + var;
+    ExpandSweepValue(val, &axis.values);
+    axes_.push_back(axis);
+  }
+  LOG(INFO) << "ParamSweep: " << axes_.size() << " swept parameters, "
+            << getNumPoints() << " points";
+}
+
+template <typename T>
+int ParamSweep<T>::getNumPoints() {
+  int num_points = 1;
+  for (auto &axis : axes_)
+    num_points *= axis.values.size();
+  return num_points;
+}
+
+template <typename T>
+std::string ParamSweep<T>::PointConfig(const std::vector<int> &choice) {
+  std::vector<std::string> lines(lines_);
+  for (int a = 0; a < axes_.size(); a++)
+    lines[axes_[a].line] = axes_[a].var + "=" + axes_[a].values[choice[a]];
+  std::string config;
+  for (auto &line : lines)
+    config += line + "\n";
+  return config;
+}
+
+template <typename T>
+typename ParamSweep<T>::Point ParamSweep<T>::Measure(
+    const std::vector<int> &choice) {
+  Point point;
+  for (int a = 0; a < axes_.size(); a++)
+    point.values.push_back(axes_[a].values[choice[a]]);
+  point.forward_time = 0;
+  point.backward_time = 0;
+
+  p_dnnmark_->ClearLayers();
+  std::istringstream is(PointConfig(choice));
+  p_dnnmark_->ParseLayerConfig(is);
+  p_dnnmark_->Initialize();
+
+  // One untimed pass generates the input
+  bool training = p_dnnmark_->isTraining();
+  bool data_fill_enabled = p_dnnmark_->isDataFillEnabled();
+  p_dnnmark_->Forward();
+  if (training)
+    p_dnnmark_->Backward();
+  p_dnnmark_->setDataFillEnabled(false);
+
+  Timer timer;
+  for (int iter = 0; iter < num_iterations_; iter++) {
+    timer.Start();
+    p_dnnmark_->Forward();
+    timer.Stop();
+    point.forward_time += timer.Elapsed();
+    if (!training)
+      continue;
+    timer.Start();
+    p_dnnmark_->Backward();
+    timer.Stop();
+    point.backward_time += timer.Elapsed();
+  }
+  point.forward_time /= num_iterations_;
+  point.backward_time /= num_iterations_;
+  p_dnnmark_->setDataFillEnabled(data_fill_enabled);
+  return point;
+}
+
+template <typename T>
+int ParamSweep<T>::Run() {
+  points_.clear();
+  // Odometer over the axes, the last one varies fastest
+  std::vector<int> choice(axes_.size(), 0);
+  while (true) {
+    points_.push_back(Measure(choice));
+    int a = axes_.size() - 1;
+    while (a >= 0 && ++choice[a] == axes_[a].values.size()) {
+      choice[a] = 0;
+      a--;
+    }
+    if (a < 0)
+      break;
+  }
+  p_dnnmark_->ClearLayers();
+  return 0;
+}
+
+template <typename T>
+void ParamSweep<T>::Report(const std::string &csv_file) {
+  std::ofstream csv;
+  if (!csv_file.empty()) {
+    csv.open(csv_file.c_str(), std::ofstream::out);
+    CHECK(csv.is_open()) << "Cannot write " << csv_file;
+    for (auto &axis : axes_)
+      csv << axis.label << ",";
+    csv << "forward_ms,backward_ms" << std::endl;
+  }
+  for (auto &point : points_) {
+    std::cout << "[ParamSweep]";
+    for (int a = 0; a < axes_.size(); a++)
+      std::cout << " " << axes_[a].label << ": " << point.values[a];
+    std::cout << std::fixed << std::setprecision(3)
+              << " forward: " << point.forward_time << " ms"
+              << " backward: " << point.backward_time << " ms"
+              << std::defaultfloat << std::endl;
+    if (csv.is_open()) {
+      for (auto &value : point.values)
+        csv << value << ",";
+      csv << point.forward_time << "," << point.backward_time << std::endl;
+    }
+  }
+}
+
+// Explicit instantiation
+template class ParamSweep<TestType>;
+
+} // namespace dnnmark
@@ -0,0 +1,390 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+
+#include "pipeline.h"
+
+namespace dnnmark {
+
+//
+// Pipeline class definition
+//
+
+template <typename T>
+Pipeline<T>::Pipeline(DNNMark<T> *p_dnnmark)
+: p_dnnmark_(p_dnnmark),
+  num_microbatches_(p_dnnmark->getPipelineMicrobatches()),
+  num_stages_(p_dnnmark->getPipelineStages()),
+  batch_size_(0), microbatch_size_(0),
+  makespan_(0), last_run_training_(false) {
+  CUDA_CALL(cudaEventCreate(&run_start_));
+}
+
+template <typename T>
+Pipeline<T>::~Pipeline() {
+  // Give the layers back to the default stream before streams go away
+  for (int s = 0; s < stages_.size(); s++)
+    for (auto layer : stages_[s])
+      p_dnnmark_->GetHandle()->SetStream(layer->getLayerId(), 0);
+  for (auto stream : streams_)
+    CUDA_CALL(cudaStreamDestroy(stream));
+  for (auto event : fwd_done_)
+    CUDA_CALL(cudaEventDestroy(event));
+  for (auto event : bwd_done_)
+    CUDA_CALL(cudaEventDestroy(event));
+  for (auto event : op_start_)
+    CUDA_CALL(cudaEventDestroy(event));
+  for (auto event : op_stop_)
+    CUDA_CALL(cudaEventDestroy(event));
+  for (auto event : run_stop_)
+    CUDA_CALL(cudaEventDestroy(event));
+  CUDA_CALL(cudaEventDestroy(run_start_));
+}
+
+template <typename T>
+std::vector<float> Pipeline<T>::ProfileLayers() {
+  int num_layers = p_dnnmark_->getNumLayers();
+  std::vector<float> layer_costs(num_layers, 0);
+  Timer timer;
+
+  // Warm up on the whole batch, this also fills the input data
+  p_dnnmark_->Forward();
+  p_dnnmark_->Backward();
+
+  // Measure forward plus backward cost of one micro-batch per layer
+  for (int i = 0; i < num_layers; i++) {
+    Layer<T> *layer = p_dnnmark_->GetLayerByID(i);
+    layer->SetBatchView(0, microbatch_size_);
+    timer.Start();
+    layer->ForwardPropagation();
+    layer->BackwardPropagation();
+    timer.Stop();
+    layer_costs[i] = timer.Elapsed();
+    layer->SetBatchView(0, batch_size_);
+    LOG(INFO) << "Pipeline: layer " << layer->getLayerName()
+              << " costs " << layer_costs[i] << " ms per micro-batch";
+  }
+  return layer_costs;
+}
+
+template <typename T>
+void Pipeline<T>::Partition(const std::vector<float> &layer_costs) {
+  // Split the layer sequence into contiguous stages so that the most
+  // expensive stage is as cheap as possible (linear partition problem)
+  int num_layers = layer_costs.size();
+  std::vector<double> prefix(num_layers + 1, 0);
+  for (int i = 0; i < num_layers; i++)
+    prefix[i + 1] = prefix[i] + layer_costs[i];
+
+  const double inf = std::numeric_limits<double>::max();
+  // cost[s][i]: best bottleneck placing the first i layers into s stages
+  std::vector<std::vector<double>> cost(num_stages_ + 1,
+    std::vector<double>(num_layers + 1, inf));
+  std::vector<std::vector<int>> split(num_stages_ + 1,
+    std::vector<int>(num_layers + 1, 0));
+  cost[0][0] = 0;
+  for (int s = 1; s <= num_stages_; s++) {
+    for (int i = s; i <= num_layers; i++) {
+      for (int j = s - 1; j < i; j++) {
+        if (cost[s - 1][j] == inf)
+          continue;
+        double bottleneck = std::max(cost[s - 1][j], prefix[i] - prefix[j]);
+        if (bottleneck < cost[s][i]) {
+          cost[s][i] = bottleneck;
+          split[s][i] = j;
+        }
+      }
+    }
+  }
+
+  // Walk the split points back from the last layer
+  std::vector<int> stage_begin(num_stages_ + 1, num_layers);
+  for (int s = num_stages_, i = num_layers; s > 0; s--) {
+    stage_begin[s - 1] = split[s][i];
+    i = split[s][i];
+  }
+
+  stages_.assign(num_stages_, std::vector<Layer<T> *>());
+  for (int s = 0; s < num_stages_; s++) {
+    for (int i = stage_begin[s]; i < stage_begin[s + 1]; i++)
+      stages_[s].push_back(p_dnnmark_->GetLayerByID(i));
+    LOG(INFO) << "Pipeline: stage " << s << " holds layers "
+              << stage_begin[s] << " to " << stage_begin[s + 1] - 1
+              << ", cost " << prefix[stage_begin[s + 1]] -
+                              prefix[stage_begin[s]] << " ms";
+  }
+}
+
+template <typename T>
+int Pipeline<T>::Setup() {
+  LOG(INFO) << "Pipeline: Setup...";
+  CHECK_EQ(p_dnnmark_->getRunMode(), COMPOSED)
+    << "Pipelined execution needs a composed model";
+  CHECK(p_dnnmark_->isTraining())
+    << "Pipelined execution needs mode=training";
+
+  batch_size_ = p_dnnmark_->GetLayerByID(0)->getInputDim()->n_;
+  CHECK_EQ(batch_size_ % num_microbatches_, 0)
+    << "Batch size " << batch_size_ << " is not divisible by "
+    << num_microbatches_ << " micro-batches";
+  microbatch_size_ = batch_size_ / num_microbatches_;
+
+  if (num_stages_ > p_dnnmark_->getNumLayers()) {
+    LOG(WARNING) << "More pipeline stages than layers, use "
+                 << p_dnnmark_->getNumLayers() << " stages";
+    num_stages_ = p_dnnmark_->getNumLayers();
+  }
+
+  Partition(ProfileLayers());
+
+  // One stream per stage, every layer of a stage is bound to it
+  streams_.resize(num_stages_);
+  for (int s = 0; s < num_stages_; s++) {
+    CUDA_CALL(cudaStreamCreateWithFlags(&streams_[s],
+                                        cudaStreamNonBlocking));
+    for (auto layer : stages_[s])
+      p_dnnmark_->GetHandle()->SetStream(layer->getLayerId(), streams_[s]);
+  }
+
+  int num_ops = num_stages_ * num_microbatches_;
+  fwd_done_.resize(num_ops);
+  bwd_done_.resize(num_ops);
+  for (int i = 0; i < num_ops; i++) {
+    CUDA_CALL(cudaEventCreateWithFlags(&fwd_done_[i],
+                                       cudaEventDisableTiming));
+    CUDA_CALL(cudaEventCreateWithFlags(&bwd_done_[i],
+                                       cudaEventDisableTiming));
+  }
+  // Forward and backward operations are timed separately
+  op_start_.resize(2 * num_ops);
+  op_stop_.resize(2 * num_ops);
+  for (int i = 0; i < 2 * num_ops; i++) {
+    CUDA_CALL(cudaEventCreate(&op_start_[i]));
+    CUDA_CALL(cudaEventCreate(&op_stop_[i]));
+  }
+  run_stop_.resize(num_stages_);
+  for (int s = 0; s < num_stages_; s++)
+    CUDA_CALL(cudaEventCreate(&run_stop_[s]));
+
+  return 0;
+}
+
+template <typename T>
+std::vector<typename Pipeline<T>::StageOp>
+Pipeline<T>::BuildSchedule(int stage, bool training) {
+  std::vector<StageOp> schedule;
+  if (!training || p_dnnmark_->getPipelineSchedule() == GPIPE) {
+    // Fill and drain: all forwards, then all backwards
+    for (int m = 0; m < num_microbatches_; m++)
+      schedule.push_back({m, true});
+    if (training)
+      for (int m = 0; m < num_microbatches_; m++)
+        schedule.push_back({m, false});
+    return schedule;
+  }
+
+  // 1F1B: warm up with enough forwards to fill the downstream stages,
+  // then alternate one forward and one backward, then drain backwards
+  int num_warmup = std::min(num_stages_ - stage - 1, num_microbatches_);
+  for (int m = 0; m < num_warmup; m++)
+    schedule.push_back({m, true});
+  for (int m = num_warmup; m < num_microbatches_; m++) {
+    schedule.push_back({m, true});
+    schedule.push_back({m - num_warmup, false});
+  }
+  for (int m = num_microbatches_ - num_warmup; m < num_microbatches_; m++)
+    schedule.push_back({m, false});
+  return schedule;
+}
+
+template <typename T>
+void Pipeline<T>::IssueOp(int stage, const StageOp &op) {
+  cudaStream_t stream = streams_[stage];
+  int index = stage * num_microbatches_ + op.microbatch;
+  int timing_index = 2 * index + (op.forward ? 0 : 1);
+
+  // Wait for the neighbouring stage to hand over this micro-batch
+  if (op.forward && stage > 0)
+    CUDA_CALL(cudaStreamWaitEvent(stream, fwd_done_[index - num_microbatches_],
+                                  0));
+  if (!op.forward && stage < num_stages_ - 1)
+    CUDA_CALL(cudaStreamWaitEvent(stream, bwd_done_[index + num_microbatches_],
+                                  0));
+
+  CUDA_CALL(cudaEventRecord(op_start_[timing_index], stream));
+  int begin = op.microbatch * microbatch_size_;
+  if (op.forward) {
+    for (auto it = stages_[stage].begin(); it != stages_[stage].end(); it++) {
+      (*it)->SetBatchView(begin, microbatch_size_);
+      (*it)->ForwardPropagation();
+    }
+  } else {
+    for (auto it = stages_[stage].rbegin(); it != stages_[stage].rend(); it++) {
+      (*it)->SetBatchView(begin, microbatch_size_);
+      (*it)->BackwardPropagation();
+    }
+  }
+  CUDA_CALL(cudaEventRecord(op_stop_[timing_index], stream));
+  CUDA_CALL(cudaEventRecord(op.forward ? fwd_done_[index] : bwd_done_[index],
+                            stream));
+  op_issued_[timing_index] = true;
+}
+
+template <typename T>
+int Pipeline<T>::Run(bool training) {
+  CHECK_GT(stages_.size(), 0) << "Pipeline is not set up";
+
+  std::vector<std::vector<StageOp>> schedules(num_stages_);
+  for (int s = 0; s < num_stages_; s++)
+    schedules[s] = BuildSchedule(s, training);
+
+  // Inputs were generated during setup, keep them out of the timed region
+  bool data_fill_enabled = p_dnnmark_->isDataFillEnabled();
+  p_dnnmark_->setDataFillEnabled(false);
+
+  // Every stage starts from a common point
+  CUDA_CALL(cudaDeviceSynchronize());
+  CUDA_CALL(cudaEventRecord(run_start_, streams_[0]));
+  for (int s = 1; s < num_stages_; s++)
+    CUDA_CALL(cudaStreamWaitEvent(streams_[s], run_start_, 0));
+
+  // Issue operations in an order that respects cross stage dependencies,
+  // a stream can only wait on events that have already been recorded
+  op_issued_.assign(2 * num_stages_ * num_microbatches_, false);
+  std::vector<int> next(num_stages_, 0);
+  int num_remaining = 0;
+  for (int s = 0; s < num_stages_; s++)
+    num_remaining += schedules[s].size();
+  while (num_remaining > 0) {
+    bool progress = false;
+    for (int s = 0; s < num_stages_; s++) {
+      while (next[s] < schedules[s].size()) {
+        const StageOp &op = schedules[s][next[s]];
+        int index = s * num_microbatches_ + op.microbatch;
+        bool ready = op.forward ?
+          (s == 0 || op_issued_[2 * (index - num_microbatches_)]) :
+          (s == num_stages_ - 1 ||
+           op_issued_[2 * (index + num_microbatches_) + 1]);
+        if (!ready)
+          break;
+        IssueOp(s, op);
+        next[s]++;
+        num_remaining--;
+        progress = true;
+      }
+    }
+    CHECK(progress) << "Pipeline schedule deadlocked";
+  }
+  for (int s = 0; s < num_stages_; s++)
+    CUDA_CALL(cudaEventRecord(run_stop_[s], streams_[s]));
+  CUDA_CALL(cudaDeviceSynchronize());
+
+  // Collect per-stage busy time and the overall makespan
+  stage_busy_time_.assign(num_stages_, 0);
+  makespan_ = 0;
+  for (int s = 0; s < num_stages_; s++) {
+    for (int m = 0; m < num_microbatches_; m++) {
+      for (int dir = 0; dir < (training ? 2 : 1); dir++) {
+        int timing_index = 2 * (s * num_microbatches_ + m) + dir;
+        float elapsed = 0;
+        CUDA_CALL(cudaEventElapsedTime(&elapsed, op_start_[timing_index],
+                                       op_stop_[timing_index]));
+        stage_busy_time_[s] += elapsed;
+      }
+    }
+    float elapsed = 0;
+    CUDA_CALL(cudaEventElapsedTime(&elapsed, run_start_, run_stop_[s]));
+    makespan_ = std::max(makespan_, elapsed);
+  }
+  last_run_training_ = training;
+
+  // Restore whole-batch execution for the regular passes
+  for (int s = 0; s < num_stages_; s++)
+    for (auto layer : stages_[s])
+      layer->SetBatchView(0, batch_size_);
+  p_dnnmark_->setDataFillEnabled(data_fill_enabled);
+  return 0;
+}
+
+template <typename T>
+int Pipeline<T>::Forward() {
+  LOG(INFO) << "Pipeline: Running forward with " << num_microbatches_
+            << " micro-batches over " << num_stages_ << " stages";
+  return Run(false);
+}
+
+template <typename T>
+int Pipeline<T>::Train() {
+  LOG(INFO) << "Pipeline: Running training with " << num_microbatches_
+            << " micro-batches over " << num_stages_ << " stages";
+  return Run(true);
+}
+
+template <typename T>
+float Pipeline<T>::getStageUtilization(int stage) {
+  if (makespan_ <= 0)
+    return 0;
+  return stage_busy_time_[stage] / makespan_;
+}
+
+template <typename T>
+float Pipeline<T>::getBubbleFraction() {
+  if (makespan_ <= 0)
+    return 0;
+  float busy = 0;
+  for (int s = 0; s < num_stages_; s++)
+    busy += stage_busy_time_[s];
+  return 1.0f - busy / (num_stages_ * makespan_);
+}
+
+template <typename T>
+void Pipeline<T>::Report() {
+  std::cout << "[Pipeline] "
+            << (last_run_training_ ?
+                (p_dnnmark_->getPipelineSchedule() == GPIPE ?
+                 "GPipe training" : "1F1B training") : "GPipe forward")
+            << ", " << num_stages_ << " stages, "
+            << num_microbatches_ << " micro-batches of "
+            << microbatch_size_ << std::endl;
+  std::cout << "[Pipeline] Makespan: " << makespan_ << " ms" << std::endl;
+  for (int s = 0; s < num_stages_; s++) {
+    std::cout << "[Pipeline] Stage " << s
+              << " (" << stages_[s].front()->getLayerName() << " - "
+              << stages_[s].back()->getLayerName() << ")"
+              << " busy: " << stage_busy_time_[s] << " ms"
+              << " utilization: " << std::fixed << std::setprecision(1)
+              << 100 * getStageUtilization(s) << "%"
+              << std::defaultfloat << std::endl;
+  }
+  std::cout << "[Pipeline] Bubble fraction: " << std::fixed
+            << std::setprecision(1) << 100 * getBubbleFraction() << "%"
+            << std::defaultfloat << std::endl;
+}
+
+// Explicit instantiation
+template class Pipeline<TestType>;
+
+} // namespace dnnmark
+
@@ -0,0 +1,454 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "prototxt_importer.h"
+
+namespace dnnmark {
+
+namespace {
+
+struct Token {
+  std::string text_;
+  int line_;
+  bool quoted_;
+};
+
+bool isPunct(const Token &token, char c) {
+  return !token.quoted_ && token.text_.size() == 1 && token.text_[0] == c;
+}
+
+void Tokenize(const std::string &file, std::vector<Token> *tokens) {
+  std::ifstream is(file.c_str(), std::ifstream::in);
+  CHECK(is.is_open()) << "Cannot open " << file;
+  std::stringstream buffer;
+  buffer << is.rdbuf();
+  const std::string text = buffer.str();
+
+  int line = 1;
+  size_t i = 0;
+  while (i < text.size()) {
+    char c = text[i];
+    if (c == '\n') {
+      line++;
+      i++;
+    } else if (isspace(c) || c == ',' || c == ';') {
+      i++;
+    } else if (c == '#') {
+      while (i < text.size() && text[i] != '\n')
+        i++;
+    } else if (c == '"' || c == '\'') {
+      Token token = {"", line, true};
+      for (i++; i < text.size() && text[i] != c; i++) {
+        if (text[i] == '\\' && i + 1 < text.size())
+          i++;
+        token.text_ += text[i];
+      }
+      CHECK_LT(i, text.size()) << file << ":" << line
+                               << ": Unterminated string";
+      i++;
+      tokens->push_back(token);
+    } else if (c == ':' || c == '{' || c == '}' || c == '<' || c == '>') {
+      // Angle brackets are an alternative spelling of braces
+      char brace = c == '<' ? '{' : (c == '>' ? '}' : c);
+      tokens->push_back(Token{std::string(1, brace), line, false});
+      i++;
+    } else {
+      Token token = {"", line, false};
+      while (i < text.size() && !isspace(text[i]) &&
+             std::string(":{}<>#\"',;").find(text[i]) == std::string::npos)
+        token.text_ += text[i++];
+      tokens->push_back(token);
+    }
+  }
+}
+
+// Fields up to the closing brace of a nested message or the end of file
+void ParseMessage(const std::vector<Token> &tokens, size_t *pos,
+                  bool nested, const std::string &file,
+                  PrototxtMessage *message) {
+  while (*pos < tokens.size()) {
+    const Token &name = tokens[*pos];
+    if (isPunct(name, '}')) {
+      CHECK(nested) << file << ":" << name.line_ << ": Unmatched }";
+      (*pos)++;
+      return;
+    }
+    CHECK(!name.quoted_ && !isPunct(name, ':') && !isPunct(name, '{'))
+      << file << ":" << name.line_ << ": Expected a field name, found "
+      << name.text_;
+    (*pos)++;
+    if (*pos < tokens.size() && isPunct(tokens[*pos], ':'))
+      (*pos)++;
+    CHECK_LT(*pos, tokens.size())
+      << file << ":" << name.line_ << ": " << name.text_ << " has no value";
+    const Token &value = tokens[*pos];
+    (*pos)++;
+    if (isPunct(value, '{')) {
+      std::shared_ptr<PrototxtMessage> child =
+        std::make_shared<PrototxtMessage>();
+      child->line_ = name.line_;
+      ParseMessage(tokens, pos, true, file, child.get());
+      message->messages_.push_back(std::make_pair(name.text_, child));
+    } else {
+      CHECK(value.quoted_ || (!isPunct(value, '}') && !isPunct(value, ':')))
+        << file << ":" << value.line_ << ": " << name.text_
+        << " has no value";
+      message->scalars_.push_back(std::make_pair(name.text_, value.text_));
+    }
+  }
+  CHECK(!nested) << file << ": Missing } of the message at line "
+                 << message->line_;
+}
+
+// Spatial parameters are repeated, given once for both dimensions or
+// given per dimension
+void Spatial(const PrototxtMessage &param, const std::string &field,
+             const std::string &field_h, const std::string &field_w,
+             int default_value, int *h, int *w) {
+  std::vector<std::string> values = param.GetAll(field);
+  *h = *w = default_value;
+  if (values.size() == 1) {
+    *h = *w = atoi(values[0].c_str());
+  } else if (values.size() >= 2) {
+    *h = atoi(values[0].c_str());
+    *w = atoi(values[1].c_str());
+  }
+  if (param.Has(field_h))
+    *h = atoi(param.Get(field_h).c_str());
+  if (param.Has(field_w))
+    *w = atoi(param.Get(field_w).c_str());
+}
+
+} // namespace
+
+//
+// PrototxtMessage definition
+//
+
+bool PrototxtMessage::Has(const std::string &field) const {
+  for (auto &scalar : scalars_)
+    if (scalar.first == field)
+      return true;
+  return Child(field) != nullptr;
+}
+
+std::string PrototxtMessage::Get(const std::string &field,
+                                 const std::string &default_value) const {
+  for (auto &scalar : scalars_)
+    if (scalar.first == field)
+      return scalar.second;
+  return default_value;
+}
+
+std::vector<std::string> PrototxtMessage::GetAll(
+    const std::string &field) const {
+  std::vector<std::string> values;
+  for (auto &scalar : scalars_)
+    if (scalar.first == field)
+      values.push_back(scalar.second);
+  return values;
+}
+
+const PrototxtMessage *PrototxtMessage::Child(
+    const std::string &field) const {
+  for (auto &message : messages_)
+    if (message.first == field)
+      return message.second.get();
+  return nullptr;
+}
+
+std::vector<const PrototxtMessage *> PrototxtMessage::Children(
+    const std::string &field) const {
+  std::vector<const PrototxtMessage *> children;
+  for (auto &message : messages_)
+    if (message.first == field)
+      children.push_back(message.second.get());
+  return children;
+}
+
+//
+// PrototxtImporter class definition
+//
+
+template <typename T>
+PrototxtImporter<T>::PrototxtImporter(DNNMark<T> *p_dnnmark)
+: p_dnnmark_(p_dnnmark), num_layers_(0), num_folded_(0), num_skipped_(0) {}
+
+template <typename T>
+int PrototxtImporter<T>::Import(const std::string &file, int batch_size) {
+  file_ = file;
+  std::vector<Token> tokens;
+  Tokenize(file, &tokens);
+  PrototxtMessage net;
+  net.line_ = 1;
+  size_t pos = 0;
+  ParseMessage(tokens, &pos, false, file, &net);
+
+  LOG_IF(FATAL, net.Has("layers"))
+    << file << ": V1 \"layers\" definitions are not supported, upgrade "
+    << "the file with Caffe's upgrade_net_proto_text";
+  p_dnnmark_->Set("run_mode", "composed");
+
+  // Network inputs declared outside of any layer
+  std::vector<std::string> inputs = net.GetAll("input");
+  std::vector<std::string> input_dims = net.GetAll("input_dim");
+  std::vector<const PrototxtMessage *> input_shapes =
+    net.Children("input_shape");
+  for (size_t i = 0; i < inputs.size(); i++) {
+    std::vector<std::string> dims;
+    if (i < input_shapes.size())
+      dims = input_shapes[i]->GetAll("dim");
+    else if (input_dims.size() >= 4 * (i + 1))
+      dims.assign(input_dims.begin() + 4 * i, input_dims.begin() + 4 * i + 4);
+    AddInput(inputs[i], dims, batch_size, net.line_);
+  }
+
+  for (auto layer : net.Children("layer")) {
+    if (layer->Get("type") == "Input") {
+      const PrototxtMessage *param = layer->Child("input_param");
+      const PrototxtMessage *shape = param ? param->Child("shape") : nullptr;
+      for (auto &top : layer->GetAll("top"))
+        AddInput(top, shape ? shape->GetAll("dim") :
+                              std::vector<std::string>(),
+                 batch_size, layer->line_);
+      continue;
+    }
+    ImportLayer(*layer);
+  }
+  LOG_IF(FATAL, num_layers_ == 0) << file << ": No layer to import";
+  return 0;
+}
+
+template <typename T>
+void PrototxtImporter<T>::AddInput(const std::string &blob,
+                                   const std::vector<std::string> &dims,
+                                   int batch_size, int line) {
+  LOG_IF(FATAL, dims.size() != 4)
+    << file_ << ":" << line << ": Input " << blob
+    << " needs a 4-dimensional NCHW shape, training definitions with data "
+    << "layers have to be turned into deploy definitions";
+  DataDim dim(atoi(dims[0].c_str()), atoi(dims[1].c_str()),
+              atoi(dims[2].c_str()), atoi(dims[3].c_str()));
+  if (batch_size > 0)
+    dim.n_ = batch_size;
+  producers_[blob] = "null";
+  shapes_[blob] = dim;
+}
+
+template <typename T>
+void PrototxtImporter<T>::ImportLayer(const PrototxtMessage &layer) {
+  std::string name = layer.Get("name");
+  std::string type = layer.Get("type");
+  std::vector<std::string> bottoms = layer.GetAll("bottom");
+  std::vector<std::string> tops = layer.GetAll("top");
+  std::ostringstream where;
+  where << file_ << ":" << layer.line_ << ": Layer " << name << " (" << type
+        << ")";
+
+  // Layers of the test phase only, e.g. Accuracy
+  for (auto include : layer.Children("include"))
+    if (include->Get("phase") == "TEST") {
+      num_skipped_++;
+      return;
+    }
+
+  // The label of a loss is not part of the network
+  if (type == "SoftmaxWithLoss" && bottoms.size() == 2)
+    bottoms.resize(1);
+  LOG_IF(FATAL, bottoms.size() != 1 || tops.size() != 1)
+    << where.str() << ": Only layers with one bottom and one top are "
+    << "supported, DNNMark networks are chains";
+  const std::string &bottom = bottoms[0];
+  const std::string &top = tops[0];
+  LOG_IF(FATAL, producers_.find(bottom) == producers_.end())
+    << where.str() << ": Unknown bottom " << bottom;
+  std::string previous_layer = producers_[bottom];
+  DataDim in = shapes_[bottom];
+  DataDim out = in;
+  // Only first layers take the input dimension
+  DataDim input_dim = previous_layer == "null" ? in : DataDim();
+
+  if (type == "Scale" && bn_blobs_.count(bottom)) {
+    // Scale and bias of the preceding batch normalization
+    producers_[top] = previous_layer;
+    shapes_[top] = in;
+    bn_blobs_.insert(top);
+    num_folded_++;
+    return;
+  }
+
+  if (type == "Convolution") {
+    const PrototxtMessage *param = layer.Child("convolution_param");
+    LOG_IF(FATAL, param == nullptr || !param->Has("num_output"))
+      << where.str() << ": convolution_param.num_output is missing";
+    LOG_IF(FATAL, atoi(param->Get("group", "1").c_str()) != 1)
+      << where.str() << ": Grouped convolution is not supported";
+    for (auto &dilation : param->GetAll("dilation"))
+      LOG_IF(FATAL, atoi(dilation.c_str()) != 1)
+        << where.str() << ": Dilated convolution is not supported";
+    ConvolutionParam conv;
+    conv.output_num_ = atoi(param->Get("num_output").c_str());
+    Spatial(*param, "kernel_size", "kernel_h", "kernel_w", 0,
+            &conv.kernel_size_h_, &conv.kernel_size_w_);
+    Spatial(*param, "pad", "pad_h", "pad_w", 0, &conv.pad_h_, &conv.pad_w_);
+    Spatial(*param, "stride", "stride_h", "stride_w", 1,
+            &conv.stride_u_, &conv.stride_v_);
+    p_dnnmark_->AddConvolution(name, previous_layer, conv, input_dim);
+    out.c_ = conv.output_num_;
+    out.h_ = (in.h_ + 2 * conv.pad_h_ - conv.kernel_size_h_) /
+             conv.stride_u_ + 1;
+    out.w_ = (in.w_ + 2 * conv.pad_w_ - conv.kernel_size_w_) /
+             conv.stride_v_ + 1;
+  } else if (type == "Pooling") {
+    const PrototxtMessage *param = layer.Child("pooling_param");
+    PrototxtMessage empty;
+    if (param == nullptr)
+      param = &empty;
+    PoolingParam pool;
+    std::string mode = param->Get("pool", "MAX");
+    if (mode == "MAX")
+      pool.mode_ = CUDNN_POOLING_MAX;
+    else if (mode == "AVE")
+      pool.mode_ = CUDNN_POOLING_AVERAGE_COUNT_INCLUDE_PADDING;
+    else
+      LOG(FATAL) << where.str() << ": " << mode
+                 << " pooling is not supported";
+    if (param->Get("global_pooling") == "true") {
+      pool.kernel_size_h_ = in.h_;
+      pool.kernel_size_w_ = in.w_;
+      pool.pad_h_ = pool.pad_w_ = 0;
+      pool.stride_h_ = pool.stride_w_ = 1;
+    } else {
+      Spatial(*param, "kernel_size", "kernel_h", "kernel_w", 0,
+              &pool.kernel_size_h_, &pool.kernel_size_w_);
+      Spatial(*param, "pad", "pad_h", "pad_w", 0, &pool.pad_h_, &pool.pad_w_);
+      Spatial(*param, "stride", "stride_h", "stride_w", 1,
+              &pool.stride_h_, &pool.stride_w_);
+    }
+    p_dnnmark_->AddPooling(name, previous_layer, pool, input_dim);
+    out.h_ = (in.h_ + 2 * pool.pad_h_ - pool.kernel_size_h_) /
+             pool.stride_h_ + 1;
+    out.w_ = (in.w_ + 2 * pool.pad_w_ - pool.kernel_size_w_) /
+             pool.stride_w_ + 1;
+    // Caffe rounds the pooled size up, cuDNN down
+    int caffe_h = static_cast<int>(std::ceil(
+      static_cast<float>(in.h_ + 2 * pool.pad_h_ - pool.kernel_size_h_) /
+      pool.stride_h_)) + 1;
+    int caffe_w = static_cast<int>(std::ceil(
+      static_cast<float>(in.w_ + 2 * pool.pad_w_ - pool.kernel_size_w_) /
+      pool.stride_w_)) + 1;
+    LOG_IF(WARNING, caffe_h != out.h_ || caffe_w != out.w_)
+      << where.str() << ": Output is " << out.h_ << "x" << out.w_
+      << " where Caffe computes " << caffe_h << "x" << caffe_w;
+  } else if (type == "LRN") {
+    const PrototxtMessage *param = layer.Child("lrn_param");
+    PrototxtMessage empty;
+    if (param == nullptr)
+      param = &empty;
+    LOG_IF(FATAL, param->Get("norm_region", "ACROSS_CHANNELS") !=
+                  "ACROSS_CHANNELS")
+      << where.str() << ": Only ACROSS_CHANNELS normalization is supported";
+    LRNParam lrn;
+    lrn.local_size_ = atoi(param->Get("local_size", "5").c_str());
+    lrn.alpha_ = atof(param->Get("alpha", "1").c_str());
+    lrn.beta_ = atof(param->Get("beta", "0.75").c_str());
+    lrn.k_ = atof(param->Get("k", "1").c_str());
+    p_dnnmark_->AddLRN(name, previous_layer, lrn, input_dim);
+  } else if (type == "ReLU" || type == "Sigmoid" || type == "TanH") {
+    const PrototxtMessage *param = layer.Child("relu_param");
+    LOG_IF(FATAL, param && atof(param->Get("negative_slope", "0").c_str()))
+      << where.str() << ": Leaky ReLU is not supported";
+    ActivationParam activation;
+    if (type == "ReLU")
+      activation.mode_ = CUDNN_ACTIVATION_RELU;
+    else if (type == "Sigmoid")
+      activation.mode_ = CUDNN_ACTIVATION_SIGMOID;
+    else
+      activation.mode_ = CUDNN_ACTIVATION_TANH;
+    p_dnnmark_->AddActivation(name, previous_layer, activation, input_dim);
+  } else if (type == "InnerProduct") {
+    const PrototxtMessage *param = layer.Child("inner_product_param");
+    LOG_IF(FATAL, param == nullptr || !param->Has("num_output"))
+      << where.str() << ": inner_product_param.num_output is missing";
+    FullyConnectedParam fc;
+    fc.output_num_ = atoi(param->Get("num_output").c_str());
+    p_dnnmark_->AddFullyConnected(name, previous_layer, fc, input_dim);
+    out.c_ = fc.output_num_;
+    out.h_ = out.w_ = 1;
+  } else if (type == "Softmax" || type == "SoftmaxWithLoss") {
+    const PrototxtMessage *param = layer.Child("softmax_param");
+    LOG_IF(FATAL, param && param->Get("axis", "1") != "1")
+      << where.str() << ": Only the softmax over channels is supported";
+    SoftmaxParam softmax;
+    softmax.mode_ = CUDNN_SOFTMAX_MODE_CHANNEL;
+    p_dnnmark_->AddSoftmax(name, previous_layer, softmax, input_dim);
+  } else if (type == "BatchNorm") {
+    const PrototxtMessage *param = layer.Child("batch_norm_param");
+    PrototxtMessage empty;
+    if (param == nullptr)
+      param = &empty;
+    BatchNormParam bn;
+    bn.mode_ = CUDNN_BATCHNORM_SPATIAL;
+    bn.use_global_stats_ = param->Get("use_global_stats") == "true";
+    // Caffe keeps that fraction of the running statistics, cuDNN takes
+    // the weight of the new batch
+    bn.exp_avg_factor_ =
+      1 - atof(param->Get("moving_average_fraction", "0.999").c_str());
+    bn.epsilon_ = atof(param->Get("eps", "1e-5").c_str());
+    p_dnnmark_->AddBatchNorm(name, previous_layer, bn, input_dim);
+    bn_blobs_.insert(top);
+  } else if (type == "Dropout") {
+    const PrototxtMessage *param = layer.Child("dropout_param");
+    DropoutParam dropout;
+    if (param)
+      dropout.dropout_p_ = atof(param->Get("dropout_ratio", "0.5").c_str());
+    p_dnnmark_->AddDropout(name, previous_layer, dropout, input_dim);
+  } else {
+    LOG(FATAL) << where.str() << ": " << type
+               << " layers are not supported by DNNMark";
+  }
+
+  producers_[top] = name;
+  shapes_[top] = out;
+  if (type != "BatchNorm")
+    bn_blobs_.erase(top);
+  num_layers_++;
+}
+
+template <typename T>
+void PrototxtImporter<T>::Report() {
+  std::cout << "[Prototxt Importer] " << file_ << ": " << num_layers_
+            << " layers, " << num_folded_
+            << " Scale layers folded into batch normalization, "
+            << num_skipped_ << " test phase layers skipped" << std::endl;
+}
+
+// Explicit instantiation
+template class PrototxtImporter<TestType>;
+
+} // namespace dnnmark
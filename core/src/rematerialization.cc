@@ -0,0 +1,351 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+
+#include "rematerialization.h"
+
+namespace dnnmark {
+
+//
+// Rematerialization class definition
+//
+
+template <typename T>
+Rematerialization<T>::Rematerialization(DNNMark<T> *p_dnnmark)
+: p_dnnmark_(p_dnnmark), num_layers_(0), num_units_(0),
+  total_activation_bytes_(0),
+  baseline_step_time_(0), budget_(0), planned_recompute_cost_(0),
+  planned_peak_bytes_(0), resident_bytes_(0), peak_resident_bytes_(0),
+  step_time_(0) {
+  CHECK_EQ(p_dnnmark_->getRunMode(), COMPOSED)
+    << "Rematerialization requires composed mode";
+  CHECK(p_dnnmark_->isTraining()) << "Rematerialization requires mode=training";
+}
+
+template <typename T>
+int Rematerialization<T>::Setup() {
+  num_layers_ = p_dnnmark_->getNumLayers();
+  CHECK_GT(num_layers_, 0);
+
+  // The planner works on a chain, each layer consumes its predecessor
+  DataManager<T> *data_manager = DataManager<T>::GetInstance();
+  total_activation_bytes_ = 0;
+  for (int i = 0; i < num_layers_; i++) {
+    Layer<T> *layer = p_dnnmark_->GetLayerByID(i);
+    std::string expected = i == 0 ? "null" :
+                           p_dnnmark_->GetLayerByID(i - 1)->getLayerName();
+    CHECK_EQ(layer->getPrevLayerName(), expected)
+      << "Rematerialization: layer " << layer->getLayerName()
+      << " does not follow " << expected << ", only chains are supported";
+    if (i > 0 && layer->isInPlace()) {
+      units_.back().push_back(layer);
+      continue;
+    }
+    units_.push_back(std::vector<Layer<T> *>(1, layer));
+    activations_.push_back(data_manager->GetData(layer->getTopChunkID(0)));
+    activation_bytes_.push_back(activations_.back()->getSize() * sizeof(T));
+    total_activation_bytes_ += activation_bytes_.back();
+  }
+  num_units_ = units_.size();
+
+  Profile();
+
+  // Keep everything until a plan says otherwise
+  return Plan(total_activation_bytes_);
+}
+
+template <typename T>
+void Rematerialization<T>::Profile() {
+  Timer timer;
+
+  // Warm up on the whole model, this also fills the input data
+  p_dnnmark_->Forward();
+  p_dnnmark_->Backward();
+
+  // Time a step the same way Train runs it, without input generation
+  bool data_fill_enabled = p_dnnmark_->isDataFillEnabled();
+  p_dnnmark_->setDataFillEnabled(false);
+  timer.Start();
+  p_dnnmark_->Forward();
+  p_dnnmark_->Backward();
+  timer.Stop();
+  baseline_step_time_ = timer.Elapsed();
+
+  forward_costs_.assign(num_units_, 0);
+  for (int u = 0; u < num_units_; u++) {
+    timer.Start();
+    ForwardUnit(u);
+    timer.Stop();
+    forward_costs_[u] = timer.Elapsed();
+    LOG(INFO) << "Rematerialization: layer " << units_[u][0]->getLayerName()
+              << " forward costs " << forward_costs_[u] << " ms, top "
+              << activation_bytes_[u] << " bytes";
+  }
+  p_dnnmark_->setDataFillEnabled(data_fill_enabled);
+}
+
+template <typename T>
+float Rematerialization<T>::SolveForBound(size_t segment_bound,
+                                          size_t checkpoint_budget,
+                                          std::vector<bool> *checkpoint) {
+  // Checkpoint memory is counted in units so it can index the table,
+  // sizes are rounded up so the plan never exceeds the budget
+  const int max_units = 1024;
+  size_t unit = std::max<size_t>(1,
+    (checkpoint_budget + max_units - 1) / max_units);
+  int Q = checkpoint_budget / unit;
+  std::vector<int> units(num_units_);
+  for (int i = 0; i < num_units_; i++)
+    units[i] = (activation_bytes_[i] + unit - 1) / unit;
+
+  // cost[i][q]: cheapest recompute with a checkpoint at layer i and q
+  // units of checkpoints up to it. Index 0 stands for the model input
+  // which is always kept, layer i is at index i + 1.
+  const float inf = std::numeric_limits<float>::max();
+  std::vector<std::vector<float>> cost(num_units_ + 1,
+    std::vector<float>(Q + 1, inf));
+  std::vector<std::vector<std::pair<int, int>>> parent(num_units_ + 1,
+    std::vector<std::pair<int, int>>(Q + 1, std::make_pair(-1, -1)));
+  cost[0][0] = 0;
+  for (int i = 1; i <= num_units_; i++) {
+    size_t segment_bytes = 0;
+    float recompute = 0;
+    // Previous checkpoint at j, layers j + 1 .. i - 1 are recomputed
+    for (int j = i - 1; j >= 0; j--) {
+      if (j < i - 1) {
+        segment_bytes += activation_bytes_[j];
+        recompute += forward_costs_[j];
+      }
+      if (segment_bytes > segment_bound)
+        break;
+      for (int q = 0; q + units[i - 1] <= Q; q++) {
+        if (cost[j][q] == inf)
+          continue;
+        int next_q = q + units[i - 1];
+        if (cost[j][q] + recompute < cost[i][next_q]) {
+          cost[i][next_q] = cost[j][q] + recompute;
+          parent[i][next_q] = std::make_pair(j, q);
+        }
+      }
+    }
+  }
+
+  // The last top is needed first in backward, so it is always kept
+  int best_q = -1;
+  for (int q = 0; q <= Q; q++)
+    if (cost[num_units_][q] != inf &&
+        (best_q < 0 || cost[num_units_][q] < cost[num_units_][best_q]))
+      best_q = q;
+  if (best_q < 0)
+    return -1;
+
+  checkpoint->assign(num_units_, false);
+  for (int i = num_units_, q = best_q; i > 0;) {
+    (*checkpoint)[i - 1] = true;
+    std::pair<int, int> p = parent[i][q];
+    i = p.first;
+    q = p.second;
+  }
+  return cost[num_units_][best_q];
+}
+
+template <typename T>
+int Rematerialization<T>::Plan(size_t budget) {
+  budget_ = budget;
+
+  // The peak is the kept checkpoints plus the largest segment that is
+  // rematerialized at once. Every candidate bound on the segment splits
+  // the budget between the two, the cheapest of them wins.
+  std::vector<size_t> bounds;
+  for (int i = 0; i < num_units_; i++) {
+    size_t segment_bytes = 0;
+    bounds.push_back(0);
+    for (int j = i; j < num_units_ - 1; j++) {
+      segment_bytes += activation_bytes_[j];
+      bounds.push_back(segment_bytes);
+    }
+  }
+  std::sort(bounds.begin(), bounds.end());
+  bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+  // Long chains only try a sample of bounds, which is near-optimal
+  const int max_bounds = 64;
+  if (bounds.size() > max_bounds) {
+    std::vector<size_t> sampled;
+    for (int k = 0; k < max_bounds; k++)
+      sampled.push_back(bounds[k * (bounds.size() - 1) / (max_bounds - 1)]);
+    bounds.swap(sampled);
+  }
+
+  while (true) {
+    float best_cost = -1;
+    for (auto bound : bounds) {
+      if (bound > budget)
+        break;
+      std::vector<bool> checkpoint;
+      float cost = SolveForBound(bound, budget - bound, &checkpoint);
+      if (cost < 0 || (best_cost >= 0 && cost >= best_cost))
+        continue;
+      best_cost = cost;
+      checkpoint_ = checkpoint;
+    }
+    if (best_cost >= 0) {
+      planned_recompute_cost_ = best_cost;
+      break;
+    }
+    size_t relaxed = budget + budget / 4 + 1;
+    LOG(WARNING) << "Rematerialization: budget of " << budget
+                 << " bytes is not feasible, trying " << relaxed;
+    budget = relaxed;
+  }
+
+  planned_peak_bytes_ = 0;
+  size_t segment_bytes = 0, max_segment_bytes = 0;
+  for (int i = 0; i < num_units_; i++) {
+    if (checkpoint_[i]) {
+      planned_peak_bytes_ += activation_bytes_[i];
+      segment_bytes = 0;
+    } else {
+      segment_bytes += activation_bytes_[i];
+      max_segment_bytes = std::max(max_segment_bytes, segment_bytes);
+    }
+  }
+  planned_peak_bytes_ += max_segment_bytes;
+  LOG(INFO) << "Rematerialization: " << getNumCheckpoints()
+            << " checkpoints, planned peak " << planned_peak_bytes_
+            << " bytes, recompute " << planned_recompute_cost_ << " ms";
+  return 0;
+}
+
+template <typename T>
+void Rematerialization<T>::ForwardUnit(int unit) {
+  for (auto layer : units_[unit])
+    layer->ForwardPropagation();
+}
+
+template <typename T>
+void Rematerialization<T>::BackwardUnit(int unit) {
+  for (auto it = units_[unit].rbegin(); it != units_[unit].rend(); it++)
+    (*it)->BackwardPropagation();
+}
+
+template <typename T>
+void Rematerialization<T>::Release(int unit) {
+  if (!activations_[unit]->isResident())
+    return;
+  activations_[unit]->Release();
+  resident_bytes_ -= activation_bytes_[unit];
+}
+
+template <typename T>
+void Rematerialization<T>::Acquire(int unit) {
+  if (activations_[unit]->isResident())
+    return;
+  activations_[unit]->Acquire();
+  resident_bytes_ += activation_bytes_[unit];
+  peak_resident_bytes_ = std::max(peak_resident_bytes_, resident_bytes_);
+}
+
+template <typename T>
+int Rematerialization<T>::Train() {
+  bool data_fill_enabled = p_dnnmark_->isDataFillEnabled();
+  p_dnnmark_->setDataFillEnabled(false);
+  Timer timer;
+
+  // Chunks are released to the device allocator, so the step time
+  // includes cudaMalloc and cudaFree. The first step is a warmup.
+  for (int iter = 0; iter < 2; iter++) {
+    resident_bytes_ = total_activation_bytes_;
+    for (int i = 0; i < num_units_; i++)
+      if (!checkpoint_[i])
+        Release(i);
+    peak_resident_bytes_ = resident_bytes_;
+    CUDA_CALL(cudaDeviceSynchronize());
+
+    timer.Start();
+    // Forward: a top is dropped once its consumer has run
+    for (int i = 0; i < num_units_; i++) {
+      Acquire(i);
+      ForwardUnit(i);
+      if (i > 0 && !checkpoint_[i - 1])
+        Release(i - 1);
+    }
+    // Backward: segment by segment from the last checkpoint
+    for (int end = num_units_ - 1; end >= 0;) {
+      int begin = end - 1;
+      while (begin >= 0 && !checkpoint_[begin])
+        begin--;
+      for (int k = begin + 1; k < end; k++) {
+        Acquire(k);
+        ForwardUnit(k);
+      }
+      for (int k = end; k > begin; k--) {
+        BackwardUnit(k);
+        if (!checkpoint_[k])
+          Release(k);
+      }
+      end = begin;
+    }
+    timer.Stop();
+    step_time_ = timer.Elapsed();
+  }
+
+  // Leave the model fully resident again
+  for (int i = 0; i < num_units_; i++)
+    Acquire(i);
+  p_dnnmark_->setDataFillEnabled(data_fill_enabled);
+  return 0;
+}
+
+template <typename T>
+int Rematerialization<T>::getNumCheckpoints() {
+  return std::count(checkpoint_.begin(), checkpoint_.end(), true);
+}
+
+template <typename T>
+void Rematerialization<T>::Report() {
+  const double MB = 1024.0 * 1024.0;
+  std::cout << std::fixed << std::setprecision(2)
+            << "[Rematerialization] budget: " << budget_ / MB << " MB"
+            << " checkpoints: " << getNumCheckpoints() << "/" << num_units_
+            << " planned peak: " << planned_peak_bytes_ / MB << " MB"
+            << " peak: " << getPeakActivationBytes() / MB << " MB"
+            << " saved: " << getSavedActivationBytes() / MB << " MB ("
+            << 100.0 * getSavedActivationBytes() / total_activation_bytes_
+            << "%)" << std::setprecision(3)
+            << " step: " << getStepTime() << " ms"
+            << " baseline: " << getBaselineStepTime() << " ms"
+            << " overhead: " << getRecomputeOverhead() << " ms ("
+            << std::setprecision(1)
+            << 100 * getRecomputeOverhead() / getBaselineStepTime()
+            << "%, planned " << std::setprecision(3)
+            << planned_recompute_cost_ << " ms)"
+            << std::defaultfloat << std::endl;
+}
+
+// Explicit instantiation
+template class Rematerialization<TestType>;
+
+} // namespace dnnmark
+
@@ -0,0 +1,276 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+
+#include "snapshot.h"
+
+namespace dnnmark {
+
+namespace {
+
+const char kMagic[8] = {'D', 'N', 'N', 'M', 'S', 'N', 'A', 'P'};
+
+double NowMs() {
+  return std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename V>
+void Put(std::string *header, V value) {
+  header->append(reinterpret_cast<const char *>(&value), sizeof(V));
+}
+
+// Bounds-checked reader over the mapped header
+class HeaderReader {
+ private:
+  const unsigned char *base_;
+  size_t size_;
+  size_t pos_;
+  const std::string &file_;
+ public:
+  HeaderReader(const unsigned char *base, size_t size,
+               const std::string &file)
+  : base_(base), size_(size), pos_(0), file_(file) {}
+  const unsigned char *Take(size_t bytes) {
+    CHECK_LE(pos_ + bytes, size_) << file_ << ": truncated snapshot header";
+    const unsigned char *p = base_ + pos_;
+    pos_ += bytes;
+    return p;
+  }
+  template <typename V>
+  V Get() {
+    V value;
+    memcpy(&value, Take(sizeof(V)), sizeof(V));
+    return value;
+  }
+};
+
+} // namespace
+
+//
+// Snapshot class definition
+//
+
+template <typename T>
+Snapshot<T>::Snapshot(DNNMark<T> *p_dnnmark)
+: p_dnnmark_(p_dnnmark),
+  num_tensors_(0), num_skipped_(0), bytes_(0), time_(0) {}
+
+template <typename T>
+void Snapshot<T>::Collect() {
+  tensors_.clear();
+  // In-place layers share chunks, each is stored once
+  std::set<int> seen;
+  auto add = [&](const std::string &name, int chunk_id,
+                 const std::vector<unsigned long long> &dims) {
+    if (!seen.insert(chunk_id).second)
+      return;
+    Tensor tensor;
+    tensor.name_ = name;
+    tensor.chunk_id_ = chunk_id;
+    tensor.dims_ = dims;
+    tensors_.push_back(tensor);
+  };
+
+  DataManager<T> *data_manager = DataManager<T>::GetInstance();
+  for (int i = 0; i < p_dnnmark_->getNumLayers(); i++) {
+    Layer<T> *layer = p_dnnmark_->GetLayerByID(i);
+    std::string name = layer->getLayerName();
+    // Inputs of the first layers, dataset batches are not part of a model
+    if (layer->isDataFillLayer()) {
+      DataDim *dim = layer->getInputDim();
+      for (int j = 0; j < layer->getNumBottoms(); j++)
+        if (!data_manager->GetData(layer->getBottomChunkID(j))->hasSource())
+          add(name + ".bottom" + std::to_string(j),
+              layer->getBottomChunkID(j),
+              {static_cast<unsigned long long>(dim->n_),
+               static_cast<unsigned long long>(dim->c_),
+               static_cast<unsigned long long>(dim->h_),
+               static_cast<unsigned long long>(dim->w_)});
+    }
+    for (int j = 0; j < layer->getNumParams(); j++)
+      add(name + ".param" + std::to_string(j), layer->getParamChunkID(j),
+          {static_cast<unsigned long long>(
+             data_manager->GetData(layer->getParamChunkID(j))->getSize())});
+    for (int j = 0; j < layer->getNumStates(); j++)
+      add(name + ".state" + std::to_string(j), layer->getStateChunkID(j),
+          {static_cast<unsigned long long>(
+             data_manager->GetData(layer->getStateChunkID(j))->getSize())});
+  }
+}
+
+template <typename T>
+int Snapshot<T>::Save(const std::string &file) {
+  double start = NowMs();
+  Collect();
+  DataManager<T> *data_manager = DataManager<T>::GetInstance();
+
+  // The header size fixes where the first payload starts
+  size_t header_size = sizeof(kMagic) + 2 * sizeof(unsigned int);
+  for (auto &tensor : tensors_)
+    header_size += 3 * sizeof(unsigned int) + tensor.name_.size() +
+                   (tensor.dims_.size() + 2) * sizeof(unsigned long long);
+
+  std::string header(kMagic, sizeof(kMagic));
+  Put<unsigned int>(&header, kVersion);
+  Put<unsigned int>(&header, tensors_.size());
+  unsigned long long offset = header_size;
+  std::vector<unsigned long long> offsets;
+  for (auto &tensor : tensors_) {
+    unsigned long long bytes =
+      data_manager->GetData(tensor.chunk_id_)->getSize() * sizeof(T);
+    offset = (offset + kAlignment - 1) / kAlignment * kAlignment;
+    offsets.push_back(offset);
+    Put<unsigned int>(&header, tensor.name_.size());
+    header.append(tensor.name_);
+    Put<unsigned int>(&header, DataType<T>::type);
+    Put<unsigned int>(&header, tensor.dims_.size());
+    for (auto dim : tensor.dims_)
+      Put<unsigned long long>(&header, dim);
+    Put<unsigned long long>(&header, offset);
+    Put<unsigned long long>(&header, bytes);
+    offset += bytes;
+  }
+  CHECK_EQ(header.size(), header_size);
+
+  std::ofstream os(file.c_str(), std::ofstream::binary);
+  CHECK(os.good()) << "Cannot create " << file;
+  os.write(header.data(), header.size());
+  CUDA_CALL(cudaDeviceSynchronize());
+  bytes_ = 0;
+  std::vector<T> host;
+  for (size_t i = 0; i < tensors_.size(); i++) {
+    Data<T> *data = data_manager->GetData(tensors_[i].chunk_id_);
+    host.resize(data->getSize());
+    CUDA_CALL(cudaMemcpy(host.data(), data->Get(), host.size() * sizeof(T),
+                         cudaMemcpyDeviceToHost));
+    // Zero padding up to the aligned payload offset
+    std::string padding(offsets[i] - static_cast<size_t>(os.tellp()), '\0');
+    os.write(padding.data(), padding.size());
+    os.write(reinterpret_cast<const char *>(host.data()),
+             host.size() * sizeof(T));
+    bytes_ += host.size() * sizeof(T);
+  }
+  CHECK(os.good()) << "Cannot write " << file;
+  os.close();
+
+  num_tensors_ = tensors_.size();
+  num_skipped_ = 0;
+  time_ = NowMs() - start;
+  return 0;
+}
+
+template <typename T>
+int Snapshot<T>::Load(const std::string &file) {
+  double start = NowMs();
+  Collect();
+  DataManager<T> *data_manager = DataManager<T>::GetInstance();
+  std::map<std::string, const Tensor *> by_name;
+  for (auto &tensor : tensors_)
+    by_name[tensor.name_] = &tensor;
+
+  int fd = open(file.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "Cannot open " << file;
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0) << "Cannot stat " << file;
+  size_t size = st.st_size;
+  void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  CHECK(addr != MAP_FAILED) << "Cannot map " << file;
+  // Payloads are read front to back, once
+  madvise(addr, size, MADV_SEQUENTIAL);
+  const unsigned char *base = static_cast<const unsigned char *>(addr);
+
+  HeaderReader reader(base, size, file);
+  CHECK_EQ(memcmp(reader.Take(sizeof(kMagic)), kMagic, sizeof(kMagic)), 0)
+    << file << " is not a DNNMark snapshot";
+  CHECK_EQ(reader.Get<unsigned int>(), static_cast<unsigned int>(kVersion))
+    << file << ": unsupported snapshot version";
+  unsigned int num_tensors = reader.Get<unsigned int>();
+
+  num_tensors_ = 0;
+  num_skipped_ = 0;
+  bytes_ = 0;
+  for (unsigned int i = 0; i < num_tensors; i++) {
+    unsigned int name_length = reader.Get<unsigned int>();
+    std::string name(
+      reinterpret_cast<const char *>(reader.Take(name_length)), name_length);
+    unsigned int dtype = reader.Get<unsigned int>();
+    unsigned int rank = reader.Get<unsigned int>();
+    unsigned long long count = 1;
+    for (unsigned int j = 0; j < rank; j++)
+      count *= reader.Get<unsigned long long>();
+    unsigned long long offset = reader.Get<unsigned long long>();
+    unsigned long long bytes = reader.Get<unsigned long long>();
+    CHECK_LE(offset + bytes, size) << file << ": " << name << " truncated";
+
+    auto it = by_name.find(name);
+    if (it == by_name.end()) {
+      LOG(WARNING) << file << ": " << name << " is not in the model";
+      num_skipped_++;
+      continue;
+    }
+    Data<T> *data = data_manager->GetData(it->second->chunk_id_);
+    CHECK_EQ(dtype, static_cast<unsigned int>(DataType<T>::type))
+      << file << ": " << name << " has another data type";
+    CHECK_EQ(count, static_cast<unsigned long long>(data->getSize()))
+      << file << ": " << name << " has another shape";
+    CHECK_EQ(bytes, count * sizeof(T));
+    CUDA_CALL(cudaMemcpy(data->Get(), base + offset, bytes,
+                         cudaMemcpyHostToDevice));
+    num_tensors_++;
+    bytes_ += bytes;
+  }
+  if (num_tensors_ < static_cast<int>(tensors_.size()))
+    LOG(WARNING) << file << ": " << tensors_.size() - num_tensors_
+                 << " tensors of the model keep their random data";
+
+  munmap(addr, size);
+  close(fd);
+  time_ = NowMs() - start;
+  return 0;
+}
+
+template <typename T>
+void Snapshot<T>::Report() {
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "[Snapshot] " << num_tensors_ << " tensors, "
+            << bytes_ / (1024.0 * 1024.0) << " MB in " << time_ << " ms";
+  if (num_skipped_ > 0)
+    std::cout << ", " << num_skipped_ << " unknown tensors skipped";
+  std::cout << std::endl;
+  std::cout << std::defaultfloat;
+}
+
+// Explicit instantiation
+template class Snapshot<TestType>;
+
+} // namespace dnnmark
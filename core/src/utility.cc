@@ -20,6 +20,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <cstdlib>
 #include <glog/logging.h>
 #include "utility.h"
 
@@ -55,6 +56,51 @@ void SplitStr(const std::string &s, std::string *var, std::string *val,
   TrimStr(val);
 }
 
+void SplitList(const std::string &s, std::vector<std::string> *items,
+               char delimiter) {
+  items->clear();
+  std::size_t begin = 0;
+  while (true) {
+    std::size_t pos = s.find(delimiter, begin);
+    std::string item = s.substr(begin, pos == std::string::npos ?
+                                       std::string::npos : pos - begin);
+    TrimStr(&item);
+    LOG_IF(FATAL, item.empty()) << "Empty item in list: " << s;
+    items->push_back(item);
+    if (pos == std::string::npos)
+      break;
+    begin = pos + 1;
+  }
+}
+
+bool isSweepValue(const std::string &s) {
+  return s.find(',') != std::string::npos ||
+         s.find(':') != std::string::npos;
+}
+
+void ExpandSweepValue(const std::string &s, std::vector<std::string> *values) {
+  if (s.find(':') == std::string::npos) {
+    SplitList(s, values);
+    return;
+  }
+  std::vector<std::string> bounds;
+  SplitList(s, &bounds, ':');
+  LOG_IF(FATAL, bounds.size() < 2 || bounds.size() > 3)
+    << "Range needs begin:end[:step]: " << s;
+  std::vector<long> numbers;
+  for (auto &bound : bounds) {
+    char *end;
+    numbers.push_back(strtol(bound.c_str(), &end, 10));
+    LOG_IF(FATAL, *end != '\0') << "Range bounds must be integers: " << s;
+  }
+  long step = numbers.size() == 3 ? numbers[2] : 1;
+  LOG_IF(FATAL, step <= 0 || numbers[1] < numbers[0])
+    << "Empty range: " << s;
+  values->clear();
+  for (long v = numbers[0]; v <= numbers[1]; v += step)
+    values->push_back(std::to_string(v));
+}
+
 bool isCommentStr(const std::string &s, char comment_marker) {
   std::string local_s = s;
   TrimStr(&local_s);
@@ -0,0 +1,152 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2016 Northeastern University
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in 
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <limits>
+#include <iomanip>
+
+#include "workspace_planner.h"
+
+namespace dnnmark {
+
+//
+// WorkspacePlanner class definition
+//
+
+template <typename T>
+WorkspacePlanner<T>::WorkspacePlanner(DNNMark<T> *p_dnnmark)
+: p_dnnmark_(p_dnnmark), budget_(p_dnnmark->getWorkspaceBudget()),
+  feasible_(true) {
+  CHECK_GT(budget_, 0);
+}
+
+template <typename T>
+int WorkspacePlanner<T>::Plan() {
+  choices_.clear();
+  for (int i = 0; i < p_dnnmark_->getNumLayers(); i++) {
+    Layer<T> *layer = p_dnnmark_->GetLayerByID(i);
+    if (layer->getLayerType() != CONVOLUTION)
+      continue;
+    ConvolutionLayer<T> *conv = dynamic_cast<ConvolutionLayer<T> *>(layer);
+    for (int d = 0; d < NUM_CONV_DIRECTIONS; d++) {
+      ConvDirection direction = static_cast<ConvDirection>(d);
+      // Backward directions are not set up in inference
+      if (conv->getCandidates(direction).empty())
+        continue;
+      choices_.push_back({conv, direction, conv->getCandidates(direction), 0});
+    }
+  }
+
+  // Workspaces in budget units, rounded up
+  size_t unit = (budget_ + kBudgetSteps - 1) / kBudgetSteps;
+  int capacity = budget_ / unit;
+  auto units = [unit](size_t bytes) {
+    return static_cast<int>((bytes + unit - 1) / unit);
+  };
+
+  // best[b]: least time of the choices so far within b units, and
+  // picks[i][b] the candidate of choice i it was reached with
+  const float inf = std::numeric_limits<float>::infinity();
+  std::vector<float> best(capacity + 1, 0);
+  std::vector<std::vector<int>> picks(choices_.size(),
+                                      std::vector<int>(capacity + 1, -1));
+  for (size_t i = 0; i < choices_.size(); i++) {
+    std::vector<float> next(capacity + 1, inf);
+    auto &candidates = choices_[i].candidates_;
+    for (int b = 0; b <= capacity; b++) {
+      for (size_t c = 0; c < candidates.size(); c++) {
+        int w = units(candidates[c].workspace_size_);
+        if (w > b || best[b - w] == inf)
+          continue;
+        float time = best[b - w] + candidates[c].time_;
+        if (time < next[b]) {
+          next[b] = time;
+          picks[i][b] = c;
+        }
+      }
+    }
+    best.swap(next);
+  }
+
+  feasible_ = choices_.empty() || best[capacity] != inf;
+  if (feasible_) {
+    int b = capacity;
+    for (int i = choices_.size() - 1; i >= 0; i--) {
+      choices_[i].chosen_ = picks[i][b];
+      b -= units(choices_[i].candidates_[choices_[i].chosen_].workspace_size_);
+    }
+  } else {
+    LOG(WARNING) << "Convolution workspaces do not fit the budget of "
+                 << budget_ << " bytes, using the smallest ones";
+    for (auto &choice : choices_) {
+      for (size_t c = 0; c < choice.candidates_.size(); c++)
+        if (choice.candidates_[c].workspace_size_ <
+            choice.candidates_[choice.chosen_].workspace_size_)
+          choice.chosen_ = c;
+    }
+  }
+
+  for (auto &choice : choices_)
+    choice.layer_->SetAlgorithm(choice.direction_,
+                                choice.candidates_[choice.chosen_].algo_);
+  return 0;
+}
+
+template <typename T>
+void WorkspacePlanner<T>::Report() {
+  const double MB = 1024.0 * 1024.0;
+  size_t used = 0, unconstrained = 0;
+  float time = 0, fastest_time = 0;
+  int num_downgraded = 0;
+  for (auto &choice : choices_) {
+    const AlgoCandidate &chosen = choice.candidates_[choice.chosen_];
+    const AlgoCandidate &fastest = choice.candidates_[0];
+    used += chosen.workspace_size_;
+    unconstrained += fastest.workspace_size_;
+    time += chosen.time_;
+    fastest_time += fastest.time_;
+    if (choice.chosen_ == 0)
+      continue;
+    num_downgraded++;
+    std::cout << std::fixed << std::setprecision(3)
+              << "[Workspace Planner] " << choice.layer_->getLayerName()
+              << " " << ConvDirectionName(choice.direction_)
+              << ": algorithm " << fastest.algo_ << " -> " << chosen.algo_
+              << ", workspace " << fastest.workspace_size_ / MB << " -> "
+              << chosen.workspace_size_ / MB << " MB, time "
+              << fastest.time_ << " -> " << chosen.time_ << " ms (+"
+              << chosen.time_ - fastest.time_ << " ms)"
+              << std::defaultfloat << std::endl;
+  }
+  std::cout << std::fixed << std::setprecision(3)
+            << "[Workspace Planner] Total: " << num_downgraded << " of "
+            << choices_.size() << " choices downgraded, workspace "
+            << used / MB << " of " << budget_ / MB << " MB"
+            << " (" << unconstrained / MB << " MB unconstrained), time "
+            << time << " ms (+" << time - fastest_time << " ms)"
+            << (feasible_ ? "" : ", over budget")
+            << std::defaultfloat << std::endl;
+}
+
+// Explicit instantiation
+template class WorkspacePlanner<TestType>;
+
+} // namespace dnnmark